@@ -163,6 +163,40 @@ VLC_API block_t *block_Init(block_t *block,
  */
 VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
+/**
+ * Block recycling pool statistics.
+ */
+struct block_pool_stats
+{
+    uint64_t hits; /**< Allocations served from the pool */
+    uint64_t misses; /**< Pool-eligible allocations served by the heap */
+    uint64_t recycled; /**< Blocks returned to the pool on release */
+    uint64_t dropped; /**< Pool blocks freed because the pool was full */
+};
+
+/**
+ * Enables or disables the block recycling pool.
+ *
+ * When enabled, block_Alloc() rounds small and medium allocations up to a
+ * size class, and block_Release() keeps the released buffers in per-thread
+ * caches for reuse instead of freeing them.
+ *
+ * This is process-wide. Blocks allocated while the pool was enabled remain
+ * valid after it is disabled.
+ *
+ * @param enable whether to recycle blocks
+ */
+VLC_API void block_PoolEnable(bool enable);
+
+/**
+ * Gets the block recycling pool statistics.
+ *
+ * The counters are cumulative since the process started.
+ *
+ * @param stats structure to fill [OUT]
+ */
+VLC_API void block_PoolGetStats(struct block_pool_stats *stats);
+
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
 /**
@@ -254,10 +288,12 @@ VLC_API block_t *block_heap_Alloc(void *, size_t) VLC_USED VLC_MALLOC;
  * This is provided by LibVLC so that mmap blocks can safely be deallocated
  * even after the allocating plugin has been unloaded from memory.
  *
- * @param addr base address of the mapping (as returned by mmap)
- * @param length length (bytes) of the mapping (as passed to mmap)
+ * @param addr base address of the mapping (as returned by mmap), or an
+ * address within its first page
+ * @param length length (bytes) of the mapping from addr
  * @return NULL if addr is MAP_FAILED, or an error occurred (in the later
- * case, munmap(addr, length) is invoked before returning).
+ * case, the pages spanning addr to addr + length are unmapped before
+ * returning).
  */
 VLC_API block_t *block_mmap_Alloc(void *addr, size_t length) VLC_USED VLC_MALLOC;
 
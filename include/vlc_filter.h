@@ -513,5 +513,50 @@ VLC_API int filter_chain_MouseFilter( filter_chain_t *, struct vlc_mouse_t *,
 int filter_chain_ForEach( filter_chain_t *chain,
                           int (*cb)( filter_t *, void * ), void *opaque );
 
+/**
+ * Pool of threads processing video filters slices.
+ *
+ * Filters that can split their processing in independent ranges of lines
+ * (or of planes) hold a reference to the pool when opening, and run each
+ * picture through vlc_filter_slices_Run(). The pool threads are shared by
+ * the filters of a same parent object, i.e. of a same video output or
+ * transcoding stream, which run one after the other.
+ */
+typedef struct vlc_filter_slices vlc_filter_slices_t;
+
+/**
+ * Holds a reference to the slices pool of the parent of a filter.
+ *
+ * \param obj filter, also used to read the "video-filter-threads" option
+ * \return the pool, or NULL if slice threading is disabled or unavailable,
+ * in which case vlc_filter_slices_Run() processes on the calling thread
+ */
+VLC_API vlc_filter_slices_t *vlc_filter_slices_Hold(vlc_object_t *obj);
+#define vlc_filter_slices_Hold(o) vlc_filter_slices_Hold(VLC_OBJECT(o))
+
+/**
+ * Releases a reference acquired with vlc_filter_slices_Hold().
+ */
+VLC_API void vlc_filter_slices_Release(vlc_filter_slices_t *pool);
+
+/**
+ * Splits [0, count) in ranges and processes them in parallel.
+ *
+ * The callback is invoked once per range, from the pool threads and from
+ * the calling thread, and must only write data owned by its range.
+ * This function returns once all the ranges have been processed.
+ * If the pool is NULL or busy with another filter, all the ranges are
+ * processed by the calling thread.
+ *
+ * \param pool pool from vlc_filter_slices_Hold() or NULL
+ * \param count number of units (usually lines) to process
+ * \param cb callback processing the units [start, end)
+ * \param opaque callback data
+ */
+VLC_API void vlc_filter_slices_Run(vlc_filter_slices_t *pool, unsigned count,
+                                   void (*cb)(void *opaque, unsigned start,
+                                              unsigned end),
+                                   void *opaque);
+
 /** @} */
 #endif /* _VLC_FILTER_H */
@@ -513,6 +513,8 @@ struct input_stats_t
     float f_demux_bitrate;
     int64_t i_demux_corrupted;
     int64_t i_demux_discontinuity;
+    int64_t i_demux_probes;
+    vlc_tick_t i_demux_probe_time;
 
     /* Decoders */
     int64_t i_decoded_audio;
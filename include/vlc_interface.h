@@ -91,6 +91,19 @@ VLC_API int intf_Create( libvlc_int_t *, const char * );
 
 VLC_API void libvlc_Quit( libvlc_int_t * );
 
+/**
+ * Registers a callback for the LibVLC instance clean up.
+ *
+ * The callbacks are invoked in reverse registration order, once the
+ * interfaces, the playlist and the preparser are destroyed, but before the
+ * logger and the plugins are. This is meant for plugins keeping resources
+ * beyond the lifetime of the objects using them.
+ *
+ * \return VLC_SUCCESS or VLC_ENOMEM
+ */
+VLC_API int libvlc_AddCleanupHandler( libvlc_int_t *,
+                                      void (*handler)(void *), void *opaque );
+
 /**
  * Recover the main playlist from an interface module
  *
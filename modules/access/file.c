@@ -51,6 +51,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -65,10 +68,17 @@
 typedef struct
 {
     int fd;
+#ifdef HAVE_MMAP
+    uint64_t offset; /* file position in memory mapped mode */
+    uint64_t page_mask;
+#endif
 
     bool b_pace_control;
 } access_sys_t;
 
+/* Size of the memory mapped blocks, and of the read ahead */
+#define MMAP_WINDOW (1 << 20)
+
 #if !defined (_WIN32) && !defined (__OS2__)
 static bool IsRemote (int fd)
 {
@@ -124,9 +134,16 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t Read (stream_t *, void *, size_t);
 static int FileSeek (stream_t *, uint64_t);
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *, bool *);
+static int MmapSeek (stream_t *, uint64_t);
+#endif
 static int FileControl (stream_t *, int, va_list);
 
 /*****************************************************************************
@@ -228,6 +245,22 @@ int FileOpen( vlc_object_t *p_this )
             fcntl (fd, F_RDAHEAD, 0);
         else
             fcntl (fd, F_RDAHEAD, 1);
+#endif
+#ifdef HAVE_MMAP
+        /* Hand out the page cache directly as blocks. Remote files are
+         * excluded since a truncation by another host would raise SIGBUS. */
+        if (S_ISREG (st.st_mode)
+         && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote(fd, p_access->psz_filepath))
+        {
+            p_access->pf_read = NULL;
+            p_access->pf_block = MmapBlock;
+            p_access->pf_seek = MmapSeek;
+            p_sys->offset = 0;
+            p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+            posix_fadvise (fd, 0, MMAP_WINDOW, POSIX_FADV_WILLNEED);
+            msg_Dbg (p_access, "using memory mapped blocks");
+        }
 #endif
     }
     else
@@ -250,7 +283,7 @@ void FileClose (vlc_object_t * p_this)
 {
     stream_t     *p_access = (stream_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_readdir != NULL)
     {
         DirClose (p_this);
         return;
@@ -284,6 +317,66 @@ static ssize_t Read (stream_t *p_access, void *p_buffer, size_t i_len)
     return val;
 }
 
+#ifdef HAVE_MMAP
+static block_t *MmapBlock (stream_t *p_access, bool *restrict eof)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    struct stat st;
+
+    /* The file may be growing (or shrinking) while it is being read */
+    if (fstat (p_sys->fd, &st))
+    {
+        msg_Err (p_access, "read error: %s", vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    if ((uint64_t)st.st_size <= p_sys->offset)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    uint64_t left = st.st_size - p_sys->offset;
+    size_t length = (left < MMAP_WINDOW) ? left : MMAP_WINDOW;
+    /* Mappings must start on a page boundary */
+    uint64_t start = p_sys->offset & ~p_sys->page_mask;
+    size_t skip = p_sys->offset - start;
+
+    void *addr = mmap (NULL, skip + length, PROT_READ, MAP_SHARED,
+                       p_sys->fd, start);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping error: %s",
+                 vlc_strerror_c(errno));
+        *eof = true;
+        return NULL;
+    }
+
+    /* Fault in the current window, and read ahead the next one */
+    posix_madvise (addr, skip + length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, skip + length, POSIX_MADV_WILLNEED);
+    posix_fadvise (p_sys->fd, p_sys->offset + length, MMAP_WINDOW,
+                   POSIX_FADV_WILLNEED);
+
+    block_t *block = block_mmap_Alloc ((uint8_t *)addr + skip, length);
+    if (unlikely(block == NULL))
+        return NULL;
+
+    p_sys->offset += length;
+    return block;
+}
+
+static int MmapSeek (stream_t *p_access, uint64_t i_pos)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+
+    p_sys->offset = i_pos;
+    posix_fadvise (p_sys->fd, i_pos, MMAP_WINDOW, POSIX_FADV_WILLNEED);
+    return VLC_SUCCESS;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
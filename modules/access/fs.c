@@ -40,6 +40,10 @@ vlc_module_begin ()
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( FileOpen, FileClose )
 
+    add_bool("file-mmap", false, N_("Memory mapped file input"),
+             N_("Read local files by mapping them in memory instead of "
+                "copying their content, with sequential read ahead."), true)
+
     add_submodule()
     set_section( N_("Directory" ), NULL )
     set_capability( "access", 55 )
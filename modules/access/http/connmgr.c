@@ -24,6 +24,11 @@
 
 #include <assert.h>
 #include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_interface.h>
+#include <vlc_list.h>
+#include <vlc_memstream.h>
+#include <vlc_modules.h>
 #include <vlc_network.h>
 #include <vlc_tls.h>
 #include <vlc_url.h>
@@ -96,41 +101,470 @@ static char *vlc_http_proxy_find(const char *hostname, unsigned port,
 }
 
 
-struct vlc_http_mgr
+/*
+ * Connections pool
+ *
+ * Connections are shared by all the managers of a LibVLC instance, keyed by
+ * scheme, server, proxy and TLS options. An HTTP/2 connection carries the
+ * streams of any number of managers, while an HTTP/1.x connection is used by
+ * one manager at a time and kept idle in between. Idle connections are closed
+ * after a while, whether managers are left or not. The pool itself lasts
+ * until the instance is cleaned up.
+ */
+#define VLC_HTTP_POOL_IDLE_MAX 16
+#ifndef VLC_HTTP_POOL_IDLE_TIMEOUT
+# define VLC_HTTP_POOL_IDLE_TIMEOUT VLC_TICK_FROM_SEC(30)
+#endif
+
+/** TLS credentials, one per set of TLS client options */
+struct vlc_http_pool_creds
 {
-    struct vlc_logger *logger;
-    vlc_object_t *obj;
+    struct vlc_list node;
+    vlc_object_t *obj; /**< holds a copy of the options */
     vlc_tls_client_t *creds;
-    struct vlc_http_cookie_jar_t *jar;
+    char *options;
+};
+
+struct vlc_http_pool_conn
+{
+    struct vlc_list node;
     struct vlc_http_conn *conn;
+    const struct vlc_http_pool_creds *creds; /**< NULL if not secure */
+    char *host;
+    char *proxy;
+    unsigned port;
+    bool http2;
+    bool failed; /**< not to be used for new requests */
+    unsigned users; /**< number of managers using the connection */
+    vlc_tick_t idle_since;
+};
+
+struct vlc_http_pool
+{
+    struct vlc_list node;
+    libvlc_int_t *libvlc;
+    struct vlc_logger *logger;
+    vlc_timer_t timer; /**< closes expired idle connections */
+    struct vlc_list creds;
+    struct vlc_list conns;
+    unsigned long requests;
+    unsigned long reused;
 };
 
-static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
-                                               const char *host, unsigned port)
+static vlc_mutex_t vlc_http_pools_lock = VLC_STATIC_MUTEX;
+static struct vlc_list vlc_http_pools = VLC_LIST_INITIALIZER(&vlc_http_pools);
+
+static void vlc_http_pool_conn_delete(struct vlc_http_pool_conn *pc)
 {
-    (void) host; (void) port;
-    return mgr->conn;
+    vlc_http_conn_release(pc->conn);
+    free(pc->proxy);
+    free(pc->host);
+    free(pc);
 }
 
-static void vlc_http_mgr_release(struct vlc_http_mgr *mgr,
-                                 struct vlc_http_conn *conn)
+/* Detaches the connections to close, and schedules the next expiry.
+ * Must be called with the lock held. */
+static void vlc_http_pool_prune(struct vlc_http_pool *pool,
+                                struct vlc_list *restrict dead)
 {
-    assert(mgr->conn == conn);
-    mgr->conn = NULL;
+    vlc_tick_t now = vlc_tick_now();
+    vlc_tick_t oldest = VLC_TICK_INVALID;
+    struct vlc_http_pool_conn *pc;
+    unsigned idle = 0;
 
-    vlc_http_conn_release(conn);
+    vlc_list_foreach(pc, &pool->conns, node)
+        if (pc->users == 0)
+            idle++;
+
+    /* Least recently used connections come first */
+    vlc_list_foreach(pc, &pool->conns, node)
+    {
+        if (pc->users > 0)
+            continue;
+
+        if (pc->failed || pc->conn->tls == NULL
+         || now - pc->idle_since >= VLC_HTTP_POOL_IDLE_TIMEOUT
+         || idle > VLC_HTTP_POOL_IDLE_MAX)
+        {
+            vlc_list_remove(&pc->node);
+            vlc_list_append(&pc->node, dead);
+            idle--;
+        }
+        else if (oldest == VLC_TICK_INVALID || pc->idle_since < oldest)
+            oldest = pc->idle_since;
+    }
+
+    if (oldest != VLC_TICK_INVALID)
+        vlc_timer_schedule(pool->timer, true,
+                           oldest + VLC_HTTP_POOL_IDLE_TIMEOUT,
+                           VLC_TIMER_FIRE_ONCE);
+    else
+        vlc_timer_disarm(pool->timer);
 }
 
-static
-struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
-                                        const char *host, unsigned port,
-                                        const struct vlc_http_msg *req)
+static void vlc_http_pool_close(struct vlc_list *dead)
+{
+    struct vlc_http_pool_conn *pc;
+
+    vlc_list_foreach(pc, dead, node)
+        vlc_http_pool_conn_delete(pc);
+}
+
+static void vlc_http_pool_expire(void *data)
+{
+    struct vlc_http_pool *pool = data;
+    struct vlc_list dead;
+
+    vlc_list_init(&dead);
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    vlc_http_pool_prune(pool, &dead);
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+
+    vlc_http_pool_close(&dead);
+}
+
+/* Invoked when the LibVLC instance is cleaned up */
+static void vlc_http_pool_destroy(void *data)
+{
+    struct vlc_http_pool *pool = data;
+
+    vlc_timer_destroy(pool->timer);
+
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    vlc_list_remove(&pool->node);
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+
+    if (pool->requests > 0)
+        vlc_http_dbg(pool->logger, "%lu of %lu requests on reused connections",
+                     pool->reused, pool->requests);
+
+    struct vlc_http_pool_conn *pc;
+
+    vlc_list_foreach(pc, &pool->conns, node)
+    {
+        assert(pc->users == 0);
+        vlc_http_pool_conn_delete(pc);
+    }
+
+    struct vlc_http_pool_creds *c;
+
+    vlc_list_foreach(c, &pool->creds, node)
+    {
+        vlc_tls_ClientDelete(c->creds);
+        vlc_object_delete(c->obj);
+        free(c->options);
+        free(c);
+    }
+    free(pool);
+}
+
+static struct vlc_http_pool *vlc_http_pool_lookup(vlc_object_t *obj)
+{
+    libvlc_int_t *libvlc = vlc_object_instance(obj);
+    struct vlc_http_pool *pool;
+
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    vlc_list_foreach(pool, &vlc_http_pools, node)
+        if (pool->libvlc == libvlc)
+            goto out;
+
+    pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+        goto out;
+
+    pool->libvlc = libvlc;
+    pool->logger = VLC_OBJECT(libvlc)->logger;
+    vlc_list_init(&pool->creds);
+    vlc_list_init(&pool->conns);
+    pool->requests = 0;
+    pool->reused = 0;
+
+    if (vlc_timer_create(&pool->timer, vlc_http_pool_expire, pool))
+    {
+        free(pool);
+        pool = NULL;
+        goto out;
+    }
+
+    if (libvlc_AddCleanupHandler(libvlc, vlc_http_pool_destroy, pool))
+    {
+        vlc_timer_destroy(pool->timer);
+        free(pool);
+        pool = NULL;
+        goto out;
+    }
+    vlc_list_append(&pool->node, &vlc_http_pools);
+out:
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+    return pool;
+}
+
+/**
+ * Gets the options of the TLS client modules as seen from an object.
+ *
+ * \param copy object to copy the options to as variables (or NULL)
+ * \return the options as a string, or NULL on error
+ */
+static char *vlc_http_tls_options(vlc_object_t *obj, vlc_object_t *copy)
 {
-    struct vlc_http_conn *conn = vlc_http_mgr_find(mgr, host, port);
-    if (conn == NULL)
+    struct vlc_memstream stream;
+
+    if (vlc_memstream_open(&stream))
         return NULL;
 
-    struct vlc_http_stream *stream = vlc_http_stream_open(conn, req);
+    size_t count;
+    module_t **mods = module_list_get(&count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!module_provides(mods[i], "tls client"))
+            continue;
+
+        unsigned size;
+        module_config_t *cfg = module_config_get(mods[i], &size);
+
+        for (unsigned j = 0; j < size; j++)
+        {
+            const char *name = cfg[j].psz_name;
+            int type = (name != NULL) ? config_GetType(name) : 0;
+            vlc_value_t val;
+
+            if (type == 0 || var_Inherit(obj, name, type, &val))
+                continue;
+
+            switch (type)
+            {
+                case VLC_VAR_STRING:
+                    vlc_memstream_printf(&stream, "%s=%s\n", name,
+                                         (val.psz_string != NULL)
+                                         ? val.psz_string : "");
+                    break;
+                case VLC_VAR_FLOAT:
+                    vlc_memstream_printf(&stream, "%s=%f\n", name,
+                                         val.f_float);
+                    break;
+                case VLC_VAR_BOOL:
+                    vlc_memstream_printf(&stream, "%s=%d\n", name,
+                                         val.b_bool);
+                    break;
+                default:
+                    vlc_memstream_printf(&stream, "%s=%"PRId64"\n", name,
+                                         val.i_int);
+                    break;
+            }
+
+            if (copy != NULL)
+            {
+                var_Create(copy, name, type);
+                var_Set(copy, name, val);
+            }
+            if (type == VLC_VAR_STRING)
+                free(val.psz_string);
+        }
+        module_config_free(cfg);
+    }
+    module_list_free(mods);
+
+    if (vlc_memstream_close(&stream))
+        return NULL;
+    return stream.ptr;
+}
+
+/**
+ * Gets the TLS credentials matching the options of an object.
+ *
+ * Credentials are created on a private object, as the pool outlives the
+ * objects of its managers, but with the options inherited by the object, so
+ * that the options of an input apply to its requests.
+ */
+static const struct vlc_http_pool_creds *
+vlc_http_pool_get_creds(struct vlc_http_pool *pool, vlc_object_t *obj)
+{
+    char *options = vlc_http_tls_options(obj, NULL);
+    if (unlikely(options == NULL))
+        return NULL;
+
+    struct vlc_http_pool_creds *c;
+
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    vlc_list_foreach(c, &pool->creds, node)
+        if (strcmp(c->options, options) == 0)
+        {
+            free(options);
+            goto out;
+        }
+
+    /* First TLS connection with these options: load x509 credentials */
+    c = malloc(sizeof (*c));
+    if (unlikely(c == NULL))
+        goto error;
+
+    c->obj = vlc_object_create(VLC_OBJECT(pool->libvlc), sizeof (*c->obj));
+    if (unlikely(c->obj == NULL))
+    {
+        free(c);
+        goto error;
+    }
+    free(vlc_http_tls_options(obj, c->obj));
+
+    c->creds = vlc_tls_ClientCreate(c->obj);
+    if (c->creds == NULL)
+    {
+        vlc_object_delete(c->obj);
+        free(c);
+        goto error;
+    }
+    c->options = options;
+    vlc_list_append(&c->node, &pool->creds);
+out:
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+    return c;
+error:
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+    free(options);
+    return NULL;
+}
+
+static bool vlc_http_pool_conn_match(const struct vlc_http_pool_conn *pc,
+                                     const struct vlc_http_pool_creds *creds,
+                                     const char *host, unsigned port,
+                                     const char *proxy)
+{
+    return pc->creds == creds && pc->port == port
+        && strcasecmp(pc->host, host) == 0
+        && (pc->proxy != NULL
+            ? proxy != NULL && strcmp(pc->proxy, proxy) == 0
+            : proxy == NULL);
+}
+
+/**
+ * Takes a connection from the pool, if any matches.
+ */
+static struct vlc_http_pool_conn *vlc_http_pool_get(struct vlc_http_pool *pool,
+                                const struct vlc_http_pool_creds *creds,
+                                const char *host, unsigned port,
+                                const char *proxy)
+{
+    struct vlc_http_pool_conn *pc, *found = NULL;
+    struct vlc_list dead;
+
+    vlc_list_init(&dead);
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    vlc_http_pool_prune(pool, &dead);
+
+    vlc_list_foreach(pc, &pool->conns, node)
+        if (!pc->failed && (pc->http2 || pc->users == 0)
+         && vlc_http_pool_conn_match(pc, creds, host, port, proxy))
+        {
+            found = pc;
+            found->users++;
+            break;
+        }
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+
+    vlc_http_pool_close(&dead);
+    return found;
+}
+
+/**
+ * Adds a new connection to the pool, used by the caller.
+ */
+static struct vlc_http_pool_conn *vlc_http_pool_add(struct vlc_http_pool *pool,
+                                struct vlc_http_conn *conn,
+                                const struct vlc_http_pool_creds *creds,
+                                const char *host, unsigned port,
+                                const char *proxy, bool http2)
+{
+    struct vlc_http_pool_conn *pc = malloc(sizeof (*pc));
+    if (unlikely(pc == NULL))
+        goto error;
+
+    pc->host = strdup(host);
+    pc->proxy = (proxy != NULL) ? strdup(proxy) : NULL;
+    if (unlikely(pc->host == NULL || (proxy != NULL && pc->proxy == NULL)))
+    {
+        free(pc->proxy);
+        free(pc->host);
+        free(pc);
+        goto error;
+    }
+
+    pc->conn = conn;
+    pc->creds = creds;
+    pc->port = port;
+    pc->http2 = http2;
+    pc->failed = false;
+    pc->users = 1;
+
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    vlc_list_append(&pc->node, &pool->conns);
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+    return pc;
+
+error:
+    vlc_http_conn_release(conn);
+    return NULL;
+}
+
+/**
+ * Gives a connection back to the pool.
+ */
+static void vlc_http_pool_put(struct vlc_http_pool *pool,
+                              struct vlc_http_pool_conn *pc, bool failed)
+{
+    struct vlc_list dead;
+
+    vlc_list_init(&dead);
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    assert(pc->users > 0);
+    if (failed)
+        pc->failed = true;
+    if (--pc->users == 0)
+    {
+        pc->idle_since = vlc_tick_now();
+        /* Keep the connections in least recently used order */
+        vlc_list_remove(&pc->node);
+        vlc_list_append(&pc->node, &pool->conns);
+    }
+    vlc_http_pool_prune(pool, &dead);
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+
+    vlc_http_pool_close(&dead);
+}
+
+static void vlc_http_pool_count(struct vlc_http_pool *pool, bool reused)
+{
+    vlc_mutex_lock(&vlc_http_pools_lock);
+    pool->requests++;
+    if (reused)
+        pool->reused++;
+    vlc_mutex_unlock(&vlc_http_pools_lock);
+}
+
+struct vlc_http_mgr
+{
+    struct vlc_logger *logger;
+    vlc_object_t *obj;
+    struct vlc_http_pool *pool;
+    const struct vlc_http_pool_creds *creds; /**< looked up on first use */
+    struct vlc_http_cookie_jar_t *jar;
+    struct vlc_http_pool_conn *conn;
+    unsigned long requests;
+    unsigned long reused;
+};
+
+static void vlc_http_mgr_release(struct vlc_http_mgr *mgr, bool failed)
+{
+    assert(mgr->conn != NULL);
+    vlc_http_pool_put(mgr->pool, mgr->conn, failed);
+    mgr->conn = NULL;
+}
+
+static struct vlc_http_msg *vlc_http_mgr_open(struct vlc_http_mgr *mgr,
+                                              const struct vlc_http_msg *req)
+{
+    struct vlc_http_stream *stream = vlc_http_stream_open(mgr->conn->conn,
+                                                          req);
     if (stream != NULL)
     {
         struct vlc_http_msg *m = vlc_http_msg_get_initial(stream);
@@ -143,41 +577,56 @@ struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
          * fine here). */
     }
     /* Get rid of closing or reset connection */
-    vlc_http_mgr_release(mgr, conn);
+    vlc_http_mgr_release(mgr, true);
     return NULL;
 }
 
+static
+struct vlc_http_msg *vlc_http_mgr_reuse(struct vlc_http_mgr *mgr,
+                                const struct vlc_http_pool_creds *creds,
+                                const char *host, unsigned port,
+                                const char *proxy,
+                                const struct vlc_http_msg *req)
+{
+    if (mgr->conn != NULL)
+    {
+        if (vlc_http_pool_conn_match(mgr->conn, creds, host, port, proxy))
+        {
+            struct vlc_http_msg *m = vlc_http_mgr_open(mgr, req);
+            if (m != NULL)
+                return m;
+        }
+        else
+            vlc_http_mgr_release(mgr, false);
+    }
+
+    /* Try the connections of other managers, until one works */
+    for (;;)
+    {
+        mgr->conn = vlc_http_pool_get(mgr->pool, creds, host, port, proxy);
+        if (mgr->conn == NULL)
+            return NULL;
+
+        struct vlc_http_msg *m = vlc_http_mgr_open(mgr, req);
+        if (m != NULL)
+            return m;
+    }
+}
+
 static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
                                               const char *host, unsigned port,
+                                              const char *proxy,
                                               const struct vlc_http_msg *req)
 {
+    vlc_tls_client_t *creds = mgr->creds->creds;
     vlc_tls_t *tls;
     bool http2 = true;
 
-    if (mgr->creds == NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTP to HTTPS not implemented */
-
-    if (mgr->creds == NULL)
-    {   /* First TLS connection: load x509 credentials */
-        mgr->creds = vlc_tls_ClientCreate(mgr->obj);
-        if (mgr->creds == NULL)
-            return NULL;
-    }
-
-    /* TODO? non-idempotent request support */
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
-    if (resp != NULL)
-        return resp; /* existing connection reused */
-
-    char *proxy = vlc_http_proxy_find(host, port, true);
     if (proxy != NULL)
-    {
-        tls = vlc_https_connect_proxy(mgr->creds, mgr->creds,
+        tls = vlc_https_connect_proxy(creds, creds,
                                       host, port, &http2, proxy);
-        free(proxy);
-    }
     else
-        tls = vlc_https_connect(mgr->creds, host, port, &http2);
+        tls = vlc_https_connect(creds, host, port, &http2);
 
     if (tls == NULL)
         return NULL;
@@ -192,9 +641,9 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
      * NOTE: We do not enforce TLS version 1.2 for HTTP 2.0 explicitly.
      */
     if (http2)
-        conn = vlc_h2_conn_create(mgr->logger, tls);
+        conn = vlc_h2_conn_create(mgr->pool->logger, tls);
     else
-        conn = vlc_h1_conn_create(mgr->logger, tls, false);
+        conn = vlc_h1_conn_create(mgr->pool->logger, tls, false);
 
     if (unlikely(conn == NULL))
     {
@@ -202,35 +651,31 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
         return NULL;
     }
 
-    mgr->conn = conn;
+    mgr->conn = vlc_http_pool_add(mgr->pool, conn, mgr->creds, host, port,
+                                  proxy,
+                                  http2);
+    if (unlikely(mgr->conn == NULL))
+        return NULL;
 
-    return vlc_http_mgr_reuse(mgr, host, port, req);
+    return vlc_http_mgr_open(mgr, req);
 }
 
 static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
                                              const char *host, unsigned port,
+                                             const char *proxy,
                                              const struct vlc_http_msg *req)
 {
-    if (mgr->creds != NULL && mgr->conn != NULL)
-        return NULL; /* switch from HTTPS to HTTP not implemented */
-
-    struct vlc_http_msg *resp = vlc_http_mgr_reuse(mgr, host, port, req);
-    if (resp != NULL)
-        return resp;
-
     struct vlc_http_conn *conn;
     struct vlc_http_stream *stream;
 
-    char *proxy = vlc_http_proxy_find(host, port, false);
     if (proxy != NULL)
     {
         vlc_url_t url;
 
         vlc_UrlParse(&url, proxy);
-        free(proxy);
 
         if (url.psz_host != NULL)
-            stream = vlc_h1_request(mgr->logger, url.psz_host,
+            stream = vlc_h1_request(mgr->pool->logger, url.psz_host,
                                     url.i_port ? url.i_port : 80, true, req,
                                     true, &conn);
         else
@@ -239,20 +684,26 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
         vlc_UrlClean(&url);
     }
     else
-        stream = vlc_h1_request(mgr->logger, host, port ? port : 80, false,
-                                req, true, &conn);
+        stream = vlc_h1_request(mgr->pool->logger, host, port ? port : 80,
+                                false, req, true, &conn);
 
     if (stream == NULL)
         return NULL;
 
-    resp = vlc_http_msg_get_initial(stream);
+    struct vlc_http_msg *resp = vlc_http_msg_get_initial(stream);
     if (resp == NULL)
     {
         vlc_http_conn_release(conn);
         return NULL;
     }
 
-    mgr->conn = conn;
+    mgr->conn = vlc_http_pool_add(mgr->pool, conn, NULL, host, port, proxy,
+                                  false);
+    if (unlikely(mgr->conn == NULL))
+    {
+        vlc_http_msg_destroy(resp);
+        return NULL;
+    }
     return resp;
 }
 
@@ -263,7 +714,39 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
     if (port && vlc_http_port_blocked(port))
         return NULL;
 
-    return (https ? vlc_https_request : vlc_http_request)(mgr, host, port, m);
+    const struct vlc_http_pool_creds *creds = NULL;
+
+    if (https)
+    {
+        if (mgr->creds == NULL)
+            mgr->creds = vlc_http_pool_get_creds(mgr->pool, mgr->obj);
+        if (mgr->creds == NULL)
+            return NULL;
+        creds = mgr->creds;
+    }
+
+    char *proxy = vlc_http_proxy_find(host, port, https);
+    struct vlc_http_msg *resp;
+    bool reused = true;
+
+    /* TODO? non-idempotent request support */
+    resp = vlc_http_mgr_reuse(mgr, creds, host, port, proxy, m);
+    if (resp == NULL)
+    {
+        reused = false;
+        resp = (https ? vlc_https_request : vlc_http_request)(mgr, host, port,
+                                                              proxy, m);
+    }
+    free(proxy);
+
+    if (resp != NULL)
+    {
+        mgr->requests++;
+        if (reused)
+            mgr->reused++;
+        vlc_http_pool_count(mgr->pool, reused);
+    }
+    return resp;
 }
 
 struct vlc_http_cookie_jar_t *vlc_http_mgr_get_jar(struct vlc_http_mgr *mgr)
@@ -278,19 +761,29 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     if (unlikely(mgr == NULL))
         return NULL;
 
+    mgr->pool = vlc_http_pool_lookup(obj);
+    if (unlikely(mgr->pool == NULL))
+    {
+        free(mgr);
+        return NULL;
+    }
+
     mgr->logger = obj->logger;
     mgr->obj = obj;
     mgr->creds = NULL;
     mgr->jar = jar;
     mgr->conn = NULL;
+    mgr->requests = 0;
+    mgr->reused = 0;
     return mgr;
 }
 
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr)
 {
+    if (mgr->requests > 0)
+        vlc_http_dbg(mgr->logger, "%lu of %lu requests on reused connections",
+                     mgr->reused, mgr->requests);
     if (mgr->conn != NULL)
-        vlc_http_mgr_release(mgr, mgr->conn);
-    if (mgr->creds != NULL)
-        vlc_tls_ClientDelete(mgr->creds);
+        vlc_http_mgr_release(mgr, false);
     free(mgr);
 }
@@ -58,6 +58,7 @@ struct vlc_http_cookie_jar_t *vlc_http_mgr_get_jar(struct vlc_http_mgr *);
  * Creates an HTTP connection manager
  *
  * Allocates an HTTP client connections manager.
+ * Connections are pooled with the other managers of the same LibVLC instance.
  *
  * @param obj parent VLC object
  * @param jar HTTP cookies jar (NULL to disable cookies)
@@ -69,7 +70,12 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
  * Destroys an HTTP connection manager
  *
  * Deallocates an HTTP client connections manager created by
- * vlc_http_msg_destroy(). Any remaining connection is closed and destroyed.
+ * vlc_http_msg_destroy(). Any remaining connection is given back to the pool,
+ * so all HTTP messages obtained from the manager must have been destroyed.
+ * Idle pooled connections are kept after the last manager is destroyed, so
+ * that a later manager can reuse them. They are closed once they have been
+ * idle for VLC_HTTP_POOL_IDLE_TIMEOUT, or at the latest when the LibVLC
+ * instance is released.
  */
 void vlc_http_mgr_destroy(struct vlc_http_mgr *mgr);
 
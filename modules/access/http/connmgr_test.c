@@ -0,0 +1,491 @@
+/*****************************************************************************
+ * connmgr_test.c: HTTP connections pool tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_configuration.h>
+#include <vlc_interface.h>
+#include <vlc_modules.h>
+#include <vlc_network.h>
+#include <vlc_tls.h>
+#include "transport.h"
+#include "conn.h"
+#include "connmgr.h"
+#include "message.h"
+
+const char vlc_module_name[] = "test_http_connmgr";
+
+/* The pool is built with a short VLC_HTTP_POOL_IDLE_TIMEOUT, see Makefile.am */
+
+/* Fake connections */
+struct test_conn
+{
+    struct vlc_http_conn conn;
+    const char *host;
+    unsigned port;
+    vlc_tls_client_t *creds; /* NULL if not secure */
+    bool http2;
+    bool broken;
+    bool closed;
+};
+
+static struct test_conn conns[64];
+static unsigned conn_count, conn_live;
+static struct test_conn *last_conn;
+/* connections are also closed by the pool timer */
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static vlc_cond_t released = VLC_STATIC_COND;
+
+static vlc_tls_t fake_tls;
+static struct vlc_http_stream fake_stream;
+static char fake_response;
+static bool alpn_h2;
+
+static struct vlc_http_stream *stream_open(struct vlc_http_conn *c,
+                                           const struct vlc_http_msg *req)
+{
+    struct test_conn *tc = container_of(c, struct test_conn, conn);
+
+    (void) req;
+    assert(!tc->closed);
+    if (tc->broken)
+        return NULL;
+
+    last_conn = tc;
+    return &fake_stream;
+}
+
+static void conn_release(struct vlc_http_conn *c)
+{
+    struct test_conn *tc = container_of(c, struct test_conn, conn);
+
+    vlc_mutex_lock(&lock);
+    assert(!tc->closed);
+    tc->closed = true;
+    assert(conn_live > 0);
+    conn_live--;
+    vlc_cond_broadcast(&released);
+    vlc_mutex_unlock(&lock);
+}
+
+static const struct vlc_http_conn_cbs conn_callbacks =
+{
+    stream_open,
+    conn_release,
+};
+
+static struct test_conn *conn_new(const char *host, unsigned port,
+                                  vlc_tls_client_t *creds, bool http2)
+{
+    assert(conn_count < ARRAY_SIZE(conns));
+
+    struct test_conn *tc = &conns[conn_count++];
+
+    tc->conn.cbs = &conn_callbacks;
+    tc->conn.tls = &fake_tls;
+    tc->host = host;
+    tc->port = port;
+    tc->creds = creds;
+    tc->http2 = http2;
+    tc->broken = false;
+    tc->closed = false;
+    vlc_mutex_lock(&lock);
+    conn_live++;
+    vlc_mutex_unlock(&lock);
+    return tc;
+}
+
+/* Transport */
+static const char *tls_host;
+static unsigned tls_port;
+static vlc_tls_client_t *tls_creds;
+
+vlc_tls_t *vlc_tls_SocketOpenTLS(vlc_tls_client_t *creds, const char *name,
+                                 unsigned port, const char *service,
+                                 const char *const *alpn, char **alp)
+{
+    assert(!strcmp(service, "https"));
+    assert(alpn != NULL);
+    tls_host = name;
+    tls_port = port;
+    tls_creds = creds;
+    *alp = alpn_h2 ? strdup("h2") : NULL;
+    return &fake_tls;
+}
+
+vlc_tls_t *vlc_https_connect_proxy(void *ctx, vlc_tls_client_t *creds,
+                                   const char *name, unsigned port,
+                                   bool *restrict two, const char *proxy)
+{
+    (void) ctx; (void) creds; (void) name; (void) port; (void) two;
+    (void) proxy;
+    assert(!"unexpected proxy");
+    return NULL;
+}
+
+char *vlc_getProxyUrl(const char *url)
+{
+    (void) url;
+    return NULL;
+}
+
+struct vlc_http_conn *vlc_h1_conn_create(void *ctx, vlc_tls_t *tls,
+                                         bool proxy)
+{
+    (void) ctx;
+    assert(tls == &fake_tls);
+    assert(!proxy);
+    return &conn_new(tls_host, tls_port, tls_creds, false)->conn;
+}
+
+struct vlc_http_conn *vlc_h2_conn_create(void *ctx, vlc_tls_t *tls)
+{
+    (void) ctx;
+    assert(tls == &fake_tls);
+    return &conn_new(tls_host, tls_port, tls_creds, true)->conn;
+}
+
+struct vlc_http_stream *vlc_h1_request(void *ctx, const char *hostname,
+                                       unsigned port, bool proxy,
+                                       const struct vlc_http_msg *req,
+                                       bool idempotent,
+                                       struct vlc_http_conn **restrict connp)
+{
+    (void) ctx; (void) req;
+    assert(!proxy);
+    assert(idempotent);
+
+    last_conn = conn_new(hostname, port, NULL, false);
+    *connp = &last_conn->conn;
+    return &fake_stream;
+}
+
+struct vlc_http_msg *vlc_http_msg_get_initial(struct vlc_http_stream *s)
+{
+    assert(s == &fake_stream);
+    return (struct vlc_http_msg *)&fake_response;
+}
+
+void vlc_http_msg_destroy(struct vlc_http_msg *m)
+{
+    assert(m == (struct vlc_http_msg *)&fake_response);
+}
+
+/* TLS credentials: a single fake TLS client module with a single option */
+static char fake_module;
+static module_config_t fake_config[] = {
+    { .psz_name = "test-tls-ca" },
+};
+
+static struct
+{
+    vlc_tls_client_t *creds;
+    char *ca;
+    bool deleted;
+} creds[8];
+static unsigned creds_count;
+
+module_t **module_list_get(size_t *n)
+{
+    module_t **tab = malloc(sizeof (*tab));
+    assert(tab != NULL);
+    tab[0] = (module_t *)&fake_module;
+    *n = 1;
+    return tab;
+}
+
+void module_list_free(module_t **tab)
+{
+    free(tab);
+}
+
+bool module_provides(const module_t *m, const char *cap)
+{
+    assert(m == (module_t *)&fake_module);
+    return !strcmp(cap, "tls client");
+}
+
+module_config_t *module_config_get(const module_t *m, unsigned *restrict n)
+{
+    assert(m == (module_t *)&fake_module);
+    *n = ARRAY_SIZE(fake_config);
+    return fake_config;
+}
+
+void module_config_free(module_config_t *tab)
+{
+    assert(tab == fake_config);
+}
+
+int config_GetType(const char *name)
+{
+    return strcmp(name, "test-tls-ca") ? 0 : VLC_VAR_STRING;
+}
+
+vlc_tls_client_t *vlc_tls_ClientCreate(vlc_object_t *obj)
+{
+    assert(creds_count < ARRAY_SIZE(creds));
+
+    unsigned i = creds_count++;
+
+    creds[i].creds = malloc(1);
+    assert(creds[i].creds != NULL);
+    /* the options are seen on the object of the credentials */
+    creds[i].ca = var_InheritString(obj, "test-tls-ca");
+    creds[i].deleted = false;
+    return creds[i].creds;
+}
+
+void vlc_tls_ClientDelete(vlc_tls_client_t *crd)
+{
+    for (unsigned i = 0; i < creds_count; i++)
+        if (creds[i].creds == crd)
+        {
+            assert(!creds[i].deleted);
+            creds[i].deleted = true;
+            free(creds[i].creds);
+            free(creds[i].ca);
+            return;
+        }
+    assert(!"unknown credentials");
+}
+
+/* LibVLC clean up */
+static void (*cleanup_handler)(void *);
+static void *cleanup_opaque;
+
+int libvlc_AddCleanupHandler(libvlc_int_t *libvlc, void (*handler)(void *),
+                             void *opaque)
+{
+    (void) libvlc;
+    assert(cleanup_handler == NULL);
+    cleanup_handler = handler;
+    cleanup_opaque = opaque;
+    return 0;
+}
+
+static char fake_request;
+static const struct vlc_http_msg *const fake_req =
+    (const struct vlc_http_msg *)&fake_request;
+
+static struct test_conn *request(struct vlc_http_mgr *mgr, bool https,
+                                 const char *host, unsigned port)
+{
+    last_conn = NULL;
+
+    struct vlc_http_msg *m = vlc_http_mgr_request(mgr, https, host, port,
+                                                  fake_req);
+    assert(m != NULL);
+    vlc_http_msg_destroy(m);
+    assert(last_conn != NULL);
+    return last_conn;
+}
+
+static void wait_live(unsigned count)
+{
+    vlc_tick_t deadline = vlc_tick_now() + 10 * VLC_HTTP_POOL_IDLE_TIMEOUT;
+
+    vlc_mutex_lock(&lock);
+    while (conn_live > count)
+        if (vlc_cond_timedwait(&released, &lock, deadline))
+            assert(!"idle connections not closed");
+    assert(conn_live == count);
+    vlc_mutex_unlock(&lock);
+}
+
+static void test_match(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *m1 = vlc_http_mgr_create(obj, NULL);
+    struct vlc_http_mgr *m2 = vlc_http_mgr_create(obj, NULL);
+    assert(m1 != NULL && m2 != NULL);
+
+    struct test_conn *c1 = request(m1, false, "www.example.com", 80);
+    assert(conn_count == 1);
+    /* same manager, same server */
+    assert(request(m1, false, "WWW.example.com", 80) == c1);
+    assert(conn_count == 1);
+
+    /* HTTP/1 connections are not shared by managers */
+    struct test_conn *c2 = request(m2, false, "www.example.com", 80);
+    assert(c2 != c1);
+    assert(conn_count == 2);
+
+    /* other ports, hosts and schemes do not match */
+    assert(request(m2, false, "www.example.com", 8080) != c2);
+    assert(request(m2, false, "www.example.org", 80) != c2);
+    assert(request(m2, true, "www.example.com", 80)->creds != NULL);
+    assert(conn_count == 5);
+
+    /* connections are idle, not closed, when their managers go away */
+    vlc_http_mgr_destroy(m1);
+    vlc_http_mgr_destroy(m2);
+    assert(conn_live == 5);
+
+    /* idle connections are reused by new managers */
+    struct vlc_http_mgr *m3 = vlc_http_mgr_create(obj, NULL);
+    assert(m3 != NULL);
+    struct test_conn *c = request(m3, false, "www.example.com", 80);
+    assert(c == c1 || c == c2);
+    assert(request(m3, false, "www.example.com", 8080)->port == 8080);
+    assert(conn_count == 5);
+    vlc_http_mgr_destroy(m3);
+    assert(conn_live == 5);
+}
+
+static void test_http2(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *m1 = vlc_http_mgr_create(obj, NULL);
+    struct vlc_http_mgr *m2 = vlc_http_mgr_create(obj, NULL);
+    assert(m1 != NULL && m2 != NULL);
+
+    unsigned count = conn_count;
+
+    alpn_h2 = true;
+    struct test_conn *c = request(m1, true, "www.example.net", 443);
+    assert(c->http2);
+    assert(conn_count == count + 1);
+
+    /* HTTP/2 connections are shared while in use */
+    assert(request(m2, true, "www.example.net", 443) == c);
+    assert(conn_count == count + 1);
+    alpn_h2 = false;
+
+    vlc_http_mgr_destroy(m1);
+    vlc_http_mgr_destroy(m2);
+    assert(!c->closed);
+}
+
+static void test_broken(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *mgr = vlc_http_mgr_create(obj, NULL);
+    assert(mgr != NULL);
+
+    struct test_conn *c = request(mgr, false, "broken.example.org", 80);
+    unsigned count = conn_count;
+
+    vlc_http_mgr_destroy(mgr);
+    c->broken = true;
+
+    /* a broken connection is closed, and replaced */
+    mgr = vlc_http_mgr_create(obj, NULL);
+    assert(mgr != NULL);
+    assert(request(mgr, false, "broken.example.org", 80) != c);
+    assert(c->closed);
+    assert(conn_count == count + 1);
+    vlc_http_mgr_destroy(mgr);
+}
+
+static void test_credentials(vlc_object_t *obj)
+{
+    vlc_object_t *in1 = vlc_object_create(obj, sizeof (*in1));
+    vlc_object_t *in2 = vlc_object_create(obj, sizeof (*in2));
+    assert(in1 != NULL && in2 != NULL);
+    var_Create(in1, "test-tls-ca", VLC_VAR_STRING);
+    var_SetString(in1, "test-tls-ca", "/other/ca.pem");
+    var_Create(in2, "test-tls-ca", VLC_VAR_STRING);
+    var_SetString(in2, "test-tls-ca", "/other/ca.pem");
+
+    struct vlc_http_mgr *m0 = vlc_http_mgr_create(obj, NULL);
+    struct vlc_http_mgr *m1 = vlc_http_mgr_create(in1, NULL);
+    struct vlc_http_mgr *m2 = vlc_http_mgr_create(in2, NULL);
+    assert(m0 != NULL && m1 != NULL && m2 != NULL);
+
+    /* the credentials follow the options of the input */
+    struct test_conn *c0 = request(m0, true, "secure.example.com", 443);
+    unsigned count = creds_count;
+    struct test_conn *c1 = request(m1, true, "secure.example.com", 443);
+    assert(creds_count == count + 1);
+    assert(c1 != c0 && c1->creds != c0->creds);
+    assert(!strcmp(creds[creds_count - 1].ca, "/other/ca.pem"));
+
+    /* the same options share the credentials, and the idle connections */
+    vlc_http_mgr_destroy(m1);
+    assert(request(m2, true, "secure.example.com", 443) == c1);
+    assert(creds_count == count + 1);
+
+    vlc_http_mgr_destroy(m2);
+    vlc_http_mgr_destroy(m0);
+    vlc_object_delete(in2);
+    vlc_object_delete(in1);
+    assert(!c0->closed && !c1->closed);
+}
+
+static void test_prune(vlc_object_t *obj)
+{
+    struct vlc_http_mgr *mgrs[20];
+
+    /* too many idle connections: the least recently used ones are closed */
+    for (unsigned i = 0; i < ARRAY_SIZE(mgrs); i++)
+    {
+        mgrs[i] = vlc_http_mgr_create(obj, NULL);
+        assert(mgrs[i] != NULL);
+        request(mgrs[i], false, "many.example.com", 80);
+    }
+
+    unsigned live = conn_live;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(mgrs); i++)
+        vlc_http_mgr_destroy(mgrs[i]);
+    assert(conn_live <= 16);
+    assert(conn_live < live);
+    assert(!conns[conn_count - 1].closed);
+
+    /* idle connections expire, with no managers left */
+    wait_live(0);
+}
+
+int main(void)
+{
+    vlc_object_t *root = (vlc_object_create)(NULL, sizeof (*root));
+    assert(root != NULL);
+    var_Create(root, "test-tls-ca", VLC_VAR_STRING);
+    var_SetString(root, "test-tls-ca", "/etc/ssl/ca.pem");
+
+    test_match(root);
+    test_http2(root);
+    test_broken(root);
+    test_credentials(root);
+    test_prune(root);
+    assert(cleanup_handler != NULL);
+
+    /* the instance clean up closes everything */
+    struct vlc_http_mgr *mgr = vlc_http_mgr_create(root, NULL);
+    assert(mgr != NULL);
+    request(mgr, true, "www.example.com", 443);
+    vlc_http_mgr_destroy(mgr);
+    assert(conn_live == 1);
+
+    cleanup_handler(cleanup_opaque);
+    assert(conn_live == 0);
+    for (unsigned i = 0; i < creds_count; i++)
+        assert(creds[i].deleted);
+
+    vlc_object_delete(root);
+    return 0;
+}
@@ -162,7 +162,7 @@ static struct vlc_http_stream *vlc_h1_stream_open(struct vlc_http_conn *c,
         return vlc_h1_stream_fatal(conn);
 
     conn->active = true;
-    conn->content_length = 0;
+    conn->content_length = UINTMAX_MAX; /* until the response is received */
     conn->connection_close = false;
     return &conn->stream;
 }
@@ -219,6 +219,8 @@ static struct vlc_http_msg *vlc_h1_stream_wait(struct vlc_http_stream *stream)
                 vlc_http_msg_destroy(resp);
                 return vlc_h1_stream_fatal(conn);
             }
+            /* The chunked stream aborts this one if closed before the end */
+            conn->content_length = 0;
         }
     }
     else
@@ -276,6 +278,13 @@ static void vlc_h1_stream_close(struct vlc_http_stream *stream, bool abort)
 
     if (abort)
         vlc_h1_stream_fatal(conn);
+    else if (conn->conn.tls != NULL
+          && (conn->connection_close || conn->content_length != 0))
+    {   /* Unread or undelimited response: the connection cannot be reused */
+        vlc_tls_Shutdown(conn->conn.tls, true);
+        vlc_tls_Close(conn->conn.tls);
+        conn->conn.tls = NULL;
+    }
 
     conn->active = false;
 
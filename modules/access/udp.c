@@ -41,6 +41,7 @@
 #include <vlc_network.h>
 #include <vlc_block.h>
 #include <vlc_interrupt.h>
+#include <errno.h>
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
@@ -53,13 +54,53 @@
  */
 #define MRU 65507u
 
+/* Initial guess of the largest datagram size. Blocks are allocated with this
+ * size, and it grows whenever a larger datagram is received. */
+#define DEFAULT_MTU 1500u
+
+#ifdef HAVE_RECVMMSG
+typedef struct mmsghdr udp_msg_t;
+#else
+typedef struct
+{
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+} udp_msg_t;
+#endif
+
+#ifdef SO_RXQ_OVFL
+# define CMSG_LEN_MAX CMSG_SPACE(sizeof (uint32_t))
+#endif
+
 typedef struct {
     int fd;
     int timeout;
+    size_t mtu;
+    unsigned batch;
+
+    block_t *queue;
+    block_t **queue_last;
+
+    /* Receive batch */
+    block_t **blocks;
+    udp_msg_t *msgs;
+    struct iovec *iovecs;
+#ifdef CMSG_LEN_MAX
+    char (*cmsgs)[CMSG_LEN_MAX];
+    uint32_t rxq_ovfl;
+#endif
 
-    size_t length;
-    char *offset;
-    char buf[MRU];
+    struct
+    {
+        uint64_t syscalls;
+        uint64_t datagrams;
+        uint64_t lost;
+        uint64_t truncated;
+    } stats;
+
+    /* One overflow slot per message of the batch. Only the pages the kernel
+     * writes to, for datagrams larger than the blocks, are ever touched. */
+    char (*overflow)[MRU];
 } access_sys_t;
 
 static int Control(stream_t *access, int query, va_list args)
@@ -83,53 +124,154 @@ static int Control(stream_t *access, int query, va_list args)
     return VLC_SUCCESS;
 }
 
-static ssize_t Read(stream_t *access, void *buf, size_t len)
+#ifdef CMSG_LEN_MAX
+/* Accounts for datagrams dropped by the kernel because the socket receive
+ * buffer was full. The kernel reports a running total with each datagram. */
+static void CheckOverflow(stream_t *access, const struct msghdr *hdr)
 {
     access_sys_t *sys = access->p_sys;
 
-    if (sys->length > 0) {
-        if (len > sys->length)
-            len = sys->length;
-
-        memcpy(buf, sys->offset, len);
-        sys->offset += len;
-        sys->length -= len;
-        return len;
+    for (const struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr);
+         cmsg != NULL;
+         cmsg = CMSG_NXTHDR((struct msghdr *)hdr, (struct cmsghdr *)cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL)
+            continue;
+
+        uint32_t ovfl;
+        memcpy(&ovfl, CMSG_DATA(cmsg), sizeof (ovfl));
+
+        uint32_t lost = ovfl - sys->rxq_ovfl;
+        if (lost > 0) {
+            msg_Warn(access, "%"PRIu32" datagram(s) lost (receive buffer "
+                     "overflow)", lost);
+            sys->stats.lost += lost;
+            sys->rxq_ovfl = ovfl;
+        }
     }
+}
+#endif
 
-    struct pollfd ufd[1];
+/* Receives up to one batch of datagrams into the pending queue. */
+static int Receive(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+
+    /* Allocate (or grow) the receive blocks, and reset the headers */
+    for (unsigned i = 0; i < sys->batch; i++) {
+        block_t *block = sys->blocks[i];
 
-    ufd[0].fd = sys->fd;
-    ufd[0].events = POLLIN;
+        if (block != NULL && block->i_buffer < sys->mtu) {
+            block_Release(block);
+            block = NULL;
+        }
+        if (block == NULL) {
+            block = block_Alloc(sys->mtu);
+            if (unlikely(block == NULL))
+                return -1;
+            sys->blocks[i] = block;
+        }
 
-    switch (vlc_poll_i11e(ufd, 1, sys->timeout)) {
-        case 0:
-            msg_Err(access, "receive time-out");
-            return 0;
-        case -1:
-            return -1;
+        struct iovec *iov = &sys->iovecs[2 * i];
+        struct msghdr *hdr = &sys->msgs[i].msg_hdr;
+
+        iov[0].iov_base = block->p_buffer;
+        iov[0].iov_len = block->i_buffer;
+        iov[1].iov_base = sys->overflow[i];
+        iov[1].iov_len = MRU;
+        hdr->msg_iov = iov;
+        hdr->msg_iovlen = 2;
+#ifdef CMSG_LEN_MAX
+        hdr->msg_control = sys->cmsgs[i];
+        hdr->msg_controllen = sizeof (sys->cmsgs[i]);
+#endif
+        hdr->msg_flags = 0;
     }
 
-    struct iovec iov[] = {
-        { .iov_base = buf,      .iov_len = len, },
-        { .iov_base = sys->buf, .iov_len = MRU, },
-    };
-    struct msghdr msg = {
-        .msg_iov = iov,
-        .msg_iovlen = ARRAY_SIZE(iov),
-    };
-    ssize_t val = recvmsg(sys->fd, &msg, 0);
-
-    if (val <= 0) /* empty (0 bytes) payload does *not* mean EOF here */
+#ifdef HAVE_RECVMMSG
+    int count = recvmmsg(sys->fd, sys->msgs, sys->batch, MSG_WAITFORONE,
+                         NULL);
+#else
+    /* Fall back to one datagram per system call */
+    ssize_t val = recvmsg(sys->fd, &sys->msgs[0].msg_hdr, 0);
+    int count = (val >= 0) ? 1 : -1;
+    if (val >= 0)
+        sys->msgs[0].msg_len = val;
+#endif
+    sys->stats.syscalls++;
+    if (count <= 0)
         return -1;
 
-    if (unlikely((size_t)val > len)) {
-        sys->offset = sys->buf;
-        sys->length = val - len;
-        val = len;
+    for (int i = 0; i < count; i++) {
+        block_t *block = sys->blocks[i];
+        const struct msghdr *hdr = &sys->msgs[i].msg_hdr;
+        size_t len = sys->msgs[i].msg_len;
+
+#ifdef CMSG_LEN_MAX
+        CheckOverflow(access, hdr);
+#endif
+        sys->stats.datagrams++;
+
+        if (len == 0) /* empty payload does *not* mean EOF here */
+            continue;
+        if (len > sys->mtu)
+            sys->mtu = len;
+
+        if (unlikely(len > block->i_buffer)) {
+            size_t head = block->i_buffer;
+
+            if (hdr->msg_flags & MSG_TRUNC) {
+                sys->stats.truncated++;
+                continue; /* recycle the block for the next batch */
+            }
+
+            block = block_Realloc(block, 0, len);
+            if (unlikely(block == NULL)) {
+                sys->blocks[i] = NULL;
+                continue;
+            }
+            memcpy(block->p_buffer + head, sys->overflow[i], len - head);
+        }
+        else
+            block->i_buffer = len;
+
+        sys->blocks[i] = NULL;
+        block_ChainLastAppend(&sys->queue_last, block);
     }
 
-    return val;
+    return count;
+}
+
+static block_t *BlockUDP(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->queue == NULL) {
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout)) {
+            case 0:
+                msg_Err(access, "receive time-out");
+                *eof = true;
+                /* fall through */
+            case -1:
+                return NULL;
+        }
+
+        if (Receive(access) <= 0 || sys->queue == NULL)
+            return NULL;
+    }
+
+    block_t *block = sys->queue;
+
+    sys->queue = block->p_next;
+    if (sys->queue == NULL)
+        sys->queue_last = &sys->queue;
+    block->p_next = NULL;
+    return block;
 }
 
 /*****************************************************************************
@@ -147,10 +289,9 @@ static int Open( vlc_object_t *p_this )
     if( unlikely( sys == NULL ) )
         return VLC_ENOMEM;
 
-    sys->length = 0;
     p_access->p_sys = sys;
-    p_access->pf_read = Read;
-    p_access->pf_block = NULL;
+    p_access->pf_read = NULL;
+    p_access->pf_block = BlockUDP;
     p_access->pf_control = Control;
     p_access->pf_seek = NULL;
 
@@ -217,7 +358,47 @@ static int Open( vlc_object_t *p_this )
     if( sys->timeout > 0)
         sys->timeout *= 1000;
 
+    sys->mtu = DEFAULT_MTU;
+    sys->queue = NULL;
+    sys->queue_last = &sys->queue;
+    memset( &sys->stats, 0, sizeof( sys->stats ) );
+#ifdef HAVE_RECVMMSG
+    sys->batch = var_InheritInteger( p_access, "udp-batch" );
+    if( sys->batch < 1 )
+        sys->batch = 1;
+    if( sys->batch > 1024 )
+        sys->batch = 1024;
+#else
+    sys->batch = 1;
+#endif
+
+    sys->blocks = vlc_obj_calloc( p_this, sys->batch, sizeof( *sys->blocks ) );
+    sys->msgs = vlc_obj_calloc( p_this, sys->batch, sizeof( *sys->msgs ) );
+    sys->iovecs = vlc_obj_calloc( p_this, 2 * sys->batch,
+                                  sizeof( *sys->iovecs ) );
+    sys->overflow = vlc_obj_malloc( p_this, sys->batch * sizeof( *sys->overflow ) );
+#ifdef CMSG_LEN_MAX
+    sys->cmsgs = vlc_obj_calloc( p_this, sys->batch, sizeof( *sys->cmsgs ) );
+    sys->rxq_ovfl = 0;
+    if( sys->cmsgs != NULL
+     && setsockopt( sys->fd, SOL_SOCKET, SO_RXQ_OVFL, &(int){ 1 },
+                    sizeof( int ) ) )
+        msg_Dbg( p_access, "cannot track receive buffer overflows: %s",
+                 vlc_strerror_c( errno ) );
+    if( unlikely( sys->cmsgs == NULL ) )
+        goto error;
+#endif
+    if( unlikely( sys->blocks == NULL || sys->msgs == NULL
+               || sys->iovecs == NULL || sys->overflow == NULL ) )
+        goto error;
+
+    msg_Dbg( p_access, "receiving up to %u datagram(s) per system call",
+             sys->batch );
     return VLC_SUCCESS;
+
+error:
+    net_Close( sys->fd );
+    return VLC_ENOMEM;
 }
 
 /*****************************************************************************
@@ -228,10 +409,21 @@ static void Close( vlc_object_t *p_this )
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+    msg_Dbg( p_access, "%"PRIu64" datagram(s) in %"PRIu64" system call(s), "
+             "%"PRIu64" lost, %"PRIu64" truncated", sys->stats.datagrams,
+             sys->stats.syscalls, sys->stats.lost, sys->stats.truncated );
+
+    for( unsigned i = 0; i < sys->batch; i++ )
+        if( sys->blocks[i] != NULL )
+            block_Release( sys->blocks[i] );
+    block_ChainRelease( sys->queue );
     net_Close( sys->fd );
 }
 
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Datagrams per system call")
+#define BATCH_LONGTEXT N_("Maximum number of datagrams received at once. " \
+    "Larger batches reduce system call overhead at high packet rates.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -242,6 +434,10 @@ vlc_module_begin()
     add_obsolete_integer("server-port") /* since 2.0.0 */
     add_obsolete_integer("udp-buffer") /* since 3.0.0 */
     add_integer("udp-timeout", -1, TIMEOUT_TEXT, NULL, true)
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range("udp-batch", 32, 1, 1024, BATCH_TEXT,
+                           BATCH_LONGTEXT, true)
+#endif
 
     set_capability("access", 0)
     add_shortcut("udp", "udpstream", "udp4", "udp6")
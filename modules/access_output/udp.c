@@ -35,6 +35,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 
 #include <vlc_sout.h>
 #include <vlc_block.h>
@@ -45,6 +46,15 @@
 #elif defined (HAVE_SYS_SOCKET_H)
 #   include <sys/socket.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#   include <sys/uio.h>
+#endif
+#ifdef __linux__
+#   include <netinet/udp.h>
+#   ifndef UDP_SEGMENT
+#       define UDP_SEGMENT 103 /* Linux 4.18 */
+#   endif
+#endif
 
 #include <vlc_network.h>
 
@@ -70,6 +80,21 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batch packets")
+#define BATCH_LONGTEXT N_("Maximum number of packets that are due at the " \
+                          "same time and handed to the kernel in a single " \
+                          "system call. A value of 1 disables batching." )
+
+#define BATCH_WINDOW_TEXT N_("Batch window (ms)")
+#define BATCH_WINDOW_LONGTEXT N_("Packets due within this delay after the " \
+                                 "first packet of a batch are sent along " \
+                                 "with it. Packets carrying a clock " \
+                                 "reference are never sent ahead of time." )
+
+#define GSO_TEXT N_("Segmentation offload")
+#define GSO_LONGTEXT N_("Let the kernel split batches of equally sized " \
+                        "packets (UDP GSO), where supported." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -78,6 +103,11 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer_with_range( SOUT_CFG_PREFIX "batch", 1, 1, 1024,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "batch-window", 1, BATCH_WINDOW_TEXT,
+                 BATCH_WINDOW_LONGTEXT, true )
+    add_bool( SOUT_CFG_PREFIX "gso", true, GSO_TEXT, GSO_LONGTEXT, true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -91,6 +121,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
+    "batch-window",
+    "gso",
     NULL
 };
 
@@ -106,6 +139,30 @@ static ssize_t Write   ( sout_access_out_t *, block_t * );
 static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
+static void* ThreadWriteBatch( void * );
+
+#ifdef HAVE_SENDMMSG
+typedef struct mmsghdr udp_msg_t;
+#else
+typedef struct
+{
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+} udp_msg_t;
+#endif
+
+#ifdef HAVE_SENDMMSG
+# define MAX_MESSAGES UINT_MAX
+#else
+# define MAX_MESSAGES 1
+#endif
+
+#ifdef __linux__
+# define GSO_CMSG_SPACE CMSG_SPACE(sizeof (uint16_t))
+/* Kernel limits on segments per send and total payload size */
+# define GSO_MAX_SEGMENTS 64
+# define GSO_MAX_BYTES    65507
+#endif
 
 typedef struct
 {
@@ -118,6 +175,30 @@ typedef struct
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
+
+    /* Batch mode (owned by the writer thread) */
+    unsigned      i_batch;
+    vlc_tick_t    i_batch_window;
+    bool          b_gso;
+    block_t     **pp_batch;
+    unsigned      i_batch_count;
+    block_t      *p_pending;
+    udp_msg_t    *p_msgs;
+    struct iovec *p_iov;
+#ifdef GSO_CMSG_SPACE
+    char        (*p_cmsgs)[GSO_CMSG_SPACE];
+#endif
+
+    struct
+    {
+        uint64_t  i_batches;
+        uint64_t  i_packets;
+        uint64_t  i_bytes;
+        uint64_t  i_messages;
+        uint64_t  i_syscalls;
+        unsigned  i_max_batch;
+        vlc_tick_t i_last_report;
+    } stats;
 } sout_access_out_sys_t;
 
 #define DEFAULT_PORT 1234
@@ -209,10 +290,69 @@ static int Open( vlc_object_t *p_this )
     p_sys->p_fifo = block_FifoNew();
     p_sys->p_buffer = NULL;
 
-    if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
-                           VLC_THREAD_PRIORITY_HIGHEST ) )
+    p_sys->i_batch = var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
+    p_sys->i_batch_window = VLC_TICK_FROM_MS(
+                     var_GetInteger( p_access, SOUT_CFG_PREFIX "batch-window" ) );
+    p_sys->b_gso = false;
+    p_sys->pp_batch = NULL;
+    p_sys->i_batch_count = 0;
+    p_sys->p_pending = NULL;
+    p_sys->p_msgs = NULL;
+    p_sys->p_iov = NULL;
+#ifdef GSO_CMSG_SPACE
+    p_sys->p_cmsgs = NULL;
+#endif
+    memset( &p_sys->stats, 0, sizeof( p_sys->stats ) );
+
+    if( p_sys->i_batch > 1 )
+    {
+        p_sys->pp_batch = vlc_alloc( p_sys->i_batch, sizeof( *p_sys->pp_batch ) );
+        p_sys->p_msgs = vlc_alloc( p_sys->i_batch, sizeof( *p_sys->p_msgs ) );
+        p_sys->p_iov = vlc_alloc( p_sys->i_batch, sizeof( *p_sys->p_iov ) );
+#ifdef GSO_CMSG_SPACE
+        p_sys->p_cmsgs = vlc_alloc( p_sys->i_batch, sizeof( *p_sys->p_cmsgs ) );
+        if( var_GetBool( p_access, SOUT_CFG_PREFIX "gso" ) )
+        {
+            int val;
+            socklen_t len = sizeof( val );
+
+            /* Probe kernel support for UDP segmentation offload */
+            p_sys->b_gso = getsockopt( i_handle, IPPROTO_UDP, UDP_SEGMENT,
+                                       &val, &len ) == 0;
+        }
+        if( p_sys->p_cmsgs == NULL )
+            p_sys->b_gso = false;
+#endif
+        if( p_sys->pp_batch == NULL || p_sys->p_msgs == NULL
+         || p_sys->p_iov == NULL )
+        {
+            free( p_sys->pp_batch );
+            free( p_sys->p_msgs );
+            free( p_sys->p_iov );
+#ifdef GSO_CMSG_SPACE
+            free( p_sys->p_cmsgs );
+#endif
+            block_FifoRelease( p_sys->p_fifo );
+            net_Close( i_handle );
+            free( p_sys );
+            return VLC_ENOMEM;
+        }
+        msg_Dbg( p_access, "batching up to %u packets per system call%s",
+                 p_sys->i_batch,
+                 p_sys->b_gso ? " with segmentation offload" : "" );
+    }
+
+    if( vlc_clone( &p_sys->thread,
+                   p_sys->i_batch > 1 ? ThreadWriteBatch : ThreadWrite,
+                   p_access, VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
+        free( p_sys->pp_batch );
+        free( p_sys->p_msgs );
+        free( p_sys->p_iov );
+#ifdef GSO_CMSG_SPACE
+        free( p_sys->p_cmsgs );
+#endif
         block_FifoRelease( p_sys->p_fifo );
         net_Close (i_handle);
         free (p_sys);
@@ -239,6 +379,26 @@ static void Close( vlc_object_t * p_this )
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
 
+    if( p_sys->i_batch > 1 )
+    {
+        msg_Dbg( p_access, "%"PRIu64" packets (%"PRIu64" bytes) sent in "
+                 "%"PRIu64" batches, %"PRIu64" messages, %"PRIu64" system "
+                 "calls, largest batch %u", p_sys->stats.i_packets,
+                 p_sys->stats.i_bytes, p_sys->stats.i_batches,
+                 p_sys->stats.i_messages, p_sys->stats.i_syscalls,
+                 p_sys->stats.i_max_batch );
+
+        for( unsigned i = 0; i < p_sys->i_batch_count; i++ )
+            block_Release( p_sys->pp_batch[i] );
+        if( p_sys->p_pending ) block_Release( p_sys->p_pending );
+        free( p_sys->pp_batch );
+        free( p_sys->p_msgs );
+        free( p_sys->p_iov );
+#ifdef GSO_CMSG_SPACE
+        free( p_sys->p_cmsgs );
+#endif
+    }
+
     net_Close( p_sys->i_handle );
     free( p_sys );
 }
@@ -419,3 +579,240 @@ static void* ThreadWrite( void *data )
     }
     return NULL;
 }
+
+/*****************************************************************************
+ * Batch mode
+ *****************************************************************************/
+
+/* Checks the date of a packet against the previous one.
+ * Returns true if the packet must be dropped. */
+static bool CheckDate( sout_access_out_t *p_access, vlc_tick_t i_date,
+                       vlc_tick_t *pi_date_last, unsigned *pi_dropped )
+{
+    if( *pi_date_last > 0 )
+    {
+        if( i_date - *pi_date_last > VLC_TICK_FROM_SEC(2) )
+        {
+            if( !*pi_dropped )
+                msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
+                         i_date - *pi_date_last );
+            *pi_date_last = i_date;
+            (*pi_dropped)++;
+            return true;
+        }
+        else if( i_date - *pi_date_last < VLC_TICK_FROM_MS(-1) )
+        {
+            if( !*pi_dropped )
+                msg_Dbg( p_access, "mmh, packets in the past (%"PRId64")",
+                         *pi_date_last - i_date );
+        }
+    }
+
+    if( *pi_dropped )
+    {
+        msg_Dbg( p_access, "dropped %u packets", *pi_dropped );
+        *pi_dropped = 0;
+    }
+    *pi_date_last = i_date;
+    return false;
+}
+
+/* Fills one message with packets from the batch, starting at index i.
+ * Returns the number of packets covered by the message. */
+static unsigned PrepareMessage( sout_access_out_sys_t *p_sys, unsigned i,
+                                unsigned i_msg )
+{
+    struct msghdr *hdr = &p_sys->p_msgs[i_msg].msg_hdr;
+    size_t i_segment = p_sys->pp_batch[i]->i_buffer;
+    unsigned n = 1;
+
+    memset( hdr, 0, sizeof( *hdr ) );
+    hdr->msg_iov = &p_sys->p_iov[i];
+
+    p_sys->p_iov[i].iov_base = p_sys->pp_batch[i]->p_buffer;
+    p_sys->p_iov[i].iov_len = i_segment;
+
+#ifdef GSO_CMSG_SPACE
+    if( p_sys->b_gso && i_segment > 0 )
+    {
+        size_t i_total = i_segment;
+
+        /* Gather equally sized packets; only the last one may be shorter */
+        while( i + n < p_sys->i_batch_count && n < GSO_MAX_SEGMENTS )
+        {
+            const block_t *p_pk = p_sys->pp_batch[i + n];
+
+            if( p_pk->i_buffer == 0 || p_pk->i_buffer > i_segment
+             || i_total + p_pk->i_buffer > GSO_MAX_BYTES )
+                break;
+
+            p_sys->p_iov[i + n].iov_base = p_pk->p_buffer;
+            p_sys->p_iov[i + n].iov_len = p_pk->i_buffer;
+            i_total += p_pk->i_buffer;
+            n++;
+            if( p_pk->i_buffer < i_segment )
+                break;
+        }
+
+        if( n > 1 )
+        {
+            hdr->msg_control = p_sys->p_cmsgs[i_msg];
+            hdr->msg_controllen = sizeof( p_sys->p_cmsgs[i_msg] );
+
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR( hdr );
+            uint16_t i_gso_size = i_segment;
+
+            cmsg->cmsg_level = IPPROTO_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN( sizeof( i_gso_size ) );
+            memcpy( CMSG_DATA( cmsg ), &i_gso_size, sizeof( i_gso_size ) );
+        }
+    }
+#endif
+    hdr->msg_iovlen = n;
+    return n;
+}
+
+/* Sends and releases all the packets of the current batch. */
+static void SendBatch( sout_access_out_t *p_access )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    unsigned i_first = 0;
+
+    p_sys->stats.i_batches++;
+    p_sys->stats.i_packets += p_sys->i_batch_count;
+    if( p_sys->i_batch_count > p_sys->stats.i_max_batch )
+        p_sys->stats.i_max_batch = p_sys->i_batch_count;
+
+    while( i_first < p_sys->i_batch_count )
+    {
+        unsigned i_msgs = 0;
+        unsigned pi_first[p_sys->i_batch_count - i_first];
+
+        for( unsigned i = i_first;
+             i < p_sys->i_batch_count && i_msgs < MAX_MESSAGES; i_msgs++ )
+        {
+            pi_first[i_msgs] = i;
+            i += PrepareMessage( p_sys, i, i_msgs );
+        }
+
+#ifdef HAVE_SENDMMSG
+        int i_sent = sendmmsg( p_sys->i_handle, p_sys->p_msgs, i_msgs, 0 );
+#else
+        /* Fall back to one message per system call */
+        int i_sent = sendmsg( p_sys->i_handle, &p_sys->p_msgs[0].msg_hdr,
+                              0 ) == -1 ? -1 : 1;
+#endif
+        p_sys->stats.i_syscalls++;
+
+        if( i_sent < 0 )
+        {
+#ifdef GSO_CMSG_SPACE
+            if( p_sys->b_gso && (errno == EIO || errno == EINVAL) )
+            {   /* Not supported by the network device or the route */
+                msg_Warn( p_access, "segmentation offload failed (%s), "
+                          "disabling", vlc_strerror_c(errno) );
+                p_sys->b_gso = false;
+                continue;
+            }
+#endif
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            i_sent = 1; /* skip the failed message */
+        }
+
+        p_sys->stats.i_messages += i_sent;
+        i_first = ((unsigned)i_sent < i_msgs) ? pi_first[i_sent]
+                                              : p_sys->i_batch_count;
+    }
+
+    for( unsigned i = 0; i < p_sys->i_batch_count; i++ )
+    {
+        p_sys->stats.i_bytes += p_sys->pp_batch[i]->i_buffer;
+        block_Release( p_sys->pp_batch[i] );
+    }
+    p_sys->i_batch_count = 0;
+
+    vlc_tick_t now = vlc_tick_now();
+    if( now - p_sys->stats.i_last_report > VLC_TICK_FROM_SEC(30) )
+    {
+        if( p_sys->stats.i_batches > 0 )
+            msg_Dbg( p_access, "%"PRIu64" packets in %"PRIu64" batches "
+                     "(%.1f packets per system call, largest %u)",
+                     p_sys->stats.i_packets, p_sys->stats.i_batches,
+                     (double)p_sys->stats.i_packets
+                        / (p_sys->stats.i_syscalls ? p_sys->stats.i_syscalls : 1),
+                     p_sys->stats.i_max_batch );
+        p_sys->stats.i_last_report = now;
+    }
+}
+
+/*****************************************************************************
+ * ThreadWriteBatch: Write packets due at the same time in one system call.
+ *****************************************************************************/
+static void* ThreadWriteBatch( void *data )
+{
+    sout_access_out_t *p_access = data;
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    vlc_tick_t i_date_last = -1;
+    unsigned i_dropped_packets = 0;
+
+    p_sys->stats.i_last_report = vlc_tick_now();
+
+    for (;;)
+    {
+        block_t *p_pk = p_sys->p_pending;
+
+        p_sys->p_pending = NULL;
+        if( p_pk == NULL )
+            p_pk = block_FifoGet( p_sys->p_fifo );
+
+        vlc_tick_t i_date = p_sys->i_caching + p_pk->i_dts;
+        if( CheckDate( p_access, i_date, &i_date_last, &i_dropped_packets ) )
+        {
+            block_Release( p_pk );
+            continue;
+        }
+
+        /* The first packet of the batch sets the pace */
+        p_sys->pp_batch[p_sys->i_batch_count++] = p_pk;
+        vlc_tick_wait( i_date );
+
+        /* Take along the queued packets that are already due, or due within
+         * the window, except clock references which must be sent on time. */
+        vlc_tick_t i_deadline = __MAX( i_date + p_sys->i_batch_window,
+                                       vlc_tick_now() );
+
+        vlc_fifo_Lock( p_sys->p_fifo );
+        while( p_sys->i_batch_count < p_sys->i_batch )
+        {
+            p_pk = vlc_fifo_DequeueUnlocked( p_sys->p_fifo );
+            if( p_pk == NULL )
+                break;
+
+            i_date = p_sys->i_caching + p_pk->i_dts;
+            if( i_date > i_deadline || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+            {
+                p_sys->p_pending = p_pk;
+                break;
+            }
+            if( CheckDate( p_access, i_date, &i_date_last,
+                           &i_dropped_packets ) )
+            {
+                block_Release( p_pk );
+                continue;
+            }
+            p_sys->pp_batch[p_sys->i_batch_count++] = p_pk;
+        }
+        vlc_fifo_Unlock( p_sys->p_fifo );
+
+        SendBatch( p_access );
+
+        i_date = vlc_tick_now() - i_date_last;
+        if ( i_date > VLC_TICK_FROM_MS(20) )
+        {
+            msg_Dbg( p_access, "packet has been sent too late (%"PRId64 ")",
+                     i_date );
+        }
+    }
+    return NULL;
+}
@@ -36,12 +36,16 @@
 #include "logic/AlwaysLowestAdaptationLogic.hpp"
 #include "logic/PredictiveAdaptationLogic.hpp"
 #include "logic/NearOptimalAdaptationLogic.hpp"
+#include "logic/HybridAdaptationLogic.hpp"
+#include "logic/AdaptationTelemetry.hpp"
+#include "plumbing/SlewedEsOut.hpp"
 #include "tools/Debug.hpp"
 #include <vlc_stream.h>
 #include <vlc_demux.h>
 #include <vlc_threads.h>
 
 #include <algorithm>
+#include <cmath>
 #include <ctime>
 
 using namespace adaptive::http;
@@ -55,6 +59,7 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
                                   AbstractAdaptationLogic::LogicType type ) :
              logicType      ( type ),
              logic          ( NULL ),
+             telemetry      ( NULL ),
              playlist       ( pl ),
              streamFactory  ( factory ),
              p_demux        ( p_demux_ )
@@ -80,13 +85,27 @@ PlaylistManager::PlaylistManager( demux_t *p_demux_,
     cached.playlistEnd = 0;
     cached.playlistLength = 0;
     cached.lastupdate = 0;
+    slewedEsOut = new SlewedEsOut(p_demux->out);
+    latency.lastcheck = VLC_TICK_INVALID;
+    latency.lastreport = VLC_TICK_INVALID;
+    latency.min = 0;
+    latency.max = 0;
+    latency.sum = 0;
+    latency.count = 0;
 }
 
 PlaylistManager::~PlaylistManager   ()
 {
     delete streamFactory;
     unsetPeriod();
+    if(latency.count)
+        msg_Dbg(p_demux, "live latency min %" PRId64 "ms avg %" PRId64 "ms max %" PRId64 "ms",
+                MS_FROM_VLC_TICK(latency.min),
+                MS_FROM_VLC_TICK(latency.sum / latency.count),
+                MS_FROM_VLC_TICK(latency.max));
+    delete slewedEsOut;
     delete playlist;
+    delete telemetry;
     delete logic;
     delete resources;
 }
@@ -117,6 +136,9 @@ bool PlaylistManager::setupPeriod()
             SegmentTracker *tracker = new SegmentTracker(resources, logic, set);
             if(!tracker)
                 continue;
+            tracker->setPrefetchMax(var_InheritInteger(p_demux, "adaptive-prefetch"));
+            if(telemetry)
+                tracker->registerListener(telemetry);
 
             AbstractStream *st = streamFactory->create(p_demux, set->getStreamFormat(),
                                                        tracker, resources->getConnManager());
@@ -277,7 +299,7 @@ AbstractStream::status PlaylistManager::dequeue(vlc_tick_t i_floor, vlc_tick_t *
         AbstractStream *st = *it;
 
         vlc_tick_t i_pcr;
-        AbstractStream::status i_ret = st->dequeue(i_nzdeadline, &i_pcr);
+        AbstractStream::status i_ret = st->dequeue(*slewedEsOut, i_nzdeadline, &i_pcr);
         if( i_ret > i_return )
             i_return = i_ret;
 
@@ -309,7 +331,7 @@ void PlaylistManager::drain()
 
         vlc_tick_sleep(VLC_TICK_FROM_MS(20)); /* ugly, but we have no way to get feedback */
     }
-    es_out_Control(p_demux->out, ES_OUT_RESET_PCR);
+    es_out_Control(*slewedEsOut, ES_OUT_RESET_PCR);
 }
 
 vlc_tick_t PlaylistManager::getResumeTime() const
@@ -454,7 +476,7 @@ int PlaylistManager::doDemux(vlc_tick_t increment)
 
                 demux.i_nzpcr = VLC_TICK_INVALID;
                 demux.i_firstpcr = VLC_TICK_INVALID;
-                es_out_Control(p_demux->out, ES_OUT_RESET_PCR);
+                es_out_Control(*slewedEsOut, ES_OUT_RESET_PCR);
 
                 setBufferingRunState(true);
             }
@@ -469,7 +491,7 @@ int PlaylistManager::doDemux(vlc_tick_t increment)
         vlc_mutex_lock(&demux.lock);
         demux.i_nzpcr = VLC_TICK_INVALID;
         demux.i_firstpcr = VLC_TICK_INVALID;
-        es_out_Control(p_demux->out, ES_OUT_RESET_PCR);
+        es_out_Control(*slewedEsOut, ES_OUT_RESET_PCR);
         vlc_mutex_unlock(&demux.lock);
         break;
     case AbstractStream::status_demuxed:
@@ -478,9 +500,11 @@ int PlaylistManager::doDemux(vlc_tick_t increment)
         {
             demux.i_nzpcr = i_nzbarrier;
             vlc_tick_t pcr = VLC_TICK_0 + std::max(INT64_C(0), demux.i_nzpcr - VLC_TICK_FROM_MS(100));
-            es_out_Control(p_demux->out, ES_OUT_SET_GROUP_PCR, 0, pcr);
+            es_out_Control(*slewedEsOut, ES_OUT_SET_GROUP_PCR, 0, pcr);
         }
         vlc_mutex_unlock(&demux.lock);
+        if(playlist->isLowLatency())
+            controlLatency();
         break;
     }
 
@@ -590,7 +614,7 @@ int PlaylistManager::doControl(int i_query, va_list args)
         }
 
         case DEMUX_GET_PTS_DELAY:
-            *va_arg (args, vlc_tick_t *) = VLC_TICK_FROM_SEC(1);
+            *va_arg (args, vlc_tick_t *) = getPtsDelay();
             break;
 
         default:
@@ -765,6 +789,81 @@ void PlaylistManager::updateControlsPosition()
                cached.i_time, currentDemuxTime, rapPlaylistStart, rapDemuxStart));
 }
 
+vlc_tick_t PlaylistManager::getPtsDelay() const
+{
+    /* Don't waste the target latency in output buffering */
+    if(playlist->isLowLatency())
+        return std::min(VLC_TICK_FROM_SEC(1),
+                        std::max(VLC_TICK_FROM_MS(100), playlist->targetLatency.Get() / 4));
+    return VLC_TICK_FROM_SEC(1);
+}
+
+#define LATENCY_CHECK_INTERVAL  VLC_TICK_FROM_SEC(1)
+#define LATENCY_REPORT_INTERVAL VLC_TICK_FROM_SEC(10)
+#define LATENCY_DEADBAND        VLC_TICK_FROM_MS(50)
+#define LATENCY_MAX_SLEW        0.04
+void PlaylistManager::controlLatency()
+{
+    const vlc_tick_t now = vlc_tick_now();
+    if(latency.lastcheck != VLC_TICK_INVALID &&
+       now - latency.lastcheck < LATENCY_CHECK_INTERVAL)
+        return;
+    latency.lastcheck = now;
+
+    const vlc_tick_t demuxTime = getCurrentDemuxTime();
+    if(demuxTime == VLC_TICK_INVALID)
+        return;
+
+    vlc_tick_t distance = -1;
+    std::vector<AbstractStream *>::const_iterator it;
+    for(it=streams.begin(); it!=streams.end(); ++it)
+    {
+        vlc_tick_t streamDistance;
+        if((*it)->isSelected() && (*it)->getLiveEdgeDistance(demuxTime, &streamDistance))
+            distance = std::max(distance, streamDistance);
+    }
+    if(distance < 0)
+        return;
+
+    /* Decoders and output are playing behind the demux pcr */
+    const vlc_tick_t current = distance + getPtsDelay();
+    if(latency.count == 0 || current < latency.min)
+        latency.min = current;
+    if(current > latency.max)
+        latency.max = current;
+    latency.sum += current;
+    latency.count++;
+
+    /* Slowly run faster or slower than the stream until
+     * we're back at the target distance from the live edge */
+    const vlc_tick_t error = current - playlist->targetLatency.Get();
+    double rate = 1.0;
+    if(error > LATENCY_DEADBAND || error < -LATENCY_DEADBAND)
+    {
+        double slew = (double) error / VLC_TICK_FROM_SEC(10);
+        slew = std::max(-LATENCY_MAX_SLEW, std::min(LATENCY_MAX_SLEW, slew));
+        rate = 1.0 + std::round(slew * 200) / 200; /* 0.5% steps */
+    }
+    if(rate != slewedEsOut->getRate())
+    {
+        msg_Dbg(p_demux, "latency %" PRId64 "ms, target %" PRId64 "ms, rate %.3f",
+                MS_FROM_VLC_TICK(current),
+                MS_FROM_VLC_TICK(playlist->targetLatency.Get()), rate);
+        slewedEsOut->setRate(rate, VLC_TICK_0 + demuxTime);
+    }
+
+    if(latency.lastreport == VLC_TICK_INVALID ||
+       now - latency.lastreport >= LATENCY_REPORT_INTERVAL)
+    {
+        latency.lastreport = now;
+        msg_Dbg(p_demux, "live latency %" PRId64 "ms (min %" PRId64 "ms avg %" PRId64
+                         "ms max %" PRId64 "ms)", MS_FROM_VLC_TICK(current),
+                MS_FROM_VLC_TICK(latency.min),
+                MS_FROM_VLC_TICK(latency.sum / latency.count),
+                MS_FROM_VLC_TICK(latency.max));
+    }
+}
+
 AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::LogicType type, AbstractConnectionManager *conn)
 {
     vlc_object_t *obj = VLC_OBJECT(p_demux);
@@ -809,6 +908,16 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
             if(predictivelogic)
                 conn->setDownloadRateObserver(predictivelogic);
             logic = predictivelogic;
+            break;
+        }
+        case AbstractAdaptationLogic::Hybrid:
+        {
+            HybridAdaptationLogic *hybridlogic =
+                    new (std::nothrow) HybridAdaptationLogic(obj);
+            if(hybridlogic)
+                conn->setDownloadRateObserver(hybridlogic);
+            logic = hybridlogic;
+            break;
         }
 
         default:
@@ -819,6 +928,23 @@ AbstractAdaptationLogic *PlaylistManager::createLogic(AbstractAdaptationLogic::L
     {
         logic->setMaxDeviceResolution( var_InheritInteger(p_demux, "adaptive-maxwidth"),
                                        var_InheritInteger(p_demux, "adaptive-maxheight") );
+
+        char *psz_telemetry = var_InheritString(p_demux, "adaptive-telemetry");
+        if(psz_telemetry && !telemetry)
+        {
+            /* Records then forwards the download rates to the logic */
+            telemetry = new (std::nothrow) AdaptationTelemetry(obj, logic);
+            if(telemetry && telemetry->open(psz_telemetry))
+            {
+                conn->setDownloadRateObserver(telemetry);
+            }
+            else
+            {
+                delete telemetry;
+                telemetry = NULL;
+            }
+        }
+        free(psz_telemetry);
     }
 
     return logic;
@@ -39,6 +39,13 @@ namespace adaptive
         class AbstractConnectionManager;
     }
 
+    namespace logic
+    {
+        class AdaptationTelemetry;
+    }
+
+    class SlewedEsOut;
+
     using namespace playlist;
     using namespace logic;
 
@@ -86,6 +93,8 @@ namespace adaptive
             void unsetPeriod();
 
             void updateControlsPosition();
+            void controlLatency();
+            vlc_tick_t getPtsDelay() const;
 
             /* local factories */
             virtual AbstractAdaptationLogic *createLogic(AbstractAdaptationLogic::LogicType,
@@ -94,6 +103,7 @@ namespace adaptive
             SharedResources                     *resources;
             AbstractAdaptationLogic::LogicType  logicType;
             AbstractAdaptationLogic             *logic;
+            AdaptationTelemetry                 *telemetry;
             AbstractPlaylist                    *playlist;
             AbstractStreamFactory               *streamFactory;
             demux_t                             *p_demux;
@@ -109,6 +119,18 @@ namespace adaptive
                 vlc_cond_t  cond;
             } demux;
 
+            /* low latency live */
+            SlewedEsOut                         *slewedEsOut;
+            struct
+            {
+                vlc_tick_t  lastcheck;
+                vlc_tick_t  lastreport;
+                vlc_tick_t  min;
+                vlc_tick_t  max;
+                vlc_tick_t  sum;
+                unsigned    count;
+            } latency;
+
             /* buffering process */
             time_t                               nextPlaylistupdate;
             int                                  failedupdates;
@@ -89,6 +89,10 @@ SegmentTracker::SegmentTracker(SharedResources *res,
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNKNOWN;
+    prefetchRep = NULL;
+    prefetchMax = 0;
+    bufferingCurrent = 0;
+    bufferingTarget = 0;
 }
 
 SegmentTracker::~SegmentTracker()
@@ -154,6 +158,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    flushPrefetched();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -266,6 +271,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA, next, &next, &b_gap);
     if(!segment)
     {
+        flushPrefetched();
         return NULL;
     }
 
@@ -276,15 +282,15 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(resources, connManager, next, rep);
+    const Timescale timescale = rep->inheritTimescale();
+    vlc_tick_t duration = timescale.ToTime(segment->duration.Get());
+    SegmentChunk *chunk = takePrefetched(rep, next, &duration);
+    if(!chunk)
+        chunk = segment->toChunk(resources, connManager, next, rep);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
-    {
-        const Timescale timescale = rep->inheritTimescale();
-        notify(SegmentTrackerEvent(rep->getAdaptationSet()->getID(),
-                                   timescale.ToTime(segment->duration.Get())));
-    }
+        notify(SegmentTrackerEvent(rep->getAdaptationSet()->getID(), duration));
 
     /* We need to check segment/chunk format changes, as we can't rely on representation's (HLS)*/
     if(chunk && format != chunk->getStreamFormat())
@@ -303,11 +309,83 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetch(rep, connManager, duration);
     }
 
     return chunk;
 }
 
+/* Requests the following segments ahead, while they fit in the buffering
+ * target, so their downloads start without waiting for the demuxer */
+void SegmentTracker::prefetch(BaseRepresentation *rep,
+                              AbstractConnectionManager *connManager,
+                              vlc_tick_t ahead)
+{
+    if(!prefetchMax || !bufferingTarget || rep->getPlaylist()->isLive())
+        return;
+
+    ahead += bufferingCurrent;
+    uint64_t number = next;
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+    {
+        ahead += (*it).duration;
+        number = (*it).number + 1;
+    }
+
+    const Timescale timescale = rep->inheritTimescale();
+    while(prefetched.size() < prefetchMax && ahead < bufferingTarget)
+    {
+        uint64_t segnumber;
+        bool b_gap = false;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &segnumber, &b_gap);
+        if(!segment || b_gap || segnumber != number)
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(resources, connManager, number, rep);
+        if(!chunk)
+            break;
+
+        PrefetchedChunk p;
+        p.number = number;
+        p.duration = timescale.ToTime(segment->duration.Get());
+        p.chunk = chunk;
+        prefetched.push_back(p);
+        prefetchRep = rep;
+
+        ahead += p.duration;
+        number++;
+    }
+}
+
+SegmentChunk * SegmentTracker::takePrefetched(const BaseRepresentation *rep,
+                                              uint64_t number, vlc_tick_t *duration)
+{
+    if(prefetched.empty())
+        return NULL;
+
+    if(rep != prefetchRep || prefetched.front().number != number)
+    {
+        flushPrefetched();
+        return NULL;
+    }
+
+    PrefetchedChunk p = prefetched.front();
+    prefetched.pop_front();
+    *duration = p.duration;
+    return p.chunk;
+}
+
+void SegmentTracker::flushPrefetched()
+{
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        delete (*it).chunk;
+    prefetched.clear();
+    prefetchRep = NULL;
+}
+
 bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -342,6 +420,7 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         index_sent = false;
         init_sent = false;
     }
+    flushPrefetched();
     curNumber = next = segnumber;
 }
 
@@ -379,16 +458,38 @@ vlc_tick_t SegmentTracker::getMinAheadTime() const
     return 0;
 }
 
+bool SegmentTracker::getLiveEdgeDistance(vlc_tick_t time, vlc_tick_t *distance) const
+{
+    uint64_t number;
+    vlc_tick_t start, duration;
+    BaseRepresentation *rep = curRepresentation;
+    if(!rep || !rep->getPlaylist()->isLive() ||
+       !rep->getSegmentNumberByTime(time, &number) ||
+       !rep->getPlaybackTimeDurationBySegmentNumber(number, &start, &duration))
+        return false;
+    /* remaining of the playing segment + published segments after it */
+    *distance = std::max(start + duration - time, vlc_tick_t(0)) +
+                rep->getMinAheadTime(number);
+    return true;
+}
+
 void SegmentTracker::notifyBufferingState(bool enabled) const
 {
     notify(SegmentTrackerEvent(adaptationSet->getID(), enabled));
 }
 
-void SegmentTracker::notifyBufferingLevel(vlc_tick_t min, vlc_tick_t current, vlc_tick_t target) const
+void SegmentTracker::notifyBufferingLevel(vlc_tick_t min, vlc_tick_t current, vlc_tick_t target)
 {
+    bufferingCurrent = current;
+    bufferingTarget = target;
     notify(SegmentTrackerEvent(adaptationSet->getID(), min, current, target));
 }
 
+void SegmentTracker::setPrefetchMax(unsigned max)
+{
+    prefetchMax = max;
+}
+
 void SegmentTracker::registerListener(SegmentTrackerListenerInterface *listener)
 {
     listeners.push_back(listener);
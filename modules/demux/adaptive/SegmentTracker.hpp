@@ -132,14 +132,19 @@ namespace adaptive
             vlc_tick_t getPlaybackTime() const; /* Current segment start time if selected */
             bool getMediaPlaybackRange(vlc_tick_t *, vlc_tick_t *, vlc_tick_t *) const;
             vlc_tick_t getMinAheadTime() const;
+            bool getLiveEdgeDistance(vlc_tick_t, vlc_tick_t *) const;
             void notifyBufferingState(bool) const;
-            void notifyBufferingLevel(vlc_tick_t, vlc_tick_t, vlc_tick_t) const;
+            void notifyBufferingLevel(vlc_tick_t, vlc_tick_t, vlc_tick_t);
+            void setPrefetchMax(unsigned);
             void registerListener(SegmentTrackerListenerInterface *);
             void updateSelected();
 
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            void prefetch(BaseRepresentation *, AbstractConnectionManager *, vlc_tick_t);
+            SegmentChunk * takePrefetched(const BaseRepresentation *, uint64_t, vlc_tick_t *);
+            void flushPrefetched();
             bool first;
             bool initializing;
             bool index_sent;
@@ -152,6 +157,18 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            /* Following segments already requested, in order */
+            struct PrefetchedChunk
+            {
+                uint64_t number;
+                vlc_tick_t duration;
+                SegmentChunk *chunk;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            const BaseRepresentation *prefetchRep;
+            unsigned prefetchMax;
+            vlc_tick_t bufferingCurrent;
+            vlc_tick_t bufferingTarget;
     };
 }
 
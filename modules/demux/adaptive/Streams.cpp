@@ -414,7 +414,7 @@ AbstractStream::buffering_status AbstractStream::doBufferize(vlc_tick_t nz_deadl
     return AbstractStream::buffering_full;
 }
 
-AbstractStream::status AbstractStream::dequeue(vlc_tick_t nz_deadline, vlc_tick_t *pi_pcr)
+AbstractStream::status AbstractStream::dequeue(es_out_t *out, vlc_tick_t nz_deadline, vlc_tick_t *pi_pcr)
 {
     vlc_mutex_locker locker(&lock);
 
@@ -427,7 +427,7 @@ AbstractStream::status AbstractStream::dequeue(vlc_tick_t nz_deadline, vlc_tick_
                  msg_Dbg(p_realdemux, "Stream %s pcr %" PRId64 " dts %" PRId64 " deadline %" PRId64 " [DRAINING]",
                          description.c_str(), pcrvalue, dtsvalue, nz_deadline));
 
-        *pi_pcr = fakeEsOut()->commandsQueue()->Process(p_realdemux->out, VLC_TICK_0 + nz_deadline);
+        *pi_pcr = fakeEsOut()->commandsQueue()->Process(out, VLC_TICK_0 + nz_deadline);
         if(!fakeEsOut()->commandsQueue()->isEmpty())
             return AbstractStream::status_demuxed;
 
@@ -453,7 +453,7 @@ AbstractStream::status AbstractStream::dequeue(vlc_tick_t nz_deadline, vlc_tick_
 
     if(nz_deadline + VLC_TICK_0 <= bufferingLevel) /* demuxed */
     {
-        *pi_pcr = fakeEsOut()->commandsQueue()->Process( p_realdemux->out, VLC_TICK_0 + nz_deadline );
+        *pi_pcr = fakeEsOut()->commandsQueue()->Process( out, VLC_TICK_0 + nz_deadline );
         return AbstractStream::status_demuxed;
     }
 
@@ -576,6 +576,19 @@ bool AbstractStream::getMediaPlaybackTimes(vlc_tick_t *start, vlc_tick_t *end,
             fakeEsOut()->getStartTimestamps(mediaStart, demuxStart));
 }
 
+bool AbstractStream::getLiveEdgeDistance(vlc_tick_t demuxTime, vlc_tick_t *distance) const
+{
+    vlc_mutex_locker locker(&lock);
+
+    vlc_tick_t mediaStart, demuxStart;
+    if(!valid || disabled ||
+       !fakeEsOut()->getStartTimestamps(&mediaStart, &demuxStart))
+        return false;
+    /* convert to playlist time, see PlaylistManager::updateControlsPosition() */
+    return segmentTracker->getLiveEdgeDistance(mediaStart + demuxTime - demuxStart,
+                                               distance);
+}
+
 void AbstractStream::runUpdates()
 {
     if(valid && !disabled)
@@ -664,6 +677,19 @@ void AbstractStream::trackerEvent(const SegmentTrackerEvent &event)
             }
             break;
 
+        case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+            /* Let the downloader serve first the streams closest to underrun */
+            if(connManager)
+                connManager->updateBufferingLevel(*event.u.buffering_level.id,
+                                                  event.u.buffering_level.current,
+                                                  event.u.buffering_level.target);
+            break;
+
+        case SegmentTrackerEvent::BUFFERING_STATE:
+            if(connManager && !event.u.buffering.enabled)
+                connManager->clearBufferingLevel(*event.u.buffering.id);
+            break;
+
         default:
             break;
     }
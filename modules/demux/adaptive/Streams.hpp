@@ -85,11 +85,12 @@ namespace adaptive
         buffering_status bufferize(vlc_tick_t, vlc_tick_t, vlc_tick_t);
         buffering_status getLastBufferStatus() const;
         vlc_tick_t getDemuxedAmount() const;
-        status dequeue(vlc_tick_t, vlc_tick_t *);
+        status dequeue(es_out_t *, vlc_tick_t, vlc_tick_t *);
         bool decodersDrained();
         virtual bool setPosition(vlc_tick_t, bool);
         bool getMediaPlaybackTimes(vlc_tick_t *, vlc_tick_t *, vlc_tick_t *,
                                    vlc_tick_t *, vlc_tick_t *) const;
+        bool getLiveEdgeDistance(vlc_tick_t, vlc_tick_t *) const;
         void runUpdates();
 
         /* Used by demuxers fake streams */
@@ -76,10 +76,29 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_WORKERS_TEXT N_("Parallel downloads")
+#define ADAPT_WORKERS_LONGTEXT N_("Number of segments that can be downloaded " \
+                                  "at the same time, for different streams")
+
+#define ADAPT_PREFETCH_TEXT N_("Prefetched segments")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of following segments of a stream " \
+                                   "requested ahead, within the buffering target")
+
+#define ADAPT_LOWLATENCY_TEXT N_("Low latency live playback")
+#define ADAPT_LOWLATENCY_LONGTEXT N_("Use the low latency extensions of live HLS " \
+                                     "and DASH streams, and keep the playback close " \
+                                     "to the advertised target latency")
+
+#define ADAPT_TELEMETRY_TEXT N_("Adaptation telemetry file")
+#define ADAPT_TELEMETRY_LONGTEXT N_("Append a JSON line per downloaded segment " \
+                                    "with the selected representation, download " \
+                                    "size and time, buffering level and reason")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
                                 AbstractAdaptationLogic::NearOptimal,
+                                AbstractAdaptationLogic::Hybrid,
                                 AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
@@ -89,6 +108,7 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "hybrid",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -97,6 +117,7 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Hybrid Buffer/Bandwidth"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -122,6 +143,14 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-download-workers", 1, 1, 8,
+                                ADAPT_WORKERS_TEXT, ADAPT_WORKERS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-prefetch", 2, 0, 8,
+                                ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
+        add_bool   ( "adaptive-lowlatency", false,
+                     ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT, true )
+        add_savefile( "adaptive-telemetry", NULL,
+                      ADAPT_TELEMETRY_TEXT, ADAPT_TELEMETRY_LONGTEXT )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
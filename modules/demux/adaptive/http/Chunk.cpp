@@ -60,6 +60,11 @@ const BytesRange & AbstractChunkSource::getBytesRange() const
     return bytesRange;
 }
 
+void AbstractChunkSource::setSegmentIdentity(const SegmentIdentity &identity)
+{
+    segmentIdentity = identity;
+}
+
 std::string AbstractChunkSource::getContentType() const
 {
     return std::string();
@@ -225,7 +230,8 @@ block_t * HTTPChunkSource::read(size_t readsize)
         if((size_t)ret < readsize)
             eof = true;
         if(ret && time)
-            connManager->updateDownloadRate(sourceid, p_block->i_buffer, time);
+            connManager->updateDownloadRate(sourceid, p_block->i_buffer, time,
+                                            segmentIdentity);
     }
 
     return p_block;
@@ -302,7 +308,11 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
-    downloadstart = 0;
+    downloadtime = 0;
+    coalesced = false;
+    rangePrev = NULL;
+    rangeNext = NULL;
+    started = false;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -344,8 +354,12 @@ void HTTPChunkBufferedSource::release()
     vlc_cond_signal(&avail);
 }
 
-void HTTPChunkBufferedSource::bufferize(size_t readsize)
+size_t HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
+    /* Only account for the time spent on this source, as downloads of
+     * different sources can be interleaved */
+    const vlc_tick_t start = vlc_tick_now();
+
     vlc_mutex_lock(&lock);
     if(!prepare())
     {
@@ -353,14 +367,15 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         eof = true;
         vlc_cond_signal(&avail);
         vlc_mutex_unlock(&lock);
-        return;
+        return 0;
     }
 
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
-    if(contentLength && readsize > contentLength - buffered)
-        readsize = contentLength - buffered;
+    /* The response can extend past our own range */
+    if(contentLength && readsize > contentLength - buffered - consumed)
+        readsize = contentLength - buffered - consumed;
 
     vlc_mutex_unlock(&lock);
 
@@ -368,7 +383,7 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     if(!p_block)
     {
         eof = true;
-        return;
+        return 0;
     }
 
     struct
@@ -377,16 +392,17 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_tick_t time;
     } rate = {0,0};
 
-    ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    ssize_t ret = connection->readSome(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
         block_Release(p_block);
         p_block = NULL;
         vlc_mutex_locker locker( &lock );
         done = true;
+        downloadtime += vlc_tick_now() - start;
         rate.size = buffered + consumed;
-        rate.time = vlc_tick_now() - downloadstart;
-        downloadstart = 0;
+        rate.time = downloadtime;
+        ret = 0;
     }
     else
     {
@@ -394,31 +410,88 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_mutex_locker locker( &lock );
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
-        if((size_t) ret < readsize)
+        downloadtime += vlc_tick_now() - start;
+        /* A short read is not the end of a chunked response */
+        if(contentLength && buffered + consumed >= contentLength)
         {
             done = true;
             rate.size = buffered + consumed;
-            rate.time = vlc_tick_now() - downloadstart;
-            downloadstart = 0;
+            rate.time = downloadtime;
         }
     }
 
     if(rate.size && rate.time)
     {
-        connManager->updateDownloadRate(sourceid, rate.size, rate.time);
+        connManager->updateDownloadRate(sourceid, rate.size, rate.time,
+                                        segmentIdentity);
     }
 
     vlc_cond_signal(&avail);
+    return (size_t) ret;
 }
 
 bool HTTPChunkBufferedSource::prepare()
 {
-    if(!prepared)
+    if(prepared)
+        return true;
+
+    /* Also request the ranges of the following sources, if any */
+    const BytesRange ownRange = bytesRange;
+    bytesRange = requestRange;
+    bool b_ret = HTTPChunkSource::prepare();
+    bytesRange = ownRange;
+
+    if(b_ret && requestRange.getEndByte() != ownRange.getEndByte())
     {
-        downloadstart = vlc_tick_now();
-        return HTTPChunkSource::prepare();
+        coalesced = (contentLength == requestRange.getEndByte() -
+                                      requestRange.getStartByte() + 1);
+        contentLength = ownRange.getEndByte() - ownRange.getStartByte() + 1;
     }
-    return true;
+    return b_ret;
+}
+
+bool HTTPChunkBufferedSource::canCoalesce(const HTTPChunkBufferedSource *next) const
+{
+    const BytesRange &nextRange = next->getBytesRange();
+    return rangeNext == NULL &&
+           bytesRange.isValid() && bytesRange.getEndByte() > 0 &&
+           nextRange.isValid() && nextRange.getEndByte() > 0 &&
+           bytesRange.getEndByte() + 1 == nextRange.getStartByte() &&
+           params.getUrl() == next->params.getUrl();
+}
+
+void HTTPChunkBufferedSource::handOver(HTTPChunkBufferedSource *next)
+{
+    AbstractConnection *conn = NULL;
+
+    vlc_mutex_lock(&lock);
+    /* Only a complete part leaves the connection at the next range */
+    if(coalesced && connection && buffered + consumed == contentLength)
+    {
+        conn = connection;
+        contentType = conn->getContentType();
+        connection = NULL;
+    }
+    vlc_mutex_unlock(&lock);
+
+    if(!conn)
+        return;
+
+    vlc_mutex_locker locker(&next->lock);
+    const BytesRange &range = next->bytesRange;
+    next->connection = conn;
+    next->contentLength = range.getEndByte() - range.getStartByte() + 1;
+    next->coalesced = true;
+    next->prepared = true;
+}
+
+std::string HTTPChunkBufferedSource::getContentType() const
+{
+    vlc_mutex_locker locker(&lock);
+    if(connection)
+        return connection->getContentType();
+    else
+        return contentType;
 }
 
 bool HTTPChunkBufferedSource::hasMoreData() const
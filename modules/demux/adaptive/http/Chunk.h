@@ -28,6 +28,7 @@
 #include "BytesRange.hpp"
 #include "ConnectionParams.hpp"
 #include "../ID.hpp"
+#include "../logic/IDownloadRateObserver.h"
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -52,6 +53,7 @@ namespace adaptive
                 virtual bool        hasMoreData     () const = 0;
                 void                setBytesRange   (const BytesRange &);
                 const BytesRange &  getBytesRange   () const;
+                void                setSegmentIdentity(const SegmentIdentity &);
                 virtual std::string getContentType  () const;
                 enum RequestStatus  getRequestStatus() const;
 
@@ -59,6 +61,7 @@ namespace adaptive
                 enum RequestStatus  requeststatus;
                 size_t              contentLength;
                 BytesRange          bytesRange;
+                SegmentIdentity     segmentIdentity;
         };
 
         class AbstractChunk
@@ -109,10 +112,10 @@ namespace adaptive
                 bool                prepared;
                 bool                eof;
                 ID                  sourceid;
+                ConnectionParams    params;
 
             private:
                 bool init(const std::string &);
-                ConnectionParams    params;
         };
 
         class HTTPChunkBufferedSource : public HTTPChunkSource
@@ -126,13 +129,16 @@ namespace adaptive
                 virtual block_t *  readBlock       (); /* reimpl */
                 virtual block_t *  read            (size_t); /* reimpl */
                 virtual bool       hasMoreData     () const; /* impl */
+                virtual std::string getContentType () const; /* reimpl */
                 void               hold();
                 void               release();
 
             protected:
                 virtual bool       prepare(); /* reimpl */
-                void               bufferize(size_t);
+                size_t             bufferize(size_t);
                 bool               isDone() const;
+                bool               canCoalesce(const HTTPChunkBufferedSource *) const;
+                void               handOver(HTTPChunkBufferedSource *);
 
             private:
                 block_t            *p_head; /* read cache buffer */
@@ -140,9 +146,18 @@ namespace adaptive
                 size_t              buffered; /* read cache size */
                 bool                done;
                 bool                eof;
-                vlc_tick_t          downloadstart;
+                vlc_tick_t          downloadtime;
                 vlc_cond_t          avail;
                 bool                held;
+                bool                coalesced; /* response covers the following ranges */
+                std::string         contentType; /* once the connection is handed over */
+                /* Contiguous ranges of the same resource are requested at once
+                 * by the first source, which then hands the connection over
+                 * to the next one. Protected by the Downloader lock. */
+                HTTPChunkBufferedSource *rangePrev;
+                HTTPChunkBufferedSource *rangeNext;
+                BytesRange          requestRange;
+                bool                started;
         };
 
         class HTTPChunk : public AbstractChunk
@@ -25,93 +25,249 @@
 
 #include <vlc_threads.h>
 
-#include <atomic>
+#include <algorithm>
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Worker::Worker(Downloader *d)
+{
+    downloader = d;
+    current = NULL;
+}
+
+Downloader::Downloader(unsigned count)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    maxworkers = count ? count : 1;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(workers.size() < maxworkers)
     {
-        return false;
+        Worker *worker = new (std::nothrow) Worker(this);
+        if(!worker)
+            break;
+        if(vlc_clone(&worker->thread_handle, downloaderThread,
+                     static_cast<void *>(worker), VLC_THREAD_PRIORITY_INPUT))
+        {
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
     }
-    thread_handle_valid = true;
-    return true;
+    return !workers.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<Worker *>::iterator it;
+    for(it = workers.begin(); it != workers.end(); ++it)
+    {
+        vlc_join((*it)->thread_handle, NULL);
+        delete *it;
+    }
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     source->hold();
+    source->requestRange = source->getBytesRange();
+    coalesce(source);
     chunks.push_back(source);
     vlc_cond_signal(&waitcond);
     vlc_mutex_unlock(&lock);
 }
 
+/* Appends the range of the source to the request of the previous source of
+ * the same stream, if they are contiguous and that request is not sent yet */
+void Downloader::coalesce(HTTPChunkBufferedSource *source)
+{
+    HTTPChunkBufferedSource *prev = NULL;
+
+    std::list<HTTPChunkBufferedSource *>::const_reverse_iterator it;
+    for(it = chunks.rbegin(); it != chunks.rend(); ++it)
+    {
+        if((*it)->sourceid == source->sourceid)
+        {
+            prev = *it;
+            break;
+        }
+    }
+
+    if(!prev || !prev->canCoalesce(source))
+        return;
+
+    HTTPChunkBufferedSource *first = prev;
+    while(first->rangePrev)
+        first = first->rangePrev;
+    if(first->started)
+        return;
+
+    prev->rangeNext = source;
+    source->rangePrev = prev;
+    first->requestRange = BytesRange(first->requestRange.getStartByte(),
+                                     source->getBytesRange().getEndByte());
+}
+
+/* Removes the source from its coalesced request: the following sources
+ * will request their own ranges */
+void Downloader::uncoalesce(HTTPChunkBufferedSource *source)
+{
+    HTTPChunkBufferedSource *prev = source->rangePrev;
+    if(prev)
+    {
+        prev->rangeNext = NULL;
+        HTTPChunkBufferedSource *first = prev;
+        while(first->rangePrev)
+            first = first->rangePrev;
+        if(!first->started)
+            first->requestRange = BytesRange(first->requestRange.getStartByte(),
+                                             prev->getBytesRange().getEndByte());
+    }
+
+    HTTPChunkBufferedSource *next = source->rangeNext;
+    while(next)
+    {
+        HTTPChunkBufferedSource *following = next->rangeNext;
+        next->rangePrev = NULL;
+        next->rangeNext = NULL;
+        next = following;
+    }
+
+    source->rangePrev = NULL;
+    source->rangeNext = NULL;
+}
+
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the worker to return the source */
+    while(isActive(source))
+        vlc_cond_wait(&updatedcond, &lock);
+    uncoalesce(source);
     source->release();
     chunks.remove(source);
     vlc_mutex_unlock(&lock);
 }
 
+void Downloader::updateBufferingLevel(const ID &id, vlc_tick_t current,
+                                      vlc_tick_t target)
+{
+    vlc_mutex_locker locker(&lock);
+    bufferingRatios[id] = (target > 0) ? (double) current / target : 1.0;
+}
+
+void Downloader::clearBufferingLevel(const ID &id)
+{
+    vlc_mutex_locker locker(&lock);
+    bufferingRatios.erase(id);
+}
+
 void * Downloader::downloaderThread(void *opaque)
 {
-    Downloader *instance = static_cast<Downloader *>(opaque);
+    Worker *worker = static_cast<Worker *>(opaque);
     int canc = vlc_savecancel();
-    instance->Run();
+    worker->downloader->Run(worker);
     vlc_restorecancel( canc );
     return NULL;
 }
 
+bool Downloader::isActive(const HTTPChunkBufferedSource *source) const
+{
+    std::vector<Worker *>::const_iterator it;
+    for(it = workers.begin(); it != workers.end(); ++it)
+        if((*it)->current == source)
+            return true;
+    return false;
+}
+
+/* Picks the next source to download from. Only the oldest pending source
+ * of each stream is eligible, and only if no worker is already on it, so
+ * that a stream never occupies more than one worker. The stream with the
+ * lowest buffering level goes first. */
+HTTPChunkBufferedSource * Downloader::nextSource() const
+{
+    HTTPChunkBufferedSource *best = NULL;
+    double bestRatio = 0.0;
+    std::list<ID> seen;
+
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = chunks.begin(); it != chunks.end(); ++it)
+    {
+        HTTPChunkBufferedSource *source = *it;
+        const ID &id = source->sourceid;
+
+        if(std::find(seen.begin(), seen.end(), id) != seen.end())
+            continue;
+        seen.push_back(id);
+
+        if(isActive(source))
+            continue;
+
+        std::map<ID, double>::const_iterator r = bufferingRatios.find(id);
+        double ratio = (r != bufferingRatios.end()) ? (*r).second : 1.0;
+
+        if(!best || ratio < bestRatio)
+        {
+            best = source;
+            bestRatio = ratio;
+        }
+    }
+    return best;
+}
+
 void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
 {
+    /* The source reports its own download rate, only accounting for
+     * the time workers spent on it */
     if(!source->isDone())
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
-void Downloader::Run()
+void Downloader::Run(Worker *worker)
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+        while(!killed && (source = nextSource()) == NULL)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        worker->current = source;
+        source->started = true;
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        worker->current = NULL;
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
+            HTTPChunkBufferedSource *next = source->rangeNext;
+            if(next)
             {
-                chunks.pop_front();
-                source->release();
+                next->rangePrev = NULL;
+                source->rangeNext = NULL;
+                source->handOver(next);
             }
+            chunks.remove(source);
+            source->release();
         }
+        /* the source, or the next one of its stream, is now available */
+        vlc_cond_signal(&waitcond);
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
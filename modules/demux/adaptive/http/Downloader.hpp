@@ -24,6 +24,8 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,22 +36,39 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
+                void updateBufferingLevel(const ID &, vlc_tick_t, vlc_tick_t);
+                void clearBufferingLevel(const ID &);
 
             private:
+                class Worker
+                {
+                    public:
+                        Worker(Downloader *);
+                        Downloader  *downloader;
+                        vlc_thread_t thread_handle;
+                        HTTPChunkBufferedSource *current;
+                };
+
                 static void * downloaderThread(void *);
-                void Run();
+                void Run(Worker *);
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * nextSource() const;
+                void coalesce(HTTPChunkBufferedSource *);
+                void uncoalesce(HTTPChunkBufferedSource *);
+                bool isActive(const HTTPChunkBufferedSource *) const;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
                 bool         killed;
+                unsigned     maxworkers;
+                std::vector<Worker *> workers;
                 std::list<HTTPChunkBufferedSource *> chunks;
+                std::map<ID, double> bufferingRatios;
         };
 
     }
@@ -65,6 +65,11 @@ const std::string & AbstractConnection::getContentType() const
     return contentType;
 }
 
+ssize_t AbstractConnection::readSome(void *p_buffer, size_t len)
+{
+    return read(p_buffer, len);
+}
+
 HTTPConnection::HTTPConnection(vlc_object_t *p_object_, AuthStorage *auth,
                                Transport *socket_, const ConnectionParams &proxy, bool persistent)
     : AbstractConnection( p_object_ )
@@ -207,6 +212,16 @@ enum RequestStatus
 }
 
 ssize_t HTTPConnection::read(void *p_buffer, size_t len)
+{
+    return read(p_buffer, len, false);
+}
+
+ssize_t HTTPConnection::readSome(void *p_buffer, size_t len)
+{
+    return read(p_buffer, len, true);
+}
+
+ssize_t HTTPConnection::read(void *p_buffer, size_t len, bool b_partial)
 {
     if( !connected() ||
        (!queryOk && bytesRead == 0) )
@@ -224,12 +239,13 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(len > toRead)
         len = toRead;
 
-    ssize_t ret = ( chunked ) ? readChunk(p_buffer, len)
+    ssize_t ret = ( chunked ) ? readChunk(p_buffer, len, b_partial)
                               : transport->read(p_buffer, len);
     if(ret >= 0)
         bytesRead += ret;
 
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
+    const bool b_eof = (chunked && b_partial) ? chunked_eof : (size_t)ret < len;
+    if(ret < 0 || b_eof || /* set EOF */
        (contentLength == bytesRead && connectionClose))
     {
         transport->disconnect();
@@ -309,7 +325,7 @@ enum RequestStatus
     return RequestStatus::Success;
 }
 
-ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
+ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len, bool b_partial)
 {
     size_t copied = 0;
 
@@ -351,6 +367,9 @@ ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
             ssize_t in = transport->read(&crlf, 2);
             if(in < 2 || memcmp(crlf, "\r\n", 2))
                 return (copied == 0) ? -1 : copied;
+            /* Hand over each chunk as soon as it is received (chunked CMAF) */
+            if(b_partial && copied)
+                break;
         }
     }
 
@@ -47,10 +47,21 @@ AbstractConnectionManager::~AbstractConnectionManager()
 
 }
 
-void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, vlc_tick_t time)
+void AbstractConnectionManager::updateDownloadRate(const adaptive::ID &sourceid, size_t size, vlc_tick_t time,
+                                                   const SegmentIdentity &segment)
 {
     if(rateObserver)
-        rateObserver->updateDownloadRate(sourceid, size, time);
+        rateObserver->updateDownloadRate(sourceid, size, time, segment);
+}
+
+void AbstractConnectionManager::updateBufferingLevel(const adaptive::ID &, vlc_tick_t, vlc_tick_t)
+{
+
+}
+
+void AbstractConnectionManager::clearBufferingLevel(const adaptive::ID &)
+{
+
 }
 
 void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *obs)
@@ -64,7 +75,8 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthSt
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    int64_t workers = var_InheritInteger(p_object, "adaptive-download-workers");
+    downloader = new (std::nothrow) Downloader(workers > 0 ? workers : 1);
     downloader->start();
     factory = new ConnectionFactory(storage);
 }
@@ -155,6 +167,17 @@ void HTTPConnectionManager::cancel(AbstractChunkSource *source)
         downloader->cancel(src);
 }
 
+void HTTPConnectionManager::updateBufferingLevel(const adaptive::ID &id,
+                                                 vlc_tick_t current, vlc_tick_t target)
+{
+    downloader->updateBufferingLevel(id, current, target);
+}
+
+void HTTPConnectionManager::clearBufferingLevel(const adaptive::ID &id)
+{
+    downloader->clearBufferingLevel(id);
+}
+
 void HTTPConnectionManager::setLocalConnectionsAllowed()
 {
     localAllowed = true;
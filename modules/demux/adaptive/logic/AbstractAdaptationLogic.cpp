@@ -42,10 +42,16 @@ AbstractAdaptationLogic::~AbstractAdaptationLogic   ()
 {
 }
 
-void AbstractAdaptationLogic::updateDownloadRate    (const adaptive::ID &, size_t, vlc_tick_t)
+void AbstractAdaptationLogic::updateDownloadRate    (const adaptive::ID &, size_t, vlc_tick_t,
+                                                     const SegmentIdentity &)
 {
 }
 
+const char * AbstractAdaptationLogic::getDecisionReason(const adaptive::ID &) const
+{
+    return NULL;
+}
+
 void AbstractAdaptationLogic::setMaxDeviceResolution (int w, int h)
 {
     maxwidth = (w > 0) ? w : std::numeric_limits<int>::max();
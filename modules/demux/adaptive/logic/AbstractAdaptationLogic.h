@@ -48,8 +48,11 @@ namespace adaptive
                 virtual ~AbstractAdaptationLogic    ();
 
                 virtual BaseRepresentation* getNextRepresentation(BaseAdaptationSet *, BaseRepresentation *) = 0;
-                virtual void                updateDownloadRate     (const ID &, size_t, vlc_tick_t);
+                virtual void                updateDownloadRate     (const ID &, size_t, vlc_tick_t,
+                                                                    const SegmentIdentity &);
                 virtual void                trackerEvent           (const SegmentTrackerEvent &) {}
+                /* Why the last representation of a stream was picked, if known */
+                virtual const char *        getDecisionReason      (const ID &) const;
                 void                        setMaxDeviceResolution (int, int);
 
                 enum LogicType
@@ -61,6 +64,7 @@ namespace adaptive
                     FixedRate,
                     Predictive,
                     NearOptimal,
+                    Hybrid,
                 };
 
             protected:
@@ -0,0 +1,158 @@
+/*
+ * AdaptationTelemetry.cpp
+ *****************************************************************************
+ * Copyright (C) 2020 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "AdaptationTelemetry.hpp"
+#include "AbstractAdaptationLogic.h"
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+
+#include <vlc_fs.h>
+
+#include <cerrno>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+AdaptationTelemetry::StreamState::StreamState()
+    : buffering_level( 0 )
+    , buffering_target( 0 )
+{ }
+
+AdaptationTelemetry::AdaptationTelemetry(vlc_object_t *obj, AbstractAdaptationLogic *logic_)
+{
+    p_obj = obj;
+    logic = logic_;
+    output = NULL;
+    start = vlc_tick_now();
+    vlc_mutex_init(&lock);
+}
+
+AdaptationTelemetry::~AdaptationTelemetry()
+{
+    if(output)
+        fclose(output);
+}
+
+bool AdaptationTelemetry::open(const char *psz_path)
+{
+    output = vlc_fopen(psz_path, "at");
+    if(!output)
+    {
+        msg_Err(p_obj, "cannot open telemetry file %s: %s", psz_path,
+                vlc_strerror_c(errno));
+        return false;
+    }
+    msg_Dbg(p_obj, "writing adaptation telemetry to %s", psz_path);
+    return true;
+}
+
+static std::string escapeJSON(const std::string &str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for(std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+        const unsigned char c = *it;
+        if(c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if(c < 0x20)
+        {
+            char code[7];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else escaped += c;
+    }
+    return escaped;
+}
+
+void AdaptationTelemetry::updateDownloadRate(const ID &id, size_t size, vlc_tick_t time,
+                                             const SegmentIdentity &segment)
+{
+    logic->updateDownloadRate(id, size, time, segment);
+
+    vlc_mutex_locker locker(&lock);
+    std::map<ID, StreamState>::const_iterator it = streams.find(id);
+    if(it == streams.end())
+        return;
+    const StreamState &state = (*it).second;
+
+    /* The segment may have been requested ahead, under an earlier decision:
+     * report the reason of the last one which picked its representation */
+    std::map<std::string, std::string>::const_iterator reason =
+            state.reasons.find(segment.representation);
+
+    /* Representation ids come from the playlist, and need escaping */
+    fprintf(output, "{\"time\":%" PRId64 ",\"stream\":\"%s\",\"representation\":\"%s\","
+                    "\"segment\":%" PRIu64 ",\"bandwidth\":%" PRIu64 ",\"bytes\":%zu,"
+                    "\"download\":%" PRId64 ",\"duration\":%" PRId64 ","
+                    "\"buffering\":%" PRId64 ",\"target\":%" PRId64 ",\"reason\":\"%s\"}\n",
+            MS_FROM_VLC_TICK(vlc_tick_now() - start), escapeJSON(id.str()).c_str(),
+            escapeJSON(segment.representation).c_str(), segment.number,
+            segment.bandwidth, size, MS_FROM_VLC_TICK(time),
+            MS_FROM_VLC_TICK(segment.duration),
+            MS_FROM_VLC_TICK(state.buffering_level),
+            MS_FROM_VLC_TICK(state.buffering_target),
+            reason != state.reasons.end() ? escapeJSON((*reason).second).c_str() : "");
+    fflush(output);
+}
+
+void AdaptationTelemetry::trackerEvent(const SegmentTrackerEvent &event)
+{
+    vlc_mutex_locker locker(&lock);
+    switch(event.type)
+    {
+        case SegmentTrackerEvent::SWITCHING:
+            if(event.u.switching.next)
+            {
+                BaseRepresentation *rep = event.u.switching.next;
+                StreamState &state = streams[rep->getAdaptationSet()->getID()];
+                state.representation = rep->getID().str();
+            }
+            break;
+
+        case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        {
+            StreamState &state = streams[*event.u.buffering_level.id];
+            state.buffering_level = event.u.buffering_level.current;
+            state.buffering_target = event.u.buffering_level.target;
+            break;
+        }
+
+        case SegmentTrackerEvent::SEGMENT_CHANGE:
+        {
+            /* Issued right after the logic picked the segment representation,
+             * which is also the one of the segments prefetched after it */
+            StreamState &state = streams[*event.u.segment.id];
+            const char *reason = logic->getDecisionReason(*event.u.segment.id);
+            state.reasons[state.representation] = reason ? reason : "";
+            break;
+        }
+
+        default:
+            break;
+    }
+}
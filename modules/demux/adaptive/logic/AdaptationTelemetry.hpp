@@ -0,0 +1,72 @@
+/*
+ * AdaptationTelemetry.hpp
+ *****************************************************************************
+ * Copyright (C) 2020 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef ADAPTATIONTELEMETRY_HPP
+#define ADAPTATIONTELEMETRY_HPP
+
+#include "IDownloadRateObserver.h"
+#include "../SegmentTracker.hpp"
+#include "../ID.hpp"
+#include <map>
+#include <string>
+
+namespace adaptive
+{
+    namespace logic
+    {
+        class AbstractAdaptationLogic;
+
+        /* Writes one JSON line per downloaded segment, with the representation,
+         * its download size and time, the buffering level and the logic reason,
+         * so the adaptation can be replayed and tuned offline.
+         * Sits between the connection manager and the logic download rate
+         * observer, and listens to the segment trackers. */
+        class AdaptationTelemetry : public IDownloadRateObserver,
+                                    public SegmentTrackerListenerInterface
+        {
+            public:
+                AdaptationTelemetry(vlc_object_t *, AbstractAdaptationLogic *);
+                virtual ~AdaptationTelemetry();
+                bool open(const char *);
+
+                virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t,
+                                                const SegmentIdentity &); /* impl */
+                virtual void trackerEvent(const SegmentTrackerEvent &); /* impl */
+
+            private:
+                class StreamState
+                {
+                    public:
+                        StreamState();
+                        std::string representation; /* current one */
+                        vlc_tick_t buffering_level;
+                        vlc_tick_t buffering_target;
+                        std::map<std::string, std::string> reasons; /* per representation */
+                };
+                vlc_object_t *p_obj;
+                AbstractAdaptationLogic *logic;
+                FILE *output;
+                vlc_tick_t start;
+                std::map<ID, StreamState> streams;
+                vlc_mutex_t lock;
+        };
+    }
+}
+
+#endif // ADAPTATIONTELEMETRY_HPP
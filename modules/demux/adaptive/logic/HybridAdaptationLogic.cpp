@@ -0,0 +1,281 @@
+/*
+ * HybridAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2020 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../tools/Debug.hpp"
+
+#include <cmath>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * Throughput based selection while the buffer is low, then buffer based
+ * (BOLA, see NearOptimalAdaptationLogic) once it is filled enough, capped
+ * by the throughput so it never goes over what the network can sustain.
+ * Same idea as dash.js DYNAMIC strategy.
+ */
+
+#define minimumBufferS    VLC_TICK_FROM_SEC(6)  /* Qmin */
+#define bufferTargetS     VLC_TICK_FROM_SEC(30) /* Qmax */
+#define bufferBasedOnS    VLC_TICK_FROM_SEC(10)
+#define throughputSafety  0.9
+
+HybridContext::HybridContext()
+    : buffering_min( minimumBufferS )
+    , buffering_level( 0 )
+    , buffering_target( bufferTargetS )
+    , last_download_rate( 0 )
+    , b_buffer_based( false )
+    , reason( NULL )
+{ }
+
+HybridAdaptationLogic::HybridAdaptationLogic(vlc_object_t *obj)
+    : AbstractAdaptationLogic(obj)
+    , currentBps( 0 )
+    , usedBps( 0 )
+{
+    vlc_mutex_init(&lock);
+}
+
+HybridAdaptationLogic::~HybridAdaptationLogic()
+{
+}
+
+BaseRepresentation *
+HybridAdaptationLogic::getBufferBasedRepresentation(BaseAdaptationSet *adaptSet,
+                                                    RepresentationSelector &selector,
+                                                    const HybridContext &ctx) const
+{
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    const float umin = std::log((float)lowest->getBandwidth());
+    const float umax = std::log((float)highest->getBandwidth());
+
+    const float qmin = secf_from_vlc_tick(ctx.buffering_min);
+    const float qmax = std::max<float>(secf_from_vlc_tick(ctx.buffering_target), qmin + 1.0f);
+    const float gammaP = 1.0 + (umax - umin) / (qmax / qmin - 1.0);
+    const float Vd = (qmin - 1.0) / (umin + gammaP);
+    const float Q = secf_from_vlc_tick(ctx.buffering_level);
+
+    BaseRepresentation *ret = NULL;
+    BaseRepresentation *prev = NULL;
+    float argmax = 0;
+    for(BaseRepresentation *rep = lowest;
+                            rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        /* utility = log(S/Smin) */
+        const float utility = std::log((float)rep->getBandwidth()) - umin;
+        const float arg = ( Vd * (utility + gammaP) - Q ) / rep->getBandwidth();
+        if(ret == NULL || argmax <= arg)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+    return ret;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet,
+                                                                 BaseRepresentation *prevRep)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+
+    vlc_mutex_lock(&lock);
+
+    std::map<ID, HybridContext>::iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return selector.lowest(adaptSet);
+    }
+    HybridContext ctxcopy = (*it).second;
+
+    const unsigned bps = getAvailableBw(currentBps, prevRep);
+
+    vlc_mutex_unlock(&lock);
+
+    BaseRepresentation *throughputRep = selector.select(adaptSet, bps * throughputSafety);
+
+    /* Switch strategy with some hysteresis */
+    const vlc_tick_t bufferBasedOn = std::min(bufferBasedOnS, ctxcopy.buffering_target / 2);
+    if(ctxcopy.b_buffer_based)
+        ctxcopy.b_buffer_based = ctxcopy.buffering_level >= bufferBasedOn / 2;
+    else
+        ctxcopy.b_buffer_based = ctxcopy.buffering_level >= bufferBasedOn;
+
+    BaseRepresentation *m;
+    const char *reason;
+    if(prevRep == NULL) /* Starting */
+    {
+        m = throughputRep;
+        reason = "startup";
+    }
+    else if(!ctxcopy.b_buffer_based)
+    {
+        m = throughputRep;
+        reason = "throughput";
+        /* don't switch up while we're still below the minimum */
+        if(ctxcopy.buffering_level < ctxcopy.buffering_min &&
+           m->getBandwidth() > prevRep->getBandwidth())
+        {
+            m = prevRep;
+            reason = "low-buffer";
+        }
+    }
+    else
+    {
+        m = getBufferBasedRepresentation(adaptSet, selector, ctxcopy);
+        reason = "buffer";
+        if(m->getBandwidth() > throughputRep->getBandwidth() &&
+           m->getBandwidth() > prevRep->getBandwidth())
+        {
+            m = (throughputRep->getBandwidth() > prevRep->getBandwidth()) ? throughputRep
+                                                                         : prevRep;
+            reason = "buffer-capped";
+        }
+    }
+
+    vlc_mutex_lock(&lock);
+    it = streams.find(adaptSet->getID());
+    if(it != streams.end())
+    {
+        (*it).second.b_buffer_based = ctxcopy.b_buffer_based;
+        (*it).second.reason = reason;
+    }
+    vlc_mutex_unlock(&lock);
+
+    BwDebug( msg_Info(p_obj, "buffering level %.2f%% rep %" PRIu64 " kBps %u kBps (%s)",
+             (float) 100 * ctxcopy.buffering_level / ctxcopy.buffering_target,
+             m->getBandwidth()/8000, bps / 8000, reason); );
+
+    return m;
+}
+
+const char * HybridAdaptationLogic::getDecisionReason(const ID &id) const
+{
+    vlc_mutex_locker locker(&lock);
+    std::map<ID, HybridContext>::const_iterator it = streams.find(id);
+    return (it != streams.end()) ? (*it).second.reason : NULL;
+}
+
+unsigned HybridAdaptationLogic::getAvailableBw(unsigned i_bw, const BaseRepresentation *curRep) const
+{
+    unsigned i_remain = i_bw;
+    if(i_remain > usedBps)
+        i_remain -= usedBps;
+    else
+        i_remain = 0;
+    if(curRep)
+        i_remain += curRep->getBandwidth();
+    return i_remain > i_bw ? i_remain : i_bw;
+}
+
+unsigned HybridAdaptationLogic::getMaxCurrentBw() const
+{
+    unsigned i_max_bitrate = 0;
+    for(std::map<ID, HybridContext>::const_iterator it = streams.begin();
+                                                    it != streams.end(); ++it)
+        i_max_bitrate = std::max(i_max_bitrate, ((*it).second).last_download_rate);
+    return i_max_bitrate;
+}
+
+void HybridAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize, vlc_tick_t time,
+                                               const SegmentIdentity &)
+{
+    if(!time)
+        return;
+    vlc_mutex_lock(&lock);
+    std::map<ID, HybridContext>::iterator it = streams.find(id);
+    if(it != streams.end())
+    {
+        HybridContext &ctx = (*it).second;
+        ctx.last_download_rate = ctx.average.push(CLOCK_FREQ * dlsize * 8 / time);
+    }
+    currentBps = getMaxCurrentBw();
+    vlc_mutex_unlock(&lock);
+}
+
+void HybridAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    switch(event.type)
+    {
+    case SegmentTrackerEvent::SWITCHING:
+        {
+            vlc_mutex_lock(&lock);
+            if(event.u.switching.prev)
+                usedBps -= event.u.switching.prev->getBandwidth();
+            if(event.u.switching.next)
+                usedBps += event.u.switching.next->getBandwidth();
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_STATE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            if(event.u.buffering.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                {
+                    HybridContext ctx;
+                    streams.insert(std::pair<ID, HybridContext>(id, ctx));
+                }
+            }
+            else
+            {
+                std::map<ID, HybridContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+            }
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        {
+            const ID &id = *event.u.buffering_level.id;
+            vlc_mutex_lock(&lock);
+            std::map<ID, HybridContext>::iterator it = streams.find(id);
+            if(it != streams.end())
+            {
+                HybridContext &ctx = (*it).second;
+                if(event.u.buffering_level.minimum)
+                    ctx.buffering_min = event.u.buffering_level.minimum;
+                ctx.buffering_level = event.u.buffering_level.current;
+                ctx.buffering_target = event.u.buffering_level.target;
+            }
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    default:
+            break;
+    }
+}
@@ -26,15 +26,29 @@
 #define IDOWNLOADRATEOBSERVER_H_
 
 #include <vlc_common.h>
+#include <string>
 
 namespace adaptive
 {
     class ID;
 
+    /* Segment a download belongs to, as the logic may already be
+     * picking the following ones while it completes */
+    class SegmentIdentity
+    {
+        public:
+            SegmentIdentity() : bandwidth(0), number(0), duration(0) {}
+            std::string representation;
+            uint64_t bandwidth;
+            uint64_t number;
+            vlc_tick_t duration;
+    };
+
     class IDownloadRateObserver
     {
         public:
-            virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t) = 0;
+            virtual void updateDownloadRate(const ID &, size_t, vlc_tick_t,
+                                            const SegmentIdentity &) = 0;
             virtual ~IDownloadRateObserver(){}
     };
 }
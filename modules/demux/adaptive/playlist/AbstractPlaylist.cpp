@@ -46,7 +46,9 @@ AbstractPlaylist::AbstractPlaylist (vlc_object_t *p_object_) :
     minBufferTime = 0;
     timeShiftBufferDepth.Set( 0 );
     suggestedPresentationDelay.Set( 0 );
+    targetLatency.Set( 0 );
     b_needsUpdates = true;
+    b_lowLatency = var_InheritBool( p_object, "adaptive-lowlatency" );
 }
 
 AbstractPlaylist::~AbstractPlaylist()
@@ -87,15 +89,31 @@ void AbstractPlaylist::setMinBuffering( vlc_tick_t min )
 
 vlc_tick_t AbstractPlaylist::getMinBuffering() const
 {
+    /* Following the live edge: buffer half of the latency target */
+    if( isLowLatency() )
+        return std::max(targetLatency.Get() / 2, VLC_TICK_FROM_MS(500));
     return std::max(minBufferTime, VLC_TICK_FROM_SEC(6));
 }
 
 vlc_tick_t AbstractPlaylist::getMaxBuffering() const
 {
     const vlc_tick_t minbuf = getMinBuffering();
+    if( isLowLatency() )
+        return std::max(minbuf, targetLatency.Get());
     return std::max(minbuf, VLC_TICK_FROM_SEC(60));
 }
 
+bool AbstractPlaylist::lowLatencyEnabled() const
+{
+    return b_lowLatency;
+}
+
+bool AbstractPlaylist::isLowLatency() const
+{
+    /* Only when requested and advertised by the live playlist */
+    return b_lowLatency && targetLatency.Get() > 0 && isLive();
+}
+
 Url AbstractPlaylist::getUrlSegment() const
 {
     Url ret;
@@ -45,6 +45,8 @@ namespace adaptive
                 void                            setMinBuffering( vlc_tick_t );
                 vlc_tick_t                      getMinBuffering() const;
                 vlc_tick_t                      getMaxBuffering() const;
+                bool                            lowLatencyEnabled() const;
+                bool                            isLowLatency() const;
                 virtual void                    debug() = 0;
 
                 void    addPeriod               (BasePeriod *period);
@@ -69,6 +71,7 @@ namespace adaptive
                 Property<vlc_tick_t>                   maxSegmentDuration;
                 Property<vlc_tick_t>                   timeShiftBufferDepth;
                 Property<vlc_tick_t>                   suggestedPresentationDelay;
+                Property<vlc_tick_t>                   targetLatency;
 
             protected:
                 vlc_object_t                       *p_object;
@@ -78,6 +81,7 @@ namespace adaptive
                 std::string                         type;
                 vlc_tick_t                          minBufferTime;
                 bool                                b_needsUpdates;
+                bool                                b_lowLatency;
         };
     }
 }
@@ -89,6 +89,13 @@ SegmentChunk* ISegment::toChunk(SharedResources *res, AbstractConnectionManager
         if(startByte != endByte)
             source->setBytesRange(BytesRange(startByte, endByte));
 
+        SegmentIdentity identity;
+        identity.representation = rep->getID().str();
+        identity.bandwidth = rep->getBandwidth();
+        identity.number = index;
+        identity.duration = rep->inheritTimescale().ToTime(duration.Get());
+        source->setSegmentIdentity(identity);
+
         SegmentChunk *chunk = createChunk(source, rep);
         if(chunk)
         {
@@ -180,11 +180,15 @@ uint64_t SegmentInformation::getLiveSegmentNumberByTime(uint64_t def, vlc_tick_t
 
 uint64_t SegmentInformation::getLiveStartSegmentNumber(uint64_t def) const
 {
-    const vlc_tick_t i_max_buffering = getPlaylist()->getMaxBuffering() +
+    const bool b_lowlatency = getPlaylist()->isLowLatency();
+    /* Low latency starts at the latency target from the live edge, and
+     * the playback speed adjustment then follows that target */
+    const vlc_tick_t i_max_buffering = b_lowlatency ? getPlaylist()->targetLatency.Get() :
+                                       getPlaylist()->getMaxBuffering() +
                                     /* FIXME: add dynamic pts-delay */ VLC_TICK_FROM_SEC(1);
 
     /* Try to never buffer up to really end */
-    const uint64_t OFFSET_FROM_END = 3;
+    const uint64_t OFFSET_FROM_END = b_lowlatency ? 0 : 3;
 
     if( mediaSegmentTemplate )
     {
@@ -208,7 +212,8 @@ uint64_t SegmentInformation::getLiveStartSegmentNumber(uint64_t def) const
                 return 0;
             }
 
-            vlc_tick_t fromend = std::max( i_max_buffering, getPlaylist()->suggestedPresentationDelay.Get() );
+            vlc_tick_t fromend = b_lowlatency ? i_max_buffering :
+                                 std::max( i_max_buffering, getPlaylist()->suggestedPresentationDelay.Get() );
             if( endtime + duration <= timescale.ToScaled( fromend ) )
                 return start;
 
@@ -218,6 +223,14 @@ uint64_t SegmentInformation::getLiveStartSegmentNumber(uint64_t def) const
             return number;
         }
         /* Else compute, current time and timeshiftdepth based */
+        else if( mediaSegmentTemplate->duration.Get() && b_lowlatency )
+        {
+            /* Segment being played at the latency target */
+            const uint64_t startnumber = mediaSegmentTemplate->inheritStartNumber();
+            start = mediaSegmentTemplate->getLiveTemplateNumber(
+                        vlc_tick_from_sec(time(NULL)) - i_max_buffering );
+            return std::max( start, startnumber );
+        }
         else if( mediaSegmentTemplate->duration.Get() )
         {
             vlc_tick_t i_delay = getPlaylist()->suggestedPresentationDelay.Get();
@@ -252,7 +265,8 @@ uint64_t SegmentInformation::getLiveStartSegmentNumber(uint64_t def) const
         const std::vector<ISegment *> list = segmentList->getSegments();
 
         const ISegment *back = list.back();
-        vlc_tick_t fromend = std::max( i_max_buffering, getPlaylist()->suggestedPresentationDelay.Get() );
+        vlc_tick_t fromend = b_lowlatency ? i_max_buffering :
+                             std::max( i_max_buffering, getPlaylist()->suggestedPresentationDelay.Get() );
         stime_t bufferingstart = back->startTime.Get() + back->duration.Get() - timescale.ToScaled( fromend );
 
         uint64_t number;
@@ -57,6 +57,7 @@ MediaSegmentTemplate::MediaSegmentTemplate( SegmentInformation *parent ) :
     initialisationSegment.Set( NULL );
     templated = true;
     parentSegmentInformation = parent;
+    availabilityTimeOffset = 0;
 }
 
 MediaSegmentTemplate::~MediaSegmentTemplate()
@@ -171,7 +172,11 @@ stime_t MediaSegmentTemplate::getMinAheadScaledTime(uint64_t number) const
     if( segmentTimeline )
         return segmentTimeline->getMinAheadScaledTime(number);
 
-    uint64_t current = getLiveTemplateNumber(vlc_tick_from_sec(time(NULL)));
+    vlc_tick_t now = vlc_tick_from_sec(time(NULL));
+    /* Low latency: chunked segments are available before their end */
+    if(parentSegmentInformation->getPlaylist()->isLowLatency())
+        now += availabilityTimeOffset;
+    uint64_t current = getLiveTemplateNumber(now);
     return (current - number) * inheritDuration();
 }
 
@@ -185,6 +190,11 @@ void MediaSegmentTemplate::setStartNumber( uint64_t v )
     startNumber = v;
 }
 
+void MediaSegmentTemplate::setAvailabilityTimeOffset( vlc_tick_t v )
+{
+    availabilityTimeOffset = v;
+}
+
 void MediaSegmentTemplate::setSegmentTimeline( SegmentTimeline *v )
 {
     delete segmentTimeline;
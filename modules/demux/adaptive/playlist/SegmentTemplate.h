@@ -53,6 +53,7 @@ namespace adaptive
                 virtual ~MediaSegmentTemplate();
                 void setStartNumber( uint64_t );
                 void setSegmentTimeline( SegmentTimeline * );
+                void setAvailabilityTimeOffset( vlc_tick_t );
                 void updateWith( MediaSegmentTemplate * );
                 virtual uint64_t getSequenceNumber() const; /* reimpl */
                 uint64_t getLiveTemplateNumber(vlc_tick_t) const;
@@ -69,6 +70,7 @@ namespace adaptive
                 uint64_t startNumber;
                 SegmentTimeline *segmentTimeline;
                 SegmentInformation *parentSegmentInformation;
+                vlc_tick_t availabilityTimeOffset; /* segments requestable before completion */
         };
 
         class InitSegmentTemplate : public BaseSegmentTemplate
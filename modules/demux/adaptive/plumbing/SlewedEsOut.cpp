@@ -0,0 +1,139 @@
+/*
+ * SlewedEsOut.cpp
+ *****************************************************************************
+ * Copyright © 2020 VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SlewedEsOut.hpp"
+#include <vlc_es_out.h>
+#include <vlc_block.h>
+
+using namespace adaptive;
+
+/* Late blocks can still be using the previous anchors */
+#define MAX_ANCHORS 16
+
+SlewedEsOut::SlewedEsOut( es_out_t *es ) : AbstractFakeEsOut()
+{
+    real_es_out = es;
+}
+
+SlewedEsOut::~SlewedEsOut()
+{
+}
+
+void SlewedEsOut::setRate( double rate, vlc_tick_t time )
+{
+    if( time == VLC_TICK_INVALID || rate == getRate() )
+        return;
+
+    Anchor anchor;
+    anchor.in = time;
+    anchor.out = map( time );
+    anchor.rate = rate;
+    anchors.push_back( anchor );
+    if( anchors.size() > MAX_ANCHORS )
+        anchors.pop_front();
+}
+
+double SlewedEsOut::getRate() const
+{
+    return anchors.empty() ? 1.0 : anchors.back().rate;
+}
+
+void SlewedEsOut::reset()
+{
+    anchors.clear();
+}
+
+vlc_tick_t SlewedEsOut::map( vlc_tick_t t ) const
+{
+    if( t == VLC_TICK_INVALID || anchors.empty() )
+        return t;
+
+    std::list<Anchor>::const_reverse_iterator it;
+    for( it = anchors.rbegin(); it != anchors.rend(); ++it )
+    {
+        if( (*it).in <= t )
+            break;
+    }
+    const Anchor &anchor = ( it != anchors.rend() ) ? *it : anchors.front();
+    return anchor.out + vlc_tick_t((t - anchor.in) / anchor.rate);
+}
+
+es_out_id_t * SlewedEsOut::esOutAdd( const es_format_t *p_fmt )
+{
+    return es_out_Add( real_es_out, p_fmt );
+}
+
+int SlewedEsOut::esOutSend( es_out_id_t *p_es, block_t *p_block )
+{
+    if( !anchors.empty() )
+    {
+        p_block->i_dts = map( p_block->i_dts );
+        p_block->i_pts = map( p_block->i_pts );
+        if( p_block->i_length )
+            p_block->i_length = vlc_tick_t(p_block->i_length / getRate());
+    }
+    return es_out_Send( real_es_out, p_es, p_block );
+}
+
+void SlewedEsOut::esOutDel( es_out_id_t *p_es )
+{
+    es_out_Del( real_es_out, p_es );
+}
+
+int SlewedEsOut::esOutControl( int i_query, va_list args )
+{
+    switch( i_query )
+    {
+        case ES_OUT_SET_PCR:
+        {
+            vlc_tick_t pcr = va_arg( args, vlc_tick_t );
+            return es_out_Control( real_es_out, ES_OUT_SET_PCR, map( pcr ) );
+        }
+
+        case ES_OUT_SET_GROUP_PCR:
+        {
+            int i_group = va_arg( args, int );
+            vlc_tick_t pcr = va_arg( args, vlc_tick_t );
+            return es_out_Control( real_es_out, ES_OUT_SET_GROUP_PCR,
+                                   i_group, map( pcr ) );
+        }
+
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        {
+            vlc_tick_t time = va_arg( args, vlc_tick_t );
+            return es_out_Control( real_es_out, ES_OUT_SET_NEXT_DISPLAY_TIME,
+                                   map( time ) );
+        }
+
+        case ES_OUT_RESET_PCR:
+            reset();
+            /* fall through */
+        default:
+            return es_out_vaControl( real_es_out, i_query, args );
+    }
+}
+
+void SlewedEsOut::esOutDestroy()
+{
+    /* we don't own the real one */
+}
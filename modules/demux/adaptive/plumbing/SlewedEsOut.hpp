@@ -0,0 +1,59 @@
+/*
+ * SlewedEsOut.hpp
+ *****************************************************************************
+ * Copyright © 2020 VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SLEWEDESOUT_HPP
+#define SLEWEDESOUT_HPP
+
+#include "FakeESOut.hpp"
+#include <list>
+
+namespace adaptive
+{
+    /* Output proxy rescaling the timestamps from a point onwards, so the
+     * playback can slightly run faster or slower than the stream without
+     * touching the input rate. Only used from the demux thread. */
+    class SlewedEsOut : public AbstractFakeEsOut
+    {
+        public:
+            SlewedEsOut( es_out_t * );
+            virtual ~SlewedEsOut();
+            void setRate( double, vlc_tick_t );
+            double getRate() const;
+            void reset();
+
+        private:
+            virtual es_out_id_t *esOutAdd( const es_format_t * ); /* impl */
+            virtual int esOutSend( es_out_id_t *, block_t * ); /* impl */
+            virtual void esOutDel( es_out_id_t * ); /* impl */
+            virtual int esOutControl( int, va_list ); /* impl */
+            virtual void esOutDestroy(); /* impl */
+            vlc_tick_t map( vlc_tick_t ) const;
+            es_out_t *real_es_out;
+            class Anchor
+            {
+                public:
+                    vlc_tick_t in;
+                    vlc_tick_t out;
+                    double rate;
+            };
+            std::list<Anchor> anchors;
+    };
+}
+
+#endif // SLEWEDESOUT_HPP
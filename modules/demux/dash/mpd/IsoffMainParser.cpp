@@ -44,6 +44,7 @@
 #include "../../adaptive/tools/Debug.hpp"
 #include "../../adaptive/tools/Conversions.hpp"
 #include <vlc_stream.h>
+#include <vlc_charset.h>
 #include <cstdio>
 #include <limits>
 
@@ -81,6 +82,7 @@ MPD * IsoffMainParser::parse()
     {
         parseMPDAttributes(mpd, root);
         parseProgramInformation(DOMHelper::getFirstChildElementByName(root, "ProgramInformation"), mpd);
+        parseServiceDescription(DOMHelper::getFirstChildElementByName(root, "ServiceDescription"), mpd);
         parseMPDBaseUrl(mpd, root);
         parsePeriods(mpd, root);
         mpd->debug();
@@ -182,6 +184,21 @@ size_t IsoffMainParser::parseSegmentTemplate(Node *templateNode, SegmentInformat
     if(templateNode->hasAttribute("duration"))
         mediaTemplate->duration.Set(Integer<stime_t>(templateNode->getAttributeValue("duration")));
 
+    /* LL-DASH: chunked segments requestable before their end */
+    if(templateNode->hasAttribute("availabilityTimeOffset"))
+    {
+        const std::string &ato = templateNode->getAttributeValue("availabilityTimeOffset");
+        double offset = us_strtod(ato.c_str(), NULL);
+        if(offset > 0.0 && ato != "INF")
+        {
+            mediaTemplate->setAvailabilityTimeOffset(vlc_tick_from_sec(offset));
+            /* Default latency target when no service description is provided */
+            AbstractPlaylist *playlist = info->getPlaylist();
+            if(playlist->targetLatency.Get() == 0)
+                playlist->targetLatency.Set(VLC_TICK_FROM_SEC(3));
+        }
+    }
+
     InitSegmentTemplate *initTemplate = NULL;
 
     if(templateNode->hasAttribute("initialization"))
@@ -512,6 +529,20 @@ void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
     }
 }
 
+void IsoffMainParser::parseServiceDescription(Node *node, MPD *mpd)
+{
+    if(!node)
+        return;
+
+    Node *latency = DOMHelper::getFirstChildElementByName(node, "Latency");
+    if(latency && latency->hasAttribute("target"))
+    {
+        uint64_t target = Integer<uint64_t>(latency->getAttributeValue("target"));
+        if(target)
+            mpd->targetLatency.Set(VLC_TICK_FROM_MS(target));
+    }
+}
+
 Profile IsoffMainParser::getProfile() const
 {
     Profile res(Profile::Unknown);
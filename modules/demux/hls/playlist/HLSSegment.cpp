@@ -22,6 +22,7 @@
 #endif
 
 #include "HLSSegment.hpp"
+#include "Representation.hpp"
 #include "../../adaptive/playlist/BaseRepresentation.h"
 
 
@@ -31,7 +32,9 @@ HLSSegment::HLSSegment( ICanonicalUrl *parent, uint64_t seq ) :
     Segment( parent )
 {
     setSequenceNumber(seq);
+    mediaSequence = seq;
     utcTime = 0;
+    independent = true;
 }
 
 HLSSegment::~HLSSegment()
@@ -44,7 +47,7 @@ bool HLSSegment::prepareChunk(SharedResources *res, SegmentChunk *chunk, BaseRep
     {
         if (encryption.iv.size() != 16)
         {
-            uint64_t sequence = getSequenceNumber() - Segment::SEQUENCE_FIRST;
+            uint64_t sequence = mediaSequence - Segment::SEQUENCE_FIRST;
             encryption.iv.clear();
             encryption.iv.resize(16);
             encryption.iv[15] = (sequence >> 0) & 0xff;
@@ -62,6 +65,25 @@ vlc_tick_t HLSSegment::getUTCTime() const
     return utcTime;
 }
 
+bool HLSSegment::isIndependent() const
+{
+    return independent;
+}
+
+uint64_t HLSSegment::partSequence(uint64_t number)
+{
+    if(number < (uint64_t) SEQUENCE_FIRST)
+        return 0;
+    return (number - SEQUENCE_FIRST) / Representation::PARTS_STRIDE;
+}
+
+uint64_t HLSSegment::partIndex(uint64_t number)
+{
+    if(number < (uint64_t) SEQUENCE_FIRST)
+        return 0;
+    return (number - SEQUENCE_FIRST) % Representation::PARTS_STRIDE;
+}
+
 int HLSSegment::compare(ISegment *segment) const
 {
     HLSSegment *hlssegment = dynamic_cast<HLSSegment *>(segment);
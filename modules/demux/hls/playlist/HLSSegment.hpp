@@ -39,10 +39,16 @@ namespace hls
                 HLSSegment( ICanonicalUrl *parent, uint64_t sequence );
                 virtual ~HLSSegment();
                 vlc_tick_t getUTCTime() const;
+                bool isIndependent() const;
+                /* Low latency partial segments numbering */
+                static uint64_t partSequence(uint64_t number);
+                static uint64_t partIndex(uint64_t number);
                 virtual int compare(ISegment *) const; /* reimpl */
 
             protected:
                 vlc_tick_t utcTime;
+                uint64_t mediaSequence; /* differs from the number for partial segments */
+                bool independent; /* partial segment starting with a key frame */
                 virtual bool prepareChunk(SharedResources *, SegmentChunk *,
                                           BaseRepresentation *); /* reimpl */
         };
@@ -157,18 +157,14 @@ void M3U8Parser::createAndFillRepresentation(vlc_object_t *p_obj, BaseAdaptation
 
 bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representation *rep)
 {
-    block_t *p_block = Retrieve::HTTP(resources, rep->getPlaylistUrl().toString());
+    block_t *p_block = Retrieve::HTTP(resources, rep->getUpdateUrl());
     if(p_block)
     {
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
         if(substream)
         {
-            std::list<Tag *> tagslist = parseEntries(substream);
+            appendSegmentsFromPlaylist(p_obj, rep, substream);
             vlc_stream_Delete(substream);
-
-            parseSegments(p_obj, rep, tagslist);
-
-            releaseTagsList(tagslist);
         }
         block_Release(p_block);
         return true;
@@ -176,6 +172,14 @@ bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representati
     return false;
 }
 
+void M3U8Parser::appendSegmentsFromPlaylist(vlc_object_t *p_obj, Representation *rep,
+                                            stream_t *p_stream)
+{
+    std::list<Tag *> tagslist = parseEntries(p_stream);
+    parseSegments(p_obj, rep, tagslist);
+    releaseTagsList(tagslist);
+}
+
 static bool parseEncryption(const AttributesTag *keytag, const Url &playlistUrl,
                             CommonEncryption &encryption)
 {
@@ -216,6 +220,7 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
 
     rep->setTimescale(100);
+    const bool b_firstload = !rep->b_loaded;
     rep->b_loaded = true;
 
     vlc_tick_t totalduration = 0;
@@ -227,6 +232,11 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
     const SingleValueTag *ctx_byterange = NULL;
     CommonEncryption encryption;
     const ValuesListTag *ctx_extinf = NULL;
+    /* Low latency partial segments */
+    uint64_t partIndex = 0;
+    std::size_t prevpartoffset = 0;
+    vlc_tick_t partHoldBack = 0;
+    bool b_hinted = false;
 
     std::list<Tag *>::const_iterator it;
     for(it = tagslist.begin(); it != tagslist.end(); ++it)
@@ -257,9 +267,23 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     break;
                 }
 
-                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, sequenceNumber++);
+                if(rep->b_parts && partIndex > 0)
+                {
+                    /* Already listed as partial segments */
+                    sequenceNumber++;
+                    partIndex = 0;
+                    prevpartoffset = 0;
+                    ctx_extinf = NULL;
+                    ctx_byterange = NULL;
+                    break;
+                }
+
+                const uint64_t number = rep->b_parts ? sequenceNumber * Representation::PARTS_STRIDE
+                                                     : sequenceNumber;
+                HLSSegment *segment = new (std::nothrow) HLSSegment(rep, number);
                 if(!segment)
                     break;
+                segment->mediaSequence = sequenceNumber++;
 
                 segment->setSourceUrl(uritag->getValue().value);
 
@@ -352,6 +376,127 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
             }
             break;
 
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const AttributesTag *ctrltag = static_cast<const AttributesTag *>(tag);
+                const Attribute *attr = ctrltag->getAttributeByName("CAN-BLOCK-RELOAD");
+                rep->b_canBlockReload = (attr && attr->value == "YES");
+                attr = ctrltag->getAttributeByName("PART-HOLD-BACK");
+                if(attr)
+                    partHoldBack = vlc_tick_from_sec(attr->floatingPoint());
+            }
+            break;
+
+            case AttributesTag::EXTXPARTINF:
+            {
+                const Attribute *attr = static_cast<const AttributesTag *>(tag)->getAttributeByName("PART-TARGET");
+                if(attr && attr->floatingPoint() > 0.0 && rep->getPlaylist()->lowLatencyEnabled())
+                {
+                    rep->partTarget = vlc_tick_from_sec(attr->floatingPoint());
+                    /* Decided once, as it changes the segments numbering */
+                    if(b_firstload)
+                        rep->b_parts = true;
+                }
+            }
+            break;
+
+            case AttributesTag::EXTXPART:
+            case AttributesTag::EXTXPRELOADHINT:
+            {
+                /* Partial segments can't be decrypted on their own */
+                if(!rep->b_parts || partIndex >= Representation::PARTS_STRIDE ||
+                   encryption.method != CommonEncryption::Method::NONE)
+                    break;
+
+                const AttributesTag *parttag = static_cast<const AttributesTag *>(tag);
+                const Attribute *uriAttr = parttag->getAttributeByName("URI");
+                const bool b_hint = (tag->getType() == AttributesTag::EXTXPRELOADHINT);
+                if(!uriAttr)
+                    break;
+
+                std::size_t rangestart = 0, rangeend = 0;
+                double duration = secf_from_vlc_tick(rep->partTarget);
+                if(b_hint)
+                {
+                    const Attribute *attr = parttag->getAttributeByName("TYPE");
+                    if(!attr || attr->value != "PART")
+                        break;
+                    /* Open ended ranges would overlap the following parts */
+                    attr = parttag->getAttributeByName("BYTERANGE-START");
+                    if(attr)
+                    {
+                        const Attribute *lengthAttr = parttag->getAttributeByName("BYTERANGE-LENGTH");
+                        if(!lengthAttr || !lengthAttr->decimal())
+                            break;
+                        rangestart = attr->decimal();
+                        rangeend = rangestart + lengthAttr->decimal() - 1;
+                    }
+                    b_hinted = true;
+                }
+                else
+                {
+                    const Attribute *attr = parttag->getAttributeByName("GAP");
+                    if(attr && attr->value == "YES")
+                    {
+                        partIndex++;
+                        break;
+                    }
+                    attr = parttag->getAttributeByName("DURATION");
+                    if(attr)
+                        duration = attr->floatingPoint();
+                    attr = parttag->getAttributeByName("BYTERANGE");
+                    if(attr)
+                    {
+                        std::pair<std::size_t,std::size_t> range = attr->unescapeQuotes().getByteRange();
+                        if(range.first == 0)
+                            range.first = prevpartoffset;
+                        prevpartoffset = range.first + range.second;
+                        rangestart = range.first;
+                        rangeend = prevpartoffset - 1;
+                    }
+                }
+
+                HLSSegment *segment = new (std::nothrow) HLSSegment(rep,
+                            sequenceNumber * Representation::PARTS_STRIDE + partIndex);
+                if(!segment)
+                    break;
+                segment->setSourceUrl(uriAttr->quotedString());
+                segment->mediaSequence = sequenceNumber;
+                const Attribute *independentAttr = parttag->getAttributeByName("INDEPENDENT");
+                segment->independent = (partIndex == 0) ||
+                                       (independentAttr && independentAttr->value == "YES");
+                if(b_hint)
+                {
+                    /* Blocking reload waits for the hinted part */
+                    rep->nextPartSequence = sequenceNumber;
+                    rep->nextPartIndex = partIndex;
+                }
+                partIndex++;
+
+                const vlc_tick_t nzDuration = vlc_tick_from_sec( duration );
+                segment->duration.Set(duration * (uint64_t) rep->getTimescale());
+                segment->startTime.Set(rep->getTimescale().ToScaled(nzStartTime));
+                nzStartTime += nzDuration;
+                totalduration += nzDuration;
+                if(absReferenceTime != VLC_TICK_INVALID)
+                {
+                    segment->utcTime = absReferenceTime;
+                    absReferenceTime += nzDuration;
+                }
+
+                if(rangestart != rangeend)
+                    segment->setByteRange(rangestart, rangeend);
+
+                if(discontinuity)
+                {
+                    segment->discontinuity = true;
+                    discontinuity = false;
+                }
+
+                segmentList->addSegment(segment);
+            }
+            break;
+
             case Tag::EXTXDISCONTINUITY:
                 discontinuity  = true;
                 break;
@@ -362,6 +507,20 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
         }
     }
 
+    if(rep->b_parts)
+    {
+        /* Without hint, wait for the next part after the listed ones */
+        if(!b_hinted)
+        {
+            rep->nextPartSequence = sequenceNumber;
+            rep->nextPartIndex = partIndex;
+        }
+        if(partHoldBack == 0)
+            partHoldBack = 3 * rep->partTarget;
+        if(rep->getPlaylist()->targetLatency.Get() == 0)
+            rep->getPlaylist()->targetLatency.Set(partHoldBack);
+    }
+
     if(rep->isLive())
     {
         rep->getPlaylist()->duration.Set(0);
@@ -44,6 +44,12 @@ Representation::Representation  ( BaseAdaptationSet *set ) :
     b_loaded = false;
     nextUpdateTime = 0;
     targetDuration = 0;
+    b_parts = false;
+    b_canBlockReload = false;
+    b_blockingReload = false;
+    partTarget = 0;
+    nextPartSequence = 0;
+    nextPartIndex = 0;
     streamFormat = StreamFormat::UNKNOWN;
 }
 
@@ -86,6 +92,19 @@ Url Representation::getPlaylistUrl() const
     }
 }
 
+std::string Representation::getUpdateUrl() const
+{
+    std::string url = getPlaylistUrl().toString();
+    if(b_blockingReload)
+    {
+        /* Blocking reload: the server answers once that part is published */
+        url += (url.find('?') == std::string::npos) ? "?" : "&";
+        url += "_HLS_msn=" + std::to_string(nextPartSequence);
+        url += "&_HLS_part=" + std::to_string(nextPartIndex);
+    }
+    return url;
+}
+
 void Representation::debug(vlc_object_t *obj, int indent) const
 {
     BaseRepresentation::debug(obj, indent);
@@ -101,11 +120,21 @@ void Representation::debug(vlc_object_t *obj, int indent) const
 void Representation::scheduleNextUpdate(uint64_t number)
 {
     const AbstractPlaylist *playlist = getPlaylist();
-    const time_t now = time(NULL);
+    const vlc_tick_t now = vlc_tick_now();
 
     /* Compute new update time */
     vlc_tick_t minbuffer = getMinAheadTime(number);
 
+    if(b_parts && partTarget)
+    {
+        /* Partial segments are published every part target. Once there is
+         * almost nothing left to play, wait for the next one on the server
+         * instead of polling */
+        b_blockingReload = b_canBlockReload && minbuffer <= partTarget;
+        nextUpdateTime = b_blockingReload ? now : now + partTarget;
+        return;
+    }
+
     /* Update frequency must always be at least targetDuration (if any)
      * but we need to update before reaching that last segment, thus -1 */
     if(targetDuration)
@@ -123,25 +152,24 @@ void Representation::scheduleNextUpdate(uint64_t number)
             minbuffer /= 2;
     }
 
-    nextUpdateTime = now + SEC_FROM_VLC_TICK(minbuffer);
+    nextUpdateTime = now + minbuffer;
 
     msg_Dbg(playlist->getVLCObject(), "Updated playlist ID %s, next update in %" PRId64 "s",
-            getID().str().c_str(), (int64_t) nextUpdateTime - now);
+            getID().str().c_str(), SEC_FROM_VLC_TICK(nextUpdateTime - now));
 
     debug(playlist->getVLCObject(), 0);
 }
 
 bool Representation::needsUpdate() const
 {
-    return !b_loaded || (isLive() && nextUpdateTime < time(NULL));
+    return !b_loaded || (isLive() && nextUpdateTime < vlc_tick_now());
 }
 
 bool Representation::runLocalUpdates(SharedResources *res,
                                      vlc_tick_t, uint64_t, bool)
 {
-    const time_t now = time(NULL);
     AbstractPlaylist *playlist = getPlaylist();
-    if(!b_loaded || (isLive() && nextUpdateTime < now))
+    if(!b_loaded || (isLive() && nextUpdateTime < vlc_tick_now()))
     {
         M3U8Parser parser(res);
         parser.appendSegmentsFromPlaylistURI(playlist->getVLCObject(), this);
@@ -180,3 +208,40 @@ uint64_t Representation::translateSegmentNumber(uint64_t num, const SegmentInfor
 
     return 1;
 }
+
+ISegment * Representation::getNextSegment(SegmentInfoType type, uint64_t pos,
+                                          uint64_t *newpos, bool *gap) const
+{
+    ISegment *segment = BaseRepresentation::getNextSegment(type, pos, newpos, gap);
+    /* Partial segments numbering skips to the next media sequence,
+     * which is not a gap */
+    if(segment && *gap && b_parts && HLSSegment::partIndex(pos) &&
+       HLSSegment::partIndex(*newpos) == 0 &&
+       HLSSegment::partSequence(*newpos) == HLSSegment::partSequence(pos) + 1)
+        *gap = false;
+    return segment;
+}
+
+uint64_t Representation::getLiveStartSegmentNumber(uint64_t def) const
+{
+    const uint64_t number = BaseRepresentation::getLiveStartSegmentNumber(def);
+    if(!b_parts)
+        return number;
+
+    /* Start on the last independent part, or on the segment start */
+    uint64_t start = number - HLSSegment::partIndex(number);
+    std::vector<ISegment *> list;
+    std::vector<ISegment *>::const_iterator it;
+    getSegments(INFOTYPE_MEDIA, list);
+    for(it=list.begin(); it != list.end(); ++it)
+    {
+        const HLSSegment *hlsSeg = dynamic_cast<HLSSegment *>(*it);
+        if(!hlsSeg || hlsSeg->getSequenceNumber() < start)
+            continue;
+        if(hlsSeg->getSequenceNumber() > number)
+            break;
+        if(hlsSeg->isIndependent())
+            start = hlsSeg->getSequenceNumber();
+    }
+    return start;
+}
@@ -53,14 +53,30 @@ namespace hls
                 virtual bool runLocalUpdates(SharedResources *,
                                              vlc_tick_t, uint64_t, bool); /* reimpl */
                 virtual uint64_t translateSegmentNumber(uint64_t, const SegmentInformation *) const; /* reimpl */
+                virtual ISegment * getNextSegment(SegmentInfoType, uint64_t,
+                                                  uint64_t *, bool *) const; /* reimpl */
+                virtual uint64_t getLiveStartSegmentNumber(uint64_t) const; /* reimpl */
+                std::string getUpdateUrl() const;
+
+                /* Low latency: partial segments are numbered
+                 * media sequence * PARTS_STRIDE + part index, offset like
+                 * all segment numbers (see HLSSegment::partIndex()) */
+                static const uint64_t PARTS_STRIDE = 1000;
 
             private:
                 StreamFormat streamFormat;
                 bool b_live;
                 bool b_loaded;
-                time_t nextUpdateTime;
+                vlc_tick_t nextUpdateTime;
                 time_t targetDuration;
                 Url playlistUrl;
+                /* Low latency */
+                bool b_parts;
+                bool b_canBlockReload;
+                bool b_blockingReload;
+                vlc_tick_t partTarget;
+                uint64_t nextPartSequence; /* next partial segment to be published */
+                uint64_t nextPartIndex;
         };
     }
 }
@@ -67,6 +67,8 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
 
 matroska_segment_c::~matroska_segment_c()
 {
+    _seeker.stop_indexing();
+
     free( psz_writing_application );
     free( psz_muxing_application );
     free( psz_segment_filename );
@@ -687,6 +689,14 @@ bool matroska_segment_c::Preload( )
     if( cluster )
         EnsureDuration();
 
+    if( cluster && !b_cues && sys.b_fastseekable &&
+        var_InheritBool( &sys.demuxer, "mkv-background-index" ) )
+    {
+        _seeker.start_indexing( *this, cluster->GetElementPosition(),
+                                segment->IsFiniteSize() ? segment->GetEndPosition()
+                                                        : std::numeric_limits<uint64_t>::max() );
+    }
+
     return true;
 }
 
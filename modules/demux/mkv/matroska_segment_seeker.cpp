@@ -28,8 +28,14 @@
 #include "util.hpp"
 #include "stream_io_callback.hpp"
 
+#include <vlc_threads.h>
+#include <vlc_interrupt.h>
+
 #include <sstream>
 #include <limits>
+#include <set>
+#include <string>
+#include <new>
 
 namespace { 
     template<class It, class T>
@@ -74,6 +80,12 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
             : UINT64_MAX
     };
 
+    return add_cluster( cinfo );
+}
+
+SegmentSeeker::cluster_map_t::iterator
+SegmentSeeker::add_cluster( Cluster const& cinfo )
+{
     add_cluster_position( cinfo.fpos );
 
     cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
@@ -301,6 +313,8 @@ SegmentSeeker::get_seekpoints( matroska_segment_c& ms, vlc_tick_t target_pts,
         }
     };
 
+    merge_indexed();
+
     for( vlc_tick_t needle_pts = target_pts; ; )
     {
         seekpoint_pair_t seekpoints = get_seekpoints_around( needle_pts, priority_tracks );
@@ -519,4 +533,428 @@ SegmentSeeker::mkv_jump_to( matroska_segment_c& ms, fptr_t fpos )
         ms.es.I_O().setFilePointer( fpos );
 }
 
+/*****************************************************************************
+ * Background indexing
+ *****************************************************************************
+ * Segments without cues are only indexed on demand, while seeking, which
+ * can block for a long time on large files. The indexer walks the clusters
+ * ahead of time from its own stream, reading only the elements headers,
+ * and the results are merged in the seeker by the demux thread.
+ *****************************************************************************/
+
+namespace {
+    enum {
+        EBML_ID_SEGMENT          = 0x18538067,
+        EBML_ID_SEEKHEAD         = 0x114D9B74,
+        EBML_ID_INFO             = 0x1549A966,
+        EBML_ID_TRACKS           = 0x1654AE6B,
+        EBML_ID_CUES             = 0x1C53BB6B,
+        EBML_ID_ATTACHMENTS      = 0x1941A469,
+        EBML_ID_CHAPTERS         = 0x1043A770,
+        EBML_ID_TAGS             = 0x1254C367,
+        EBML_ID_CLUSTER          = 0x1F43B675,
+        EBML_ID_CLUSTER_TIMECODE = 0xE7,
+        EBML_ID_SIMPLEBLOCK      = 0xA3,
+        EBML_ID_BLOCKGROUP       = 0xA0,
+        EBML_ID_BLOCK            = 0xA1,
+        EBML_ID_REFERENCEBLOCK   = 0xFB,
+    };
+
+    bool is_level1_id( uint32_t id )
+    {
+        switch( id )
+        {
+            case EBML_ID_SEGMENT:
+            case EBML_ID_SEEKHEAD:
+            case EBML_ID_INFO:
+            case EBML_ID_TRACKS:
+            case EBML_ID_CUES:
+            case EBML_ID_ATTACHMENTS:
+            case EBML_ID_CHAPTERS:
+            case EBML_ID_TAGS:
+            case EBML_ID_CLUSTER:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool read_ebml_id( stream_t *s, uint32_t *pi_id )
+    {
+        uint8_t p[4];
+        if( vlc_stream_Read( s, p, 1 ) != 1 )
+            return false;
+
+        size_t i_len = 1;
+        while( i_len <= 4 && !( p[0] & ( 0x80 >> ( i_len - 1 ) ) ) )
+            i_len++;
+        if( i_len > 4 ||
+            vlc_stream_Read( s, &p[1], i_len - 1 ) != ssize_t( i_len - 1 ) )
+            return false;
+
+        *pi_id = 0;
+        for( size_t i = 0; i < i_len; i++ )
+            *pi_id = ( *pi_id << 8 ) | p[i];
+        return true;
+    }
+
+    /* reads an element size or a track number, unknown sizes are returned
+     * as UINT64_MAX */
+    bool read_ebml_vint( stream_t *s, uint64_t *pi_value )
+    {
+        uint8_t p[8];
+        if( vlc_stream_Read( s, p, 1 ) != 1 )
+            return false;
+
+        size_t i_len = 1;
+        while( i_len <= 8 && !( p[0] & ( 0x80 >> ( i_len - 1 ) ) ) )
+            i_len++;
+        if( i_len > 8 ||
+            vlc_stream_Read( s, &p[1], i_len - 1 ) != ssize_t( i_len - 1 ) )
+            return false;
+
+        uint64_t i_value = p[0] & ( 0xFF >> i_len );
+        bool b_unknown = i_value == uint64_t( 0xFF >> i_len );
+        for( size_t i = 1; i < i_len; i++ )
+        {
+            i_value = ( i_value << 8 ) | p[i];
+            b_unknown &= p[i] == 0xFF;
+        }
+        *pi_value = b_unknown ? UINT64_MAX : i_value;
+        return true;
+    }
+
+    bool read_block_header( stream_t *s, uint64_t *pi_track, int16_t *pi_timecode,
+                            uint8_t *pi_flags )
+    {
+        uint8_t p[3];
+        if( !read_ebml_vint( s, pi_track ) || vlc_stream_Read( s, p, 3 ) != 3 )
+            return false;
+        *pi_timecode = int16_t( GetWBE( p ) );
+        *pi_flags = p[2];
+        return true;
+    }
+}
+
+class SegmentSeeker::Indexer
+{
+    public:
+        struct Results
+        {
+            std::vector<Cluster> clusters;
+            std::vector<std::pair<track_id_t, Seekpoint> > seekpoints;
+            ranges_t ranges;
+        };
+
+        Indexer( demux_t *p_demux, const char *psz_url, std::set<track_id_t> tracks,
+                 uint64_t i_timescale, fptr_t start, fptr_t end )
+            : p_demux( p_demux )
+            , url( psz_url )
+            , tracks( tracks )
+            , i_timescale( i_timescale )
+            , start( start )
+            , end( end )
+            , p_interrupt( NULL )
+            , b_running( false )
+        {
+            vlc_mutex_init( &lock );
+        }
+
+        ~Indexer()
+        {
+            stop();
+        }
+
+        bool run()
+        {
+            p_interrupt = vlc_interrupt_create();
+            if( unlikely( p_interrupt == NULL ) )
+                return false;
+            b_running = !vlc_clone( &thread, Thread, this, VLC_THREAD_PRIORITY_LOW );
+            if( !b_running )
+            {
+                vlc_interrupt_destroy( p_interrupt );
+                p_interrupt = NULL;
+            }
+            return b_running;
+        }
+
+        void stop()
+        {
+            if( !b_running )
+                return;
+            vlc_interrupt_kill( p_interrupt );
+            vlc_join( thread, NULL );
+            vlc_interrupt_destroy( p_interrupt );
+            p_interrupt = NULL;
+            b_running = false;
+        }
+
+        void take( Results& out )
+        {
+            vlc_mutex_locker guard( &lock );
+            std::swap( out, pending );
+        }
+
+    private:
+        static void *Thread( void *p_data )
+        {
+            Indexer *p_this = static_cast<Indexer *>( p_data );
+            vlc_interrupt_set( p_this->p_interrupt );
+            p_this->index();
+            return NULL;
+        }
+
+        void index();
+        bool index_cluster( stream_t *, fptr_t i_pos, uint64_t i_size );
+        bool index_block_group( stream_t *, fptr_t i_end, uint64_t i_cluster_timecode,
+                                std::vector<std::pair<track_id_t, Seekpoint> >& );
+
+        vlc_tick_t block_pts( uint64_t i_cluster_timecode, int16_t i_timecode ) const
+        {
+            return VLC_TICK_FROM_NS( int64_t( i_cluster_timecode + i_timecode ) * int64_t( i_timescale ) );
+        }
+
+        demux_t                  *p_demux;
+        std::string               url;
+        std::set<track_id_t>      tracks;
+        uint64_t                  i_timescale;
+        fptr_t                    start, end;
+
+        vlc_thread_t              thread;
+        vlc_interrupt_t          *p_interrupt;
+        bool                      b_running;
+
+        vlc_mutex_t               lock;
+        Results                   pending;
+};
+
+void SegmentSeeker::Indexer::index()
+{
+    stream_t *s = vlc_stream_NewURL( p_demux, url.c_str() );
+    if( s == NULL )
+        return;
+
+    vlc_tick_t i_begin = vlc_tick_now();
+    unsigned i_clusters = 0;
+
+    fptr_t i_pos = start;
+    if( vlc_stream_Seek( s, i_pos ) == VLC_SUCCESS )
+    {
+        while( i_pos < end && !vlc_killed() )
+        {
+            uint32_t i_id;
+            uint64_t i_size;
+            if( !read_ebml_id( s, &i_id ) || !read_ebml_vint( s, &i_size ) )
+                break;
+
+            if( i_id == EBML_ID_CLUSTER )
+            {
+                if( !index_cluster( s, i_pos, i_size ) )
+                    break;
+                i_clusters++;
+            }
+            else if( i_size == UINT64_MAX ||
+                     vlc_stream_Seek( s, vlc_stream_Tell( s ) + i_size ) != VLC_SUCCESS )
+                break;
+
+            i_pos = vlc_stream_Tell( s );
+        }
+    }
+
+    msg_Dbg( p_demux, "background indexing %s: %u clusters in %" PRId64 " ms",
+             vlc_killed() ? "interrupted" : "done", i_clusters,
+             MS_FROM_VLC_TICK( vlc_tick_now() - i_begin ) );
+
+    vlc_stream_Delete( s );
+}
+
+bool SegmentSeeker::Indexer::index_cluster( stream_t *s, fptr_t i_pos, uint64_t i_size )
+{
+    fptr_t const i_data = vlc_stream_Tell( s );
+    fptr_t const i_end  = i_size == UINT64_MAX ? UINT64_MAX : i_data + i_size;
+
+    bool     b_timecode = false;
+    uint64_t i_cluster_timecode = 0;
+    std::vector<std::pair<track_id_t, Seekpoint> > seekpoints;
+
+    for( fptr_t i_child = i_data; i_child < i_end; i_child = vlc_stream_Tell( s ) )
+    {
+        if( vlc_killed() )
+            return false;
+
+        uint32_t i_id;
+        uint64_t i_child_size;
+        if( !read_ebml_id( s, &i_id ) )
+            break; /* end of file */
+
+        if( i_size == UINT64_MAX && is_level1_id( i_id ) )
+        {
+            /* end of a cluster of unknown size */
+            if( vlc_stream_Seek( s, i_child ) != VLC_SUCCESS )
+                return false;
+            break;
+        }
+
+        if( !read_ebml_vint( s, &i_child_size ) || i_child_size == UINT64_MAX )
+            return false;
+        fptr_t const i_child_end = vlc_stream_Tell( s ) + i_child_size;
+
+        switch( i_id )
+        {
+            case EBML_ID_CLUSTER_TIMECODE:
+            {
+                uint8_t p[8];
+                if( i_child_size > sizeof( p ) ||
+                    vlc_stream_Read( s, p, i_child_size ) != ssize_t( i_child_size ) )
+                    return false;
+                i_cluster_timecode = 0;
+                for( size_t i = 0; i < i_child_size; i++ )
+                    i_cluster_timecode = ( i_cluster_timecode << 8 ) | p[i];
+                b_timecode = true;
+                break;
+            }
+            case EBML_ID_SIMPLEBLOCK:
+            {
+                uint64_t i_track;
+                int16_t  i_timecode;
+                uint8_t  i_flags;
+                if( !b_timecode ||
+                    !read_block_header( s, &i_track, &i_timecode, &i_flags ) )
+                    break;
+                if( ( i_flags & 0x80 ) && tracks.count( track_id_t( i_track ) ) )
+                    seekpoints.push_back( std::make_pair( track_id_t( i_track ),
+                        Seekpoint( i_child, block_pts( i_cluster_timecode, i_timecode ) ) ) );
+                break;
+            }
+            case EBML_ID_BLOCKGROUP:
+                if( b_timecode &&
+                    !index_block_group( s, i_child_end, i_cluster_timecode, seekpoints ) )
+                    return false;
+                break;
+            default:
+                break;
+        }
+
+        if( vlc_stream_Seek( s, i_child_end ) != VLC_SUCCESS )
+            return false;
+    }
+
+    if( !b_timecode )
+        return true;
+
+    fptr_t const i_cluster_end = vlc_stream_Tell( s );
+    Cluster const cinfo = {
+        /* fpos     */ i_pos,
+        /* pts      */ block_pts( i_cluster_timecode, 0 ),
+        /* duration */ vlc_tick_t( -1 ),
+        /* size     */ i_cluster_end - i_pos
+    };
+
+    vlc_mutex_locker guard( &lock );
+
+    pending.clusters.push_back( cinfo );
+    pending.seekpoints.insert( pending.seekpoints.end(), seekpoints.begin(), seekpoints.end() );
+    /* clusters are walked in order, keep the searched ranges merged */
+    if( !pending.ranges.empty() && pending.ranges.back().end == i_pos )
+        pending.ranges.back().end = i_cluster_end;
+    else
+        pending.ranges.push_back( Range( i_pos, i_cluster_end ) );
+    return true;
+}
+
+bool SegmentSeeker::Indexer::index_block_group( stream_t *s, fptr_t i_end, uint64_t i_cluster_timecode,
+                                                std::vector<std::pair<track_id_t, Seekpoint> >& seekpoints )
+{
+    fptr_t   i_block_pos = std::numeric_limits<fptr_t>::max();
+    uint64_t i_track = 0;
+    int16_t  i_timecode = 0;
+    bool     b_reference = false;
+
+    for( fptr_t i_child = vlc_stream_Tell( s ); i_child < i_end; i_child = vlc_stream_Tell( s ) )
+    {
+        uint32_t i_id;
+        uint64_t i_size;
+        if( !read_ebml_id( s, &i_id ) || !read_ebml_vint( s, &i_size ) ||
+            i_size == UINT64_MAX )
+            return false;
+        fptr_t const i_child_end = vlc_stream_Tell( s ) + i_size;
+
+        if( i_id == EBML_ID_BLOCK )
+        {
+            uint8_t i_flags;
+            if( !read_block_header( s, &i_track, &i_timecode, &i_flags ) )
+                return false;
+            i_block_pos = i_child;
+        }
+        else if( i_id == EBML_ID_REFERENCEBLOCK )
+            b_reference = true;
+
+        if( vlc_stream_Seek( s, i_child_end ) != VLC_SUCCESS )
+            return false;
+    }
+
+    if( i_block_pos != std::numeric_limits<fptr_t>::max() && !b_reference &&
+        tracks.count( track_id_t( i_track ) ) )
+        seekpoints.push_back( std::make_pair( track_id_t( i_track ),
+            Seekpoint( i_block_pos, block_pts( i_cluster_timecode, i_timecode ) ) ) );
+    return true;
+}
+
+SegmentSeeker::SegmentSeeker()
+{
+}
+
+SegmentSeeker::~SegmentSeeker()
+{
+}
+
+void
+SegmentSeeker::start_indexing( matroska_segment_c& ms, fptr_t start, fptr_t end )
+{
+    stream_t *s = static_cast<vlc_stream_io_callback&>( ms.es.I_O() ).getStream();
+    if( _indexer || s->psz_url == NULL )
+        return;
+
+    std::set<track_id_t> tracks;
+    for( matroska_segment_c::tracks_map_t::const_iterator it = ms.tracks.begin();
+         it != ms.tracks.end(); ++it )
+        tracks.insert( it->first );
+
+    _indexer.reset( new (std::nothrow) Indexer( &ms.sys.demuxer, s->psz_url, tracks,
+                                                ms.i_timescale, start, end ) );
+    if( _indexer && !_indexer->run() )
+        _indexer.reset();
+    else if( _indexer )
+        msg_Dbg( &ms.sys.demuxer, "no cues, indexing the clusters in background" );
+}
+
+void
+SegmentSeeker::stop_indexing()
+{
+    if( _indexer )
+        _indexer->stop();
+}
+
+void
+SegmentSeeker::merge_indexed()
+{
+    if( !_indexer )
+        return;
+
+    Indexer::Results results;
+    _indexer->take( results );
+
+    for( std::vector<Cluster>::const_iterator it = results.clusters.begin();
+         it != results.clusters.end(); ++it )
+        add_cluster( *it );
+
+    for( std::vector<std::pair<track_id_t, Seekpoint> >::const_iterator it = results.seekpoints.begin();
+         it != results.seekpoints.end(); ++it )
+        add_seekpoint( it->first, it->second );
+
+    for( ranges_t::const_iterator it = results.ranges.begin(); it != results.ranges.end(); ++it )
+        mark_range_as_searched( *it );
+}
+
 } // namespace
@@ -29,6 +29,7 @@
 #include <vector>
 #include <map>
 #include <limits>
+#include <memory>
 
 namespace mkv {
 
@@ -88,6 +89,9 @@ class SegmentSeeker
         };
 
     public:
+        SegmentSeeker();
+        ~SegmentSeeker();
+
         typedef std::vector<track_id_t> track_ids_t;
         typedef std::vector<Range> ranges_t;
         typedef std::vector<Seekpoint> seekpoints_t;
@@ -110,6 +114,7 @@ class SegmentSeeker
 
         cluster_positions_t::iterator add_cluster_position( fptr_t pos );
         cluster_map_t      ::iterator add_cluster( KaxCluster * const );
+        cluster_map_t      ::iterator add_cluster( Cluster const& );
 
         void mkv_jump_to( matroska_segment_c&, fptr_t );
 
@@ -119,11 +124,20 @@ class SegmentSeeker
         void mark_range_as_searched( Range );
         ranges_t get_search_areas( fptr_t start, fptr_t end ) const;
 
+        /* background indexing of the clusters, for segments without cues */
+        void start_indexing( matroska_segment_c&, fptr_t start, fptr_t end );
+        void stop_indexing();
+        void merge_indexed();
+
     public:
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
         cluster_positions_t _cluster_positions;
         cluster_map_t       _clusters;
+
+    private:
+        class Indexer;
+        std::unique_ptr<Indexer> _indexer;
 };
 
 } // namespace
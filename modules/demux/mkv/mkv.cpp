@@ -80,6 +80,10 @@ vlc_module_begin ()
             N_("Preload clusters"),
             N_("Find all cluster positions by jumping cluster-to-cluster before playback"), true );
 
+    add_bool( "mkv-background-index", true,
+            N_("Index in background"),
+            N_("Find the keyframes of local files without cues in the background, to seek without scanning the file."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -362,6 +362,29 @@ static int MP4_PeekBoxHeader( stream_t *p_stream, MP4_Box_t *p_box )
     return 1;
 }
 
+/* Sample tables whose loading is deferred by MP4_BoxGetRootDeferred() */
+static bool MP4_BoxIsDeferred( const MP4_Box_t *p_box, const MP4_Box_t *p_father )
+{
+    switch( p_box->i_type )
+    {
+        case ATOM_stsz:
+        case ATOM_stco:
+        case ATOM_co64:
+        case ATOM_stsc:
+        case ATOM_stts:
+        case ATOM_ctts:
+            break;
+        default:
+            return false;
+    }
+
+    if( !p_father || p_father->i_type != ATOM_stbl )
+        return false;
+    while( p_father->p_father )
+        p_father = p_father->p_father;
+    return p_father->e_flags & BOX_FLAG_DEFER_TABLES;
+}
+
 /*****************************************************************************
  * MP4_ReadBoxRestricted : Reads box from current position
  *****************************************************************************
@@ -423,7 +446,9 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
 
     const uint64_t i_next = p_box->i_pos + p_box->i_size;
     p_box->p_father = p_father;
-    if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
+    if( MP4_BoxIsDeferred( p_box, p_father ) )
+        p_box->e_flags |= BOX_FLAG_DEFERRED;
+    else if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
     {
         msg_Warn( p_stream, "Failed reading box %4.4s", (char*) &peekbox.i_type );
         MP4_BoxFree( p_box );
@@ -5350,7 +5375,7 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
  *  The first box is a virtual box "root" and is the father for all first
  *  level boxes for the file, a sort of virtual contener
  *****************************************************************************/
-MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
+static MP4_Box_t *MP4_BoxGetRootInternal( stream_t *p_stream, bool b_defer )
 {
     int i_result;
 
@@ -5359,6 +5384,8 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
         return NULL;
 
     p_vroot->i_shortsize = 1;
+    if( b_defer )
+        p_vroot->e_flags |= BOX_FLAG_DEFER_TABLES;
     uint64_t i_size;
     if( vlc_stream_GetSize( p_stream, &i_size ) == 0 )
         p_vroot->i_size = i_size;
@@ -5394,6 +5421,9 @@ MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
         const uint32_t stoplist[] = { ATOM_sidx, 0 };
         const uint32_t excludelist[] = { ATOM_moof, ATOM_mdat, 0 };
         MP4_ReadBoxContainerChildrenIndexed( p_stream, p_vroot, stoplist, excludelist, false );
+        /* the moov tables of fragmented files are small */
+        if( b_defer )
+            MP4_BoxLoadDeferred( p_stream, p_vroot );
         return p_vroot;
     }
 
@@ -5439,6 +5469,64 @@ error:
     return NULL;
 }
 
+MP4_Box_t *MP4_BoxGetRoot( stream_t *p_stream )
+{
+    return MP4_BoxGetRootInternal( p_stream, false );
+}
+
+MP4_Box_t *MP4_BoxGetRootDeferred( stream_t *p_stream )
+{
+    return MP4_BoxGetRootInternal( p_stream, true );
+}
+
+static int MP4_BoxLoadDeferredTree( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    int i_ret = VLC_SUCCESS;
+    MP4_Box_t *p_prev = NULL;
+
+    for( MP4_Box_t *p_child = p_box->p_first; p_child; )
+    {
+        MP4_Box_t *p_next = p_child->p_next;
+
+        if( p_child->e_flags & BOX_FLAG_DEFERRED )
+        {
+            if( MP4_Seek( p_stream, p_child->i_pos ) == VLC_SUCCESS &&
+                MP4_Box_Read_Specific( p_stream, p_child, p_box ) == VLC_SUCCESS )
+                p_child->e_flags &= ~BOX_FLAG_DEFERRED;
+            else
+            {
+                /* Discarded, as when the box is read without deferring */
+                msg_Warn( p_stream, "Failed reading deferred box %4.4s",
+                          (char *) &p_child->i_type );
+                if( p_prev )
+                    p_prev->p_next = p_next;
+                else
+                    p_box->p_first = p_next;
+                if( p_box->p_last == p_child )
+                    p_box->p_last = p_prev;
+                MP4_BoxFree( p_child );
+                i_ret = VLC_EGENERIC;
+                p_child = p_next;
+                continue;
+            }
+        }
+
+        if( MP4_BoxLoadDeferredTree( p_stream, p_child ) != VLC_SUCCESS )
+            i_ret = VLC_EGENERIC;
+        p_prev = p_child;
+        p_child = p_next;
+    }
+    return i_ret;
+}
+
+int MP4_BoxLoadDeferred( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    const uint64_t i_pos = vlc_stream_Tell( p_stream );
+    int i_ret = MP4_BoxLoadDeferredTree( p_stream, p_box );
+    MP4_Seek( p_stream, i_pos );
+    return i_ret;
+}
+
 
 static void MP4_BoxDumpStructure_Internal( stream_t *s, const MP4_Box_t *p_box,
                                            unsigned int i_level )
@@ -1843,6 +1843,8 @@ struct MP4_Box_s
     {
         BOX_FLAG_NONE = 0,
         BOX_FLAG_INCOMPLETE,
+        BOX_FLAG_DEFERRED = 1 << 1,     /* data not loaded, see MP4_BoxLoadDeferred */
+        BOX_FLAG_DEFER_TABLES = 1 << 2, /* root whose sample tables are deferred */
     }            e_flags;
 
     UUID_t       i_uuid;  /* Set if i_type == "uuid" */
@@ -1910,6 +1912,25 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_BoxGetRootDeferred : Same as MP4_BoxGetRoot, without loading the
+ *                          sample tables of non fragmented files
+ *****************************************************************************
+ *  The stsz, stco, co64, stsc, stts and ctts boxes are only located: they
+ *  are flagged BOX_FLAG_DEFERRED and have no data until
+ *  MP4_BoxLoadDeferred() is called on one of their parents.
+ *  The stream must be seekable.
+ *****************************************************************************/
+MP4_Box_t *MP4_BoxGetRootDeferred( stream_t * );
+
+/*****************************************************************************
+ * MP4_BoxLoadDeferred : Loads the deferred boxes of a boxes tree
+ *****************************************************************************
+ *  The stream position is restored. Boxes failing to load are removed
+ *  from the tree and freed, as when they are read without deferring.
+ *****************************************************************************/
+int MP4_BoxLoadDeferred( stream_t *, MP4_Box_t * );
+
 /*****************************************************************************
  * MP4_BoxNew : Allocates a new MP4 Box with its atom type
  *****************************************************************************
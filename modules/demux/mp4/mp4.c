@@ -39,6 +39,7 @@
 #include <limits.h>
 #include "attachments.h"
 #include "heif.h"
+#include "sampleindex.h"
 #include "../../codec/cc.h"
 #include "../av1_unpack.h"
 
@@ -53,6 +54,11 @@ static void Close( vlc_object_t * );
 #define MP4_M4A_TEXT     N_("M4A audio only")
 #define MP4_M4A_LONGTEXT N_("Ignore non audio tracks from iTunes audio files")
 
+#define MP4_INDEX_TEXT     N_("Cache sample tables")
+#define MP4_INDEX_LONGTEXT N_( \
+    "Store the sample tables index of large local files in the cache " \
+    "directory, to open them faster the next time.")
+
 #define HEIF_DURATION_TEXT N_("Duration in seconds")
 #define HEIF_DURATION_LONGTEXT N_( \
     "Duration in seconds before simulating an end of file. " \
@@ -68,6 +74,7 @@ vlc_module_begin ()
 
     add_category_hint("Hacks", NULL)
     add_bool( CFG_PREFIX"m4a-audioonly", false, MP4_M4A_TEXT, MP4_M4A_LONGTEXT, true )
+    add_bool( CFG_PREFIX"index-cache", false, MP4_INDEX_TEXT, MP4_INDEX_LONGTEXT, true )
 
     add_submodule()
         set_category( CAT_INPUT )
@@ -140,6 +147,7 @@ typedef struct
     } hacks;
 
     mp4_fragments_index_t *p_fragsindex;
+    mp4_sample_index_t    *p_sampleindex; /* cached sample tables */
 } demux_sys_t;
 
 #define DEMUX_INCREMENT VLC_TICK_FROM_MS(250) /* How far the pcr will go, each round */
@@ -468,8 +476,11 @@ static int LoadInitFrag( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
-    /* Load all boxes ( except raw data ) */
-    MP4_Box_t *p_root = MP4_BoxGetRoot( p_demux->s );
+    /* Load all boxes ( except raw data, and the sample tables
+       provided by the sample index ) */
+    MP4_Box_t *p_root = p_sys->p_sampleindex ?
+                        MP4_BoxGetRootDeferred( p_demux->s ) :
+                        MP4_BoxGetRoot( p_demux->s );
     if( p_root == NULL || !MP4_BoxGet( p_root, "/moov" ) )
     {
         MP4_BoxFree( p_root );
@@ -800,6 +811,12 @@ static int Open( vlc_object_t * p_this )
 
     p_demux->p_sys = p_sys;
 
+    const bool b_index_cache = p_sys->b_seekable && p_demux->psz_filepath &&
+                               var_InheritBool( p_demux, CFG_PREFIX"index-cache" );
+    if( b_index_cache )
+        p_sys->p_sampleindex = MP4_SampleIndex_Open( VLC_OBJECT(p_demux),
+                                                     p_demux->psz_filepath );
+
     if( LoadInitFrag( p_demux ) != VLC_SUCCESS )
         goto error;
 
@@ -1127,6 +1144,19 @@ static int Open( vlc_object_t * p_this )
         goto error;
     }
 
+    if( b_index_cache && !p_sys->p_sampleindex && !p_sys->b_fragmented )
+    {
+        for( unsigned i = 0; i < p_sys->i_tracks; i++ )
+        {
+            if( p_sys->track[i].i_sample_count >= MP4_SAMPLE_INDEX_MIN_SAMPLES )
+            {
+                MP4_SampleIndex_Write( VLC_OBJECT(p_demux), p_demux->psz_filepath,
+                                       p_sys->track, p_sys->i_tracks );
+                break;
+            }
+        }
+    }
+
     if( p_sys->i_tracks > 1 && !p_sys->b_fastseekable )
     {
         vlc_tick_t i_max_continuity;
@@ -2145,6 +2175,8 @@ static void Close ( vlc_object_t * p_this )
         MP4_TrackClean( p_demux->out, &p_sys->track[i_track] );
     free( p_sys->track );
 
+    MP4_SampleIndex_Close( p_sys->p_sampleindex );
+
     free( p_sys );
 }
 
@@ -2247,7 +2279,11 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
         }
         if( tk->i_sample+1 >= tk->chunk[tk->i_chunk].i_sample_first +
                               tk->chunk[tk->i_chunk].i_sample_count )
+        {
             tk->i_chunk++;
+            if( MP4_ChunkTimes_Load( VLC_OBJECT(p_demux), tk, tk->i_chunk ) )
+                break;
+        }
     }
 }
 static void LoadChapter( demux_t  *p_demux )
@@ -2307,6 +2343,10 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         return( VLC_EGENERIC );
     }
 
+    /* Tables can be left without data if their deferred loading failed */
+    if( !BOXDATA(p_co64) || !BOXDATA(p_stsc) )
+        return VLC_EGENERIC;
+
     p_demux_track->i_chunk_count = BOXDATA(p_co64)->i_entry_count;
     if( !p_demux_track->i_chunk_count )
     {
@@ -2454,7 +2494,7 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
      *  Gives the sample size for each samples. There is also a stz2 table
      *  (compressed form) that we need to implement TODO */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stsz )
     {
         /* FIXME and stz2 */
         msg_Warn( p_demux, "cannot find STSZ box" );
@@ -2476,27 +2516,23 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         /* 1: all sample have the same size, so no need to construct a table */
         p_demux_track->i_sample_size = stsz->i_sample_size;
         p_demux_track->p_sample_size = NULL;
+        p_demux_track->tables.i_sizes_count = 0;
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size, the table of the box
+         * is used as is */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
+        p_demux_track->tables.i_sizes_count = stsz->i_sample_count;
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
     {
         const mp4_chunk_t *lastchunk = &p_demux_track->chunk[p_demux_track->i_chunk_count - 1];
-        if( (uint64_t)lastchunk->i_sample_count + p_demux_track->i_chunk_count - 1 > stsz->i_sample_count )
+        /* p_sample_size points to the stsz table, which must cover all
+         * the chunks samples */
+        if( (uint64_t)lastchunk->i_sample_first + lastchunk->i_sample_count > stsz->i_sample_count )
         {
             msg_Err( p_demux, "invalid samples table: stsz table is too small" );
             return VLC_EGENERIC;
@@ -2507,17 +2543,16 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
      * XXX: if we don't want to waste too much memory, we can't expand
      *  the box! so each chunk will contain an "extract" of this table
      *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     *  just channels*bits_per_sample/8. Only the position of the chunks in
+     *  the tables is computed here, their extracts are loaded on demand by
+     *  MP4_ChunkTimes_Load(). */
 
     int64_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
@@ -2528,17 +2563,22 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
+        p_demux_track->tables.i_stts_count = stts->i_entry_count;
+        p_demux_track->tables.p_stts_count = stts->pi_sample_count;
+        p_demux_track->tables.p_stts_delta = stts->pi_sample_delta;
+
+        /* Locate each chunk in the stts table */
         uint32_t i_index = 0;
         uint32_t i_current_index_samples_left = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
 
             /* save first dts */
             ck->i_first_dts = i_next_dts;
+            ck->i_stts_index = i_index;
+            ck->i_stts_left = i_current_index_samples_left;
 
             /* count how many entries are needed for this chunk
              * for p_sample_delta_dts and p_sample_count_dts */
@@ -2552,71 +2592,16 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             if ( i_ret == VLC_EGENERIC )
                 return i_ret;
 
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
+            uint32_t i_sample_count = ck->i_sample_count;
             for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
             {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
+                uint32_t i_entry;
+                uint32_t i_count = MP4_ChunkTimes_NextRun( stts->pi_sample_count,
+                                                           &i_index,
+                                                           &i_current_index_samples_left,
+                                                           &i_sample_count, &i_entry );
+                i_next_dts += i_count * stts->pi_sample_delta[i_entry];
+                if ( i_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
             }
         }
     }
@@ -2637,14 +2622,21 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         if( p_cslg && BOXDATA(p_cslg) )
             i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
 
-        /* Create pts-dts table per chunk */
+        p_demux_track->tables.i_ctts_count = ctts->i_entry_count;
+        p_demux_track->tables.p_ctts_count = ctts->pi_sample_count;
+        p_demux_track->tables.p_ctts_offset = ctts->pi_sample_offset;
+        p_demux_track->tables.i_cts_shift = i_cts_shift;
+
+        /* Locate each chunk in the ctts table */
         uint32_t i_index = 0;
         uint32_t i_current_index_samples_left = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
+
+            ck->i_ctts_index = i_index;
+            ck->i_ctts_left = i_current_index_samples_left;
 
             /* count how many entries are needed for this chunk
              * for p_sample_offset_pts and p_sample_count_pts */
@@ -2657,64 +2649,13 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
             if ( i_ret == VLC_EGENERIC )
                 return i_ret;
 
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
+            uint32_t i_sample_count = ck->i_sample_count;
             for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
             {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
+                uint32_t i_entry;
+                MP4_ChunkTimes_NextRun( ctts->pi_sample_count, &i_index,
+                                        &i_current_index_samples_left,
+                                        &i_sample_count, &i_entry );
             }
         }
     }
@@ -3037,6 +2978,9 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         }
     }
 
+    if( MP4_ChunkTimes_Load( VLC_OBJECT(p_demux), p_track, i_chunk ) )
+        return VLC_EGENERIC;
+
     /* *** find sample in the chunk *** */
     i_sample = p_track->chunk[i_chunk].i_sample_first;
     i_dts    = p_track->chunk[i_chunk].i_first_dts;
@@ -3110,6 +3054,12 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
 {
     bool b_reselect = false;
 
+    if( MP4_ChunkTimes_Load( VLC_OBJECT(p_demux), p_track, i_chunk ) )
+    {
+        p_track->b_selected = false;
+        return VLC_EGENERIC;
+    }
+
     /* now see if actual es is ok */
     if( p_track->i_chunk >= p_track->i_chunk_count ||
         p_track->chunk[p_track->i_chunk].i_sample_description_index !=
@@ -3398,16 +3348,28 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
         }
     }
 
-    /* Create chunk index table and sample index table */
-    if( TrackCreateChunksIndex( p_demux,p_track  ) ||
-        TrackCreateSamplesIndex( p_demux, p_track ) )
+    /* Create chunk index table and sample index table, from the sample
+       index when available, else from the sample tables boxes */
+    if( !p_sys->p_sampleindex ||
+        MP4_SampleIndex_SetupTrack( p_sys->p_sampleindex, p_track ) )
     {
-        msg_Err( p_demux, "cannot create chunks index" );
-        return; /* cannot create chunks index */
+        free( p_track->chunk );
+        p_track->chunk = NULL;
+        p_track->i_chunk_count = 0;
+        if( p_sys->p_sampleindex )
+            MP4_BoxLoadDeferred( p_demux->s, (MP4_Box_t *) p_track->p_stbl );
+        if( TrackCreateChunksIndex( p_demux,p_track  ) ||
+            TrackCreateSamplesIndex( p_demux, p_track ) )
+        {
+            msg_Err( p_demux, "cannot create chunks index" );
+            return; /* cannot create chunks index */
+        }
     }
 
     p_track->i_chunk  = 0;
     p_track->i_sample = 0;
+    if( MP4_ChunkTimes_Load( VLC_OBJECT(p_demux), p_track, 0 ) )
+        return;
 
     /* Disable chapter only track */
     if( p_track->fmt.i_cat == UNKNOWN_ES &&
@@ -3512,9 +3474,6 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 
@@ -3977,7 +3936,7 @@ static stime_t GetCumulatedDuration( demux_t *p_demux )
         const MP4_Box_t *p_stsz;
         const MP4_Box_t *p_tkhd;
         if ( (p_tkhd = MP4_BoxGet( p_trak, "tkhd" )) &&
-             (p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" )) &&
+             (p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" )) && BOXDATA(p_stsz) &&
              /* duration might be wrong an be set to whole duration :/ */
              BOXDATA(p_stsz)->i_sample_count > 0 )
         {
@@ -4039,7 +3998,7 @@ static stime_t GetMoovTrackDuration( demux_sys_t *p_sys, unsigned i_track_ID )
     const MP4_Box_t *p_stsz;
     const MP4_Box_t *p_tkhd;
     if ( (p_tkhd = MP4_BoxGet( p_trak, "tkhd" )) &&
-         (p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" )) &&
+         (p_stsz = MP4_BoxGet( p_trak, "mdia/minf/stbl/stsz" )) && BOXDATA(p_stsz) &&
          /* duration might be wrong an be set to whole duration :/ */
          BOXDATA(p_stsz)->i_sample_count > 0 )
     {
@@ -55,6 +55,13 @@ typedef struct
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
+    /* stts and ctts tables positions of the first sample, the dts/pts
+       tables above are only loaded around the current chunk */
+    uint32_t     i_stts_index;
+    uint32_t     i_stts_left;
+    uint32_t     i_ctts_index;
+    uint32_t     i_ctts_left;
+
     uint32_t     *p_sample_size;
     /* TODO if needed add pts
         but quickly *add* support for edts and seeking */
@@ -129,9 +136,25 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
+    const uint32_t   *p_sample_size; /* XXX perhaps add file offset if take
 //                                    too much time to do sumations each time*/
 
+    /* sample size and time to sample tables, from the stbl boxes or the
+     * sample index */
+    struct
+    {
+        uint32_t        i_sizes_count;  /* entries of p_sample_size */
+        uint32_t        i_stts_count;
+        const uint32_t *p_stts_count;
+        const int32_t  *p_stts_delta;
+        uint32_t        i_ctts_count;
+        const uint32_t *p_ctts_count;
+        const int32_t  *p_ctts_offset;
+        int64_t         i_cts_shift;
+        uint32_t        i_loaded_first; /* range of the chunks with */
+        uint32_t        i_loaded_end;   /* loaded dts/pts tables */
+    } tables;
+
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
     uint64_t     i_first_dts;    /* i_first_dts value
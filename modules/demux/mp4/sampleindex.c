@@ -0,0 +1,635 @@
+/*****************************************************************************
+ * sampleindex.c : MP4 sample tables index and lazy chunk times
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_configuration.h>
+
+#include "sampleindex.h"
+
+/* Native byte order: the index is only a local cache */
+#define INDEX_MAGIC     "VLCMP4I2"
+#define INDEX_BYTEORDER 0x01020304
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t i_byteorder;
+    uint32_t i_tracks;
+    uint64_t i_file_size;
+    int64_t  i_file_mtime;
+    uint32_t i_file_mtime_ns;
+    uint32_t i_reserved;
+} index_header_t;
+
+typedef struct
+{
+    uint32_t i_track_ID;
+    uint32_t i_chunk_count;
+    uint32_t i_sample_count;
+    uint32_t i_sample_size;
+    uint32_t i_sizes_count;
+    uint32_t i_stts_count;
+    uint32_t i_ctts_count;
+    uint32_t i_reserved;
+    int64_t  i_cts_shift;
+    uint64_t i_data;        /* offset of the chunks records */
+} index_track_t;
+
+typedef struct
+{
+    uint64_t i_offset;
+    uint64_t i_first_dts;
+    uint64_t i_duration;
+    uint32_t i_sample_description_index;
+    uint32_t i_sample_count;
+    uint32_t i_sample_first;
+    uint32_t i_entries_dts;
+    uint32_t i_entries_pts;
+    uint32_t i_stts_index;
+    uint32_t i_stts_left;
+    uint32_t i_ctts_index;
+    uint32_t i_ctts_left;
+    uint32_t i_reserved;
+} index_chunk_t;
+
+static_assert( sizeof(index_header_t) == 40, "unexpected header padding" );
+static_assert( sizeof(index_track_t) == 48, "unexpected track padding" );
+static_assert( sizeof(index_chunk_t) == 64, "unexpected chunk padding" );
+
+struct mp4_sample_index_t
+{
+    const uint8_t *p_data;
+    size_t         i_data;
+    bool           b_mapped;
+};
+
+static char *GetIndexPath( const char *psz_filepath, bool b_create_dir )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_cachedir == NULL )
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_filepath, strlen( psz_filepath ) );
+    EndMD5( &md5 );
+    char *psz_hash = psz_md5_hash( &md5 );
+
+    char *psz_path = NULL;
+    if( psz_hash != NULL )
+    {
+        if( b_create_dir )
+        {
+            char *psz_dir;
+            vlc_mkdir( psz_cachedir, 0700 );
+            if( asprintf( &psz_dir, "%s" DIR_SEP "mp4index",
+                          psz_cachedir ) != -1 )
+            {
+                vlc_mkdir( psz_dir, 0700 );
+                free( psz_dir );
+            }
+        }
+        if( asprintf( &psz_path, "%s" DIR_SEP "mp4index" DIR_SEP "%s",
+                      psz_cachedir, psz_hash ) == -1 )
+            psz_path = NULL;
+        free( psz_hash );
+    }
+    free( psz_cachedir );
+    return psz_path;
+}
+
+/* Sub-second modification time, so that files rewritten within the same
+ * second as they were indexed are not mistaken for the indexed ones */
+static uint32_t StatMtimeNs( const struct stat *p_st )
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC)
+    return p_st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC)
+    return p_st->st_mtimespec.tv_nsec;
+#else
+    VLC_UNUSED(p_st);
+    return 0;
+#endif
+}
+
+static size_t TrackDataSize( const index_track_t *p_tk )
+{
+    uint64_t i_size = (uint64_t) p_tk->i_chunk_count * sizeof(index_chunk_t) +
+                      (uint64_t) p_tk->i_sizes_count * sizeof(uint32_t) +
+                      (uint64_t) p_tk->i_stts_count * 2 * sizeof(uint32_t) +
+                      (uint64_t) p_tk->i_ctts_count * 2 * sizeof(uint32_t);
+    i_size = ( i_size + 7 ) & ~UINT64_C(7);
+    return i_size > SIZE_MAX ? 0 : i_size;
+}
+
+mp4_sample_index_t * MP4_SampleIndex_Open( vlc_object_t *p_obj,
+                                           const char *psz_filepath )
+{
+    struct stat st;
+    if( vlc_stat( psz_filepath, &st ) )
+        return NULL;
+
+    char *psz_path = GetIndexPath( psz_filepath, false );
+    if( psz_path == NULL )
+        return NULL;
+
+    int fd = vlc_open( psz_path, O_RDONLY );
+    free( psz_path );
+    if( fd == -1 )
+        return NULL;
+
+    mp4_sample_index_t *p_index = NULL;
+    struct stat ist;
+    if( fstat( fd, &ist ) || (uint64_t) ist.st_size < sizeof(index_header_t) ||
+        (uint64_t) ist.st_size > SIZE_MAX )
+        goto end;
+
+    p_index = malloc( sizeof(*p_index) );
+    if( p_index == NULL )
+        goto end;
+    p_index->i_data = ist.st_size;
+    p_index->b_mapped = false;
+
+#ifdef HAVE_MMAP
+    void *p_map = mmap( NULL, p_index->i_data, PROT_READ, MAP_SHARED, fd, 0 );
+    if( p_map != MAP_FAILED )
+    {
+        p_index->p_data = p_map;
+        p_index->b_mapped = true;
+    }
+    else
+#endif
+    {
+        uint8_t *p_buf = malloc( p_index->i_data );
+        size_t i_read = 0;
+        while( p_buf && i_read < p_index->i_data )
+        {
+            ssize_t i_ret = read( fd, &p_buf[i_read], p_index->i_data - i_read );
+            if( i_ret <= 0 )
+            {
+                if( i_ret < 0 && errno == EINTR )
+                    continue;
+                free( p_buf );
+                p_buf = NULL;
+            }
+            else
+                i_read += i_ret;
+        }
+        if( p_buf == NULL )
+        {
+            free( p_index );
+            p_index = NULL;
+            goto end;
+        }
+        p_index->p_data = p_buf;
+    }
+
+    const index_header_t *p_hdr = (const index_header_t *) p_index->p_data;
+    if( memcmp( p_hdr->magic, INDEX_MAGIC, sizeof(p_hdr->magic) ) ||
+        p_hdr->i_byteorder != INDEX_BYTEORDER ||
+        p_hdr->i_file_size != (uint64_t) st.st_size ||
+        p_hdr->i_file_mtime != (int64_t) st.st_mtime ||
+        p_hdr->i_file_mtime_ns != StatMtimeNs( &st ) ||
+        p_hdr->i_tracks > ( p_index->i_data - sizeof(index_header_t) ) /
+                          sizeof(index_track_t) )
+    {
+        msg_Dbg( p_obj, "discarding outdated or invalid sample index" );
+        MP4_SampleIndex_Close( p_index );
+        p_index = NULL;
+        goto end;
+    }
+
+    msg_Dbg( p_obj, "using sample index of %"PRIu32" tracks", p_hdr->i_tracks );
+
+end:
+    vlc_close( fd );
+    return p_index;
+}
+
+void MP4_SampleIndex_Close( mp4_sample_index_t *p_index )
+{
+    if( p_index == NULL )
+        return;
+#ifdef HAVE_MMAP
+    if( p_index->b_mapped )
+        munmap( (void *) p_index->p_data, p_index->i_data );
+    else
+#endif
+        free( (void *) p_index->p_data );
+    free( p_index );
+}
+
+int MP4_SampleIndex_SetupTrack( const mp4_sample_index_t *p_index,
+                                mp4_track_t *p_track )
+{
+    const index_header_t *p_hdr = (const index_header_t *) p_index->p_data;
+    const index_track_t *p_tracks = (const index_track_t *) &p_hdr[1];
+    const index_track_t *p_tk = NULL;
+
+    for( uint32_t i = 0; i < p_hdr->i_tracks; i++ )
+    {
+        if( p_tracks[i].i_track_ID == p_track->i_track_ID )
+        {
+            p_tk = &p_tracks[i];
+            break;
+        }
+    }
+    if( p_tk == NULL )
+        return VLC_EGENERIC;
+
+    /* Check the tables fit in the index */
+    const size_t i_size = TrackDataSize( p_tk );
+    if( i_size == 0 || ( p_tk->i_data & 7 ) ||
+        p_tk->i_data > p_index->i_data || i_size > p_index->i_data - p_tk->i_data ||
+        ( p_tk->i_sample_size == 0 && p_tk->i_sizes_count < p_tk->i_sample_count ) )
+        return VLC_EGENERIC;
+
+    const index_chunk_t *p_chunks =
+            (const index_chunk_t *) &p_index->p_data[p_tk->i_data];
+    const uint32_t *p_sizes = (const uint32_t *) &p_chunks[p_tk->i_chunk_count];
+    const uint32_t *p_stts = &p_sizes[p_tk->i_sizes_count];
+    const uint32_t *p_ctts = &p_stts[2 * p_tk->i_stts_count];
+
+    /* The chunks must only refer to existing samples and tables entries */
+    uint32_t i_sample_first = 0;
+    for( uint32_t i = 0; i < p_tk->i_chunk_count; i++ )
+    {
+        const index_chunk_t *ick = &p_chunks[i];
+        if( ick->i_sample_first != i_sample_first ||
+            ick->i_sample_count > UINT32_MAX - i_sample_first ||
+            ( ick->i_entries_dts &&
+              ( ick->i_stts_index > p_tk->i_stts_count ||
+                ick->i_entries_dts > p_tk->i_stts_count - ick->i_stts_index ) ) ||
+            ( ick->i_entries_pts &&
+              ( ick->i_ctts_index > p_tk->i_ctts_count ||
+                ick->i_entries_pts > p_tk->i_ctts_count - ick->i_ctts_index ) ) )
+            return VLC_EGENERIC;
+        i_sample_first += ick->i_sample_count;
+    }
+    /* i_sample_first is now the end of the last chunk samples */
+    if( i_sample_first > p_tk->i_sample_count ||
+        ( p_tk->i_sample_size == 0 && i_sample_first > p_tk->i_sizes_count ) )
+        return VLC_EGENERIC;
+
+    p_track->chunk = calloc( p_tk->i_chunk_count, sizeof(mp4_chunk_t) );
+    if( p_tk->i_chunk_count && p_track->chunk == NULL )
+        return VLC_ENOMEM;
+
+    for( uint32_t i = 0; i < p_tk->i_chunk_count; i++ )
+    {
+        const index_chunk_t *ick = &p_chunks[i];
+        mp4_chunk_t *ck = &p_track->chunk[i];
+        ck->i_offset = ick->i_offset;
+        ck->i_first_dts = ick->i_first_dts;
+        ck->i_duration = ick->i_duration;
+        ck->i_sample_description_index = ick->i_sample_description_index;
+        ck->i_sample_count = ick->i_sample_count;
+        ck->i_sample_first = ick->i_sample_first;
+        ck->i_entries_dts = ick->i_entries_dts;
+        ck->i_entries_pts = ick->i_entries_pts;
+        ck->i_stts_index = ick->i_stts_index;
+        ck->i_stts_left = ick->i_stts_left;
+        ck->i_ctts_index = ick->i_ctts_index;
+        ck->i_ctts_left = ick->i_ctts_left;
+    }
+
+    p_track->i_chunk_count = p_tk->i_chunk_count;
+    p_track->i_sample_count = p_tk->i_sample_count;
+    p_track->i_sample_size = p_tk->i_sample_size;
+    p_track->p_sample_size = p_tk->i_sample_size ? NULL : p_sizes;
+    p_track->tables.i_sizes_count = p_tk->i_sizes_count;
+    p_track->tables.i_stts_count = p_tk->i_stts_count;
+    p_track->tables.p_stts_count = p_stts;
+    p_track->tables.p_stts_delta = (const int32_t *) &p_stts[p_tk->i_stts_count];
+    p_track->tables.i_ctts_count = p_tk->i_ctts_count;
+    p_track->tables.p_ctts_count = p_ctts;
+    p_track->tables.p_ctts_offset = (const int32_t *) &p_ctts[p_tk->i_ctts_count];
+    p_track->tables.i_cts_shift = p_tk->i_cts_shift;
+
+    return VLC_SUCCESS;
+}
+
+static bool TrackIsIndexable( const mp4_track_t *p_track )
+{
+    return p_track->chunk && p_track->tables.p_stts_count &&
+           ( p_track->i_sample_size || p_track->p_sample_size );
+}
+
+static int WriteIndex( FILE *p_file, const index_header_t *p_hdr,
+                       const index_track_t *p_tks,
+                       const mp4_track_t *p_tracks, unsigned i_tracks )
+{
+    static const uint8_t zeros[8];
+
+    if( fwrite( p_hdr, sizeof(*p_hdr), 1, p_file ) != 1 ||
+        fwrite( p_tks, sizeof(*p_tks), p_hdr->i_tracks, p_file ) != p_hdr->i_tracks )
+        return VLC_EGENERIC;
+
+    uint64_t i_pos = sizeof(*p_hdr) + p_hdr->i_tracks * sizeof(*p_tks);
+    const index_track_t *p_tk = p_tks;
+    for( unsigned i = 0; i < i_tracks; i++ )
+    {
+        const mp4_track_t *p_track = &p_tracks[i];
+        if( !TrackIsIndexable( p_track ) )
+            continue;
+        assert( p_tk->i_data == i_pos );
+
+        for( uint32_t j = 0; j < p_track->i_chunk_count; j++ )
+        {
+            const mp4_chunk_t *ck = &p_track->chunk[j];
+            const index_chunk_t ick = {
+                .i_offset = ck->i_offset,
+                .i_first_dts = ck->i_first_dts,
+                .i_duration = ck->i_duration,
+                .i_sample_description_index = ck->i_sample_description_index,
+                .i_sample_count = ck->i_sample_count,
+                .i_sample_first = ck->i_sample_first,
+                .i_entries_dts = ck->i_entries_dts,
+                .i_entries_pts = ck->i_entries_pts,
+                .i_stts_index = ck->i_stts_index,
+                .i_stts_left = ck->i_stts_left,
+                .i_ctts_index = ck->i_ctts_index,
+                .i_ctts_left = ck->i_ctts_left,
+            };
+            if( fwrite( &ick, sizeof(ick), 1, p_file ) != 1 )
+                return VLC_EGENERIC;
+        }
+
+        if( fwrite( p_track->p_sample_size, sizeof(uint32_t),
+                    p_tk->i_sizes_count, p_file ) != p_tk->i_sizes_count ||
+            fwrite( p_track->tables.p_stts_count, sizeof(uint32_t),
+                    p_tk->i_stts_count, p_file ) != p_tk->i_stts_count ||
+            fwrite( p_track->tables.p_stts_delta, sizeof(int32_t),
+                    p_tk->i_stts_count, p_file ) != p_tk->i_stts_count ||
+            fwrite( p_track->tables.p_ctts_count, sizeof(uint32_t),
+                    p_tk->i_ctts_count, p_file ) != p_tk->i_ctts_count ||
+            fwrite( p_track->tables.p_ctts_offset, sizeof(int32_t),
+                    p_tk->i_ctts_count, p_file ) != p_tk->i_ctts_count )
+            return VLC_EGENERIC;
+
+        const size_t i_size = TrackDataSize( p_tk );
+        const size_t i_written = p_tk->i_chunk_count * sizeof(index_chunk_t) +
+                                 ( p_tk->i_sizes_count + 2 * p_tk->i_stts_count +
+                                   2 * p_tk->i_ctts_count ) * sizeof(uint32_t);
+        if( i_size > i_written &&
+            fwrite( zeros, i_size - i_written, 1, p_file ) != 1 )
+            return VLC_EGENERIC;
+        i_pos += i_size;
+        p_tk++;
+    }
+
+    return VLC_SUCCESS;
+}
+
+int MP4_SampleIndex_Write( vlc_object_t *p_obj, const char *psz_filepath,
+                           const mp4_track_t *p_tracks, unsigned i_tracks )
+{
+    struct stat st;
+    if( vlc_stat( psz_filepath, &st ) )
+        return VLC_EGENERIC;
+
+    index_header_t hdr = {
+        .i_byteorder = INDEX_BYTEORDER,
+        .i_tracks = 0,
+        .i_file_size = st.st_size,
+        .i_file_mtime = st.st_mtime,
+        .i_file_mtime_ns = StatMtimeNs( &st ),
+    };
+    memcpy( hdr.magic, INDEX_MAGIC, sizeof(hdr.magic) );
+
+    index_track_t *p_tks = vlc_alloc( i_tracks, sizeof(*p_tks) );
+    if( p_tks == NULL )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < i_tracks; i++ )
+        if( TrackIsIndexable( &p_tracks[i] ) )
+            hdr.i_tracks++;
+
+    /* the records are all 8 bytes multiples, and so the tracks data */
+    uint64_t i_data = sizeof(hdr) + hdr.i_tracks * sizeof(*p_tks);
+    index_track_t *p_tk = p_tks;
+    for( unsigned i = 0; i < i_tracks; i++ )
+    {
+        const mp4_track_t *p_track = &p_tracks[i];
+        if( !TrackIsIndexable( p_track ) )
+            continue;
+
+        *p_tk = (index_track_t) {
+            .i_track_ID = p_track->i_track_ID,
+            .i_chunk_count = p_track->i_chunk_count,
+            .i_sample_count = p_track->i_sample_count,
+            .i_sample_size = p_track->i_sample_size,
+            .i_sizes_count = p_track->i_sample_size ? 0 :
+                             p_track->tables.i_sizes_count,
+            .i_stts_count = p_track->tables.i_stts_count,
+            .i_ctts_count = p_track->tables.i_ctts_count,
+            .i_cts_shift = p_track->tables.i_cts_shift,
+            .i_data = i_data,
+        };
+        i_data += TrackDataSize( p_tk );
+        p_tk++;
+    }
+
+    int i_ret = VLC_EGENERIC;
+    char *psz_path = GetIndexPath( psz_filepath, true );
+    char *psz_tmp = NULL;
+    if( psz_path == NULL || asprintf( &psz_tmp, "%s.part", psz_path ) == -1 )
+    {
+        psz_tmp = NULL;
+        goto end;
+    }
+
+    FILE *p_file = vlc_fopen( psz_tmp, "wb" );
+    if( p_file == NULL )
+    {
+        msg_Warn( p_obj, "cannot create sample index %s: %s", psz_tmp,
+                  vlc_strerror_c( errno ) );
+        goto end;
+    }
+
+    i_ret = WriteIndex( p_file, &hdr, p_tks, p_tracks, i_tracks );
+    if( fclose( p_file ) )
+        i_ret = VLC_EGENERIC;
+
+    if( i_ret == VLC_SUCCESS && vlc_rename( psz_tmp, psz_path ) )
+        i_ret = VLC_EGENERIC;
+    if( i_ret != VLC_SUCCESS )
+    {
+        msg_Warn( p_obj, "cannot write sample index %s", psz_path );
+        vlc_unlink( psz_tmp );
+    }
+    else
+        msg_Dbg( p_obj, "wrote sample index of %"PRIu32" tracks to %s",
+                 hdr.i_tracks, psz_path );
+
+end:
+    free( psz_tmp );
+    free( psz_path );
+    free( p_tks );
+    return i_ret;
+}
+
+uint32_t MP4_ChunkTimes_NextRun( const uint32_t *pi_table_count,
+                                 uint32_t *pi_index, uint32_t *pi_left,
+                                 uint32_t *pi_sample_count, uint32_t *pi_entry )
+{
+    uint32_t i_count;
+
+    *pi_entry = *pi_index;
+    if ( *pi_left )
+    {
+        if ( *pi_left > *pi_sample_count )
+        {
+            i_count = *pi_sample_count;
+            *pi_left -= i_count;
+        }
+        else
+        {
+            i_count = *pi_left;
+            *pi_left = 0;
+            (*pi_index)++;
+        }
+    }
+    else
+    {
+        if ( pi_table_count[*pi_index] > *pi_sample_count )
+        {
+            i_count = *pi_sample_count;
+            *pi_left = pi_table_count[*pi_index] - i_count;
+        }
+        else
+        {
+            i_count = pi_table_count[*pi_index];
+            (*pi_index)++;
+        }
+    }
+    *pi_sample_count -= i_count;
+    return i_count;
+}
+
+void MP4_ChunkTimes_Release( mp4_chunk_t *ck )
+{
+    free( ck->p_sample_count_dts );
+    free( ck->p_sample_delta_dts );
+    free( ck->p_sample_count_pts );
+    free( ck->p_sample_offset_pts );
+    ck->p_sample_count_dts = NULL;
+    ck->p_sample_delta_dts = NULL;
+    ck->p_sample_count_pts = NULL;
+    ck->p_sample_offset_pts = NULL;
+}
+
+/* Chunks around the current one keeping their dts/pts tables */
+#define CHUNK_TIMES_RANGE 32
+
+int MP4_ChunkTimes_Load( vlc_object_t *p_obj, mp4_track_t *p_track,
+                         uint32_t i_chunk )
+{
+    if( i_chunk >= p_track->i_chunk_count )
+        return VLC_SUCCESS;
+
+    mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    if( ck->p_sample_count_dts || !ck->i_entries_dts )
+        return VLC_SUCCESS;
+
+    const uint32_t i_first = i_chunk > CHUNK_TIMES_RANGE ?
+                             i_chunk - CHUNK_TIMES_RANGE : 0;
+    const uint32_t i_end = __MIN( (uint64_t)i_chunk + CHUNK_TIMES_RANGE + 1,
+                                  p_track->i_chunk_count );
+    uint32_t i_loaded_first = i_chunk;
+    uint32_t i_loaded_end = i_chunk + 1;
+    for( uint32_t i = p_track->tables.i_loaded_first;
+         i < p_track->tables.i_loaded_end; i++ )
+    {
+        if( ( i >= i_first && i < i_end ) || i == p_track->i_chunk )
+        {
+            if( p_track->chunk[i].p_sample_count_dts )
+            {
+                i_loaded_first = __MIN( i_loaded_first, i );
+                i_loaded_end = __MAX( i_loaded_end, i + 1 );
+            }
+        }
+        else
+            MP4_ChunkTimes_Release( &p_track->chunk[i] );
+    }
+    p_track->tables.i_loaded_first = i_loaded_first;
+    p_track->tables.i_loaded_end = i_loaded_end;
+
+    ck->p_sample_count_dts = vlc_alloc( ck->i_entries_dts, sizeof( uint32_t ) );
+    ck->p_sample_delta_dts = vlc_alloc( ck->i_entries_dts, sizeof( uint32_t ) );
+    if( ck->i_entries_pts )
+    {
+        ck->p_sample_count_pts = vlc_alloc( ck->i_entries_pts, sizeof( uint32_t ) );
+        ck->p_sample_offset_pts = vlc_alloc( ck->i_entries_pts, sizeof( int32_t ) );
+    }
+    if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts ||
+        ( ck->i_entries_pts && ( !ck->p_sample_count_pts ||
+                                 !ck->p_sample_offset_pts ) ) )
+    {
+        msg_Err( p_obj, "can't allocate memory for chunk %"PRIu32" times",
+                 i_chunk );
+        MP4_ChunkTimes_Release( ck );
+        return VLC_ENOMEM;
+    }
+
+    uint32_t i_index = ck->i_stts_index;
+    uint32_t i_left = ck->i_stts_left;
+    uint32_t i_sample_count = ck->i_sample_count;
+    for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
+    {
+        uint32_t i_entry;
+        ck->p_sample_count_dts[i] =
+            MP4_ChunkTimes_NextRun( p_track->tables.p_stts_count,
+                                    &i_index, &i_left, &i_sample_count, &i_entry );
+        ck->p_sample_delta_dts[i] = p_track->tables.p_stts_delta[i_entry];
+    }
+
+    i_index = ck->i_ctts_index;
+    i_left = ck->i_ctts_left;
+    i_sample_count = ck->i_sample_count;
+    for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
+    {
+        uint32_t i_entry;
+        ck->p_sample_count_pts[i] =
+            MP4_ChunkTimes_NextRun( p_track->tables.p_ctts_count,
+                                    &i_index, &i_left, &i_sample_count, &i_entry );
+        ck->p_sample_offset_pts[i] = p_track->tables.p_ctts_offset[i_entry] +
+                                     p_track->tables.i_cts_shift;
+    }
+
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,76 @@
+/*****************************************************************************
+ * sampleindex.h : MP4 sample tables index and lazy chunk times
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_MP4_SAMPLEINDEX_H_
+#define VLC_MP4_SAMPLEINDEX_H_
+
+#include "mp4.h"
+
+/* The index stores, per track, the chunks table as built by the demuxer
+ * and the sample size and time to sample tables. It lives in the user
+ * cache directory, is keyed by the file path, and is only valid for the
+ * file size and modification time it was written for. */
+
+typedef struct mp4_sample_index_t mp4_sample_index_t;
+
+/* Minimum samples count of a track for the index to be written */
+#define MP4_SAMPLE_INDEX_MIN_SAMPLES 65536
+
+/**
+ * Maps the index of a local file, if any and still valid.
+ */
+mp4_sample_index_t * MP4_SampleIndex_Open( vlc_object_t *, const char *psz_filepath );
+void MP4_SampleIndex_Close( mp4_sample_index_t * );
+
+/**
+ * Sets up the chunks, sample size and time to sample tables of a track
+ * from the index. The tables point to the index mapping, which must
+ * outlive the track.
+ *
+ * \return VLC_SUCCESS, or an error if the track is not (validly) indexed
+ */
+int MP4_SampleIndex_SetupTrack( const mp4_sample_index_t *, mp4_track_t * );
+
+/**
+ * Writes the index of the set up tracks of a file.
+ */
+int MP4_SampleIndex_Write( vlc_object_t *, const char *psz_filepath,
+                           const mp4_track_t *, unsigned i_tracks );
+
+/* The chunks only record their position in the time to sample tables of
+ * their track, their dts/pts tables are loaded on demand. */
+
+/**
+ * Takes the next run of samples of a chunk sharing the same stts or ctts
+ * entry, from the table position (*pi_index, *pi_left).
+ *
+ * \return the run samples count, its table entry being set in *pi_entry
+ */
+uint32_t MP4_ChunkTimes_NextRun( const uint32_t *pi_table_count,
+                                 uint32_t *pi_index, uint32_t *pi_left,
+                                 uint32_t *pi_sample_count, uint32_t *pi_entry );
+
+/**
+ * Loads the dts/pts tables of a chunk, and releases the ones of the chunks
+ * far from it, except for the current chunk of the track.
+ */
+int MP4_ChunkTimes_Load( vlc_object_t *, mp4_track_t *, uint32_t i_chunk );
+void MP4_ChunkTimes_Release( mp4_chunk_t * );
+
+#endif
@@ -46,6 +46,7 @@
 #include "ts_hotfixes.h"
 #include "ts_sl.h"
 #include "ts_metadata.h"
+#include "ts_sync.h"
 #include "sections.h"
 #include "pes.h"
 #include "timestamps.h"
@@ -196,6 +197,8 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+typedef struct ts_scan_t ts_scan_t;
+static unsigned SkipUnselectedPackets( demux_t *p_demux, ts_scan_t *, unsigned );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -207,6 +210,18 @@ static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 #define TS_PACKET_SIZE_MAX 204
 #define TS_HEADER_SIZE 4
 
+/* how many packets headers we scan ahead at once */
+#define TS_SCAN_MAX 64
+
+struct ts_scan_t
+{
+    uint64_t i_pos;     /* stream offset of the next scanned packet */
+    unsigned i_count;   /* number of scanned packets */
+    unsigned i_next;    /* next scanned packet */
+    uint16_t pid[TS_SCAN_MAX];
+    uint8_t  flags[TS_SCAN_MAX];
+};
+
 #define PROBE_CHUNK_COUNT 500
 #define PROBE_MAX         (PROBE_CHUNK_COUNT * 10)
 
@@ -406,6 +421,7 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_ts_read = 50;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
+    p_sys->b_recording = false;
 
     vlc_dictionary_init( &p_sys->attachments, 0 );
 
@@ -631,12 +647,21 @@ static int Demux( demux_t *p_demux )
         GetPID(p_sys, 0)->u.p_pat->b_generated = true;
     }
 
+    ts_scan_t scan;
+    scan.i_count = scan.i_next = 0;
+
     /* We read at most 100 TS packet or until a frame is completed */
     for( unsigned i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
     {
         bool         b_frame = false;
         int          i_header = 0;
         block_t     *p_pkt;
+
+        /* Drop packets of unselected ES without reading them */
+        i_pkt += SkipUnselectedPackets( p_demux, &scan, p_sys->i_ts_read - i_pkt );
+        if( i_pkt >= p_sys->i_ts_read )
+            break;
+
         if( !(p_pkt = ReadTSPacket( p_demux )) )
         {
             return VLC_DEMUXER_EOF;
@@ -1174,6 +1199,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             vlc_stream_Control( p_sys->stream, STREAM_SET_RECORD_STATE,
                                 false );
         p_sys->b_start_record = b_bool;
+        p_sys->b_recording = b_bool;
         return VLC_SUCCESS;
 
     case DEMUX_GET_SIGNAL:
@@ -1758,6 +1784,92 @@ static void PESDataChainHandle( vlc_object_t *p_obj, void *priv, block_t *p_data
     ParsePESDataChain( (demux_t *)p_obj, (ts_pid_t *) priv, p_data );
 }
 
+static bool IsUnselectedPacket( demux_sys_t *p_sys, uint16_t i_pid, uint8_t i_flags )
+{
+    /* Anything with side effects (PCR, scrambling changes, errors) goes
+     * through the regular path */
+    if( i_flags & (TS_SYNC_TEI|TS_SYNC_SCRAMBLED|TS_SYNC_ADAPTATION) )
+        return false;
+
+    const ts_pid_t *p_pid = GetPID( p_sys, i_pid );
+    return p_pid->type == TYPE_STREAM &&
+           (p_pid->i_flags & (FLAG_SEEN|FLAG_FILTERED|FLAG_SCRAMBLED)) == FLAG_SEEN;
+}
+
+/* Skips the leading packets that the demux loop would drop anyway as
+ * belonging to unselected ES. Returns the number of skipped packets. */
+static unsigned SkipUnselectedPackets( demux_t *p_demux, ts_scan_t *p_scan,
+                                       unsigned i_max )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const unsigned i_size = p_sys->i_packet_size;
+
+    /* Hardware filtered, still probing, or skipped data would not be
+     * recorded */
+    if( p_sys->b_access_control || p_sys->es_creation == DELAY_ES ||
+        p_sys->b_recording || !SEEN( GetPID( p_sys, 0 ) ) )
+        return 0;
+
+    uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+    if( p_scan->i_next >= p_scan->i_count || p_scan->i_pos != i_pos )
+    {
+        /* Rescan on exhaustion or after the regular path resynchronized */
+        const uint8_t *p_peek;
+        ssize_t i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
+                                          __MIN(i_max, TS_SCAN_MAX) * i_size );
+        p_scan->i_next = 0;
+        p_scan->i_pos = i_pos;
+        if( i_peek < (ssize_t)i_size )
+        {
+            p_scan->i_count = 0;
+            return 0;
+        }
+        p_scan->i_count = ts_sync_ScanHeaders( &p_peek[p_sys->i_packet_header_size],
+                                               i_size, i_peek / i_size,
+                                               p_scan->pid, p_scan->flags );
+    }
+
+    unsigned i_skip = 0;
+    while( i_skip < i_max && p_scan->i_next + i_skip < p_scan->i_count &&
+           IsUnselectedPacket( p_sys, p_scan->pid[p_scan->i_next + i_skip],
+                                      p_scan->flags[p_scan->i_next + i_skip] ) )
+        i_skip++;
+
+    if( i_skip > 0 )
+    {
+        /* Keep continuity counters in sync for when the ES gets selected */
+        const uint8_t *p_peek;
+        if( vlc_stream_Peek( p_sys->stream, &p_peek, i_skip * i_size ) ==
+            (ssize_t)(i_skip * i_size) )
+        {
+            for( unsigned i = 0; i < i_skip; i++ )
+            {
+                const uint8_t *p = &p_peek[i * i_size + p_sys->i_packet_header_size];
+                if( p[3] & 0x10 )
+                {
+                    ts_pid_t *p_pid = GetPID( p_sys, p_scan->pid[p_scan->i_next + i] );
+                    p_pid->i_cc = p[3] & 0x0f;
+                    p_pid->i_dup = 0;
+                }
+            }
+        }
+
+        if( vlc_stream_Read( p_sys->stream, NULL, i_skip * i_size ) !=
+            (ssize_t)(i_skip * i_size) )
+        {
+            p_scan->i_count = 0;
+            return 0;
+        }
+        p_sys->b_end_preparse = true;
+    }
+
+    /* Whatever follows is consumed by the regular path */
+    p_scan->i_next += i_skip + 1;
+    p_scan->i_pos = i_pos + (uint64_t)(i_skip + 1) * i_size;
+
+    return i_skip;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
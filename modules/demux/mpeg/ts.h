@@ -142,6 +142,7 @@ struct demux_sys_t
 
     /* */
     bool        b_start_record;
+    bool        b_recording;
 };
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
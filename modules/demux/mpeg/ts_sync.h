@@ -0,0 +1,252 @@
+/*****************************************************************************
+ * ts_sync.h: TS packet headers batch scanning
+ *****************************************************************************
+ * Copyright (C) 2020 VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TS_SYNC_H
+#define VLC_TS_SYNC_H
+
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+#   include <emmintrin.h>
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+#   include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#   include <arm_neon.h>
+#endif
+
+/* Scans the 4 bytes headers of consecutive packets, stopping at the first
+ * lost sync byte. For each packet in sync, the PID and the following flags
+ * are returned, so that packets can be sorted out without copying them. */
+
+#define TS_SYNC_TEI         0x01 /* transport_error_indicator */
+#define TS_SYNC_SCRAMBLED   0x02 /* transport_scrambling_control */
+#define TS_SYNC_ADAPTATION  0x04 /* adaptation_field present */
+
+/* Header as a little endian 32 bits word:
+ *  bits  0- 7 sync byte
+ *  bit     15 transport_error_indicator
+ *  bits 8-12, 16-23 PID
+ *  bit     29 adaptation_field present
+ *  bits 30-31 transport_scrambling_control */
+#define TS_SYNC_WORD_PID(w)   (((w) & 0x1F00) | (((w) >> 16) & 0xFF))
+#define TS_SYNC_WORD_FLAGS(w) ((((w) >> 15) & 0x01) | \
+                               ((((w) >> 30) | ((w) >> 31)) & 0x01) << 1 | \
+                               (((w) >> 29) & 0x01) << 2)
+
+static inline uint32_t ts_sync_LoadHeader( const uint8_t *p )
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+           (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline size_t ts_sync_ScanHeaders_C( const uint8_t *p, size_t i_stride,
+                                            size_t i_count,
+                                            uint16_t *pi_pid, uint8_t *pi_flags )
+{
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        uint32_t w = ts_sync_LoadHeader( &p[i * i_stride] );
+        if( (w & 0xFF) != 0x47 )
+            return i;
+        pi_pid[i] = TS_SYNC_WORD_PID(w);
+        pi_flags[i] = TS_SYNC_WORD_FLAGS(w);
+    }
+    return i_count;
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+__attribute__ ((__target__ ("sse2")))
+static inline size_t ts_sync_ScanHeaders_SSE2( const uint8_t *p, size_t i_stride,
+                                               size_t i_count,
+                                               uint16_t *pi_pid, uint8_t *pi_flags )
+{
+    const __m128i sync = _mm_set1_epi32( 0x47 );
+    const __m128i bytemask = _mm_set1_epi32( 0xFF );
+    const __m128i pidmask = _mm_set1_epi32( 0x1F00 );
+    const __m128i one = _mm_set1_epi32( 0x01 );
+    size_t i = 0;
+
+    for( ; i + 4 <= i_count; i += 4 )
+    {
+        const uint8_t *q = &p[i * i_stride];
+        __m128i w = _mm_set_epi32( ts_sync_LoadHeader( q + 3 * i_stride ),
+                                   ts_sync_LoadHeader( q + 2 * i_stride ),
+                                   ts_sync_LoadHeader( q + i_stride ),
+                                   ts_sync_LoadHeader( q ) );
+
+        __m128i insync = _mm_cmpeq_epi32( _mm_and_si128( w, bytemask ), sync );
+        if( _mm_movemask_epi8( insync ) != 0xFFFF )
+            break;
+
+        __m128i pid = _mm_or_si128( _mm_and_si128( w, pidmask ),
+                          _mm_and_si128( _mm_srli_epi32( w, 16 ), bytemask ) );
+        __m128i tei = _mm_and_si128( _mm_srli_epi32( w, 15 ), one );
+        __m128i scr = _mm_and_si128( _mm_or_si128( _mm_srli_epi32( w, 30 ),
+                                                   _mm_srli_epi32( w, 31 ) ), one );
+        __m128i af = _mm_and_si128( _mm_srli_epi32( w, 29 ), one );
+        __m128i flags = _mm_or_si128( tei, _mm_or_si128( _mm_slli_epi32( scr, 1 ),
+                                                         _mm_slli_epi32( af, 2 ) ) );
+
+        /* Both fit in 16 bits: pack them side by side */
+        __m128i packed = _mm_packs_epi32( pid, flags );
+        uint16_t out[8];
+        _mm_storeu_si128( (__m128i *) out, packed );
+        for( unsigned j = 0; j < 4; j++ )
+        {
+            pi_pid[i + j] = out[j];
+            pi_flags[i + j] = out[4 + j];
+        }
+    }
+
+    return i + ts_sync_ScanHeaders_C( &p[i * i_stride], i_stride, i_count - i,
+                                      &pi_pid[i], &pi_flags[i] );
+}
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+__attribute__ ((__target__ ("avx2")))
+static inline size_t ts_sync_ScanHeaders_AVX2( const uint8_t *p, size_t i_stride,
+                                               size_t i_count,
+                                               uint16_t *pi_pid, uint8_t *pi_flags )
+{
+    const __m256i sync = _mm256_set1_epi32( 0x47 );
+    const __m256i bytemask = _mm256_set1_epi32( 0xFF );
+    const __m256i pidmask = _mm256_set1_epi32( 0x1F00 );
+    const __m256i one = _mm256_set1_epi32( 0x01 );
+    const __m256i offsets = _mm256_mullo_epi32( _mm256_set1_epi32( i_stride ),
+                                    _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+    size_t i = 0;
+
+    if( i_stride > INT32_MAX / 8 )
+        return ts_sync_ScanHeaders_C( p, i_stride, i_count, pi_pid, pi_flags );
+
+    for( ; i + 8 <= i_count; i += 8 )
+    {
+        /* Gather the 8 headers at once */
+        __m256i w = _mm256_i32gather_epi32( (const int *) &p[i * i_stride],
+                                            offsets, 1 );
+
+        __m256i insync = _mm256_cmpeq_epi32( _mm256_and_si256( w, bytemask ), sync );
+        if( (uint32_t) _mm256_movemask_epi8( insync ) != 0xFFFFFFFF )
+            break;
+
+        __m256i pid = _mm256_or_si256( _mm256_and_si256( w, pidmask ),
+                          _mm256_and_si256( _mm256_srli_epi32( w, 16 ), bytemask ) );
+        __m256i tei = _mm256_and_si256( _mm256_srli_epi32( w, 15 ), one );
+        __m256i scr = _mm256_and_si256( _mm256_or_si256( _mm256_srli_epi32( w, 30 ),
+                                                         _mm256_srli_epi32( w, 31 ) ), one );
+        __m256i af = _mm256_and_si256( _mm256_srli_epi32( w, 29 ), one );
+        __m256i flags = _mm256_or_si256( tei,
+                                         _mm256_or_si256( _mm256_slli_epi32( scr, 1 ),
+                                                          _mm256_slli_epi32( af, 2 ) ) );
+
+        uint32_t outpid[8], outflags[8];
+        _mm256_storeu_si256( (__m256i *) outpid, pid );
+        _mm256_storeu_si256( (__m256i *) outflags, flags );
+        for( unsigned j = 0; j < 8; j++ )
+        {
+            pi_pid[i + j] = outpid[j];
+            pi_flags[i + j] = outflags[j];
+        }
+    }
+
+    return i + ts_sync_ScanHeaders_C( &p[i * i_stride], i_stride, i_count - i,
+                                      &pi_pid[i], &pi_flags[i] );
+}
+#endif
+
+#if defined(__ARM_NEON)
+static inline size_t ts_sync_ScanHeaders_NEON( const uint8_t *p, size_t i_stride,
+                                               size_t i_count,
+                                               uint16_t *pi_pid, uint8_t *pi_flags )
+{
+    const uint32x4_t sync = vdupq_n_u32( 0x47 );
+    const uint32x4_t bytemask = vdupq_n_u32( 0xFF );
+    const uint32x4_t pidmask = vdupq_n_u32( 0x1F00 );
+    const uint32x4_t one = vdupq_n_u32( 0x01 );
+    size_t i = 0;
+
+    for( ; i + 4 <= i_count; i += 4 )
+    {
+        const uint8_t *q = &p[i * i_stride];
+        uint32x4_t w = vdupq_n_u32( ts_sync_LoadHeader( q ) );
+        w = vsetq_lane_u32( ts_sync_LoadHeader( q + i_stride ), w, 1 );
+        w = vsetq_lane_u32( ts_sync_LoadHeader( q + 2 * i_stride ), w, 2 );
+        w = vsetq_lane_u32( ts_sync_LoadHeader( q + 3 * i_stride ), w, 3 );
+
+        uint32x4_t insync = vceqq_u32( vandq_u32( w, bytemask ), sync );
+        uint32x2_t all = vand_u32( vget_low_u32( insync ), vget_high_u32( insync ) );
+        if( (vget_lane_u32( all, 0 ) & vget_lane_u32( all, 1 )) != 0xFFFFFFFF )
+            break;
+
+        uint32x4_t pid = vorrq_u32( vandq_u32( w, pidmask ),
+                                    vandq_u32( vshrq_n_u32( w, 16 ), bytemask ) );
+        uint32x4_t tei = vandq_u32( vshrq_n_u32( w, 15 ), one );
+        uint32x4_t scr = vandq_u32( vorrq_u32( vshrq_n_u32( w, 30 ),
+                                               vshrq_n_u32( w, 31 ) ), one );
+        uint32x4_t af = vandq_u32( vshrq_n_u32( w, 29 ), one );
+        uint32x4_t flags = vorrq_u32( tei, vorrq_u32( vshlq_n_u32( scr, 1 ),
+                                                      vshlq_n_u32( af, 2 ) ) );
+
+        uint16x4_t pid16 = vmovn_u32( pid );
+        uint16x4_t flags16 = vmovn_u32( flags );
+        vst1_u16( &pi_pid[i], pid16 );
+        pi_flags[i + 0] = vget_lane_u16( flags16, 0 );
+        pi_flags[i + 1] = vget_lane_u16( flags16, 1 );
+        pi_flags[i + 2] = vget_lane_u16( flags16, 2 );
+        pi_flags[i + 3] = vget_lane_u16( flags16, 3 );
+    }
+
+    return i + ts_sync_ScanHeaders_C( &p[i * i_stride], i_stride, i_count - i,
+                                      &pi_pid[i], &pi_flags[i] );
+}
+#endif
+
+/**
+ * Scans packet headers.
+ *
+ * @param p first sync byte
+ * @param i_stride packet size (including any extra header)
+ * @param i_count number of packets available from p
+ * @param pi_pid PIDs of the packets [OUT]
+ * @param pi_flags TS_SYNC_* flags of the packets [OUT]
+ * @return the number of leading packets with a valid sync byte
+ */
+static inline size_t ts_sync_ScanHeaders( const uint8_t *p, size_t i_stride,
+                                          size_t i_count,
+                                          uint16_t *pi_pid, uint8_t *pi_flags )
+{
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        return ts_sync_ScanHeaders_AVX2( p, i_stride, i_count, pi_pid, pi_flags );
+#endif
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+        return ts_sync_ScanHeaders_SSE2( p, i_stride, i_count, pi_pid, pi_flags );
+#endif
+#if defined(__ARM_NEON)
+    if( vlc_CPU_ARM_NEON() )
+        return ts_sync_ScanHeaders_NEON( p, i_stride, i_count, pi_pid, pi_flags );
+#endif
+    return ts_sync_ScanHeaders_C( p, i_stride, i_count, pi_pid, pi_flags );
+}
+
+#endif
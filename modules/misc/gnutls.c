@@ -47,8 +47,33 @@ typedef struct vlc_tls_gnutls
     vlc_tls_t tls;
     gnutls_session_t session;
     vlc_object_t *obj;
+    /* Client sessions only */
+    vlc_tls_client_t *client;
+    char *host;
+    vlc_tick_t start;
+    bool established;
 } vlc_tls_gnutls_t;
 
+/* Client-side sessions are resumed from this many servers at most */
+#define SESSION_CACHE_SIZE 32
+
+typedef struct vlc_tls_client_sys
+{
+    gnutls_certificate_credentials_t x509;
+
+    vlc_mutex_t lock;
+    struct
+    {
+        char *host;
+        gnutls_datum_t data;
+        vlc_tick_t date;
+    } cache[SESSION_CACHE_SIZE];
+    unsigned handshakes;
+    unsigned resumed;
+    vlc_tick_t full_time;
+    vlc_tick_t resumed_time;
+} vlc_tls_client_sys_t;
+
 static void gnutls_Banner(vlc_object_t *obj)
 {
     msg_Dbg(obj, "using GnuTLS v%s (built with v"GNUTLS_VERSION")",
@@ -203,11 +228,22 @@ static int gnutls_Shutdown(vlc_tls_t *tls, bool duplex)
     return 0;
 }
 
+static void gnutls_SessionStore(vlc_tls_gnutls_t *priv);
+
 static void gnutls_Close (vlc_tls_t *tls)
 {
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
 
+#if GNUTLS_VERSION_NUMBER >= 0x03060d
+    /* TLS 1.3 tickets are sent after the handshake */
+    if (priv->established
+     && gnutls_protocol_get_version(priv->session) == GNUTLS_TLS1_3
+     && (gnutls_session_get_flags(priv->session)
+         & GNUTLS_SFLAGS_SESSION_TICKET))
+        gnutls_SessionStore(priv);
+#endif
     gnutls_deinit(priv->session);
+    free(priv->host);
     free(priv);
 }
 
@@ -295,6 +331,9 @@ static vlc_tls_gnutls_t *gnutls_SessionOpen(vlc_object_t *obj, int type,
 
     priv->session = session;
     priv->obj = obj;
+    priv->client = NULL;
+    priv->host = NULL;
+    priv->established = false;
 
     vlc_tls_t *tls = &priv->tls;
 
@@ -373,31 +412,112 @@ static int gnutls_Handshake(vlc_tls_t *tls, char **restrict alp)
     return 0;
 }
 
+/**
+ * Saves the parameters of an established client session, so that the next
+ * session with the same server can be resumed with an abbreviated handshake.
+ */
+static void gnutls_SessionStore(vlc_tls_gnutls_t *priv)
+{
+    vlc_tls_client_sys_t *sys = priv->client->sys;
+    gnutls_datum_t data;
+
+    if (priv->host == NULL
+     || gnutls_session_get_data2(priv->session, &data) != 0)
+        return;
+
+    vlc_mutex_lock(&sys->lock);
+    unsigned slot = 0;
+
+    /* Replace the entry of the same server, or else the oldest one */
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        if (sys->cache[i].host != NULL
+         && strcasecmp(sys->cache[i].host, priv->host) == 0)
+        {
+            slot = i;
+            break;
+        }
+        if (sys->cache[i].date < sys->cache[slot].date)
+            slot = i;
+    }
+
+    if (sys->cache[slot].host == NULL
+     || strcasecmp(sys->cache[slot].host, priv->host) != 0)
+    {
+        char *host = strdup(priv->host);
+        if (unlikely(host == NULL))
+        {
+            vlc_mutex_unlock(&sys->lock);
+            gnutls_free(data.data);
+            return;
+        }
+        free(sys->cache[slot].host);
+        sys->cache[slot].host = host;
+    }
+    gnutls_free(sys->cache[slot].data.data);
+    sys->cache[slot].data = data;
+    sys->cache[slot].date = vlc_tick_now();
+    vlc_mutex_unlock(&sys->lock);
+}
+
+/**
+ * Sets the saved parameters of a previous session with the same server.
+ */
+static void gnutls_SessionResume(vlc_tls_gnutls_t *priv)
+{
+    vlc_tls_client_sys_t *sys = priv->client->sys;
+
+    vlc_mutex_lock(&sys->lock);
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+        if (sys->cache[i].host != NULL
+         && strcasecmp(sys->cache[i].host, priv->host) == 0)
+        {
+            int val = gnutls_session_set_data(priv->session,
+                                              sys->cache[i].data.data,
+                                              sys->cache[i].data.size);
+            if (val != 0)
+                msg_Dbg(priv->obj, "cannot resume TLS session: %s",
+                        gnutls_strerror(val));
+            break;
+        }
+    vlc_mutex_unlock(&sys->lock);
+}
+
 static vlc_tls_t *gnutls_ClientSessionOpen(vlc_tls_client_t *crd,
                                            vlc_tls_t *sk, const char *hostname,
                                            const char *const *alpn)
 {
+    vlc_tls_client_sys_t *sys = crd->sys;
     vlc_tls_gnutls_t *priv = gnutls_SessionOpen(VLC_OBJECT(crd), GNUTLS_CLIENT,
-                                                crd->sys, sk, alpn);
+                                                sys->x509, sk, alpn);
     if (priv == NULL)
         return NULL;
 
     gnutls_session_t session = priv->session;
 
+    priv->client = crd;
+    priv->start = vlc_tick_now();
+
     /* minimum DH prime bits */
     gnutls_dh_set_prime_bits (session, 1024);
 
     if (likely(hostname != NULL))
+    {
         /* fill Server Name Indication */
         gnutls_server_name_set (session, GNUTLS_NAME_DNS,
                                 hostname, strlen (hostname));
 
+        priv->host = strdup(hostname);
+        if (likely(priv->host != NULL))
+            gnutls_SessionResume(priv);
+    }
+
     return &priv->tls;
 }
 
-static int gnutls_ClientHandshake(vlc_tls_t *tls,
-                                  const char *host, const char *service,
-                                  char **restrict alp)
+static int gnutls_ClientVerify(vlc_tls_t *tls,
+                               const char *host, const char *service,
+                               char **restrict alp)
 {
     vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
     vlc_object_t *obj = priv->obj;
@@ -529,11 +649,62 @@ error:
     return -1;
 }
 
+static int gnutls_ClientHandshake(vlc_tls_t *tls,
+                                  const char *host, const char *service,
+                                  char **restrict alp)
+{
+    vlc_tls_gnutls_t *priv = (vlc_tls_gnutls_t *)tls;
+
+    int val = gnutls_ClientVerify(tls, host, service, alp);
+    if (val)
+        return val;
+
+    vlc_tls_client_sys_t *sys = priv->client->sys;
+    vlc_tick_t delay = vlc_tick_now() - priv->start;
+    bool resumed = gnutls_session_is_resumed(priv->session);
+
+    priv->established = true;
+#if GNUTLS_VERSION_NUMBER >= 0x03060d
+    /* TLS 1.3 tickets come after the handshake, see gnutls_Close() */
+    if (gnutls_protocol_get_version(priv->session) != GNUTLS_TLS1_3)
+#endif
+        gnutls_SessionStore(priv);
+
+    vlc_mutex_lock(&sys->lock);
+    sys->handshakes++;
+    if (resumed)
+    {
+        sys->resumed++;
+        sys->resumed_time += delay;
+    }
+    else
+        sys->full_time += delay;
+    vlc_mutex_unlock(&sys->lock);
+
+    msg_Dbg(priv->obj, "TLS session %s in %"PRId64" ms",
+            resumed ? "resumed" : "established", MS_FROM_VLC_TICK(delay));
+    return 0;
+}
+
 static void gnutls_ClientDestroy(vlc_tls_client_t *crd)
 {
-    gnutls_certificate_credentials_t x509 = crd->sys;
+    vlc_tls_client_sys_t *sys = crd->sys;
+    unsigned full = sys->handshakes - sys->resumed;
+
+    if (sys->handshakes > 0)
+        msg_Dbg(crd, "%u TLS handshakes: %u full (%"PRId64" ms average), "
+                "%u resumed (%"PRId64" ms average)", sys->handshakes,
+                full, full ? MS_FROM_VLC_TICK(sys->full_time / full) : 0,
+                sys->resumed, sys->resumed
+                ? MS_FROM_VLC_TICK(sys->resumed_time / sys->resumed) : 0);
 
-    gnutls_certificate_free_credentials(x509);
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        free(sys->cache[i].host);
+        gnutls_free(sys->cache[i].data.data);
+    }
+    gnutls_certificate_free_credentials(sys->x509);
+    free(sys);
 }
 
 static const struct vlc_tls_client_operations gnutls_ClientOps =
@@ -552,11 +723,16 @@ static int OpenClient(vlc_tls_client_t *crd)
 
     gnutls_Banner(VLC_OBJECT(crd));
 
+    vlc_tls_client_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
     int val = gnutls_certificate_allocate_credentials (&x509);
     if (val != 0)
     {
         msg_Err (crd, "cannot allocate credentials: %s",
                  gnutls_strerror (val));
+        free(sys);
         return VLC_EGENERIC;
     }
 
@@ -586,8 +762,22 @@ static int OpenClient(vlc_tls_client_t *crd)
     gnutls_certificate_set_verify_flags (x509,
                                          GNUTLS_VERIFY_ALLOW_X509_V1_CA_CRT);
 
+    sys->x509 = x509;
+    vlc_mutex_init(&sys->lock);
+    for (unsigned i = 0; i < SESSION_CACHE_SIZE; i++)
+    {
+        sys->cache[i].host = NULL;
+        sys->cache[i].data.data = NULL;
+        sys->cache[i].data.size = 0;
+        sys->cache[i].date = VLC_TICK_INVALID;
+    }
+    sys->handshakes = 0;
+    sys->resumed = 0;
+    sys->full_time = 0;
+    sys->resumed_time = 0;
+
     crd->ops = &gnutls_ClientOps;
-    crd->sys = x509;
+    crd->sys = sys;
     return VLC_SUCCESS;
 }
 
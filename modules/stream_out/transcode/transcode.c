@@ -35,6 +35,7 @@
 #include <vlc_plugin.h>
 #include <vlc_sout.h>
 #include <vlc_spu.h>
+#include <vlc_charset.h>
 
 #include "transcode.h"
 
@@ -126,6 +127,16 @@
 #define HP_LONGTEXT N_( \
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
     "VIDEO." )
+#define PIPELINE_TEXT N_("Pipelined video transcoding")
+#define PIPELINE_LONGTEXT N_( \
+    "Filters and encodes the decoded video in a separate thread, so that " \
+    "decoding, filtering and encoding (with threads > 0) run concurrently. " \
+    "The picture pool size bounds the queue of decoded pictures." )
+#define RENDITIONS_TEXT N_("Additional video renditions")
+#define RENDITIONS_LONGTEXT N_( \
+    "List of additional video encodings of the same decoded pictures, " \
+    "each overriding vb, width, height, maxwidth, maxheight or scale, " \
+    "e.g. \"{vb=1500,width=854}{vb=800,width=640}\"." )
 #define POOL_TEXT N_("Picture pool size")
 #define POOL_LONGTEXT N_( "Defines how many pictures we allow to be in pool "\
     "between decoder/encoder threads when threads > 0" )
@@ -177,6 +188,8 @@ vlc_module_begin ()
                  MAXHEIGHT_LONGTEXT, true )
     add_module_list(SOUT_CFG_PREFIX "vfilter", "video filter", NULL,
                     VFILTER_TEXT, VFILTER_LONGTEXT)
+    add_string( SOUT_CFG_PREFIX "renditions", NULL, RENDITIONS_TEXT,
+                RENDITIONS_LONGTEXT, true )
 
     set_section( N_("Audio"), NULL )
     add_module(SOUT_CFG_PREFIX "aenc", "encoder", NULL,
@@ -215,6 +228,8 @@ vlc_module_begin ()
         change_integer_range( 1, 1000 )
     add_bool( SOUT_CFG_PREFIX "high-priority", false, HP_TEXT, HP_LONGTEXT,
               true )
+    add_bool( SOUT_CFG_PREFIX "pipeline", false, PIPELINE_TEXT,
+              PIPELINE_LONGTEXT, true )
 
 vlc_module_end ()
 
@@ -224,7 +239,7 @@ static const char *const ppsz_sout_options[] = {
     "deinterlace-module", "threads", "aenc", "acodec", "ab", "alang",
     "afilter", "samplerate", "channels", "senc", "scodec", "soverlay",
     "sfilter", "high-priority", "maxwidth", "maxheight", "pool-size",
-    NULL
+    "pipeline", "renditions", NULL
 };
 
 /*****************************************************************************
@@ -325,6 +340,7 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
 
     p_cfg->video.threads.i_count = var_GetInteger( p_stream, SOUT_CFG_PREFIX "threads" );
     p_cfg->video.threads.pool_size = var_GetInteger( p_stream, SOUT_CFG_PREFIX "pool-size" );
+    p_cfg->video.threads.b_pipeline = var_GetBool( p_stream, SOUT_CFG_PREFIX "pipeline" );
 
     if( var_GetBool( p_stream, SOUT_CFG_PREFIX "high-priority" ) )
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_OUTPUT;
@@ -332,6 +348,70 @@ static void SetVideoEncoderConfig( sout_stream_t *p_stream, transcode_encoder_co
         p_cfg->video.threads.i_priority = VLC_THREAD_PRIORITY_VIDEO;
 }
 
+static void SetVideoRenditionsConfig( sout_stream_t *p_stream,
+                                      sout_stream_sys_t *p_sys )
+{
+    char *psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "renditions" );
+
+    if( psz_string == NULL )
+        return;
+
+    /* Each rendition is a {name=value,...} group of options */
+    for( const char *psz_opts = psz_string; *psz_opts != '\0'; )
+    {
+        config_chain_t *p_chain = NULL;
+        psz_opts = config_ChainParseOptions( &p_chain, psz_opts );
+        if( p_chain == NULL )
+            continue;
+
+        transcode_encoder_config_t *p_cfgs =
+            realloc( p_sys->p_vrenditions_cfg,
+                     (p_sys->i_vrenditions + 1) * sizeof(*p_cfgs) );
+        if( unlikely(p_cfgs == NULL) )
+        {
+            config_ChainDestroy( p_chain );
+            break;
+        }
+        p_sys->p_vrenditions_cfg = p_cfgs;
+
+        /* Same codec, encoder and threading as the main encoding */
+        transcode_encoder_config_t *p_cfg = &p_cfgs[p_sys->i_vrenditions++];
+        *p_cfg = p_sys->venc_cfg;
+
+        for( const config_chain_t *p = p_chain; p != NULL; p = p->p_next )
+        {
+            if( p->psz_value == NULL )
+                continue;
+            if( !strcmp( p->psz_name, "vb" ) )
+            {
+                p_cfg->video.i_bitrate = atoi( p->psz_value );
+                if( p_cfg->video.i_bitrate < 16000 )
+                    p_cfg->video.i_bitrate *= 1000;
+            }
+            else if( !strcmp( p->psz_name, "width" ) )
+                p_cfg->video.i_width = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "height" ) )
+                p_cfg->video.i_height = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "maxwidth" ) )
+                p_cfg->video.i_maxwidth = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "maxheight" ) )
+                p_cfg->video.i_maxheight = atoi( p->psz_value );
+            else if( !strcmp( p->psz_name, "scale" ) )
+                p_cfg->video.f_scale = us_atof( p->psz_value );
+            else
+                msg_Warn( p_stream, "unknown rendition option %s",
+                          p->psz_name );
+        }
+        config_ChainDestroy( p_chain );
+
+        msg_Dbg( p_stream, "video rendition %zu: %dx%d scaling: %f %dkb/s",
+                 p_sys->i_vrenditions,
+                 p_cfg->video.i_width, p_cfg->video.i_height,
+                 p_cfg->video.f_scale, p_cfg->video.i_bitrate / 1000 );
+    }
+    free( psz_string );
+}
+
 static void SetSPUEncoderConfig( sout_stream_t *p_stream, transcode_encoder_config_t *p_cfg )
 {
     char *psz_string = var_GetString( p_stream, SOUT_CFG_PREFIX "senc" );
@@ -418,6 +498,7 @@ static int Open( vlc_object_t *p_this )
                  p_sys->venc_cfg.video.i_height,
                  p_sys->venc_cfg.video.f_scale,
                  p_sys->venc_cfg.video.i_bitrate / 1000 );
+        SetVideoRenditionsConfig( p_stream, p_sys );
     }
 
     /* Video Filter Parameters */
@@ -480,6 +561,9 @@ static void Close( vlc_object_t * p_this )
     sout_stream_t       *p_stream = (sout_stream_t*)p_this;
     sout_stream_sys_t   *p_sys = p_stream->p_sys;
 
+    /* Renditions only hold shallow copies of venc_cfg */
+    free( p_sys->p_vrenditions_cfg );
+    TAB_CLEAN( p_sys->i_allocated_ids, p_sys->pi_allocated_ids );
     transcode_encoder_config_clean( &p_sys->venc_cfg );
     sout_filters_config_clean( &p_sys->vfilters_cfg );
 
@@ -574,6 +658,22 @@ static void *transcode_downstream_Add( sout_stream_t *p_stream,
     return downstream;
 }
 
+/* Additional renditions are output as new ES, with their own ids */
+void *transcode_downstream_AddRendition( sout_stream_t *p_stream,
+                                         const es_format_t *fmt_orig,
+                                         const es_format_t *fmt )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    es_format_t orig = *fmt_orig; /* shallow copy, only the id differs */
+
+    vlc_mutex_lock( &p_sys->lock );
+    orig.i_id = ++p_sys->i_es_id_last;
+    TAB_APPEND( p_sys->i_allocated_ids, p_sys->pi_allocated_ids, orig.i_id );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return transcode_downstream_Add( p_stream, &orig, fmt );
+}
+
 static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -586,6 +686,28 @@ static void *Add( sout_stream_t *p_stream, const es_format_t *p_fmt )
     vlc_mutex_init(&id->fifo.lock);
     id->pf_transcode_downstream_add = transcode_downstream_Add;
 
+    /* An ES added later (e.g. on a PMT update) can reuse an id allocated
+     * for a rendition or another renumbered ES: give it a new id instead */
+    es_format_t renumbered;
+    int i_allocated;
+
+    vlc_mutex_lock( &p_sys->lock );
+    TAB_FIND( p_sys->i_allocated_ids, p_sys->pi_allocated_ids,
+              p_fmt->i_id, i_allocated );
+    if( i_allocated >= 0 )
+    {
+        renumbered = *p_fmt; /* shallow copy, only the id differs */
+        renumbered.i_id = ++p_sys->i_es_id_last;
+        TAB_APPEND( p_sys->i_allocated_ids, p_sys->pi_allocated_ids,
+                    renumbered.i_id );
+        msg_Dbg( p_stream, "ES id %d is already used, renumbered to %d",
+                 p_fmt->i_id, renumbered.i_id );
+        p_fmt = &renumbered;
+    }
+    else if( p_fmt->i_id > p_sys->i_es_id_last )
+        p_sys->i_es_id_last = p_fmt->i_id;
+    vlc_mutex_unlock( &p_sys->lock );
+
     /* Create decoder object */
     struct decoder_owner * p_owner = vlc_object_create( p_stream, sizeof( *p_owner ) );
     if( !p_owner )
@@ -693,7 +815,7 @@ static void Del( sout_stream_t *p_stream, void *_id )
             if( id == p_sys->id_video )
                 p_sys->id_video = NULL;
             vlc_mutex_unlock( &p_sys->lock );
-            transcode_video_clean( id );
+            transcode_video_clean( p_stream, id );
             break;
         case SPU_ES:
             decoder_Destroy( id->p_decoder );
@@ -52,6 +52,10 @@ typedef struct
     /* Video */
     transcode_encoder_config_t venc_cfg;
     sout_filters_config_t vfilters_cfg;
+    /* Additional video encodings sharing the decoding (shallow copies of
+     * venc_cfg) */
+    transcode_encoder_config_t *p_vrenditions_cfg;
+    size_t          i_vrenditions;
 
     /* SPU */
     transcode_encoder_config_t senc_cfg;
@@ -63,10 +67,17 @@ typedef struct
     sout_stream_id_sys_t *id_master_sync;
     /* Spu's video */
     sout_stream_id_sys_t *id_video;
+    /* Highest ES id seen so far, renditions are numbered above it */
+    int             i_es_id_last;
+    /* ES ids allocated here (renditions, renumbered ES), that input ES
+     * must not reuse */
+    int             i_allocated_ids;
+    int            *pi_allocated_ids;
 
 } sout_stream_sys_t;
 
 struct aout_filters;
+struct transcode_video_rendition;
 
 struct sout_stream_id_sys_t
 {
@@ -130,6 +141,9 @@ struct sout_stream_id_sys_t
              spu_t           *p_spu;
              vlc_decoder_device *dec_dev;
              vlc_video_context *enc_vctx_in;
+             struct transcode_video_pipeline *pipeline;
+             struct transcode_video_rendition *p_renditions;
+             size_t          i_renditions;
          };
          struct
          {
@@ -207,7 +221,9 @@ int  transcode_audio_init   ( sout_stream_t *, const es_format_t *,
 
 /* VIDEO */
 
-void transcode_video_clean  ( sout_stream_id_sys_t * );
+void *transcode_downstream_AddRendition( sout_stream_t *, const es_format_t *,
+                                         const es_format_t * );
+void transcode_video_clean  ( sout_stream_t *, sout_stream_id_sys_t * );
 int  transcode_video_process( sout_stream_t *, sout_stream_id_sys_t *,
                                      block_t *, block_t ** );
 int transcode_video_get_output_dimensions( sout_stream_id_sys_t *,
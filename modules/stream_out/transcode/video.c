@@ -46,6 +46,50 @@ struct encoder_owner
     sout_stream_id_sys_t *id;
 };
 
+struct transcode_video_stage
+{
+    vlc_tick_t i_total;
+    vlc_tick_t i_max;
+    uint64_t   i_count;
+};
+
+/* Pipelined mode: the decoder runs in the caller thread, while a worker
+ * filters, blends and encodes the decoded pictures (the encoder itself
+ * can run in its own thread with threads > 0).
+ * Everything is protected by the fifo lock. */
+struct transcode_video_pipeline
+{
+    sout_stream_t *p_stream;
+    vlc_thread_t thread;
+    vlc_cond_t   wait;      /* pictures queued, or stop requested */
+    vlc_cond_t   room;      /* picture dequeued, or worker idle */
+    unsigned     i_depth;   /* queued pictures */
+    unsigned     i_max_depth;
+    bool         b_busy;
+    bool         b_stop;
+
+    /* encoded, not yet sent */
+    block_t     *p_out;
+    block_t    **pp_out_last;
+
+    /* statistics */
+    struct transcode_video_stage decode, filter, encode;
+    uint64_t     i_depth_sum;
+    uint64_t     i_depth_samples;
+    unsigned     i_depth_peak;
+    uint64_t     i_stalls;
+};
+
+/* Additional encoding of the decoded pictures, with its own conversions,
+ * encoder and output ES */
+struct transcode_video_rendition
+{
+    sout_stream_id_sys_t id;
+    /* encoded, not yet sent, protected by the main fifo lock */
+    block_t     *p_out;
+    block_t    **pp_out_last;
+};
+
 static vlc_decoder_device *TranscodeHoldDecoderDevice(vlc_object_t *o, sout_stream_id_sys_t *id)
 {
     if (id->dec_dev == NULL)
@@ -151,23 +195,90 @@ static void decoder_queue_video( decoder_t *p_dec, picture_t *p_pic )
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
     sout_stream_id_sys_t *id = p_owner->id;
 
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
+
     vlc_mutex_lock(&id->fifo.lock);
+    if( p_pipe )
+    {
+        /* Bound the queue: the decoder waits for the filter stage */
+        if( p_pipe->i_depth >= p_pipe->i_max_depth )
+            p_pipe->i_stalls++;
+        while( p_pipe->i_depth >= p_pipe->i_max_depth && !p_pipe->b_stop )
+            vlc_cond_wait( &p_pipe->room, &id->fifo.lock );
+
+        p_pipe->i_depth++;
+        p_pipe->i_depth_sum += p_pipe->i_depth;
+        p_pipe->i_depth_samples++;
+        if( p_pipe->i_depth > p_pipe->i_depth_peak )
+            p_pipe->i_depth_peak = p_pipe->i_depth;
+        vlc_cond_signal( &p_pipe->wait );
+    }
     *id->fifo.pic.last = p_pic;
     id->fifo.pic.last = &p_pic->p_next;
     vlc_mutex_unlock(&id->fifo.lock);
 }
 
+static int transcode_video_pipeline_start( sout_stream_t *, sout_stream_id_sys_t * );
+static void transcode_video_pipeline_stop( sout_stream_id_sys_t * );
+
 static picture_t *transcode_dequeue_all_pics( sout_stream_id_sys_t *id )
 {
     vlc_mutex_lock(&id->fifo.lock);
     picture_t *p_pics = id->fifo.pic.first;
     id->fifo.pic.first = NULL;
     id->fifo.pic.last = &id->fifo.pic.first;
+    if( id->pipeline )
+        id->pipeline->i_depth = 0;
     vlc_mutex_unlock(&id->fifo.lock);
 
     return p_pics;
 }
 
+static void transcode_video_renditions_init( sout_stream_t *p_stream,
+                                             sout_stream_id_sys_t *id,
+                                             const es_format_t *p_fmt_in )
+{
+    const sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( p_sys->i_vrenditions == 0 )
+        return;
+
+    id->p_renditions = calloc( p_sys->i_vrenditions, sizeof(*id->p_renditions) );
+    if( unlikely(id->p_renditions == NULL) )
+        return;
+
+    for( size_t i = 0; i < p_sys->i_vrenditions; i++ )
+    {
+        struct transcode_video_rendition *p_rend =
+            &id->p_renditions[id->i_renditions];
+        sout_stream_id_sys_t *rid = &p_rend->id;
+
+        struct encoder_owner *p_enc_owner =
+            (struct encoder_owner *)sout_EncoderCreate(p_stream, sizeof(struct encoder_owner));
+        if( unlikely(p_enc_owner == NULL) )
+            break;
+        rid->encoder = transcode_encoder_new( &p_enc_owner->enc, p_fmt_in );
+        if( !rid->encoder )
+            break;
+        p_enc_owner->id = rid;
+        p_enc_owner->enc.cbs = &encoder_video_transcode_cbs;
+        transcode_encoder_update_format_in( rid->encoder, p_fmt_in );
+
+        /* The decoder is owned by the main encoding */
+        rid->b_transcode = true;
+        rid->p_decoder = id->p_decoder;
+        rid->pf_transcode_downstream_add = transcode_downstream_AddRendition;
+        rid->p_filterscfg = id->p_filterscfg;
+        rid->p_enccfg = &p_sys->p_vrenditions_cfg[i];
+        vlc_mutex_init( &rid->fifo.lock );
+        es_format_Init( &rid->decoder_out, VIDEO_ES, 0 );
+        p_rend->pp_out_last = &p_rend->p_out;
+        id->i_renditions++;
+    }
+
+    msg_Dbg( p_stream, "%zu additional video renditions", id->i_renditions );
+}
+
 int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
                           sout_stream_id_sys_t *id )
 {
@@ -177,6 +288,9 @@ int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
 
     id->fifo.pic.first = NULL;
     id->fifo.pic.last = &id->fifo.pic.first;
+    id->pipeline = NULL;
+    id->p_renditions = NULL;
+    id->i_renditions = 0;
     id->b_transcode = true;
     es_format_Init( &id->decoder_out, VIDEO_ES, 0 );
     id->decoder_vctx_out = NULL;
@@ -275,8 +389,14 @@ int transcode_video_init( sout_stream_t *p_stream, const es_format_t *p_fmt,
     /* Will use this format as encoder input for now */
     transcode_encoder_update_format_in( id->encoder, &encoder_tested_fmt_in );
 
+    transcode_video_renditions_init( p_stream, id, &encoder_tested_fmt_in );
+
     es_format_Clean( &encoder_tested_fmt_in );
 
+    if( id->p_enccfg->video.threads.b_pipeline &&
+        transcode_video_pipeline_start( p_stream, id ) != VLC_SUCCESS )
+        msg_Warn( p_stream, "cannot start the video pipeline thread" );
+
     return VLC_SUCCESS;
 }
 
@@ -349,6 +469,12 @@ static int transcode_video_set_conversions( sout_stream_t *p_stream,
     return VLC_SUCCESS;
 }
 
+static int transcode_video_output_init( sout_stream_t *,
+                                        const sout_filters_config_t *,
+                                        const es_format_t *, vlc_video_context *,
+                                        const es_format_t *,
+                                        sout_stream_id_sys_t * );
+
 static inline bool transcode_video_filters_configured( const sout_stream_id_sys_t *id )
 {
     return !!id->p_f_chain;
@@ -390,6 +516,45 @@ static int transcode_video_filters_init( sout_stream_t *p_stream,
         src_ctx = filter_chain_GetVideoCtxOut( id->p_f_chain );
     }
 
+    if( transcode_video_output_init( p_stream, p_cfg, p_src, src_ctx, p_dst,
+                                     id ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    /* SPU Sources */
+    if( p_cfg->video.psz_spu_sources )
+    {
+        if( id->p_spu || (id->p_spu = spu_Create( p_stream, NULL )) )
+            spu_ChangeSources( id->p_spu, p_cfg->video.psz_spu_sources );
+    }
+
+    return VLC_SUCCESS;
+}
+
+static void transcode_video_remove_output_filters( sout_stream_id_sys_t *id )
+{
+    transcode_remove_filters( &id->p_conv_nonstatic );
+    transcode_remove_filters( &id->p_conv_static );
+    transcode_remove_filters( &id->p_uf_chain );
+    transcode_remove_filters( &id->p_final_conv_static );
+    if( id->p_spu_blender )
+        filter_DeleteBlend( id->p_spu_blender );
+    id->p_spu_blender = NULL;
+}
+
+/* Conversions and user filters, from the deinterlaced pictures to the
+ * encoder input */
+static int transcode_video_output_init( sout_stream_t *p_stream,
+                                        const sout_filters_config_t *p_cfg,
+                                        const es_format_t *p_src,
+                                        vlc_video_context *src_ctx,
+                                        const es_format_t *p_dst,
+                                        sout_stream_id_sys_t *id )
+{
+    filter_owner_t owner = {
+        .video = &transcode_filter_video_cbs,
+        .sys = id,
+    };
+
     /* Chroma and other conversions */
     if( transcode_video_set_conversions( p_stream, id, &p_src, &src_ctx, p_dst,
                                          p_cfg->video.b_reorient ) != VLC_SUCCESS )
@@ -411,18 +576,31 @@ static int transcode_video_filters_init( sout_stream_t *p_stream,
     /* Update encoder so it matches filters output */
     transcode_encoder_update_format_in( id->encoder, p_src );
 
-    /* SPU Sources */
-    if( p_cfg->video.psz_spu_sources )
-    {
-        if( id->p_spu || (id->p_spu = spu_Create( p_stream, NULL )) )
-            spu_ChangeSources( id->p_spu, p_cfg->video.psz_spu_sources );
-    }
-
     return VLC_SUCCESS;
 }
 
-void transcode_video_clean( sout_stream_id_sys_t *id )
+void transcode_video_clean( sout_stream_t *p_stream, sout_stream_id_sys_t *id )
 {
+    if( id->pipeline )
+        transcode_video_pipeline_stop( id );
+
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_video_rendition *p_rend = &id->p_renditions[i];
+        sout_stream_id_sys_t *rid = &p_rend->id;
+
+        transcode_encoder_close( rid->encoder );
+        transcode_encoder_delete( rid->encoder );
+        es_format_Clean( &rid->decoder_out );
+        transcode_video_remove_output_filters( rid );
+        if( rid->dec_dev )
+            vlc_decoder_device_Release( rid->dec_dev );
+        block_ChainRelease( p_rend->p_out );
+        if( rid->downstream_id )
+            sout_StreamIdDel( p_stream->p_next, rid->downstream_id );
+    }
+    free( id->p_renditions );
+
     /* Close encoder */
     transcode_encoder_close( id->encoder );
     transcode_encoder_delete( id->encoder );
@@ -446,12 +624,17 @@ void transcode_video_clean( sout_stream_id_sys_t *id )
 void transcode_video_push_spu( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
                                subpicture_t *p_subpicture )
 {
+    /* The pipeline thread may be rendering concurrently */
+    vlc_mutex_lock( &id->fifo.lock );
     if( !id->p_spu )
         id->p_spu = spu_Create( p_stream, NULL );
-    if( !id->p_spu )
+    spu_t *p_spu = id->p_spu;
+    vlc_mutex_unlock( &id->fifo.lock );
+
+    if( !p_spu )
         subpicture_Delete( p_subpicture );
     else
-        spu_PutSubpicture( id->p_spu, p_subpicture );
+        spu_PutSubpicture( p_spu, p_subpicture );
 }
 
 int transcode_video_get_output_dimensions( sout_stream_id_sys_t *id,
@@ -464,14 +647,18 @@ int transcode_video_get_output_dimensions( sout_stream_id_sys_t *id,
     return (*w && *h) ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
-static picture_t * RenderSubpictures( sout_stream_id_sys_t *id, picture_t *p_pic )
+static picture_t * RenderSubpictures( sout_stream_id_sys_t *id, picture_t *p_pic,
+                                      bool b_shared )
 {
-    if( !id->p_spu )
-        return p_pic;
-
     /* Check if we have a subpicture to overlay */
     video_format_t fmt, outfmt;
     vlc_mutex_lock( &id->fifo.lock );
+    spu_t *p_spu = id->p_spu;
+    if( !p_spu )
+    {
+        vlc_mutex_unlock( &id->fifo.lock );
+        return p_pic;
+    }
     video_format_Copy( &outfmt, &id->decoder_out.video );
     vlc_mutex_unlock( &id->fifo.lock );
     video_format_Copy( &fmt, &p_pic->format );
@@ -483,14 +670,14 @@ static picture_t * RenderSubpictures( sout_stream_id_sys_t *id, picture_t *p_pic
         fmt.i_y_offset       = 0;
     }
 
-    subpicture_t *p_subpic = spu_Render( id->p_spu, NULL, &fmt,
+    subpicture_t *p_subpic = spu_Render( p_spu, NULL, &fmt,
                                          &outfmt, vlc_tick_now(), p_pic->date,
                                          false, false );
 
     /* Overlay subpicture */
     if( p_subpic )
     {
-        if( filter_chain_IsEmpty( id->p_f_chain ) )
+        if( b_shared || filter_chain_IsEmpty( id->p_f_chain ) )
         {
             /* We can't modify the picture, we need to duplicate it,
                  * in this point the picture is already p_encoder->fmt.in format*/
@@ -503,7 +690,7 @@ static picture_t * RenderSubpictures( sout_stream_id_sys_t *id, picture_t *p_pic
             }
         }
         if( unlikely( !id->p_spu_blender ) )
-            id->p_spu_blender = filter_NewBlend( VLC_OBJECT( id->p_spu ), &fmt );
+            id->p_spu_blender = filter_NewBlend( VLC_OBJECT( p_spu ), &fmt );
         if( likely( id->p_spu_blender ) )
             picture_BlendSubpicture( p_pic, id->p_spu_blender, p_subpic );
         subpicture_Delete( p_subpic );
@@ -525,192 +712,604 @@ static void tag_last_block_with_flag( block_t **out, int i_flag )
     }
 }
 
-int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
-                                    block_t *in, block_t **out )
+static void transcode_video_stage_add( struct transcode_video_stage *p_stage,
+                                       vlc_tick_t i_start )
 {
-    *out = NULL;
+    vlc_tick_t i_duration = vlc_tick_now() - i_start;
+    p_stage->i_total += i_duration;
+    if( i_duration > p_stage->i_max )
+        p_stage->i_max = i_duration;
+    p_stage->i_count++;
+}
 
-    bool b_eos = in && (in->i_flags & BLOCK_FLAG_END_OF_SEQUENCE);
+static void transcode_video_stage_log( vlc_object_t *p_obj, const char *psz_name,
+                                       const struct transcode_video_stage *p_stage )
+{
+    if( p_stage->i_count == 0 )
+        return;
+    msg_Dbg( p_obj, "pipeline %s: %"PRIu64" frames, %"PRId64" us avg, "
+             "%"PRId64" us max", psz_name, p_stage->i_count,
+             US_FROM_VLC_TICK(p_stage->i_total / p_stage->i_count),
+             US_FROM_VLC_TICK(p_stage->i_max) );
+}
 
-    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
-    if( ret != VLCDEC_SUCCESS )
+static int transcode_video_encoder_start( sout_stream_t *, sout_stream_id_sys_t * );
+static int transcode_video_rendition_configure( sout_stream_t *,
+                                                sout_stream_id_sys_t *,
+                                                sout_stream_id_sys_t *,
+                                                picture_t * );
+
+/* Configures filters and encoder for a new input picture format.
+ * Called with the fifo lock held, as the decoder thread might update the
+ * decoder output format concurrently in pipelined mode. */
+static int transcode_video_reconfigure( sout_stream_t *p_stream,
+                                        sout_stream_id_sys_t *id,
+                                        picture_t *p_pic )
+{
+    if( !transcode_encoder_opened(id->encoder) ) /* Configure Encoder input/output */
+    {
+        assert( !id->p_f_chain && !id->p_uf_chain );
+        transcode_encoder_video_configure( VLC_OBJECT(p_stream),
+                                           &id->p_decoder->fmt_out.video,
+                                           id->p_enccfg,
+                                           &p_pic->format,
+                                           picture_GetVideoContext(p_pic),
+                                           id->encoder );
+        /* will be opened below */
+    }
+    else /* picture format has changed */
+    {
+        msg_Info( p_stream, "aspect-ratio changed, reiniting. %i -> %i : %i -> %i.",
+                    id->decoder_out.video.i_sar_num, p_pic->format.i_sar_num,
+                    id->decoder_out.video.i_sar_den, p_pic->format.i_sar_den
+                );
+        /* Close filters, encoder format input can't change */
+        transcode_remove_filters( &id->p_f_chain );
+        transcode_remove_filters( &id->p_conv_nonstatic );
+        transcode_remove_filters( &id->p_conv_static );
+        transcode_remove_filters( &id->p_uf_chain );
+        transcode_remove_filters( &id->p_final_conv_static );
+        if( id->p_spu_blender )
+            filter_DeleteBlend( id->p_spu_blender );
+        id->p_spu_blender = NULL;
+
+        video_format_Clean( &id->decoder_out.video );
+    }
+
+    video_format_Copy( &id->decoder_out.video, &p_pic->format );
+    transcode_video_framerate_apply( &p_pic->format, &id->decoder_out.video );
+    transcode_video_sar_apply( &p_pic->format, &id->decoder_out.video );
+    id->decoder_vctx_out = picture_GetVideoContext(p_pic);
+
+    if( !transcode_video_filters_configured( id ) )
+    {
+        if( transcode_video_filters_init( p_stream,
+                                          id->p_filterscfg,
+                                         (id->p_enccfg->video.fps.num > 0),
+                                         &id->decoder_out,
+                                         id->decoder_vctx_out,
+                                         transcode_encoder_format_in( id->encoder ),
+                                         id ) != VLC_SUCCESS )
+            return VLC_EGENERIC;
+    }
+
+    if( transcode_video_encoder_start( p_stream, id ) != VLC_SUCCESS )
         return VLC_EGENERIC;
 
-    picture_t *p_pics = transcode_dequeue_all_pics( id );
+    /* Renditions are fed from the deinterlaced pictures */
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        sout_stream_id_sys_t *rid = &id->p_renditions[i].id;
+        if( !rid->b_error &&
+            transcode_video_rendition_configure( p_stream, id, rid,
+                                                 p_pic ) != VLC_SUCCESS )
+        {
+            msg_Err( p_stream, "disabling video rendition %zu", i + 1 );
+            rid->b_error = true;
+        }
+    }
+
+    return VLC_SUCCESS;
+}
+
+/* Opens the encoder if needed, with a last converter to its input */
+static int transcode_video_encoder_start( sout_stream_t *p_stream,
+                                          sout_stream_id_sys_t *id )
+{
+    /* Store the current encoder input chroma to detect whether we need
+     * a converter in p_final_conv_static. The encoder will override it
+     * if it needs any different format or chroma. */
+    es_format_t filter_fmt_out;
+    es_format_Copy( &filter_fmt_out, transcode_encoder_format_in( id->encoder ) );
+    bool is_encoder_open = transcode_encoder_opened( id->encoder );
+
+    /* Start missing encoder */
+    if( !is_encoder_open &&
+        transcode_encoder_open( id->encoder, id->p_enccfg ) != VLC_SUCCESS )
+    {
+        msg_Err( p_stream, "cannot find video encoder (module:%s fourcc:%4.4s). "
+                           "Take a look few lines earlier to see possible reason.",
+                           id->p_enccfg->psz_name ? id->p_enccfg->psz_name : "any",
+                           (char *)&id->p_enccfg->i_codec );
+        es_format_Clean( &filter_fmt_out );
+        return VLC_EGENERIC;
+    }
+
+    /* The fmt_in may have been overriden by the encoder. */
+    const es_format_t *encoder_fmt_in = transcode_encoder_format_in( id->encoder );
+
+    /* In case the encoder wasn't open yet, check if we need to add
+     * a converter between last user filter and encoder. */
+    if( !is_encoder_open &&
+        filter_fmt_out.i_codec != encoder_fmt_in->i_codec )
+    {
+        if ( !id->p_final_conv_static )
+            id->p_final_conv_static =
+                filter_chain_NewVideo( p_stream, false, NULL );
+        filter_chain_Reset( id->p_final_conv_static,
+                            &filter_fmt_out,
+                            //encoder_vctx_in,
+                            NULL,
+                            encoder_fmt_in );
+        filter_chain_AppendConverter( id->p_final_conv_static, NULL );
+    }
+    es_format_Clean(&filter_fmt_out);
+
+    msg_Dbg( p_stream, "destination (after video filters) %ux%u",
+                       transcode_encoder_format_in( id->encoder )->video.i_width,
+                       transcode_encoder_format_in( id->encoder )->video.i_height );
+    return VLC_SUCCESS;
+}
+
+static int transcode_video_rendition_configure( sout_stream_t *p_stream,
+                                                sout_stream_id_sys_t *id,
+                                                sout_stream_id_sys_t *rid,
+                                                picture_t *p_pic )
+{
+    if( !transcode_encoder_opened( rid->encoder ) )
+        transcode_encoder_video_configure( VLC_OBJECT(p_stream),
+                                           &id->p_decoder->fmt_out.video,
+                                           rid->p_enccfg,
+                                           &p_pic->format,
+                                           picture_GetVideoContext(p_pic),
+                                           rid->encoder );
+    else
+        transcode_video_remove_output_filters( rid );
+
+    if( transcode_video_output_init( p_stream, rid->p_filterscfg,
+                                     filter_chain_GetFmtOut( id->p_f_chain ),
+                                     filter_chain_GetVideoCtxOut( id->p_f_chain ),
+                                     transcode_encoder_format_in( rid->encoder ),
+                                     rid ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
+
+    return transcode_video_encoder_start( p_stream, rid );
+}
 
-    do
+static int transcode_video_add_downstream( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id )
+{
+    if( !id->downstream_id )
+        id->downstream_id =
+            id->pf_transcode_downstream_add( p_stream,
+                                             &id->p_decoder->fmt_in,
+                                             transcode_encoder_format_out( id->encoder ) );
+    if( !id->downstream_id )
     {
-        picture_t *p_pic = p_pics;
-        if( p_pic )
+        msg_Err( p_stream, "cannot output transcoded stream %4.4s",
+                           (char *) &id->p_enccfg->i_codec );
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void transcode_video_encode_picture( sout_stream_id_sys_t *,
+                                            struct transcode_video_pipeline *,
+                                            picture_t *, bool, block_t **,
+                                            vlc_tick_t );
+
+/* Filters, blends and encodes one decoded picture */
+static int transcode_video_process_picture( sout_stream_t *p_stream,
+                                            sout_stream_id_sys_t *id,
+                                            picture_t *p_pic, block_t **out )
+{
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
+
+    if( p_pic )
+    {
+        vlc_mutex_lock( &id->fifo.lock );
+        int i_ret = VLC_SUCCESS;
+        if( unlikely(!transcode_encoder_opened(id->encoder)) ||
+            !video_format_IsSimilar( &id->decoder_out.video, &p_pic->format ) )
+            i_ret = transcode_video_reconfigure( p_stream, id, p_pic );
+        vlc_mutex_unlock( &id->fifo.lock );
+
+        if( i_ret != VLC_SUCCESS )
+            goto error;
+
+        /* The downstream is added by the caller thread in pipelined mode */
+        if( p_pipe == NULL &&
+            transcode_video_add_downstream( p_stream, id ) != VLC_SUCCESS )
+            goto error;
+    }
+
+    /* Deinterlacing and frame rate conversion are shared by all the
+     * renditions */
+    vlc_tick_t i_start = vlc_tick_now();
+    if( p_pic && id->p_f_chain )
+        p_pic = filter_chain_VideoFilter( id->p_f_chain, p_pic );
+    if( !p_pic )
+        return VLC_SUCCESS;
+
+    /* Pictures are shared by reference between the renditions, and copied
+     * by whichever one needs to modify them in place (see
+     * transcode_video_encode_picture) */
+    bool b_shared = false;
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_video_rendition *p_rend = &id->p_renditions[i];
+        if( p_rend->id.b_error )
+            continue;
+
+        block_t *p_out = NULL;
+        transcode_video_encode_picture( &p_rend->id, p_pipe,
+                                        picture_Hold( p_pic ), true,
+                                        &p_out, i_start );
+        b_shared = true;
+        i_start = vlc_tick_now();
+        if( p_out )
         {
-            p_pics = p_pic->p_next;
-            p_pic->p_next = NULL;
+            vlc_mutex_lock( &id->fifo.lock );
+            block_ChainLastAppend( &p_rend->pp_out_last, p_out );
+            vlc_mutex_unlock( &id->fifo.lock );
         }
+    }
+
+    transcode_video_encode_picture( id, p_pipe, p_pic, b_shared, out, i_start );
+    return VLC_SUCCESS;
+
+error:
+    if( p_pic )
+        picture_Release( p_pic );
+    return VLC_EGENERIC;
+}
+
+static picture_t *transcode_video_unshare( picture_t *p_pic )
+{
+    picture_t *p_copy = picture_NewFromFormat( &p_pic->format );
+    if( likely(p_copy) )
+        picture_Copy( p_copy, p_pic );
+    picture_Release( p_pic );
+    return p_copy;
+}
+
+/* Converts, blends and encodes a picture for one rendition.
+ * If b_shared, the picture is also used by other renditions, and is copied
+ * before being modified in place by the user filters or the blending. */
+static void transcode_video_encode_picture( sout_stream_id_sys_t *id,
+                                            struct transcode_video_pipeline *p_pipe,
+                                            picture_t *p_pic, bool b_shared,
+                                            block_t **out, vlc_tick_t i_start )
+{
+    /* Run the filter and output chains; first with the picture,
+     * and then with NULL as many times as we need until they
+     * stop outputting frames.
+     */
+    for ( picture_t *p_in = p_pic; ; p_in = NULL /* drain second time */ )
+    {
+        /* Drained pictures are output by our own chains */
+        bool b_in_shared = b_shared && p_in != NULL;
 
-        if( id->b_error && p_pic )
+        /* Run filter chain */
+        filter_chain_t * primary_chains[] = { id->p_conv_nonstatic,
+                                              id->p_conv_static };
+        for( size_t i=0; p_in && i<ARRAY_SIZE(primary_chains); i++ )
         {
-            picture_Release( p_pic );
-            continue;
+            if( !primary_chains[i] || filter_chain_IsEmpty( primary_chains[i] ) )
+                continue;
+            /* Converters output new pictures */
+            p_in = filter_chain_VideoFilter( primary_chains[i], p_in );
+            b_in_shared = false;
         }
 
-        if( p_pic && ( unlikely(!transcode_encoder_opened(id->encoder)) ||
-              !video_format_IsSimilar( &id->decoder_out.video, &p_pic->format ) ) )
+        if( !p_in )
+            break;
+
+        for ( ;; p_in = NULL /* drain second time */ )
         {
-            if( !transcode_encoder_opened(id->encoder) ) /* Configure Encoder input/output */
+            if( !p_in )
+                b_in_shared = false;
+
+            /* Run user specified filter chain */
+            if( p_in && b_in_shared && id->p_uf_chain &&
+                !filter_chain_IsEmpty( id->p_uf_chain ) )
             {
-                assert( !id->p_f_chain && !id->p_uf_chain );
-                transcode_encoder_video_configure( VLC_OBJECT(p_stream),
-                                                   &id->p_decoder->fmt_out.video,
-                                                   id->p_enccfg,
-                                                   &p_pic->format,
-                                                   picture_GetVideoContext(p_pic),
-                                                   id->encoder );
-                /* will be opened below */
+                p_in = transcode_video_unshare( p_in );
+                b_in_shared = false;
             }
-            else /* picture format has changed */
+            filter_chain_t * secondary_chains[] = { id->p_uf_chain,
+                                                    id->p_final_conv_static };
+            for( size_t i=0; p_in && i<ARRAY_SIZE(secondary_chains); i++ )
             {
-                msg_Info( p_stream, "aspect-ratio changed, reiniting. %i -> %i : %i -> %i.",
-                            id->decoder_out.video.i_sar_num, p_pic->format.i_sar_num,
-                            id->decoder_out.video.i_sar_den, p_pic->format.i_sar_den
-                        );
-                /* Close filters, encoder format input can't change */
-                transcode_remove_filters( &id->p_f_chain );
-                transcode_remove_filters( &id->p_conv_nonstatic );
-                transcode_remove_filters( &id->p_conv_static );
-                transcode_remove_filters( &id->p_uf_chain );
-                transcode_remove_filters( &id->p_final_conv_static );
-                if( id->p_spu_blender )
-                    filter_DeleteBlend( id->p_spu_blender );
-                id->p_spu_blender = NULL;
-
-                video_format_Clean( &id->decoder_out.video );
+                if( !secondary_chains[i] || filter_chain_IsEmpty( secondary_chains[i] ) )
+                    continue;
+                p_in = filter_chain_VideoFilter( secondary_chains[i], p_in );
+                b_in_shared = false;
             }
 
-            video_format_Copy( &id->decoder_out.video, &p_pic->format );
-            transcode_video_framerate_apply( &p_pic->format, &id->decoder_out.video );
-            transcode_video_sar_apply( &p_pic->format, &id->decoder_out.video );
-            id->decoder_vctx_out = picture_GetVideoContext(p_pic);
+            if( !p_in )
+                break;
 
-            if( !transcode_video_filters_configured( id ) )
+            /* Blend subpictures */
+            p_in = RenderSubpictures( id, p_in, b_in_shared );
+
+            if( p_in )
             {
-                if( transcode_video_filters_init( p_stream,
-                                                  id->p_filterscfg,
-                                                 (id->p_enccfg->video.fps.num > 0),
-                                                 &id->decoder_out,
-                                                 id->decoder_vctx_out,
-                                                 transcode_encoder_format_in( id->encoder ),
-                                                 id ) != VLC_SUCCESS )
-                    goto error;
-            }
+                if( p_pipe )
+                {
+                    transcode_video_stage_add( &p_pipe->filter, i_start );
+                    i_start = vlc_tick_now();
+                }
 
-            /* Store the current encoder input chroma to detect whether we need
-             * a converter in p_final_conv_static. The encoder will override it
-             * if it needs any different format or chroma. */
-            es_format_t filter_fmt_out;
-            es_format_Copy( &filter_fmt_out, transcode_encoder_format_in( id->encoder ) );
-            bool is_encoder_open = transcode_encoder_opened( id->encoder );
+                block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
+                if( p_encoded )
+                    block_ChainAppend( out, p_encoded );
+                picture_Release( p_in );
 
-            /* Start missing encoder */
-            if( !is_encoder_open &&
-                transcode_encoder_open( id->encoder, id->p_enccfg ) != VLC_SUCCESS )
-            {
-                msg_Err( p_stream, "cannot find video encoder (module:%s fourcc:%4.4s). "
-                                   "Take a look few lines earlier to see possible reason.",
-                                   id->p_enccfg->psz_name ? id->p_enccfg->psz_name : "any",
-                                   (char *)&id->p_enccfg->i_codec );
-                goto error;
+                if( p_pipe )
+                {
+                    transcode_video_stage_add( &p_pipe->encode, i_start );
+                    i_start = vlc_tick_now();
+                }
             }
+        }
+    }
+}
 
-            /* The fmt_in may have been overriden by the encoder. */
-            const es_format_t *encoder_fmt_in = transcode_encoder_format_in( id->encoder );
+static void *transcode_video_pipeline_thread( void *data )
+{
+    sout_stream_id_sys_t *id = data;
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
 
-            /* In case the encoder wasn't open yet, check if we need to add
-             * a converter between last user filter and encoder. */
-            if( !is_encoder_open &&
-                filter_fmt_out.i_codec != encoder_fmt_in->i_codec )
-            {
-                if ( !id->p_final_conv_static )
-                    id->p_final_conv_static =
-                        filter_chain_NewVideo( p_stream, false, NULL );
-                filter_chain_Reset( id->p_final_conv_static,
-                                    &filter_fmt_out,
-                                    //encoder_vctx_in,
-                                    NULL,
-                                    encoder_fmt_in );
-                filter_chain_AppendConverter( id->p_final_conv_static, NULL );
-            }
-            es_format_Clean(&filter_fmt_out);
-
-            msg_Dbg( p_stream, "destination (after video filters) %ux%u",
-                               transcode_encoder_format_in( id->encoder )->video.i_width,
-                               transcode_encoder_format_in( id->encoder )->video.i_height );
-
-            if( !id->downstream_id )
-                id->downstream_id =
-                    id->pf_transcode_downstream_add( p_stream,
-                                                     &id->p_decoder->fmt_in,
-                                                     transcode_encoder_format_out( id->encoder ) );
-            if( !id->downstream_id )
-            {
-                msg_Err( p_stream, "cannot output transcoded stream %4.4s",
-                                   (char *) &id->p_enccfg->i_codec );
-                goto error;
-            }
+    vlc_mutex_lock( &id->fifo.lock );
+    for( ;; )
+    {
+        while( !p_pipe->b_stop && id->fifo.pic.first == NULL )
+            vlc_cond_wait( &p_pipe->wait, &id->fifo.lock );
+        if( p_pipe->b_stop )
+            break;
+
+        picture_t *p_pic = id->fifo.pic.first;
+        id->fifo.pic.first = p_pic->p_next;
+        if( id->fifo.pic.first == NULL )
+            id->fifo.pic.last = &id->fifo.pic.first;
+        p_pic->p_next = NULL;
+        p_pipe->i_depth--;
+        p_pipe->b_busy = true;
+        vlc_cond_broadcast( &p_pipe->room );
+        bool b_error = id->b_error;
+        vlc_mutex_unlock( &id->fifo.lock );
+
+        block_t *p_out = NULL;
+        if( b_error )
+            picture_Release( p_pic );
+        else if( transcode_video_process_picture( p_pipe->p_stream, id,
+                                                  p_pic, &p_out ) != VLC_SUCCESS )
+            b_error = true;
+
+        vlc_mutex_lock( &id->fifo.lock );
+        if( b_error )
+            id->b_error = true;
+        block_ChainLastAppend( &p_pipe->pp_out_last, p_out );
+        p_pipe->b_busy = false;
+        vlc_cond_broadcast( &p_pipe->room );
+    }
+    vlc_mutex_unlock( &id->fifo.lock );
+
+    return NULL;
+}
+
+/* Waits until the worker has processed every queued picture */
+static void transcode_video_pipeline_flush( sout_stream_id_sys_t *id )
+{
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
+
+    vlc_mutex_lock( &id->fifo.lock );
+    while( id->fifo.pic.first != NULL || p_pipe->b_busy )
+        vlc_cond_wait( &p_pipe->room, &id->fifo.lock );
+    vlc_mutex_unlock( &id->fifo.lock );
+}
+
+static block_t *transcode_video_pipeline_get_output( sout_stream_id_sys_t *id )
+{
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
+
+    vlc_mutex_lock( &id->fifo.lock );
+    block_t *p_out = p_pipe->p_out;
+    p_pipe->p_out = NULL;
+    p_pipe->pp_out_last = &p_pipe->p_out;
+    vlc_mutex_unlock( &id->fifo.lock );
+    return p_out;
+}
+
+static int transcode_video_pipeline_start( sout_stream_t *p_stream,
+                                           sout_stream_id_sys_t *id )
+{
+    struct transcode_video_pipeline *p_pipe = malloc( sizeof(*p_pipe) );
+    if( unlikely(p_pipe == NULL) )
+        return VLC_ENOMEM;
+
+    memset( p_pipe, 0, sizeof(*p_pipe) );
+    p_pipe->p_stream = p_stream;
+    vlc_cond_init( &p_pipe->wait );
+    vlc_cond_init( &p_pipe->room );
+    p_pipe->i_max_depth = id->p_enccfg->video.threads.pool_size;
+    p_pipe->pp_out_last = &p_pipe->p_out;
+    id->pipeline = p_pipe;
+
+    if( vlc_clone( &p_pipe->thread, transcode_video_pipeline_thread, id,
+                   id->p_enccfg->video.threads.i_priority ) )
+    {
+        id->pipeline = NULL;
+        free( p_pipe );
+        return VLC_EGENERIC;
+    }
+    msg_Dbg( p_stream, "pipelined video transcoding, %u pictures queue",
+             p_pipe->i_max_depth );
+    return VLC_SUCCESS;
+}
+
+static void transcode_video_pipeline_stop( sout_stream_id_sys_t *id )
+{
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
+    vlc_object_t *p_obj = VLC_OBJECT(p_pipe->p_stream);
+
+    vlc_mutex_lock( &id->fifo.lock );
+    p_pipe->b_stop = true;
+    vlc_cond_signal( &p_pipe->wait );
+    vlc_cond_broadcast( &p_pipe->room );
+    vlc_mutex_unlock( &id->fifo.lock );
+    vlc_join( p_pipe->thread, NULL );
+
+    transcode_video_stage_log( p_obj, "decode", &p_pipe->decode );
+    transcode_video_stage_log( p_obj, "filter", &p_pipe->filter );
+    transcode_video_stage_log( p_obj, "encode", &p_pipe->encode );
+    if( p_pipe->i_depth_samples > 0 )
+        msg_Dbg( p_obj, "pipeline queue: %.1f pictures avg, %u max, "
+                 "%"PRIu64" decoder stalls",
+                 (double) p_pipe->i_depth_sum / p_pipe->i_depth_samples,
+                 p_pipe->i_depth_peak, p_pipe->i_stalls );
+
+    picture_t *p_pics = transcode_dequeue_all_pics( id );
+    while( p_pics )
+    {
+        picture_t *p_next = p_pics->p_next;
+        picture_Release( p_pics );
+        p_pics = p_next;
+    }
+    block_ChainRelease( p_pipe->p_out );
+
+    id->pipeline = NULL;
+    free( p_pipe );
+}
+
+/* Sends the output of the additional renditions */
+static void transcode_video_renditions_output( sout_stream_t *p_stream,
+                                               sout_stream_id_sys_t *id,
+                                               bool b_eos, bool b_drain )
+{
+    for( size_t i = 0; i < id->i_renditions; i++ )
+    {
+        struct transcode_video_rendition *p_rend = &id->p_renditions[i];
+        sout_stream_id_sys_t *rid = &p_rend->id;
+
+        vlc_mutex_lock( &id->fifo.lock );
+        block_t *p_out = p_rend->p_out;
+        p_rend->p_out = NULL;
+        p_rend->pp_out_last = &p_rend->p_out;
+        bool b_opened = !rid->b_error && transcode_encoder_opened( rid->encoder );
+        vlc_mutex_unlock( &id->fifo.lock );
+
+        if( rid->p_enccfg->video.threads.i_count >= 1 )
+            block_ChainAppend( &p_out, transcode_encoder_get_output_async( rid->encoder ) );
+
+        if( b_opened && transcode_video_add_downstream( p_stream, rid ) != VLC_SUCCESS )
+        {
+            vlc_mutex_lock( &id->fifo.lock );
+            rid->b_error = true;
+            vlc_mutex_unlock( &id->fifo.lock );
+            b_opened = false;
         }
 
-        /* Run the filter and output chains; first with the picture,
-         * and then with NULL as many times as we need until they
-         * stop outputting frames.
-         */
-        for ( picture_t *p_in = p_pic; ; p_in = NULL /* drain second time */ )
+        /* The pipeline, if any, is idle */
+        if( b_opened && (b_eos || b_drain) )
         {
-            /* Run filter chain */
-            filter_chain_t * primary_chains[] = { id->p_f_chain,
-                                                  id->p_conv_nonstatic,
-                                                  id->p_conv_static };
-            for( size_t i=0; p_in && i<ARRAY_SIZE(primary_chains); i++ )
+            if( transcode_encoder_drain( rid->encoder, &p_out ) != VLC_SUCCESS )
+                msg_Warn( p_stream, "Flushing rendition %zu failed", i + 1 );
+            if( b_eos )
             {
-                if( !primary_chains[i] )
-                    continue;
-                p_in = filter_chain_VideoFilter( primary_chains[i], p_in );
+                transcode_encoder_close( rid->encoder );
+                transcode_video_remove_output_filters( rid );
+                tag_last_block_with_flag( &p_out, BLOCK_FLAG_END_OF_SEQUENCE );
             }
+        }
 
-            if( !p_in )
-                break;
+        if( p_out == NULL )
+            continue;
+        if( rid->downstream_id )
+            sout_StreamIdSend( p_stream->p_next, rid->downstream_id, p_out );
+        else
+            block_ChainRelease( p_out );
+    }
+}
 
-            for ( ;; p_in = NULL /* drain second time */ )
-            {
-                /* Run user specified filter chain */
-                filter_chain_t * secondary_chains[] = { id->p_uf_chain,
-                                                        id->p_final_conv_static };
-                for( size_t i=0; p_in && i<ARRAY_SIZE(secondary_chains); i++ )
-                {
-                    if( !secondary_chains[i] )
-                        continue;
-                    p_in = filter_chain_VideoFilter( secondary_chains[i], p_in );
-                }
+int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
+                                    block_t *in, block_t **out )
+{
+    struct transcode_video_pipeline *p_pipe = id->pipeline;
+    *out = NULL;
 
-                if( !p_in )
-                    break;
+    bool b_eos = in && (in->i_flags & BLOCK_FLAG_END_OF_SEQUENCE);
 
-                /* Blend subpictures */
-                p_in = RenderSubpictures( id, p_in );
+    vlc_tick_t i_start = vlc_tick_now();
+    int ret = id->p_decoder->pf_decode( id->p_decoder, in );
+    if( ret != VLCDEC_SUCCESS )
+        return VLC_EGENERIC;
 
-                if( p_in )
-                {
-                    block_t *p_encoded = transcode_encoder_encode( id->encoder, p_in );
-                    if( p_encoded )
-                        block_ChainAppend( out, p_encoded );
-                    picture_Release( p_in );
-                }
+    if( p_pipe )
+    {
+        /* Pictures are filtered and encoded by the pipeline thread */
+        vlc_mutex_lock( &id->fifo.lock );
+        transcode_video_stage_add( &p_pipe->decode, i_start );
+        vlc_mutex_unlock( &id->fifo.lock );
+
+        /* End of sequence and drain need every picture to be encoded */
+        if( b_eos || in == NULL )
+            transcode_video_pipeline_flush( id );
+
+        *out = transcode_video_pipeline_get_output( id );
+
+        vlc_mutex_lock( &id->fifo.lock );
+        bool b_add = !id->b_error && transcode_encoder_opened( id->encoder );
+        vlc_mutex_unlock( &id->fifo.lock );
+        if( b_add && transcode_video_add_downstream( p_stream, id ) != VLC_SUCCESS )
+        {
+            vlc_mutex_lock( &id->fifo.lock );
+            id->b_error = true;
+            vlc_mutex_unlock( &id->fifo.lock );
+        }
+    }
+    else
+    {
+        picture_t *p_pics = transcode_dequeue_all_pics( id );
+
+        while( p_pics )
+        {
+            picture_t *p_pic = p_pics;
+            p_pics = p_pic->p_next;
+            p_pic->p_next = NULL;
+
+            if( id->b_error )
+            {
+                picture_Release( p_pic );
+                continue;
             }
+
+            if( transcode_video_process_picture( p_stream, id, p_pic,
+                                                 out ) != VLC_SUCCESS )
+                id->b_error = true;
         }
+    }
+
+    transcode_video_renditions_output( p_stream, id, b_eos, in == NULL );
 
-        if( b_eos )
+    if( b_eos && !id->b_error && transcode_encoder_opened( id->encoder ) )
+    {
+        msg_Info( p_stream, "Drain/restart on EOS" );
+        if( transcode_encoder_drain( id->encoder, out ) != VLC_SUCCESS )
+            id->b_error = true;
+        else
         {
-            msg_Info( p_stream, "Drain/restart on EOS" );
-            if( transcode_encoder_drain( id->encoder, out ) != VLC_SUCCESS )
-                goto error;
             transcode_encoder_close( id->encoder );
             /* Close filters */
             transcode_remove_filters( &id->p_f_chain );
@@ -718,16 +1317,8 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_sys_t *id,
             transcode_remove_filters( &id->p_conv_static );
             transcode_remove_filters( &id->p_uf_chain );
             transcode_remove_filters( &id->p_final_conv_static );
-            tag_last_block_with_flag( out, BLOCK_FLAG_END_OF_SEQUENCE );
-            b_eos = false;
         }
-
-        continue;
-error:
-        if( p_pic )
-            picture_Release( p_pic );
-        id->b_error = true;
-    } while( p_pics );
+    }
 
     if( id->p_enccfg->video.threads.i_count >= 1 )
     {
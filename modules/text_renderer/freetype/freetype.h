@@ -110,6 +110,10 @@ typedef struct
     /** Font face cache */
     vlc_dictionary_t  face_map;
 
+    /** Loaded and rendered glyphs, and shaped runs caches */
+    struct lru_cache_t *p_glyph_cache;
+    struct lru_cache_t *p_shape_cache;
+
     int               i_fallback_counter;
 
     /* Current scaling of the text, default is 100 (%) */
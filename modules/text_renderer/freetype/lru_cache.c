@@ -0,0 +1,170 @@
+/*****************************************************************************
+ * lru_cache.c : Bounded least recently used cache
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_list.h>
+
+#include "lru_cache.h"
+
+typedef struct lru_entry_t
+{
+    struct lru_entry_t *p_next;  /**< next entry of the hash bucket */
+    struct vlc_list     node;    /**< position in the use order */
+    uint32_t            i_hash;
+    size_t              i_key;
+    void               *p_value;
+    unsigned char       key[];
+} lru_entry_t;
+
+struct lru_cache_t
+{
+    lru_entry_t   **pp_buckets;
+    size_t          i_buckets;     /**< power of 2 */
+    size_t          i_max_entries;
+    struct vlc_list lru;           /**< most recently used first */
+    void          (*pf_free)( void * );
+    lru_cache_stats_t stats;
+};
+
+static uint32_t Hash( const void *p_key, size_t i_key )
+{
+    /* FNV-1a */
+    const unsigned char *p = p_key;
+    uint32_t i_hash = 2166136261u;
+    for( size_t i = 0; i < i_key; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619u;
+    return i_hash;
+}
+
+lru_cache_t *LRUCacheNew( size_t i_max_entries, void (*pf_free)( void * ) )
+{
+    lru_cache_t *p_cache = malloc( sizeof( *p_cache ) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->i_buckets = 16;
+    while( p_cache->i_buckets < i_max_entries )
+        p_cache->i_buckets <<= 1;
+    p_cache->pp_buckets = calloc( p_cache->i_buckets,
+                                  sizeof( *p_cache->pp_buckets ) );
+    if( !p_cache->pp_buckets )
+    {
+        free( p_cache );
+        return NULL;
+    }
+    p_cache->i_max_entries = i_max_entries;
+    p_cache->pf_free = pf_free;
+    vlc_list_init( &p_cache->lru );
+    memset( &p_cache->stats, 0, sizeof( p_cache->stats ) );
+    return p_cache;
+}
+
+static void RemoveEntry( lru_cache_t *p_cache, lru_entry_t *p_entry )
+{
+    lru_entry_t **pp = &p_cache->pp_buckets[p_entry->i_hash &
+                                            ( p_cache->i_buckets - 1 )];
+    while( *pp != p_entry )
+        pp = &(*pp)->p_next;
+    *pp = p_entry->p_next;
+
+    vlc_list_remove( &p_entry->node );
+    p_cache->pf_free( p_entry->p_value );
+    free( p_entry );
+    p_cache->stats.i_entries--;
+}
+
+void LRUCacheFlush( lru_cache_t *p_cache )
+{
+    lru_entry_t *p_entry;
+    vlc_list_foreach( p_entry, &p_cache->lru, node )
+        RemoveEntry( p_cache, p_entry );
+}
+
+void LRUCacheDelete( lru_cache_t *p_cache )
+{
+    LRUCacheFlush( p_cache );
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+void *LRUCacheGet( lru_cache_t *p_cache, const void *p_key, size_t i_key )
+{
+    const uint32_t i_hash = Hash( p_key, i_key );
+
+    for( lru_entry_t *p_entry =
+             p_cache->pp_buckets[i_hash & ( p_cache->i_buckets - 1 )];
+         p_entry; p_entry = p_entry->p_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key &&
+            !memcmp( p_entry->key, p_key, i_key ) )
+        {
+            vlc_list_remove( &p_entry->node );
+            vlc_list_prepend( &p_entry->node, &p_cache->lru );
+            p_cache->stats.i_hits++;
+            return p_entry->p_value;
+        }
+    }
+    p_cache->stats.i_misses++;
+    return NULL;
+}
+
+int LRUCachePut( lru_cache_t *p_cache, const void *p_key, size_t i_key,
+                 void *p_value )
+{
+    lru_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key );
+    if( !p_entry )
+    {
+        p_cache->pf_free( p_value );
+        return VLC_ENOMEM;
+    }
+
+    if( p_cache->stats.i_entries >= p_cache->i_max_entries )
+    {
+        lru_entry_t *p_last =
+            vlc_list_last_entry_or_null( &p_cache->lru, lru_entry_t, node );
+        if( p_last )
+        {
+            RemoveEntry( p_cache, p_last );
+            p_cache->stats.i_evictions++;
+        }
+    }
+
+    p_entry->i_hash = Hash( p_key, i_key );
+    p_entry->i_key = i_key;
+    p_entry->p_value = p_value;
+    memcpy( p_entry->key, p_key, i_key );
+
+    lru_entry_t **pp_bucket =
+        &p_cache->pp_buckets[p_entry->i_hash & ( p_cache->i_buckets - 1 )];
+    p_entry->p_next = *pp_bucket;
+    *pp_bucket = p_entry;
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_cache->stats.i_entries++;
+    return VLC_SUCCESS;
+}
+
+void LRUCacheGetStats( const lru_cache_t *p_cache, lru_cache_stats_t *p_stats )
+{
+    *p_stats = p_cache->stats;
+}
@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * lru_cache.h : Bounded least recently used cache
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_LRU_CACHE_H
+#define VLC_FREETYPE_LRU_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Bounded least recently used cache, used for glyphs and shaped runs
+ */
+
+typedef struct lru_cache_t lru_cache_t;
+
+typedef struct
+{
+    uint64_t i_hits;
+    uint64_t i_misses;
+    uint64_t i_evictions;
+    size_t   i_entries;
+} lru_cache_stats_t;
+
+/**
+ * Creates a cache.
+ *
+ * \param i_max_entries maximum number of entries, the least recently used
+ *                      ones are evicted beyond that
+ * \param pf_free releases the values of the entries
+ */
+lru_cache_t *LRUCacheNew( size_t i_max_entries, void (*pf_free)( void * ) );
+void LRUCacheDelete( lru_cache_t * );
+
+/**
+ * Releases all the entries.
+ */
+void LRUCacheFlush( lru_cache_t * );
+
+/**
+ * Looks up a value by key, and marks it as the most recently used.
+ * The value remains owned by the cache, and is only valid until the next
+ * insertion or flush.
+ *
+ * \param p_key key bytes, including any padding, which must be zeroed
+ * \return the value or NULL if not found
+ */
+void *LRUCacheGet( lru_cache_t *, const void *p_key, size_t i_key );
+
+/**
+ * Inserts a value, which must not be in the cache yet. The cache takes
+ * ownership of the value, even on error.
+ */
+int LRUCachePut( lru_cache_t *, const void *p_key, size_t i_key, void *p_value );
+
+void LRUCacheGetStats( const lru_cache_t *, lru_cache_stats_t * );
+
+/** @} */
+
+#endif
@@ -64,6 +64,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "lru_cache.h"
 
 #include <stdlib.h>
 
@@ -112,10 +113,34 @@ typedef struct run_desc_t
     hb_glyph_info_t            *p_glyph_infos;
     hb_glyph_position_t        *p_glyph_positions;
     unsigned int                i_glyph_count;
+    void                       *p_shaped;   /* copy of a cached shaping */
 #endif
 
 } run_desc_t;
 
+/**
+ * Key of the glyph cache entries. Faces are loaded for a given size, so
+ * the face identifies the font file, face index and size.
+ */
+typedef struct
+{
+    FT_Face  p_face;
+    unsigned i_glyph_index;
+    int      i_style_flags;     /* synthesized bold and italic, outline */
+    int      i_outline_radius;
+    int      i_kind;
+    int      i_origin_x;        /* subpixel origin of rendered bitmaps */
+    int      i_origin_y;
+} glyph_cache_key_t;
+
+enum
+{
+    GLYPH_CACHE_LOADED,     /* styled and stroked glyph images */
+    GLYPH_CACHE_GLYPH,      /* rendered bitmaps */
+    GLYPH_CACHE_OUTLINE,
+    GLYPH_CACHE_SHADOW,
+};
+
 /**
  * Glyph bitmaps. Advance and offset are 26.6 values
  */
@@ -131,6 +156,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t cache_key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -298,6 +324,295 @@ static void FixGlyph( FT_Glyph glyph, FT_BBox *p_bbox,
     }
 }
 
+/*****************************************************************************
+ * Glyph and shaping caches
+ *****************************************************************************
+ * Faces are only released when the module is closed, so their handles are
+ * stable keys. The cached values are copied out, as the callers own and
+ * release their glyphs.
+ *****************************************************************************/
+typedef struct
+{
+    FT_Glyph  p_glyph;
+    FT_Glyph  p_outline;
+    FT_Vector advance;
+} cached_glyph_t;
+
+static void FreeCachedGlyph( void *p_value )
+{
+    cached_glyph_t *p_cached = p_value;
+    if( p_cached->p_glyph )
+        FT_Done_Glyph( p_cached->p_glyph );
+    if( p_cached->p_outline )
+        FT_Done_Glyph( p_cached->p_outline );
+    free( p_cached );
+}
+
+/* Takes ownership of the glyphs, the returned value belongs to the cache */
+static const cached_glyph_t *PutCachedGlyph( filter_sys_t *p_sys,
+                                             const glyph_cache_key_t *p_key,
+                                             FT_Glyph p_glyph,
+                                             FT_Glyph p_outline,
+                                             const FT_Vector *p_advance )
+{
+    cached_glyph_t *p_cached = malloc( sizeof( *p_cached ) );
+    if( !p_cached )
+    {
+        FT_Done_Glyph( p_glyph );
+        if( p_outline )
+            FT_Done_Glyph( p_outline );
+        return NULL;
+    }
+    p_cached->p_glyph = p_glyph;
+    p_cached->p_outline = p_outline;
+    p_cached->advance = *p_advance;
+
+    if( LRUCachePut( p_sys->p_glyph_cache, p_key, sizeof( *p_key ), p_cached ) )
+        return NULL;
+    return p_cached;
+}
+
+static void CacheLoadedGlyph( filter_sys_t *p_sys,
+                              const glyph_bitmaps_t *p_bitmaps,
+                              const FT_Vector *p_advance )
+{
+    FT_Glyph p_glyph, p_outline = NULL;
+
+    if( FT_Glyph_Copy( p_bitmaps->p_glyph, &p_glyph ) )
+        return;
+    if( p_bitmaps->p_outline
+     && FT_Glyph_Copy( p_bitmaps->p_outline, &p_outline ) )
+    {
+        FT_Done_Glyph( p_glyph );
+        return;
+    }
+    PutCachedGlyph( p_sys, &p_bitmaps->cache_key, p_glyph, p_outline,
+                    p_advance );
+}
+
+/**
+ * Gets the styled and stroked images of a glyph from the cache.
+ * \return 1 on hit, 0 on miss, -1 if the cached glyph could not be copied
+ */
+static int GetCachedGlyph( filter_sys_t *p_sys, glyph_bitmaps_t *p_bitmaps,
+                           FT_Vector *p_advance )
+{
+    const cached_glyph_t *p_cached =
+        LRUCacheGet( p_sys->p_glyph_cache, &p_bitmaps->cache_key,
+                     sizeof( p_bitmaps->cache_key ) );
+    if( !p_cached )
+        return 0;
+
+    if( FT_Glyph_Copy( p_cached->p_glyph, &p_bitmaps->p_glyph ) )
+        return -1;
+    if( !p_cached->p_outline
+     || FT_Glyph_Copy( p_cached->p_outline, &p_bitmaps->p_outline ) )
+        p_bitmaps->p_outline = 0;
+    *p_advance = p_cached->advance;
+    return 1;
+}
+
+/**
+ * FT_Glyph_To_Bitmap() going through the glyph cache. Bitmaps are rendered
+ * once per subpixel origin, then shifted by whole pixels to the pen position.
+ */
+static FT_Error RenderGlyph( filter_sys_t *p_sys, FT_Glyph *pp_glyph,
+                             FT_Vector *p_origin, bool b_destroy,
+                             const glyph_cache_key_t *p_loaded_key,
+                             int i_kind )
+{
+    if( !p_sys->p_glyph_cache || !p_loaded_key->p_face
+     || (*pp_glyph)->format == FT_GLYPH_FORMAT_BITMAP )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   p_origin, b_destroy );
+
+    FT_Vector frac = { .x = p_origin->x & 63, .y = p_origin->y & 63 };
+    glyph_cache_key_t key = *p_loaded_key;
+    key.i_kind = i_kind;
+    key.i_origin_x = frac.x;
+    key.i_origin_y = frac.y;
+
+    const cached_glyph_t *p_cached =
+        LRUCacheGet( p_sys->p_glyph_cache, &key, sizeof( key ) );
+    if( !p_cached )
+    {
+        FT_Glyph p_bitmap = *pp_glyph;
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_bitmap, FT_RENDER_MODE_NORMAL,
+                                               &frac, 0 );
+        if( i_error )
+            return i_error;
+
+        const FT_Vector no_advance = { 0, 0 };
+        p_cached = PutCachedGlyph( p_sys, &key, p_bitmap, NULL, &no_advance );
+        if( !p_cached )
+            return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                       p_origin, b_destroy );
+    }
+
+    FT_Glyph p_copy;
+    FT_Error i_error = FT_Glyph_Copy( p_cached->p_glyph, &p_copy );
+    if( i_error )
+        return i_error;
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    ShiftGlyph( (FT_BitmapGlyph) p_copy, ( p_origin->x - frac.x ) / 64,
+                                         ( p_origin->y - frac.y ) / 64 );
+    *pp_glyph = p_copy;
+    return 0;
+}
+
+#ifdef HAVE_HARFBUZZ
+/* Glyphs of a shaped run, the arrays follow the structure */
+typedef struct
+{
+    unsigned int         i_glyph_count;
+    hb_glyph_info_t     *p_infos;
+    hb_glyph_position_t *p_positions;
+} shaped_run_t;
+
+typedef struct
+{
+    FT_Face        p_face;
+    hb_direction_t direction;
+    hb_script_t    script;
+    int            i_length;
+    /* followed by the code points of the run */
+} shape_cache_key_t;
+
+static shaped_run_t *NewShapedRun( unsigned int i_count,
+                                   const hb_glyph_info_t *p_infos,
+                                   const hb_glyph_position_t *p_positions )
+{
+    shaped_run_t *p_shaped =
+        malloc( sizeof( *p_shaped ) + i_count * ( sizeof( *p_infos )
+                                                + sizeof( *p_positions ) ) );
+    if( !p_shaped )
+        return NULL;
+
+    p_shaped->i_glyph_count = i_count;
+    p_shaped->p_infos = (hb_glyph_info_t *) ( p_shaped + 1 );
+    p_shaped->p_positions =
+        (hb_glyph_position_t *) ( p_shaped->p_infos + i_count );
+    memcpy( p_shaped->p_infos, p_infos, i_count * sizeof( *p_infos ) );
+    memcpy( p_shaped->p_positions, p_positions,
+            i_count * sizeof( *p_positions ) );
+    return p_shaped;
+}
+
+static void *NewShapeCacheKey( const paragraph_t *p_paragraph,
+                               const run_desc_t *p_run, size_t *pi_size )
+{
+    const int i_length = p_run->i_end_offset - p_run->i_start_offset;
+    const size_t i_size = sizeof( shape_cache_key_t )
+                        + i_length * sizeof( uni_char_t );
+    shape_cache_key_t *p_key = malloc( i_size );
+    if( !p_key )
+        return NULL;
+
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->p_face = p_run->p_face;
+    p_key->direction = p_run->direction;
+    p_key->script = p_run->script;
+    p_key->i_length = i_length;
+    memcpy( p_key + 1, p_paragraph->p_code_points + p_run->i_start_offset,
+            i_length * sizeof( uni_char_t ) );
+    *pi_size = i_size;
+    return p_key;
+}
+
+/**
+ * Copies a cached shaping of the run, the glyphs are then owned by the run.
+ */
+static bool GetShapedRun( filter_sys_t *p_sys, const paragraph_t *p_paragraph,
+                          run_desc_t *p_run )
+{
+    size_t i_key;
+    void *p_key = NewShapeCacheKey( p_paragraph, p_run, &i_key );
+    if( !p_key )
+        return false;
+
+    const shaped_run_t *p_cached =
+        LRUCacheGet( p_sys->p_shape_cache, p_key, i_key );
+    free( p_key );
+    if( !p_cached )
+        return false;
+
+    shaped_run_t *p_shaped = NewShapedRun( p_cached->i_glyph_count,
+                                           p_cached->p_infos,
+                                           p_cached->p_positions );
+    if( !p_shaped )
+        return false;
+
+    p_run->p_shaped = p_shaped;
+    p_run->p_glyph_infos = p_shaped->p_infos;
+    p_run->p_glyph_positions = p_shaped->p_positions;
+    p_run->i_glyph_count = p_shaped->i_glyph_count;
+    return true;
+}
+
+static void CacheShapedRun( filter_sys_t *p_sys, const paragraph_t *p_paragraph,
+                            const run_desc_t *p_run )
+{
+    size_t i_key;
+    void *p_key = NewShapeCacheKey( p_paragraph, p_run, &i_key );
+    if( !p_key )
+        return;
+
+    shaped_run_t *p_shaped = NewShapedRun( p_run->i_glyph_count,
+                                           p_run->p_glyph_infos,
+                                           p_run->p_glyph_positions );
+    if( p_shaped )
+        LRUCachePut( p_sys->p_shape_cache, p_key, i_key, p_shaped );
+    free( p_key );
+}
+#endif
+
+int CreateLayoutCaches( filter_t *p_filter, size_t i_max_glyphs )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( i_max_glyphs == 0 )
+        return VLC_SUCCESS;
+
+    p_sys->p_glyph_cache = LRUCacheNew( i_max_glyphs, FreeCachedGlyph );
+    if( !p_sys->p_glyph_cache )
+        return VLC_ENOMEM;
+#ifdef HAVE_HARFBUZZ
+    p_sys->p_shape_cache = LRUCacheNew( __MAX( i_max_glyphs / 4, 16 ), free );
+    if( !p_sys->p_shape_cache )
+    {
+        LRUCacheDelete( p_sys->p_glyph_cache );
+        p_sys->p_glyph_cache = NULL;
+        return VLC_ENOMEM;
+    }
+#endif
+    return VLC_SUCCESS;
+}
+
+static void DeleteLayoutCache( filter_t *p_filter, lru_cache_t *p_cache,
+                               const char *psz_name )
+{
+    lru_cache_stats_t stats;
+
+    LRUCacheGetStats( p_cache, &stats );
+    msg_Dbg( p_filter, "%s cache: %"PRIu64" hits, %"PRIu64" misses, "
+             "%"PRIu64" evictions", psz_name,
+             stats.i_hits, stats.i_misses, stats.i_evictions );
+    LRUCacheDelete( p_cache );
+}
+
+void DestroyLayoutCaches( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_glyph_cache )
+        DeleteLayoutCache( p_filter, p_sys->p_glyph_cache, "glyph" );
+    if( p_sys->p_shape_cache )
+        DeleteLayoutCache( p_filter, p_sys->p_shape_cache, "shaping" );
+    p_sys->p_glyph_cache = NULL;
+    p_sys->p_shape_cache = NULL;
+}
+
 static paragraph_t *NewParagraph( filter_t *p_filter,
                                   int i_size,
                                   const uni_char_t *p_code_points,
@@ -770,6 +1085,12 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        if( p_sys->p_shape_cache && GetShapedRun( p_sys, p_paragraph, p_run ) )
+        {
+            i_total_glyphs += p_run->i_glyph_count;
+            continue;
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
@@ -812,6 +1133,9 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             goto error;
         }
 
+        if( p_sys->p_shape_cache )
+            CacheShapedRun( p_sys, p_paragraph, p_run );
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -883,8 +1207,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_buffer )
+            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        free( p_paragraph->p_runs[ i ].p_shaped );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -898,6 +1225,7 @@ error:
             hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
         if( p_paragraph->p_runs[ i ].p_buffer )
             hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        free( p_paragraph->p_runs[ i ].p_shaped );
     }
 
     if( p_new_paragraph )
@@ -1039,12 +1367,13 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        int i_radius = 0;
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
                 var_InheritInteger( p_filter, "freetype-outline-thickness" ) / 100.0;
             f_outline_thickness = VLC_CLIP( f_outline_thickness, 0.0, 0.5 );
-            int i_radius = ( i_live_size << 6 ) * f_outline_thickness;
+            i_radius = ( i_live_size << 6 ) * f_outline_thickness;
             FT_Stroker_Set( p_sys->p_stroker,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
@@ -1101,39 +1430,67 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            glyph_cache_key_t *p_key = &p_bitmaps->cache_key;
+            memset( p_key, 0, sizeof( *p_key ) );
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            FT_Vector advance;
+            int i_cached = 0;
+            if( p_sys->p_glyph_cache )
+            {
+                p_key->p_face = p_face;
+                p_key->i_glyph_index = i_glyph_index;
+                p_key->i_style_flags = p_style->i_style_flags
+                                     & ( STYLE_BOLD | STYLE_ITALIC );
+                if( p_sys->p_stroker )
+                    p_key->i_style_flags |= p_style->i_style_flags & STYLE_OUTLINE;
+                p_key->i_outline_radius = i_radius;
+                p_key->i_kind = GLYPH_CACHE_LOADED;
+
+                i_cached = GetCachedGlyph( p_sys, p_bitmaps, &advance );
+                if( i_cached < 0 )
+                    SKIP_GLYPH( p_bitmaps )
+            }
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+            if( !i_cached )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-#undef SKIP_GLYPH
+                if( ( p_style->i_style_flags & STYLE_BOLD )
+                      && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( ( p_style->i_style_flags & STYLE_ITALIC )
+                      && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
+
+                if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
+
+                advance = p_face->glyph->advance;
+                if( p_sys->p_glyph_cache )
+                    CacheLoadedGlyph( p_sys, p_bitmaps, &advance );
             }
 
+#undef SKIP_GLYPH
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1240,8 +1597,8 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( RenderGlyph( p_sys, &p_bitmaps->p_shadow, &pen_shadow, false,
+                             &p_bitmaps->cache_key, GLYPH_CACHE_SHADOW ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1249,8 +1606,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_sys, &p_bitmaps->p_glyph, &pen_new, true,
+                             &p_bitmaps->cache_key, GLYPH_CACHE_GLYPH ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1265,8 +1622,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_sys, &p_bitmaps->p_outline, &pen_new, true,
+                             &p_bitmaps->cache_key, GLYPH_CACHE_OUTLINE ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
@@ -105,3 +105,17 @@ typedef struct
  */
 int LayoutTextBlock( filter_t *p_filter, const layout_text_block_t *p_textblock,
                      line_desc_t **pp_lines, FT_BBox *p_bbox, int *pi_max_face_height );
+
+/**
+ * Create the caches of loaded and rendered glyphs, and of shaped runs.
+ *
+ * \param p_filter the FreeType module object [IN]
+ * \param i_max_glyphs maximum number of cached glyph images, 0 disables
+ *                     the caches [IN]
+ */
+int CreateLayoutCaches( filter_t *p_filter, size_t i_max_glyphs );
+
+/**
+ * Release the layout caches. Must be called before the faces are released.
+ */
+void DestroyLayoutCaches( filter_t *p_filter );
@@ -28,6 +28,8 @@
 # include "config.h"
 #endif
 
+#include <limits.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
@@ -55,9 +57,10 @@ vlc_module_end ()
  *****************************************************************************/
 static picture_t *Chain         ( filter_t *, picture_t * );
 
-static int BuildTransformChain( filter_t *p_filter );
-static int BuildChromaResize( filter_t * );
-static int BuildChromaChain( filter_t *p_filter );
+static int BuildTransformChain( filter_t *p_filter, unsigned i_attempt );
+static int BuildChromaResize( filter_t *, unsigned i_attempt );
+static int BuildChromaChain( filter_t *p_filter, unsigned i_attempt );
+static int BuildConverterChain( filter_t *p_filter );
 static int BuildFilterChain( filter_t *p_filter );
 
 static int CreateChain( filter_t *p_filter, const es_format_t *p_fmt_mid );
@@ -217,10 +220,10 @@ static int Activate( filter_t *p_filter, int (*pf_build)(filter_t *) )
     return VLC_SUCCESS;
 }
 
-static int ActivateConverter( vlc_object_t *p_this )
-{
-    filter_t *p_filter = (filter_t *)p_this;
+typedef int (*chain_build_cb)( filter_t *, unsigned );
 
+static chain_build_cb GetConverterBuilder( const filter_t *p_filter )
+{
     const bool b_chroma = p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma;
     const bool b_resize = p_filter->fmt_in.video.i_width  != p_filter->fmt_out.video.i_width ||
                           p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height;
@@ -229,11 +232,21 @@ static int ActivateConverter( vlc_object_t *p_this )
     const bool b_transform = p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation;
 
     if( !b_chroma && !b_chroma_resize && !b_transform)
+        return NULL;
+
+    return b_transform ? BuildTransformChain :
+           b_chroma_resize ? BuildChromaResize :
+           BuildChromaChain;
+}
+
+static int ActivateConverter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( GetConverterBuilder( p_filter ) == NULL )
         return VLC_EGENERIC;
 
-    return Activate( p_filter, b_transform ? BuildTransformChain :
-                               b_chroma_resize ? BuildChromaResize :
-                               BuildChromaChain );
+    return Activate( p_filter, BuildConverterChain );
 }
 
 static int ActivateFilter( vlc_object_t *p_this )
@@ -275,89 +288,323 @@ static picture_t *Chain( filter_t *p_filter, picture_t *p_pic )
 }
 
 /*****************************************************************************
- * Builders
+ * Plans cache
+ *****************************************************************************
+ * Building a converter chain goes through the possible intermediate formats
+ * one by one, each attempt probing converter modules. The attempt that
+ * succeeded, or the failure of all of them, is remembered per conversion so
+ * that repeated requests build the chain directly. Successful attempts are
+ * shared by all the sizes, since a failing replay falls back to all the
+ * attempts, but failures only apply to the same sizes.
  *****************************************************************************/
+#define PLAN_CACHE_SIZE 32
+#define PLAN_FAILED     UINT_MAX
+/* Failures may be transient (e.g. missing decoder device) */
+#define PLAN_FAILED_TTL VLC_TICK_FROM_SEC(5)
+
+typedef struct
+{
+    chain_build_cb pf_build;
+    vlc_fourcc_t i_chroma_in;
+    vlc_fourcc_t i_chroma_out;
+    video_orientation_t orientation_in;
+    video_orientation_t orientation_out;
+    bool b_resize;
+    bool b_fmt_out_change;
+    bool b_vctx_in;
+    int i_level;
+} chain_key_t;
+
+typedef struct
+{
+    unsigned i_width_in;
+    unsigned i_height_in;
+    unsigned i_width_out;
+    unsigned i_height_out;
+} chain_sizes_t;
+
+typedef struct
+{
+    chain_key_t key;
+    unsigned i_attempt; /* PLAN_FAILED if no chain could be built */
+    chain_sizes_t sizes; /* sizes of the failed request */
+    vlc_tick_t i_date;
+} chain_plan_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    chain_plan_t plans[PLAN_CACHE_SIZE];
+    unsigned i_plans;
+    unsigned i_next;
+
+    /* Creation latency counters */
+    unsigned long i_builds;
+    unsigned long i_hits;
+    vlc_tick_t i_total;
+    vlc_tick_t i_max;
+} cache = { .lock = VLC_STATIC_MUTEX };
+
+static void PlanKeyInit( chain_key_t *p_key, filter_t *p_filter,
+                         chain_build_cb pf_build )
+{
+    const video_format_t *p_in = &p_filter->fmt_in.video;
+    const video_format_t *p_out = &p_filter->fmt_out.video;
+
+    p_key->pf_build = pf_build;
+    p_key->i_chroma_in = p_in->i_chroma;
+    p_key->i_chroma_out = p_out->i_chroma;
+    p_key->orientation_in = p_in->orientation;
+    p_key->orientation_out = p_out->orientation;
+    p_key->b_resize = p_in->i_width != p_out->i_width ||
+                      p_in->i_height != p_out->i_height;
+    p_key->b_fmt_out_change = p_filter->b_allow_fmt_out_change;
+    p_key->b_vctx_in = p_filter->vctx_in != NULL;
+    /* Nested chains cannot recurse as deep */
+    p_key->i_level = var_GetInteger( p_filter, "chain-level" );
+}
+
+static void PlanSizesInit( chain_sizes_t *p_sizes, const filter_t *p_filter )
+{
+    p_sizes->i_width_in = p_filter->fmt_in.video.i_width;
+    p_sizes->i_height_in = p_filter->fmt_in.video.i_height;
+    p_sizes->i_width_out = p_filter->fmt_out.video.i_width;
+    p_sizes->i_height_out = p_filter->fmt_out.video.i_height;
+}
 
-static int BuildTransformChain( filter_t *p_filter )
+static bool PlanSizesEquals( const chain_sizes_t *a, const chain_sizes_t *b )
 {
+    return a->i_width_in == b->i_width_in &&
+           a->i_height_in == b->i_height_in &&
+           a->i_width_out == b->i_width_out &&
+           a->i_height_out == b->i_height_out;
+}
+
+static bool PlanKeyEquals( const chain_key_t *a, const chain_key_t *b )
+{
+    return a->pf_build == b->pf_build &&
+           a->i_chroma_in == b->i_chroma_in &&
+           a->i_chroma_out == b->i_chroma_out &&
+           a->orientation_in == b->orientation_in &&
+           a->orientation_out == b->orientation_out &&
+           a->b_resize == b->b_resize &&
+           a->b_fmt_out_change == b->b_fmt_out_change &&
+           a->b_vctx_in == b->b_vctx_in &&
+           a->i_level == b->i_level;
+}
+
+/* Must be called with the cache lock held */
+static chain_plan_t *PlanFind( const chain_key_t *p_key )
+{
+    for( unsigned i = 0; i < cache.i_plans; i++ )
+        if( PlanKeyEquals( &cache.plans[i].key, p_key ) )
+            return &cache.plans[i];
+    return NULL;
+}
+
+static bool PlanLookup( const chain_key_t *p_key, const chain_sizes_t *p_sizes,
+                        unsigned *pi_attempt, vlc_tick_t now )
+{
+    bool b_found = false;
+
+    vlc_mutex_lock( &cache.lock );
+    const chain_plan_t *p_plan = PlanFind( p_key );
+    if( p_plan != NULL && ( p_plan->i_attempt != PLAN_FAILED ||
+                            ( PlanSizesEquals( &p_plan->sizes, p_sizes ) &&
+                              now - p_plan->i_date < PLAN_FAILED_TTL ) ) )
+    {
+        *pi_attempt = p_plan->i_attempt;
+        b_found = true;
+    }
+    vlc_mutex_unlock( &cache.lock );
+    return b_found;
+}
 
+static void PlanStore( const chain_key_t *p_key, const chain_sizes_t *p_sizes,
+                       unsigned i_attempt, vlc_tick_t now )
+{
+    vlc_mutex_lock( &cache.lock );
+    chain_plan_t *p_plan = PlanFind( p_key );
+    if( p_plan == NULL )
+    {
+        if( cache.i_plans < PLAN_CACHE_SIZE )
+            p_plan = &cache.plans[cache.i_plans++];
+        else
+        {
+            p_plan = &cache.plans[cache.i_next];
+            cache.i_next = (cache.i_next + 1) % PLAN_CACHE_SIZE;
+        }
+        p_plan->key = *p_key;
+    }
+    p_plan->i_attempt = i_attempt;
+    p_plan->sizes = *p_sizes;
+    p_plan->i_date = now;
+    vlc_mutex_unlock( &cache.lock );
+}
+
+static int BuildConverterChain( filter_t *p_filter )
+{
+    const chain_build_cb pf_build = GetConverterBuilder( p_filter );
+    const vlc_tick_t i_start = vlc_tick_now();
+    chain_key_t key;
+    chain_sizes_t sizes;
+    unsigned i_plan;
+    int i_ret;
+
+    PlanKeyInit( &key, p_filter, pf_build );
+    PlanSizesInit( &sizes, p_filter );
+
+    bool b_hit = PlanLookup( &key, &sizes, &i_plan, i_start );
+    if( b_hit )
+    {
+        if( i_plan == PLAN_FAILED )
+            i_ret = VLC_EGENERIC;
+        else
+        {
+            i_ret = pf_build( p_filter, i_plan );
+            /* The attempt may also depend on the sizes and on the modules
+             * options: fall back to trying all of them. */
+            b_hit = i_ret == VLC_SUCCESS;
+        }
+    }
+    else
+        i_plan = PLAN_FAILED;
+
+    if( !b_hit )
+    {
+        unsigned i_attempt = 0;
+
+        for( ;; i_attempt++ )
+        {
+            if( i_attempt == i_plan )
+                continue;
+            i_ret = pf_build( p_filter, i_attempt );
+            if( i_ret == VLC_SUCCESS || i_ret == VLC_ENOITEM )
+                break;
+        }
+        if( i_ret != VLC_SUCCESS )
+        {
+            i_ret = VLC_EGENERIC;
+            i_attempt = PLAN_FAILED;
+        }
+        PlanStore( &key, &sizes, i_attempt, i_start );
+    }
+
+    const vlc_tick_t i_duration = vlc_tick_now() - i_start;
+
+    vlc_mutex_lock( &cache.lock );
+    cache.i_builds++;
+    if( b_hit )
+        cache.i_hits++;
+    cache.i_total += i_duration;
+    if( i_duration > cache.i_max )
+        cache.i_max = i_duration;
+    unsigned long i_builds = cache.i_builds, i_hits = cache.i_hits;
+    vlc_tick_t i_average = cache.i_total / cache.i_builds;
+    vlc_tick_t i_max = cache.i_max;
+    vlc_mutex_unlock( &cache.lock );
+
+    msg_Dbg( p_filter, "%s chain %s in %"PRId64" us "
+             "(%lu/%lu cached, average %"PRId64" us, max %"PRId64" us)",
+             b_hit ? "cached" : "new",
+             i_ret == VLC_SUCCESS ? "built" : "failed",
+             US_FROM_VLC_TICK(i_duration), i_hits, i_builds,
+             US_FROM_VLC_TICK(i_average), US_FROM_VLC_TICK(i_max) );
+    return i_ret;
+}
+
+/*****************************************************************************
+ * Builders
+ *****************************************************************************/
+
+/* Each builder tries the given attempt, and returns VLC_ENOITEM once there
+ * are no more attempts. */
+
+static int BuildTransformChain( filter_t *p_filter, unsigned i_attempt )
+{
     es_format_t fmt_mid;
     int i_ret;
 
-    /* Lets try transform first, then (potentially) resize+chroma */
-    msg_Dbg( p_filter, "Trying to build transform, then chroma+resize" );
-    es_format_Copy( &fmt_mid, &p_filter->fmt_in );
-    video_format_TransformTo(&fmt_mid.video, p_filter->fmt_out.video.orientation);
-    i_ret = CreateChain( p_filter, &fmt_mid );
-    es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    switch( i_attempt )
+    {
+        case 0:
+            /* Lets try transform first, then (potentially) resize+chroma */
+            msg_Dbg( p_filter, "Trying to build transform, then chroma+resize" );
+            es_format_Copy( &fmt_mid, &p_filter->fmt_in );
+            video_format_TransformTo(&fmt_mid.video, p_filter->fmt_out.video.orientation);
+            break;
+        case 1:
+            /* Lets try resize+chroma first, then transform */
+            msg_Dbg( p_filter, "Trying to build chroma+resize" );
+            EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
+            break;
+        default:
+            return VLC_ENOITEM;
+    }
 
-    /* Lets try resize+chroma first, then transform */
-    msg_Dbg( p_filter, "Trying to build chroma+resize" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
     i_ret = CreateChain( p_filter, &fmt_mid );
     es_format_Clean( &fmt_mid );
     return i_ret;
 }
 
-static int BuildChromaResize( filter_t *p_filter )
+static int BuildChromaResize( filter_t *p_filter, unsigned i_attempt )
 {
     es_format_t fmt_mid;
     int i_ret;
 
-    /* Lets try resizing and then doing the chroma conversion */
-    msg_Dbg( p_filter, "Trying to build resize+chroma" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
-    i_ret = CreateResizeChromaChain( p_filter, &fmt_mid );
-    es_format_Clean( &fmt_mid );
-
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
+    switch( i_attempt )
+    {
+        case 0:
+            /* Lets try resizing and then doing the chroma conversion */
+            msg_Dbg( p_filter, "Trying to build resize+chroma" );
+            EsFormatMergeSize( &fmt_mid, &p_filter->fmt_in, &p_filter->fmt_out );
+            i_ret = CreateResizeChromaChain( p_filter, &fmt_mid );
+            break;
+        case 1:
+            /* Lets try it the other way arround (chroma and then resize) */
+            msg_Dbg( p_filter, "Trying to build chroma+resize" );
+            EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
+            i_ret = CreateChain( p_filter, &fmt_mid );
+            break;
+        default:
+            return VLC_ENOITEM;
+    }
 
-    /* Lets try it the other way arround (chroma and then resize) */
-    msg_Dbg( p_filter, "Trying to build chroma+resize" );
-    EsFormatMergeSize( &fmt_mid, &p_filter->fmt_out, &p_filter->fmt_in );
-    i_ret = CreateChain( p_filter, &fmt_mid );
     es_format_Clean( &fmt_mid );
-    if( i_ret == VLC_SUCCESS )
-        return VLC_SUCCESS;
-
-    return VLC_EGENERIC;
+    return i_ret == VLC_SUCCESS ? VLC_SUCCESS : VLC_EGENERIC;
 }
 
-static int BuildChromaChain( filter_t *p_filter )
+static int BuildChromaChain( filter_t *p_filter, unsigned i_attempt )
 {
     es_format_t fmt_mid;
-    int i_ret = VLC_EGENERIC;
+    int i_ret;
 
     /* Now try chroma format list */
     const vlc_fourcc_t *pi_allowed_chromas = get_allowed_chromas( p_filter );
-    for( int i = 0; pi_allowed_chromas[i]; i++ )
-    {
-        const vlc_fourcc_t i_chroma = pi_allowed_chromas[i];
-        if( i_chroma == p_filter->fmt_in.i_codec ||
-            i_chroma == p_filter->fmt_out.i_codec )
-            continue;
-
-        msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
-                 (char*)&i_chroma );
-
-        es_format_Copy( &fmt_mid, &p_filter->fmt_in );
-        fmt_mid.i_codec        =
-        fmt_mid.video.i_chroma = i_chroma;
-        fmt_mid.video.i_rmask  = 0;
-        fmt_mid.video.i_gmask  = 0;
-        fmt_mid.video.i_bmask  = 0;
-        video_format_FixRgb(&fmt_mid.video);
+    for( unsigned i = 0; i < i_attempt; i++ )
+        if( pi_allowed_chromas[i] == 0 )
+            return VLC_ENOITEM;
+
+    const vlc_fourcc_t i_chroma = pi_allowed_chromas[i_attempt];
+    if( i_chroma == 0 )
+        return VLC_ENOITEM;
+    if( i_chroma == p_filter->fmt_in.i_codec ||
+        i_chroma == p_filter->fmt_out.i_codec )
+        return VLC_EGENERIC;
 
-        i_ret = CreateChain( p_filter, &fmt_mid );
-        es_format_Clean( &fmt_mid );
+    msg_Dbg( p_filter, "Trying to use chroma %4.4s as middle man",
+             (char*)&i_chroma );
 
-        if( i_ret == VLC_SUCCESS )
-            break;
-    }
+    es_format_Copy( &fmt_mid, &p_filter->fmt_in );
+    fmt_mid.i_codec        =
+    fmt_mid.video.i_chroma = i_chroma;
+    fmt_mid.video.i_rmask  = 0;
+    fmt_mid.video.i_gmask  = 0;
+    fmt_mid.video.i_bmask  = 0;
+    video_format_FixRgb(&fmt_mid.video);
 
+    i_ret = CreateChain( p_filter, &fmt_mid );
+    es_format_Clean( &fmt_mid );
     return i_ret;
 }
 
@@ -46,6 +46,88 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+struct yadif_slices
+{
+    void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
+                   int w, int prefs, int mrefs, int parity, int mode);
+    picture_t *p_dst;
+    const picture_t *p_prev;
+    const picture_t *p_cur;
+    const picture_t *p_next;
+    int i_field;
+    int parity;
+};
+
+static void RenderYadifLines( const struct yadif_slices *ctx, int n,
+                              int y_start, int y_end )
+{
+    const plane_t *prevp = &ctx->p_prev->p[n];
+    const plane_t *curp  = &ctx->p_cur->p[n];
+    const plane_t *nextp = &ctx->p_next->p[n];
+    const plane_t *dstp  = &ctx->p_dst->p[n];
+
+    for( int y = y_start; y < y_end; y++ )
+    {
+        if( (y % 2) == ctx->i_field  ||  ctx->parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            ctx->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                         &prevp->p_pixels[y * prevp->i_pitch],
+                         &curp->p_pixels[y * curp->i_pitch],
+                         &nextp->p_pixels[y * nextp->i_pitch],
+                         dstp->i_visible_pitch,
+                         y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                         y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                         ctx->parity,
+                         mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
+/* Renders the lines [start, end) of the planes put one after the other,
+ * without their first and last lines. Only the source pictures are read,
+ * so that the slices are independent. */
+static void RenderYadifSlice( void *opaque, unsigned start, unsigned end )
+{
+    const struct yadif_slices *ctx = opaque;
+    unsigned i_offset = 0;
+
+    for( int n = 0; n < ctx->p_dst->i_planes && i_offset < end; n++ )
+    {
+        const int i_visible_lines = ctx->p_dst->p[n].i_visible_lines;
+        if( i_visible_lines <= 2 )
+            continue;
+
+        const unsigned i_count = i_visible_lines - 2;
+        if( start < i_offset + i_count )
+        {
+            unsigned i_first = start > i_offset ? start - i_offset : 0;
+            unsigned i_last = __MIN( end - i_offset, i_count );
+            RenderYadifLines( ctx, n, 1 + i_first, 1 + i_last );
+        }
+        i_offset += i_count;
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -112,6 +194,21 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
         void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
                        int w, int prefs, int mrefs, int parity, int mode);
 
+        if( p_sys->chroma->pixel_size == 2 )
+        {
+#if defined(HAVE_AVX2_INTRINSICS)
+            if( vlc_CPU_AVX2() )
+                filter = yadif_filter_line_avx2_16bit;
+            else
+#endif
+                filter = yadif_filter_line_c_16bit;
+        }
+        else
+#if defined(HAVE_AVX2_INTRINSICS)
+        if( vlc_CPU_AVX2() )
+            filter = yadif_filter_line_avx2;
+        else
+#endif
 #if defined(HAVE_X86ASM)
         if( vlc_CPU_SSSE3() )
             filter = vlcpriv_yadif_filter_line_ssse3;
@@ -127,53 +224,19 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
 #endif
             filter = yadif_filter_line_c;
 
-        if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+        struct yadif_slices ctx = {
+            .filter = filter,
+            .p_dst = p_dst, .p_prev = p_prev, .p_cur = p_cur, .p_next = p_next,
+            .i_field = i_field, .parity = yadif_parity,
+        };
 
+        /* Lines of all the planes are processed in parallel slices */
+        unsigned i_lines = 0;
         for( int n = 0; n < p_dst->i_planes; n++ )
-        {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
-        }
+            if( p_dst->p[n].i_visible_lines > 2 )
+                i_lines += p_dst->p[n].i_visible_lines - 2;
 
+        vlc_filter_slices_Run( p_sys->slices, i_lines, RenderYadifSlice, &ctx );
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
 
         return VLC_SUCCESS;
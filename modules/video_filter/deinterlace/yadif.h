@@ -93,6 +93,123 @@ static void yadif_filter_line_c_16bit(uint8_t *dst8, uint8_t *prev8, uint8_t *cu
     FILTER
 }
 
+#if defined(HAVE_AVX2_INTRINSICS)
+#include <immintrin.h>
+
+/* AVX2 version of FILTER, bit-exact with the C code. The pixels are widened
+ * to 16-bit lanes (8-bit input) or 32-bit lanes (16-bit input), which is
+ * enough to hold all the intermediate values. */
+#define YADIF_AVX2_LOAD8(p)  _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define YADIF_AVX2_LOAD16(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define YADIF_AVX2_STORE8(p, v) \
+    _mm_storeu_si128((__m128i *)(p), \
+                     _mm_packus_epi16(_mm256_castsi256_si128(v), \
+                                      _mm256_extracti128_si256(v, 1)))
+#define YADIF_AVX2_STORE16(p, v) \
+    _mm_storeu_si128((__m128i *)(p), \
+                     _mm_packus_epi32(_mm256_castsi256_si128(v), \
+                                      _mm256_extracti128_si256(v, 1)))
+
+#define YADIF_AVX2_CHECK(j, mask, bits, LOAD) { \
+        __m256i score = _mm256_add_epi##bits( \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&cur[x+mrefs-1+(j)]), LOAD(&cur[x+prefs-1-(j)]))), \
+            _mm256_add_epi##bits( \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&cur[x+mrefs  +(j)]), LOAD(&cur[x+prefs  -(j)]))), \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&cur[x+mrefs+1+(j)]), LOAD(&cur[x+prefs+1-(j)]))))); \
+        mask = _mm256_and_si256(mask, _mm256_cmpgt_epi##bits(spatial_score, score)); \
+        __m256i pred = _mm256_srai_epi##bits(_mm256_add_epi##bits( \
+            LOAD(&cur[x+mrefs+(j)]), LOAD(&cur[x+prefs-(j)])), 1); \
+        spatial_score = _mm256_blendv_epi8(spatial_score, score, mask); \
+        spatial_pred = _mm256_blendv_epi8(spatial_pred, pred, mask); \
+    }
+
+#define YADIF_AVX2_FILTER(bits, step, LOAD, STORE) \
+    for (; x + step <= w; x += step) { \
+        __m256i c = LOAD(&cur[x+mrefs]); \
+        __m256i e = LOAD(&cur[x+prefs]); \
+        __m256i p2 = LOAD(&prev2[x]); \
+        __m256i n2 = LOAD(&next2[x]); \
+        __m256i d = _mm256_srai_epi##bits(_mm256_add_epi##bits(p2, n2), 1); \
+        __m256i temporal_diff0 = _mm256_abs_epi##bits(_mm256_sub_epi##bits(p2, n2)); \
+        __m256i temporal_diff1 = _mm256_srai_epi##bits(_mm256_add_epi##bits( \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&prev[x+mrefs]), c)), \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&prev[x+prefs]), e))), 1); \
+        __m256i temporal_diff2 = _mm256_srai_epi##bits(_mm256_add_epi##bits( \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&next[x+mrefs]), c)), \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&next[x+prefs]), e))), 1); \
+        __m256i diff = _mm256_max_epi##bits(_mm256_srai_epi##bits(temporal_diff0, 1), \
+                       _mm256_max_epi##bits(temporal_diff1, temporal_diff2)); \
+        __m256i spatial_pred = _mm256_srai_epi##bits(_mm256_add_epi##bits(c, e), 1); \
+        __m256i spatial_score = _mm256_sub_epi##bits(_mm256_add_epi##bits( \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&cur[x+mrefs-1]), LOAD(&cur[x+prefs-1]))), \
+            _mm256_add_epi##bits(_mm256_abs_epi##bits(_mm256_sub_epi##bits(c, e)), \
+            _mm256_abs_epi##bits(_mm256_sub_epi##bits(LOAD(&cur[x+mrefs+1]), LOAD(&cur[x+prefs+1]))))), \
+            one); \
+        __m256i mask = ones; \
+        YADIF_AVX2_CHECK(-1, mask, bits, LOAD) YADIF_AVX2_CHECK(-2, mask, bits, LOAD) \
+        mask = ones; \
+        YADIF_AVX2_CHECK( 1, mask, bits, LOAD) YADIF_AVX2_CHECK( 2, mask, bits, LOAD) \
+ \
+        if (mode < 2) { \
+            __m256i b = _mm256_srai_epi##bits(_mm256_add_epi##bits( \
+                LOAD(&prev2[x+2*mrefs]), LOAD(&next2[x+2*mrefs])), 1); \
+            __m256i f = _mm256_srai_epi##bits(_mm256_add_epi##bits( \
+                LOAD(&prev2[x+2*prefs]), LOAD(&next2[x+2*prefs])), 1); \
+            __m256i de = _mm256_sub_epi##bits(d, e); \
+            __m256i dc = _mm256_sub_epi##bits(d, c); \
+            __m256i bc = _mm256_sub_epi##bits(b, c); \
+            __m256i fe = _mm256_sub_epi##bits(f, e); \
+            __m256i max = _mm256_max_epi##bits(_mm256_max_epi##bits(de, dc), \
+                                               _mm256_min_epi##bits(bc, fe)); \
+            __m256i min = _mm256_min_epi##bits(_mm256_min_epi##bits(de, dc), \
+                                               _mm256_max_epi##bits(bc, fe)); \
+            diff = _mm256_max_epi##bits(_mm256_max_epi##bits(diff, min), \
+                                        _mm256_sub_epi##bits(zero, max)); \
+        } \
+ \
+        /* diff is never negative, so this is the same as the C clipping */ \
+        spatial_pred = _mm256_min_epi##bits(_mm256_max_epi##bits(spatial_pred, \
+                                            _mm256_sub_epi##bits(d, diff)), \
+                                            _mm256_add_epi##bits(d, diff)); \
+        STORE(&dst[x], spatial_pred); \
+    }
+
+__attribute__ ((__target__ ("avx2")))
+static void yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int prefs, int mrefs, int parity, int mode) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i ones = _mm256_set1_epi16(-1);
+    uint8_t *prev2= parity ? prev : cur ;
+    uint8_t *next2= parity ? cur  : next;
+    int x = 0;
+    YADIF_AVX2_FILTER(16, 16, YADIF_AVX2_LOAD8, YADIF_AVX2_STORE8)
+    if (x < w)
+        yadif_filter_line_c(dst + x, prev + x, cur + x, next + x, w - x,
+                            prefs, mrefs, parity, mode);
+}
+
+__attribute__ ((__target__ ("avx2")))
+static void yadif_filter_line_avx2_16bit(uint8_t *dst8, uint8_t *prev8, uint8_t *cur8, uint8_t *next8, int w, int prefs, int mrefs, int parity, int mode) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    uint16_t *dst = (uint16_t *)dst8;
+    uint16_t *prev = (uint16_t *)prev8;
+    uint16_t *cur = (uint16_t *)cur8;
+    uint16_t *next = (uint16_t *)next8;
+    uint16_t *prev2= parity ? prev : cur ;
+    uint16_t *next2= parity ? cur  : next;
+    int x = 0;
+    mrefs /= 2;
+    prefs /= 2;
+    YADIF_AVX2_FILTER(32, 8, YADIF_AVX2_LOAD16, YADIF_AVX2_STORE16)
+    if (x < w)
+        yadif_filter_line_c_16bit((uint8_t *)(dst + x), (uint8_t *)(prev + x),
+                                  (uint8_t *)(cur + x), (uint8_t *)(next + x),
+                                  w - x, prefs * 2, mrefs * 2, parity, mode);
+}
+#endif
+
 #if defined(__i386__) || defined(__x86_64__)
 void vlcpriv_yadif_filter_line_ssse3(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int prefs, int mrefs, int parity, int mode);
 void vlcpriv_yadif_filter_line_sse2(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int prefs, int mrefs, int parity, int mode);
@@ -95,6 +95,20 @@ struct decoder_owner
     /* fifo */
     block_fifo_t *p_fifo;
 
+    /* Lock-less input queue in front of the fifo, filled by
+     * input_DecoderDecode() and moved to the fifo with the fifo locked.
+     * The decoder thread is only woken up when it waits for data, so that
+     * blocks queued while it decodes are moved in a single batch. */
+    struct
+    {
+        _Atomic(block_t *) last; /* most recently queued, linked backward */
+        atomic_size_t depth;      /* blocks count in the inbox */
+        atomic_size_t bytes;      /* bytes in the inbox */
+        atomic_size_t fifo_depth; /* fifo blocks count, as last seen */
+        atomic_size_t fifo_bytes; /* fifo bytes, as last seen */
+        atomic_bool   waiting;    /* the decoder thread waits for data */
+    } inbox;
+
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
     vlc_cond_t  wait_request;
@@ -1620,6 +1634,97 @@ static void DecoderThread_ChangeDelay( struct decoder_owner *p_owner, vlc_tick_t
     }
 }
 
+/* Publishes the fifo counters for the lock-less input path */
+static void DecoderInboxUpdateLocked( struct decoder_owner *p_owner )
+{
+    atomic_store_explicit( &p_owner->inbox.fifo_depth,
+                           vlc_fifo_GetCount( p_owner->p_fifo ),
+                           memory_order_relaxed );
+    atomic_store_explicit( &p_owner->inbox.fifo_bytes,
+                           vlc_fifo_GetBytes( p_owner->p_fifo ),
+                           memory_order_relaxed );
+}
+
+/* Moves the blocks of the lock-less input queue to the fifo, in order */
+static void DecoderInboxMoveLocked( struct decoder_owner *p_owner )
+{
+    block_t *p_last = atomic_exchange_explicit( &p_owner->inbox.last, NULL,
+                                                memory_order_acquire );
+    if( p_last == NULL )
+        return;
+
+    block_t *p_first = NULL;
+    size_t i_depth = 0, i_bytes = 0;
+    while( p_last != NULL )
+    {
+        block_t *p_prev = p_last->p_next;
+        p_last->p_next = p_first;
+        p_first = p_last;
+        p_last = p_prev;
+        i_depth++;
+        i_bytes += p_first->i_buffer;
+    }
+
+    atomic_fetch_sub_explicit( &p_owner->inbox.depth, i_depth,
+                               memory_order_relaxed );
+    atomic_fetch_sub_explicit( &p_owner->inbox.bytes, i_bytes,
+                               memory_order_relaxed );
+    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_first );
+    DecoderInboxUpdateLocked( p_owner );
+}
+
+/* Queues a block without locking the fifo, unless the decoder thread waits
+ * for data. Returns false if the block must go through the locked path. */
+static bool DecoderInboxPush( struct decoder_owner *p_owner, block_t *p_block,
+                              bool b_do_pace )
+{
+    if( p_block->p_next != NULL )
+        return false;
+
+    if( !b_do_pace )
+    {
+        size_t i_bytes =
+            atomic_load_explicit( &p_owner->inbox.bytes, memory_order_relaxed )
+          + atomic_load_explicit( &p_owner->inbox.fifo_bytes,
+                                  memory_order_relaxed );
+        if( i_bytes + p_block->i_buffer > 400*1024*1024 )
+            return false;
+    }
+    else
+    if( !p_owner->b_waiting )
+    {
+        size_t i_depth =
+            atomic_load_explicit( &p_owner->inbox.depth, memory_order_relaxed )
+          + atomic_load_explicit( &p_owner->inbox.fifo_depth,
+                                  memory_order_relaxed );
+        if( i_depth >= 10 )
+            return false;
+    }
+
+    atomic_fetch_add_explicit( &p_owner->inbox.depth, 1,
+                               memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_owner->inbox.bytes, p_block->i_buffer,
+                               memory_order_relaxed );
+
+    block_t *p_last = atomic_load_explicit( &p_owner->inbox.last,
+                                            memory_order_relaxed );
+    do
+        p_block->p_next = p_last;
+    while( !atomic_compare_exchange_weak( &p_owner->inbox.last, &p_last,
+                                          p_block ) );
+
+    /* Only the first block queued while the decoder thread waits wakes it
+     * up: the next ones are moved along with it. */
+    if( atomic_load( &p_owner->inbox.waiting )
+     && atomic_exchange( &p_owner->inbox.waiting, false ) )
+    {
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_fifo_Signal( p_owner->p_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+    }
+    return true;
+}
+
 /**
  * The decoding main loop
  *
@@ -1712,14 +1817,22 @@ static void *DecoderThread( void *p_data )
 
         vlc_cond_signal( &p_owner->wait_fifo );
 
+        DecoderInboxMoveLocked( p_owner );
         block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        DecoderInboxUpdateLocked( p_owner );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
                 p_owner->b_idle = true;
                 vlc_cond_signal( &p_owner->wait_acknowledge );
-                vlc_fifo_Wait( p_owner->p_fifo );
+                /* Announce the wait before checking the inbox a last time:
+                 * either the producer sees the flag and signals, or this
+                 * thread sees the queued block. */
+                atomic_store( &p_owner->inbox.waiting, true );
+                if( atomic_load( &p_owner->inbox.last ) == NULL )
+                    vlc_fifo_Wait( p_owner->p_fifo );
+                atomic_store( &p_owner->inbox.waiting, false );
                 p_owner->b_idle = false;
                 continue;
             }
@@ -1867,6 +1980,12 @@ static struct decoder_owner * CreateDecoder( vlc_object_t *p_parent,
         vlc_object_delete(p_dec);
         return NULL;
     }
+    atomic_init( &p_owner->inbox.last, NULL );
+    atomic_init( &p_owner->inbox.depth, 0 );
+    atomic_init( &p_owner->inbox.bytes, 0 );
+    atomic_init( &p_owner->inbox.fifo_depth, 0 );
+    atomic_init( &p_owner->inbox.fifo_bytes, 0 );
+    atomic_init( &p_owner->inbox.waiting, false );
 
     vlc_mutex_init( &p_owner->lock );
     vlc_mutex_init( &p_owner->mouse_lock );
@@ -1974,6 +2093,7 @@ static void DeleteDecoder( decoder_t * p_dec )
         vlc_video_context_Release( p_owner->vctx );
 
     /* Free all packets still in the decoder fifo. */
+    block_ChainRelease( atomic_load( &p_owner->inbox.last ) );
     block_FifoRelease( p_owner->p_fifo );
 
     /* Cleanup */
@@ -2212,7 +2332,12 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    if( DecoderInboxPush( p_owner, p_block, b_do_pace ) )
+        return;
+
     vlc_fifo_Lock( p_owner->p_fifo );
+    /* Keep the blocks order */
+    DecoderInboxMoveLocked( p_owner );
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
@@ -2236,6 +2361,7 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     }
 
     vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    DecoderInboxUpdateLocked( p_owner );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2246,6 +2372,7 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
+    DecoderInboxMoveLocked( p_owner );
     if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2301,7 +2428,9 @@ void input_DecoderFlush( decoder_t *p_dec )
     vlc_fifo_Lock( p_owner->p_fifo );
 
     /* Empty the fifo */
+    DecoderInboxMoveLocked( p_owner );
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    DecoderInboxUpdateLocked( p_owner );
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2515,6 +2644,7 @@ void input_DecoderWait( decoder_t *p_dec )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
+        DecoderInboxMoveLocked( p_owner );
         if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
         {
             msg_Err( p_dec, "buffer deadlock prevented" );
@@ -2578,7 +2708,8 @@ size_t input_DecoderGetFifoSize( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
-    return block_FifoSize( p_owner->p_fifo );
+    return block_FifoSize( p_owner->p_fifo )
+         + atomic_load_explicit( &p_owner->inbox.bytes, memory_order_relaxed );
 }
 
 void input_DecoderSetVoutMouseEvent( decoder_t *dec, vlc_mouse_event mouse_event,
@@ -138,6 +138,18 @@ static const char* DemuxNameFromExtension( char const* ext,
     return result ? result->name : NULL;
 }
 
+static const char *DemuxNameFromContent( stream_t *s )
+{
+    /* Peek once for all signatures: the stream keeps the data for the
+     * demux probes */
+    const uint8_t *p_peek;
+    ssize_t i_peek = vlc_stream_Peek( s, &p_peek, DEMUX_SIGNATURE_PEEK );
+    if( i_peek <= 0 )
+        return NULL;
+
+    return demux_NameFromSignature( p_peek, i_peek );
+}
+
 demux_t *demux_New( vlc_object_t *p_obj, const char *psz_name,
                     stream_t *s, es_out_t *out )
 {
@@ -148,6 +160,11 @@ demux_t *demux_New( vlc_object_t *p_obj, const char *psz_name,
 struct vlc_demux_private
 {
     module_t *module;
+
+    /* Probing statistics */
+    unsigned probes;
+    vlc_tick_t probe_time;
+    vlc_tick_t last_probe_time;
 };
 
 static void demux_DestroyDemux(demux_t *demux)
@@ -177,7 +194,12 @@ static int demux_Probe(void *func, bool forced, va_list ap)
 
     demux->obj.force = forced;
 
+    struct vlc_demux_private *priv = vlc_stream_Private(demux);
+    vlc_tick_t start = vlc_tick_now();
     int ret = probe(VLC_OBJECT(demux));
+    priv->last_probe_time = vlc_tick_now() - start;
+    priv->probe_time += priv->last_probe_time;
+    priv->probes++;
     if (ret)
         vlc_objres_clear(VLC_OBJECT(demux));
     return ret;
@@ -196,6 +218,9 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_input,
 
     assert(s != NULL);
     priv = vlc_stream_Private(p_demux);
+    priv->probes = 0;
+    priv->probe_time = 0;
+    priv->last_probe_time = 0;
 
     if (!strcasecmp( psz_demux, "any" ) || !psz_demux[0])
     {   /* Look up demux by mime-type for hard to detect formats */
@@ -242,18 +267,42 @@ demux_t *demux_NewAdvanced( vlc_object_t *p_obj, input_thread_t *p_input,
             psz_module = DemuxNameFromExtension( psz_ext + 1, b_preparsing );
     }
 
+    /* Try the demux matching the content first */
+    if( psz_module == NULL && !strcmp( p_demux->psz_name, "any" ) )
+    {
+        psz_module = DemuxNameFromContent( s );
+        if( psz_module != NULL && !b_preparsing )
+            msg_Dbg( p_obj, "content looks like \"%s\"", psz_module );
+    }
+
     if( psz_module == NULL )
         psz_module = p_demux->psz_name;
 
     priv->module = vlc_module_load(p_demux, "demux", psz_module,
         !strcmp(psz_module, p_demux->psz_name), demux_Probe, p_demux);
 
+    struct input_stats *stats = p_input ? input_priv(p_input)->stats : NULL;
+    if( stats != NULL )
+    {
+        atomic_fetch_add_explicit( &stats->demux_probes, priv->probes,
+                                   memory_order_relaxed );
+        atomic_fetch_add_explicit( &stats->demux_probe_time, priv->probe_time,
+                                   memory_order_relaxed );
+    }
+
     if (priv->module == NULL)
     {
         free( p_demux->psz_filepath );
         goto error;
     }
 
+    if( !b_preparsing )
+        msg_Dbg( p_obj, "demux \"%s\" probed in %"PRId64" us, after %u "
+                 "failed probe(s) in %"PRId64" us",
+                 module_get_object( priv->module ),
+                 US_FROM_VLC_TICK( priv->last_probe_time ), priv->probes - 1,
+                 US_FROM_VLC_TICK( priv->probe_time - priv->last_probe_time ) );
+
     return p_demux;
 error:
     free( p_demux->psz_name );
@@ -59,6 +59,19 @@ int demux_GetSeekpoint( demux_t * );
  */
 demux_t *demux_FilterChainNew( demux_t *source, const char *list ) VLC_USED;
 
+/** Number of bytes needed by demux_NameFromSignature() */
+#define DEMUX_SIGNATURE_PEEK 189
+
+/**
+ * Finds the demux matching the first bytes of a stream.
+ *
+ * Only unambiguous signatures are recognized. The returned demux is meant
+ * to be tried first, not to be forced.
+ *
+ * @return the demux short name, or NULL if no signature matches
+ */
+const char *demux_NameFromSignature( const uint8_t *p_peek, size_t i_peek );
+
 bool demux_FilterEnable( demux_t *p_demux_chain, const char* psz_demux );
 bool demux_FilterDisable( demux_t *p_demux_chain, const char* psz_demux );
 
@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * demux_signature.c: demux lookup from the stream content
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include "demux.h"
+
+typedef const struct
+{
+    struct
+    {
+        unsigned short offset;
+        unsigned char  size;
+        char const     bytes[8];
+    } magic[2]; /* all the non-empty parts must match */
+    char const name[8];
+
+} demux_signature;
+
+const char *demux_NameFromSignature( const uint8_t *p_peek, size_t i_peek )
+{
+    /* NOTE: Add only unambiguous signatures here. The matching demux is only
+     * tried first, the others are still probed if it fails.
+     *  - no RIFF/WAVE: es shall see a52 and dts stored as raw audio first,
+     *    like for the .wav extension
+     */
+    static demux_signature signatures[] =
+    {
+        { { { 0, 4, "\x1A\x45\xDF\xA3" } },            "mkv" },
+        { { { 0, 4, "OggS" } },                          "ogg" },
+        { { { 0, 4, "fLaC" } },                          "flac" },
+        { { { 4, 4, "ftyp" } },                          "mp4" },
+        { { { 4, 4, "moov" } },                          "mp4" },
+        { { { 0, 8, "\x30\x26\xB2\x75\x8E\x66\xCF\x11" } }, "asf" },
+        { { { 0, 4, "RIFF" }, { 8, 4, "AVI " } },        "avi" },
+        { { { 0, 4, "FORM" }, { 8, 4, "AIFF" } },        "aiff" },
+        { { { 0, 4, ".snd" } },                          "au" },
+        { { { 0, 4, "MThd" } },                          "smf" },
+        { { { 0, 8, "Creative" }, { 8, 8, " Voice F" } }, "voc" },
+        { { { 0, 4, "\x00\x00\x01\xBA" } },            "ps" },
+        { { { 0, 1, "\x47" }, { 188, 1, "\x47" } },      "ts" },
+    };
+
+    for( size_t i = 0; i < ARRAY_SIZE( signatures ); i++ )
+    {
+        bool b_match = true;
+
+        for( size_t j = 0; j < ARRAY_SIZE( signatures[i].magic ) && b_match; j++ )
+        {
+            unsigned offset = signatures[i].magic[j].offset;
+            unsigned size = signatures[i].magic[j].size;
+
+            assert( offset + size <= DEMUX_SIGNATURE_PEEK );
+            b_match = size == 0 ||
+                ( offset + size <= i_peek &&
+                  !memcmp( &p_peek[offset], signatures[i].magic[j].bytes, size ) );
+        }
+        if( b_match )
+            return signatures[i].name;
+    }
+    return NULL;
+}
@@ -82,8 +82,9 @@ typedef struct attribute_packed
 typedef struct attribute_packed
 {
     es_out_id_t *p_es;
-    block_t *p_block;
+    block_t *p_block;  /* NULL while stored */
     int     i_offset;  /* We do not use file > INT_MAX */
+    int     i_buffer;  /* Stored data size */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -172,6 +173,16 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Stored block record header, followed by the block data */
+typedef struct
+{
+    vlc_tick_t i_dts;
+    vlc_tick_t i_pts;
+    vlc_tick_t i_length;
+    uint32_t   i_flags;
+    uint32_t   i_nb_samples;
+} ts_block_header_t;
+
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -181,14 +192,15 @@ struct ts_storage_t
 #ifdef _WIN32
     char    *psz_file;  /* Filename */
 #endif
-    size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
+    int     fd;         /* File used as a ring of block records */
+    size_t  i_file_max; /* Ring size in bytes */
+    size_t  i_data_r;   /* Offset of the oldest record */
+    size_t  i_data_w;   /* Offset following the newest record */
+    int     i_data_count;
 
-    /* */
+    /* Commands ring, also indexing the block records */
     int      i_cmd_r;
-    int      i_cmd_w;
+    int      i_cmd_count;
     int      i_cmd_max;
     ts_cmd_t *p_cmd;
 };
@@ -280,7 +292,7 @@ static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
 static void CmdClean( ts_cmd_t * );
@@ -969,7 +981,7 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
     }
 
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_ts->p_storage_w, p_cmd );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -1204,22 +1216,6 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
 
-    p_storage->p_filew = fdopen( fd, "w+b" );
-    if( p_storage->p_filew == NULL )
-    {
-        vlc_close( fd );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-    p_storage->p_filer = vlc_fopen( psz_file, "rb" );
-    if( p_storage->p_filer == NULL )
-    {
-        fclose( p_storage->p_filew );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
 #ifndef _WIN32
     vlc_unlink( psz_file );
     free( psz_file );
@@ -1229,12 +1225,15 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
     p_storage->p_next = NULL;
 
     /* */
+    p_storage->fd = fd;
     p_storage->i_file_max = i_tmp_size_max;
-    p_storage->i_file_size = 0;
+    p_storage->i_data_r = 0;
+    p_storage->i_data_w = 0;
+    p_storage->i_data_count = 0;
 
     /* */
-    p_storage->i_cmd_w = 0;
     p_storage->i_cmd_r = 0;
+    p_storage->i_cmd_count = 0;
     p_storage->i_cmd_max = 30000;
     p_storage->p_cmd = vlc_alloc( p_storage->i_cmd_max, sizeof(*p_storage->p_cmd) );
     //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
@@ -1245,15 +1244,11 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
     return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
 }
 
 static void TsStorageDelete( ts_storage_t *p_storage )
 {
-    while( p_storage->i_cmd_r < p_storage->i_cmd_w )
+    while( p_storage->i_cmd_count > 0 )
     {
         ts_cmd_t cmd;
 
@@ -1263,8 +1258,7 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+    vlc_close( p_storage->fd );
 #ifdef _WIN32
     vlc_unlink( p_storage->psz_file );
     free( p_storage->psz_file );
@@ -1275,31 +1269,126 @@ static void TsStorageDelete( ts_storage_t *p_storage )
 static void TsStoragePack( ts_storage_t *p_storage )
 {
     /* Try to release a bit of memory */
-    if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
+    if( p_storage->i_cmd_count >= p_storage->i_cmd_max )
         return;
 
-    p_storage->i_cmd_max = __MAX( p_storage->i_cmd_w, 1 );
+    const int i_max = __MAX( p_storage->i_cmd_count, 1 );
+    ts_cmd_t *p_new = vlc_alloc( i_max, sizeof(*p_new) );
+    if( !p_new )
+        return;
 
-    ts_cmd_t *p_new = realloc( p_storage->p_cmd, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
-    if( p_new )
-        p_storage->p_cmd = p_new;
+    /* Unwrap the commands ring */
+    for( int i = 0; i < p_storage->i_cmd_count; i++ )
+        p_new[i] = p_storage->p_cmd[(p_storage->i_cmd_r + i) % p_storage->i_cmd_max];
+
+    free( p_storage->p_cmd );
+    p_storage->p_cmd = p_new;
+    p_storage->i_cmd_r = 0;
+    p_storage->i_cmd_max = i_max;
 }
+
+/* Finds room for a record of i_size bytes in the file ring. The file is
+ * used from its start whenever the ring is empty. */
+static bool TsStorageFindData( const ts_storage_t *p_storage, size_t i_size,
+                               size_t *pi_offset )
+{
+    if( p_storage->i_data_count == 0 )
+    {
+        /* A record bigger than the ring is still accepted alone */
+        *pi_offset = 0;
+        return true;
+    }
+
+    if( p_storage->i_data_w >= p_storage->i_data_r )
+    {
+        if( p_storage->i_data_w + i_size <= p_storage->i_file_max )
+        {
+            *pi_offset = p_storage->i_data_w;
+            return true;
+        }
+        /* Wrap around, the end of the file is left unused */
+        if( i_size < p_storage->i_data_r )
+        {
+            *pi_offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    if( p_storage->i_data_w + i_size < p_storage->i_data_r )
+    {
+        *pi_offset = p_storage->i_data_w;
+        return true;
+    }
+    return false;
+}
+
 static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
-    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
+    if( p_cmd && p_cmd->i_type == C_SEND )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_size = sizeof(ts_block_header_t) + p_cmd->u.send.p_block->i_buffer;
+        size_t i_offset;
 
-        if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
+        if( !TsStorageFindData( p_storage, i_size, &i_offset ) )
             return true;
     }
-    return p_storage->i_cmd_w >= p_storage->i_cmd_max;
+    return p_storage->i_cmd_count >= p_storage->i_cmd_max;
 }
 static bool TsStorageIsEmpty( ts_storage_t *p_storage )
 {
-    return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
+    return !p_storage || p_storage->i_cmd_count <= 0;
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+
+static int TsStorageWrite( int fd, const void *p_data, size_t i_data,
+                           size_t i_offset )
+{
+    const uint8_t *p = p_data;
+
+    while( i_data > 0 )
+    {
+#ifdef HAVE_PWRITE
+        ssize_t i_ret = pwrite( fd, p, i_data, i_offset );
+#else
+        ssize_t i_ret = -1;
+        if( lseek( fd, i_offset, SEEK_SET ) != (off_t)-1 )
+            i_ret = write( fd, p, i_data );
+#endif
+        if( i_ret < 0 && errno == EINTR )
+            continue;
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p += i_ret;
+        i_data -= i_ret;
+        i_offset += i_ret;
+    }
+    return VLC_SUCCESS;
+}
+static int TsStorageRead( int fd, void *p_data, size_t i_data, size_t i_offset )
+{
+    uint8_t *p = p_data;
+
+    while( i_data > 0 )
+    {
+#ifdef HAVE_PREAD
+        ssize_t i_ret = pread( fd, p, i_data, i_offset );
+#else
+        ssize_t i_ret = -1;
+        if( lseek( fd, i_offset, SEEK_SET ) != (off_t)-1 )
+            i_ret = read( fd, p, i_data );
+#endif
+        if( i_ret < 0 && errno == EINTR )
+            continue;
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p += i_ret;
+        i_data -= i_ret;
+        i_offset += i_ret;
+    }
+    return VLC_SUCCESS;
+}
+
+static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
 {
     ts_cmd_t cmd = *p_cmd;
 
@@ -1308,62 +1397,86 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
     if( cmd.i_type == C_SEND )
     {
         block_t *p_block = cmd.u.send.p_block;
-
-        cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
-
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
+        const ts_block_header_t header = {
+            .i_dts = p_block->i_dts,
+            .i_pts = p_block->i_pts,
+            .i_length = p_block->i_length,
+            .i_flags = p_block->i_flags,
+            .i_nb_samples = p_block->i_nb_samples,
+        };
+        const size_t i_size = sizeof(header) + p_block->i_buffer;
+        size_t i_offset;
+
+        if( !TsStorageFindData( p_storage, i_size, &i_offset )
+         || TsStorageWrite( p_storage->fd, &header, sizeof(header), i_offset )
+         || TsStorageWrite( p_storage->fd, p_block->p_buffer, p_block->i_buffer,
+                            i_offset + sizeof(header) ) )
         {
             block_Release( p_block );
             return;
         }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
-        {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
-        }
-        p_storage->i_file_size += p_block->i_buffer;
+
+        cmd.u.send.p_block = NULL;
+        cmd.u.send.i_offset = i_offset;
+        cmd.u.send.i_buffer = p_block->i_buffer;
         block_Release( p_block );
 
-        if( b_flush )
-            fflush( p_storage->p_filew );
+        if( p_storage->i_data_count++ == 0 )
+            p_storage->i_data_r = i_offset;
+        p_storage->i_data_w = i_offset + i_size;
     }
-    p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
+    p_storage->p_cmd[(p_storage->i_cmd_r + p_storage->i_cmd_count++)
+                     % p_storage->i_cmd_max] = cmd;
 }
 static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
 {
     assert( !TsStorageIsEmpty( p_storage ) );
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
+    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r];
+    p_storage->i_cmd_r = (p_storage->i_cmd_r + 1) % p_storage->i_cmd_max;
+    p_storage->i_cmd_count--;
+
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        const size_t i_offset = p_cmd->u.send.i_offset;
+        const size_t i_size = sizeof(ts_block_header_t) + p_cmd->u.send.i_buffer;
+        block_t *p_block = NULL;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+        if( !b_flush )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
+            /* Read the header and the data at once */
+            p_block = block_Alloc( i_size );
+            if( p_block &&
+                TsStorageRead( p_storage->fd, p_block->p_buffer, i_size, i_offset ) )
             {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+                //perror( "TsStoragePopCmd" );
+                block_Release( p_block );
+                p_block = block_Alloc( 1 );
+            }
+            else if( p_block )
+            {
+                ts_block_header_t header;
+
+                memcpy( &header, p_block->p_buffer, sizeof(header) );
+                p_block->p_buffer += sizeof(header);
+                p_block->i_buffer -= sizeof(header);
+                p_block->i_dts      = header.i_dts;
+                p_block->i_pts      = header.i_pts;
+                p_block->i_flags    = header.i_flags;
+                p_block->i_length   = header.i_length;
+                p_block->i_nb_samples = header.i_nb_samples;
             }
-            p_cmd->u.send.p_block = p_block;
         }
         else
         {
-            //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
+            p_block = block_Alloc( 1 );
         }
+        p_cmd->u.send.p_block = p_block;
+
+        /* Release the room of the record */
+        p_storage->i_data_r = i_offset + i_size;
+        if( --p_storage->i_data_count == 0 )
+            p_storage->i_data_r = p_storage->i_data_w = 0;
     }
 }
 
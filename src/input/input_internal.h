@@ -724,6 +724,8 @@ struct input_stats {
     input_rate_t demux_bitrate;
     atomic_uintmax_t demux_corrupted;
     atomic_uintmax_t demux_discontinuity;
+    atomic_uintmax_t demux_probes;
+    atomic_uintmax_t demux_probe_time;
     atomic_uintmax_t decoded_audio;
     atomic_uintmax_t decoded_video;
     atomic_uintmax_t played_abuffers;
@@ -61,6 +61,8 @@ struct input_stats *input_stats_Create(void)
     input_rate_Init(&stats->demux_bitrate);
     atomic_init(&stats->demux_corrupted, 0);
     atomic_init(&stats->demux_discontinuity, 0);
+    atomic_init(&stats->demux_probes, 0);
+    atomic_init(&stats->demux_probe_time, 0);
     atomic_init(&stats->decoded_audio, 0);
     atomic_init(&stats->decoded_video, 0);
     atomic_init(&stats->played_abuffers, 0);
@@ -92,6 +94,10 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                  memory_order_relaxed);
     st->i_demux_discontinuity = atomic_load_explicit(
                     &stats->demux_discontinuity, memory_order_relaxed);
+    st->i_demux_probes = atomic_load_explicit(&stats->demux_probes,
+                                              memory_order_relaxed);
+    st->i_demux_probe_time = atomic_load_explicit(&stats->demux_probe_time,
+                                                  memory_order_relaxed);
 
     /* Aout */
     st->i_decoded_audio = atomic_load_explicit(&stats->decoded_audio,
@@ -183,6 +183,15 @@ static int thumbnailer_request_Probe( void* owner, void* handle )
     return res;
 }
 
+static void thumbnailer_Idle( void* owner, unsigned count, vlc_tick_t duration )
+{
+    vlc_thumbnailer_t *thumbnailer = owner;
+
+    msg_Dbg( thumbnailer->parent, "thumbnailed %u item(s) in %"PRId64" ms "
+             "(%.1f items/s)", count, MS_FROM_VLC_TICK( duration ),
+             duration > 0 ? count * (double)CLOCK_FREQ / duration : 0. );
+}
+
 static vlc_thumbnailer_request_t*
 thumbnailer_RequestCommon( vlc_thumbnailer_t* thumbnailer,
                            const vlc_thumbnailer_params_t* params )
@@ -263,12 +272,13 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
     thumbnailer->parent = parent;
     struct background_worker_config cfg = {
         .default_timeout = -1,
-        .max_threads = 1,
+        .max_threads = var_InheritInteger( parent, "thumbnail-threads" ),
         .pf_release = thumbnailer_request_Release,
         .pf_hold = thumbnailer_request_Hold,
         .pf_start = thumbnailer_request_Start,
         .pf_probe = thumbnailer_request_Probe,
         .pf_stop = thumbnailer_request_Stop,
+        .pf_idle = thumbnailer_Idle,
     };
     thumbnailer->worker = background_worker_New( thumbnailer, &cfg );
     if ( unlikely( thumbnailer->worker == NULL ) )
@@ -401,6 +401,14 @@ static const char *const screensaver_texts[] = {
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define VIDEO_FILTER_THREADS_TEXT N_("Video filter threads")
+#define VIDEO_FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads used by video filters that can split their work " \
+    "in slices of lines, such as deinterlacing, denoising or image " \
+    "adjustment. The threads are shared by the filters of each video " \
+    "output. " \
+    "0 means one per CPU, 1 disables slice threading.")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -1102,6 +1110,14 @@ static const char *const ppsz_prefres[] = {
     "slow. You should only activate this if you know what you're " \
     "doing.")
 
+#define BLOCK_POOL_TEXT N_("Recycle data blocks")
+#define BLOCK_POOL_LONGTEXT N_( \
+    "Keep released data blocks in per-thread caches and reuse them for " \
+    "later allocations of the same size class, instead of going through " \
+    "the system memory allocator every time. This reduces allocation " \
+    "overhead with high packet rate inputs, at the expense of some " \
+    "memory.")
+
 #define RT_OFFSET_TEXT N_("Adjust VLC priority")
 #define RT_OFFSET_LONGTEXT N_( \
     "This option adds an offset (positive or negative) to VLC default " \
@@ -1216,6 +1232,10 @@ static const char *const clock_sources_text[] = {
 #define PREPARSE_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to preparse items" )
 
+#define THUMBNAIL_THREADS_TEXT N_( "Thumbnailing threads" )
+#define THUMBNAIL_THREADS_LONGTEXT N_( \
+    "Maximum number of threads used to generate thumbnails" )
+
 #define FETCH_ART_THREADS_TEXT N_( "Fetch-art threads" )
 #define FETCH_ART_THREADS_LONGTEXT N_( \
     "Maximum number of threads used to fetch art" )
@@ -1764,6 +1784,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list("video-filter", "video filter", NULL,
                     VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT)
+    add_integer_with_range( "video-filter-threads", 0, 0, 32,
+                            VIDEO_FILTER_THREADS_TEXT,
+                            VIDEO_FILTER_THREADS_LONGTEXT, true )
 
 #if 0
     add_string( "pixel-ratio", "1", PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT )
@@ -2174,6 +2197,9 @@ vlc_module_begin ()
                  RT_OFFSET_LONGTEXT, true )
 #endif
 
+    add_bool( "block-pool", false, BLOCK_POOL_TEXT,
+              BLOCK_POOL_LONGTEXT, true )
+
 #if defined(HAVE_DBUS)
     add_obsolete_bool( "inhibit" ) /* since 3.0.0 */
 #endif
@@ -2239,6 +2265,10 @@ vlc_module_begin ()
     add_integer( "preparse-threads", 1, PREPARSE_THREADS_TEXT,
                  PREPARSE_THREADS_LONGTEXT, false )
 
+    add_integer_with_range( "thumbnail-threads", 1, 1, 32,
+                            THUMBNAIL_THREADS_TEXT,
+                            THUMBNAIL_THREADS_LONGTEXT, false )
+
     add_integer( "fetch-art-threads", 1, FETCH_ART_THREADS_TEXT,
                  FETCH_ART_THREADS_LONGTEXT, false )
 
@@ -59,6 +59,7 @@
 #include <vlc_keystore.h>
 #include <vlc_fs.h>
 #include <vlc_cpu.h>
+#include <vlc_block.h>
 #include <vlc_url.h>
 #include <vlc_modules.h>
 #include <vlc_media_library.h>
@@ -97,6 +98,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->media_source_provider = NULL;
 
     vlc_ExitInit( &priv->exit );
+    vlc_list_init( &priv->cleanup_handlers );
 
     return p_libvlc;
 }
@@ -140,6 +142,9 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
 
     vlc_threads_setup (p_libvlc);
 
+    if (var_InheritBool(p_libvlc, "block-pool"))
+        block_PoolEnable(true);
+
     /* Load the builtins and plugins into the module_bank.
      * We have to do it before config_Load*() because this also gets the
      * list of configuration options exported by each module and loads their
@@ -433,6 +438,8 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if ( priv->p_media_library )
         libvlc_MlRelease( priv->p_media_library );
 
+    libvlc_CleanupHandlersRun( p_libvlc );
+
     libvlc_InternalActionsClean( p_libvlc );
 
     /* Save the configuration */
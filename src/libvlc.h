@@ -74,6 +74,8 @@ typedef struct vlc_exit
 
 void vlc_ExitInit( vlc_exit_t * );
 
+void libvlc_CleanupHandlersRun( libvlc_int_t * );
+
 /*
  * LibVLC objects stuff
  */
@@ -197,6 +199,9 @@ typedef struct libvlc_priv_t
 
     /* Exit callback */
     vlc_exit_t       exit;
+
+    /* Clean up callbacks, see libvlc_AddCleanupHandler() */
+    struct vlc_list cleanup_handlers;
 } libvlc_priv_t;
 
 static inline libvlc_priv_t *libvlc_priv (libvlc_int_t *libvlc)
@@ -53,6 +53,8 @@ struct background_worker {
     vlc_mutex_t lock;
 
     int uncompleted; /**< number of tasks requested but not completed */
+    unsigned batch_count; /**< number of tasks terminated since idle */
+    vlc_tick_t batch_start; /**< date of the first push since idle */
     int nthreads; /**< number of threads in the threads list */
     struct vlc_list threads; /**< list of active background_thread instances */
 
@@ -111,9 +113,11 @@ static void QueuePush(struct background_worker *worker, struct task *task)
     vlc_cond_signal(&worker->queue_wait);
 }
 
-static void QueueRemoveAll(struct background_worker *worker, void *id)
+/* return true if the removal completed the batch */
+static bool QueueRemoveAll(struct background_worker *worker, void *id)
 {
     vlc_mutex_assert(&worker->lock);
+    bool removed = false;
     struct task *task;
     vlc_list_foreach(task, &worker->queue, node)
     {
@@ -121,8 +125,12 @@ static void QueueRemoveAll(struct background_worker *worker, void *id)
         {
             vlc_list_remove(&task->node);
             task_Destroy(worker, task);
+            worker->uncompleted--;
+            assert(worker->uncompleted >= 0);
+            removed = true;
         }
     }
+    return removed && worker->uncompleted == 0;
 }
 
 static struct background_thread *
@@ -157,6 +165,8 @@ static struct background_worker *background_worker_Create(void *owner,
 
     vlc_mutex_init(&worker->lock);
     worker->uncompleted = 0;
+    worker->batch_count = 0;
+    worker->batch_start = VLC_TICK_INVALID;
     worker->nthreads = 0;
     vlc_list_init(&worker->threads);
     vlc_list_init(&worker->queue);
@@ -179,9 +189,16 @@ static void TerminateTask(struct background_thread *thread, struct task *task)
     thread->task = NULL;
     worker->uncompleted--;
     assert(worker->uncompleted >= 0);
+    worker->batch_count++;
+    bool idle = worker->uncompleted == 0;
+    unsigned count = worker->batch_count;
+    vlc_tick_t duration = vlc_tick_now() - worker->batch_start;
     vlc_mutex_unlock(&worker->lock);
 
     task_Destroy(worker, task);
+
+    if (idle && worker->conf.pf_idle)
+        worker->conf.pf_idle(worker->owner, count, duration);
 }
 
 static void RemoveThread(struct background_thread *thread)
@@ -296,6 +313,11 @@ int background_worker_Push( struct background_worker* worker, void* entity,
         return VLC_ENOMEM;
 
     vlc_mutex_lock(&worker->lock);
+    if (worker->uncompleted == 0)
+    {   /* start a new batch */
+        worker->batch_count = 0;
+        worker->batch_start = vlc_tick_now();
+    }
     QueuePush(worker, task);
     if (++worker->uncompleted > worker->nthreads
             && worker->nthreads < worker->conf.max_threads)
@@ -305,12 +327,12 @@ int background_worker_Push( struct background_worker* worker, void* entity,
     return VLC_SUCCESS;
 }
 
-static void BackgroundWorkerCancelLocked(struct background_worker *worker,
+static bool BackgroundWorkerCancelLocked(struct background_worker *worker,
                                          void *id)
 {
     vlc_mutex_assert(&worker->lock);
 
-    QueueRemoveAll(worker, id);
+    bool idle = QueueRemoveAll(worker, id);
 
     struct background_thread *thread;
     vlc_list_foreach(thread, &worker->threads, node)
@@ -321,13 +343,20 @@ static void BackgroundWorkerCancelLocked(struct background_worker *worker,
             vlc_cond_signal(&thread->probe_cancel_wait);
         }
     }
+    return idle;
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
 {
     vlc_mutex_lock(&worker->lock);
-    BackgroundWorkerCancelLocked(worker, id);
+    bool idle = BackgroundWorkerCancelLocked(worker, id);
+    unsigned count = worker->batch_count;
+    vlc_tick_t duration = vlc_tick_now() - worker->batch_start;
     vlc_mutex_unlock(&worker->lock);
+
+    /* no task was running, the batch will not be reported by TerminateTask() */
+    if (idle && worker->conf.pf_idle)
+        worker->conf.pf_idle(worker->owner, count, duration);
 }
 
 void background_worker_RequestProbe( struct background_worker* worker )
@@ -349,7 +378,9 @@ void background_worker_Delete( struct background_worker* worker )
     vlc_mutex_lock(&worker->lock);
 
     worker->closing = true;
-    BackgroundWorkerCancelLocked(worker, NULL);
+    bool idle = BackgroundWorkerCancelLocked(worker, NULL);
+    unsigned count = worker->batch_count;
+    vlc_tick_t duration = vlc_tick_now() - worker->batch_start;
     /* closing is now true, this will wake up any QueueTake() */
     vlc_cond_broadcast(&worker->queue_wait);
 
@@ -358,6 +389,9 @@ void background_worker_Delete( struct background_worker* worker )
 
     vlc_mutex_unlock(&worker->lock);
 
+    if (idle && worker->conf.pf_idle)
+        worker->conf.pf_idle(worker->owner, count, duration);
+
     /* no threads use the worker anymore, we can destroy it */
     background_worker_Destroy(worker);
 }
@@ -119,6 +119,19 @@ struct background_worker_config {
      * \parma handle the handle associated with the task to be stopped
      **/
     void( *pf_stop )( void* owner, void* handle );
+
+    /**
+     * Report a completed batch (optional, can be NULL)
+     *
+     * This callback is called when the last uncompleted task has terminated
+     * or has been canceled, i.e. when the background-worker becomes idle. A
+     * batch starts when a task is pushed to an idle background-worker.
+     *
+     * \param owner the owner of the background-worker
+     * \param count the number of tasks terminated during the batch
+     * \param duration the duration of the batch
+     **/
+    void( *pf_idle )( void* owner, unsigned count, vlc_tick_t duration );
 };
 
 /**
@@ -126,7 +139,8 @@ struct background_worker_config {
  *
  * This function creates a new background-worker using the passed configuration.
  *
- * \warning all members of `config` shall have been set by the caller.
+ * \warning all members of `config` shall have been set by the caller, only
+ *          \ref pf_idle can be NULL.
  * \warning the returned resource must be destroyed using \ref
  *          background_worker_Delete on success.
  *
@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -105,6 +106,238 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Block recycling pool
+ *
+ * When enabled, allocations that fit in one of the size classes are rounded
+ * up to the class size and recycled on release instead of being freed.
+ * Each thread keeps a small cache of free blocks per class, so that the
+ * common case takes no lock at all. Full thread caches spill half of their
+ * content to a shared depot, and empty ones refill from it, so that blocks
+ * flow back from consumer threads (decoders, outputs) to producer threads
+ * (access, demux) with one lock per batch rather than one per block.
+ */
+
+/** Smallest size class (including block_t header, alignment and padding) */
+#define BLOCK_POOL_MIN_SHIFT 9 /* 512 bytes */
+/** Number of size classes: 512 bytes to 128 KiB */
+#define BLOCK_POOL_CLASSES   9
+/** Maximum number of free blocks per class in a thread cache */
+#define BLOCK_POOL_CACHE_MAX 64
+/** Maximum number of bytes per class in a thread cache */
+#define BLOCK_POOL_CACHE_BYTES (1 << 20)
+/** Maximum number of bytes per class in the shared depot */
+#define BLOCK_POOL_DEPOT_BYTES (4 << 20)
+
+struct block_cache
+{
+    block_t *head[BLOCK_POOL_CLASSES];
+    unsigned count[BLOCK_POOL_CLASSES];
+};
+
+static struct
+{
+    atomic_bool enabled;
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_uint_fast64_t recycled;
+    atomic_uint_fast64_t dropped;
+
+    vlc_mutex_t lock;
+    struct block_cache depot;
+} block_pool = {
+    .enabled = false,
+    .lock = VLC_STATIC_MUTEX,
+};
+
+static vlc_threadvar_t block_cache_key;
+
+static size_t block_pool_ClassSize(unsigned cls)
+{
+    return (size_t)1 << (BLOCK_POOL_MIN_SHIFT + cls);
+}
+
+static unsigned block_pool_ClassMax(const struct block_cache *cache,
+                                    unsigned cls)
+{
+    unsigned max = ((cache == &block_pool.depot) ? BLOCK_POOL_DEPOT_BYTES
+                                                 : BLOCK_POOL_CACHE_BYTES)
+                   >> (BLOCK_POOL_MIN_SHIFT + cls);
+    if (cache != &block_pool.depot && max > BLOCK_POOL_CACHE_MAX)
+        max = BLOCK_POOL_CACHE_MAX;
+    return max;
+}
+
+/** Returns the size class for an allocation, or -1 if it does not fit. */
+static int block_pool_Class(size_t alloc)
+{
+    for (unsigned cls = 0; cls < BLOCK_POOL_CLASSES; cls++)
+        if (alloc <= block_pool_ClassSize(cls))
+            return cls;
+    return -1;
+}
+
+/** Moves up to count blocks of a class from one cache to another. */
+static void block_cache_Move(struct block_cache *restrict dst,
+                             struct block_cache *restrict src,
+                             unsigned cls, unsigned count)
+{
+    while (count > 0 && src->head[cls] != NULL)
+    {
+        block_t *b = src->head[cls];
+
+        src->head[cls] = b->p_next;
+        src->count[cls]--;
+        b->p_next = dst->head[cls];
+        dst->head[cls] = b;
+        dst->count[cls]++;
+        count--;
+    }
+}
+
+/** Frees blocks in excess of the cache bound. */
+static void block_cache_Trim(struct block_cache *cache, unsigned cls)
+{
+    unsigned max = block_pool_ClassMax(cache, cls);
+
+    while (cache->count[cls] > max)
+    {
+        block_t *b = cache->head[cls];
+
+        cache->head[cls] = b->p_next;
+        cache->count[cls]--;
+        free(b);
+        atomic_fetch_add_explicit(&block_pool.dropped, 1,
+                                  memory_order_relaxed);
+    }
+}
+
+static void block_cache_Destroy(void *data)
+{
+    struct block_cache *cache = data;
+
+    /* Hand the blocks of exiting threads over to the surviving ones. */
+    vlc_mutex_lock(&block_pool.lock);
+    for (unsigned cls = 0; cls < BLOCK_POOL_CLASSES; cls++)
+    {
+        block_cache_Move(&block_pool.depot, cache, cls, cache->count[cls]);
+        block_cache_Trim(&block_pool.depot, cls);
+    }
+    vlc_mutex_unlock(&block_pool.lock);
+    free(cache);
+}
+
+static void block_pool_InitOnce(void)
+{
+    if (vlc_threadvar_create(&block_cache_key, block_cache_Destroy))
+        abort();
+}
+
+static struct block_cache *block_cache_Get(void)
+{
+    static vlc_once_t once = VLC_STATIC_ONCE;
+
+    vlc_once(&once, block_pool_InitOnce);
+
+    struct block_cache *cache = vlc_threadvar_get(block_cache_key);
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc(1, sizeof (*cache));
+        if (likely(cache != NULL)
+         && unlikely(vlc_threadvar_set(block_cache_key, cache)))
+        {
+            free(cache);
+            cache = NULL;
+        }
+    }
+    return cache;
+}
+
+static block_t *block_pool_Get(unsigned cls)
+{
+    struct block_cache *cache = block_cache_Get();
+
+    if (likely(cache != NULL))
+    {
+        if (cache->head[cls] == NULL)
+        {   /* Refill half of the thread cache from the depot */
+            vlc_mutex_lock(&block_pool.lock);
+            block_cache_Move(cache, &block_pool.depot, cls,
+                             (block_pool_ClassMax(cache, cls) + 1) / 2);
+            vlc_mutex_unlock(&block_pool.lock);
+        }
+
+        block_t *b = cache->head[cls];
+        if (b != NULL)
+        {
+            cache->head[cls] = b->p_next;
+            cache->count[cls]--;
+            atomic_fetch_add_explicit(&block_pool.hits, 1,
+                                      memory_order_relaxed);
+            return b;
+        }
+    }
+
+    atomic_fetch_add_explicit(&block_pool.misses, 1, memory_order_relaxed);
+    return malloc(block_pool_ClassSize(cls));
+}
+
+static void block_pool_Release(block_t *block)
+{
+    assert(block->p_start == (unsigned char *)(block + 1));
+
+    struct block_cache *cache = NULL;
+    if (atomic_load_explicit(&block_pool.enabled, memory_order_relaxed))
+        cache = block_cache_Get();
+    if (unlikely(cache == NULL))
+    {
+        free(block);
+        atomic_fetch_add_explicit(&block_pool.dropped, 1,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    int cls = block_pool_Class(sizeof (*block) + block->i_size);
+    assert(cls >= 0);
+    assert(block_pool_ClassSize(cls) == sizeof (*block) + block->i_size);
+
+    block->p_next = cache->head[cls];
+    cache->head[cls] = block;
+    cache->count[cls]++;
+    atomic_fetch_add_explicit(&block_pool.recycled, 1, memory_order_relaxed);
+
+    unsigned max = block_pool_ClassMax(cache, cls);
+    if (cache->count[cls] > max)
+    {   /* Spill half of the thread cache to the depot */
+        vlc_mutex_lock(&block_pool.lock);
+        block_cache_Move(&block_pool.depot, cache, cls, (max + 1) / 2);
+        block_cache_Trim(&block_pool.depot, cls);
+        vlc_mutex_unlock(&block_pool.lock);
+    }
+}
+
+static const struct vlc_block_callbacks block_pool_cbs =
+{
+    block_pool_Release,
+};
+
+void block_PoolEnable(bool enable)
+{
+    atomic_store_explicit(&block_pool.enabled, enable, memory_order_relaxed);
+}
+
+void block_PoolGetStats(struct block_pool_stats *stats)
+{
+    stats->hits = atomic_load_explicit(&block_pool.hits,
+                                       memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&block_pool.misses,
+                                         memory_order_relaxed);
+    stats->recycled = atomic_load_explicit(&block_pool.recycled,
+                                           memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&block_pool.dropped,
+                                          memory_order_relaxed);
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -114,16 +347,30 @@ block_t *block_Alloc (size_t size)
     }
 
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    const struct vlc_block_callbacks *cbs = &block_generic_cbs;
+    block_t *b;
+    int cls = -1;
+
+    if (atomic_load_explicit(&block_pool.enabled, memory_order_relaxed))
+        cls = block_pool_Class(alloc);
+
+    if (cls >= 0)
+    {
+        alloc = block_pool_ClassSize(cls);
+        cbs = &block_pool_cbs;
+        b = block_pool_Get(cls);
+    }
+    else
+        b = malloc (alloc);
     if (unlikely(b == NULL))
         return NULL;
 
-    block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
+    block_Init(b, cbs, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
@@ -289,7 +536,8 @@ block_t *block_mmap_Alloc (void *addr, size_t length)
     block_t *block = malloc (sizeof (*block));
     if (block == NULL)
     {
-        munmap (addr, length);
+        /* addr need not be page aligned, unmap the whole mapping */
+        munmap (((char *)addr) - left, left + length + right);
         return NULL;
     }
 
@@ -48,6 +48,51 @@ void libvlc_SetExitHandler( libvlc_int_t *p_libvlc, void (*handler) (void *),
     vlc_mutex_unlock( &exit->lock );
 }
 
+struct vlc_cleanup_handler
+{
+    struct vlc_list node;
+    void (*handler)(void *);
+    void *opaque;
+};
+
+int libvlc_AddCleanupHandler( libvlc_int_t *p_libvlc,
+                              void (*handler) (void *), void *opaque )
+{
+    libvlc_priv_t *priv = libvlc_priv( p_libvlc );
+    struct vlc_cleanup_handler *h = malloc( sizeof (*h) );
+    if( unlikely(h == NULL) )
+        return VLC_ENOMEM;
+
+    h->handler = handler;
+    h->opaque = opaque;
+
+    vlc_mutex_lock( &priv->lock );
+    vlc_list_prepend( &h->node, &priv->cleanup_handlers );
+    vlc_mutex_unlock( &priv->lock );
+    return VLC_SUCCESS;
+}
+
+void libvlc_CleanupHandlersRun( libvlc_int_t *p_libvlc )
+{
+    libvlc_priv_t *priv = libvlc_priv( p_libvlc );
+    struct vlc_cleanup_handler *h;
+
+    for( ;; )
+    {
+        vlc_mutex_lock( &priv->lock );
+        h = vlc_list_first_entry_or_null( &priv->cleanup_handlers,
+                                          struct vlc_cleanup_handler, node );
+        if( h != NULL )
+            vlc_list_remove( &h->node );
+        vlc_mutex_unlock( &priv->lock );
+
+        if( h == NULL )
+            break;
+        h->handler( h->opaque );
+        free( h );
+    }
+}
+
 /**
  * Posts an exit signal to LibVLC instance.
  * This function should only be called on behalf of the user.
@@ -30,6 +30,7 @@
 #include <vlc_mouse.h>
 #include <vlc_spu.h>
 #include <libvlc.h>
+#include "modules/modules.h"
 #include <assert.h>
 
 typedef struct chained_filter_t
@@ -201,6 +202,39 @@ void filter_chain_Reset( filter_chain_t *p_chain,
     es_format_Copy( &p_chain->fmt_out, p_fmt_out );
 }
 
+#define FILTER_HINT_PARAMS 15
+
+/* Format properties identifying a conversion, for the converter hints */
+static void FilterHintParams( const es_format_t *fmt, uint32_t *params )
+{
+    if( fmt->i_cat == VIDEO_ES )
+    {
+        const video_format_t *v = &fmt->video;
+
+        params[0] = v->i_width;
+        params[1] = v->i_height;
+        params[2] = v->i_x_offset;
+        params[3] = v->i_y_offset;
+        params[4] = v->i_visible_width;
+        params[5] = v->i_visible_height;
+        params[6] = v->orientation;
+        params[7] = v->i_rmask;
+        params[8] = v->i_gmask;
+        params[9] = v->i_bmask;
+        params[10] = v->primaries;
+        params[11] = v->transfer;
+        params[12] = v->space;
+        params[13] = v->color_range;
+        params[14] = v->chroma_location;
+    }
+    else if( fmt->i_cat == AUDIO_ES )
+    {
+        params[0] = fmt->audio.i_rate;
+        params[1] = fmt->audio.i_physical_channels;
+        params[2] = fmt->audio.channel_type;
+    }
+}
+
 static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
     const char *name, const char *capability, config_chain_t *cfg,
     const es_format_t *fmt_out )
@@ -253,8 +287,35 @@ static filter_t *filter_chain_AppendInner( filter_chain_t *chain,
         sprintf( name_chained, "%s,chain", name );
         filter->p_module = module_need( filter, capability, name_chained, true );
     }
+    else if( name != NULL )
+        filter->p_module = module_need( filter, capability, name, true );
     else
-        filter->p_module = module_need( filter, capability, name, name != NULL );
+    {
+        /* Conversions between the same formats usually end up with the
+         * same module: try the last successful one first. The key holds
+         * the format properties the converters usually check. */
+        struct
+        {
+            uint32_t cat;
+            vlc_fourcc_t in, out;
+            uint32_t vctx;
+            uint32_t in_params[FILTER_HINT_PARAMS];
+            uint32_t out_params[FILTER_HINT_PARAMS];
+        } key;
+        static_assert( sizeof (key) <= 160, "converter hint key too long" );
+
+        memset( &key, 0, sizeof (key) );
+        key.cat = filter->fmt_in.i_cat;
+        key.in = filter->fmt_in.i_codec;
+        key.out = filter->fmt_out.i_codec;
+        if( filter->vctx_in != NULL )
+            key.vctx = 1 + vlc_video_context_GetType( filter->vctx_in );
+        FilterHintParams( &filter->fmt_in, key.in_params );
+        FilterHintParams( &filter->fmt_out, key.out_params );
+
+        filter->p_module = module_need_hinted( VLC_OBJECT(filter), capability,
+                                               &key, sizeof (key) );
+    }
 
     if( filter->p_module == NULL )
         goto error;
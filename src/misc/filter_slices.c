@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * filter_slices.c : threads pools for slice threaded video filters
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+
+#define SLICES_MAX_THREADS 32
+/* Slices per thread, so that uneven slices costs get balanced */
+#define SLICES_PER_THREAD  4
+
+struct vlc_filter_slices_job
+{
+    void (*cb)(void *, unsigned, unsigned);
+    void *opaque;
+    unsigned count;
+    unsigned slices;
+    atomic_uint next;
+    unsigned busy; /* workers inside the job, protected by the pool lock */
+};
+
+struct vlc_filter_slices
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+    vlc_cond_t done;
+    struct vlc_filter_slices_job *job;
+    bool quit;
+
+    vlc_object_t *owner; /* protected by slices_lock */
+    struct vlc_filter_slices *next;
+    unsigned refs;
+    unsigned threads;
+    vlc_thread_t thread[SLICES_MAX_THREADS];
+};
+
+/* One pool per owner of filters, e.g. per video output */
+static vlc_mutex_t slices_lock = VLC_STATIC_MUTEX;
+static struct vlc_filter_slices *slices_pools;
+
+static void JobProcess(struct vlc_filter_slices_job *job)
+{
+    for (;;)
+    {
+        unsigned slice = atomic_fetch_add_explicit(&job->next, 1,
+                                                   memory_order_relaxed);
+        if (slice >= job->slices)
+            break;
+
+        unsigned start = (uint64_t) job->count * slice / job->slices;
+        unsigned end = (uint64_t) job->count * (slice + 1) / job->slices;
+        if (start < end)
+            job->cb(job->opaque, start, end);
+    }
+}
+
+static bool JobPending(const struct vlc_filter_slices_job *job)
+{
+    return job != NULL &&
+           atomic_load_explicit(&job->next, memory_order_relaxed) < job->slices;
+}
+
+static void *Thread(void *data)
+{
+    struct vlc_filter_slices *pool = data;
+
+    vlc_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->quit && !JobPending(pool->job))
+            vlc_cond_wait(&pool->wait, &pool->lock);
+        if (pool->quit)
+            break;
+
+        struct vlc_filter_slices_job *job = pool->job;
+        job->busy++;
+        vlc_mutex_unlock(&pool->lock);
+
+        JobProcess(job);
+
+        vlc_mutex_lock(&pool->lock);
+        if (--job->busy == 0)
+            vlc_cond_signal(&pool->done);
+    }
+    vlc_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+#undef vlc_filter_slices_Hold
+vlc_filter_slices_t *vlc_filter_slices_Hold(vlc_object_t *obj)
+{
+    struct vlc_filter_slices *pool;
+    vlc_object_t *owner = vlc_object_parent(obj);
+
+    if (owner == NULL)
+        owner = obj;
+
+    vlc_mutex_lock(&slices_lock);
+    for (pool = slices_pools; pool != NULL; pool = pool->next)
+        if (pool->owner == owner)
+        {
+            pool->refs++;
+            goto out;
+        }
+
+    unsigned threads = var_InheritInteger(obj, "video-filter-threads");
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    /* the calling thread processes slices too */
+    threads = __MIN(threads, SLICES_MAX_THREADS + 1) - 1;
+    if (threads == 0)
+        goto out;
+
+    pool = malloc(sizeof (*pool));
+    if (unlikely(pool == NULL))
+        goto out;
+
+    vlc_mutex_init(&pool->lock);
+    vlc_cond_init(&pool->wait);
+    vlc_cond_init(&pool->done);
+    pool->job = NULL;
+    pool->quit = false;
+    pool->owner = owner;
+    pool->refs = 1;
+    pool->threads = 0;
+
+    while (pool->threads < threads)
+    {
+        if (vlc_clone(&pool->thread[pool->threads], Thread, pool,
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break;
+        pool->threads++;
+    }
+
+    if (pool->threads == 0)
+    {
+        free(pool);
+        pool = NULL;
+        goto out;
+    }
+
+    msg_Dbg(obj, "using %u video filter slice threads", pool->threads + 1);
+    pool->next = slices_pools;
+    slices_pools = pool;
+out:
+    vlc_mutex_unlock(&slices_lock);
+    return pool;
+}
+
+void vlc_filter_slices_Release(vlc_filter_slices_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+    vlc_mutex_lock(&slices_lock);
+    if (--pool->refs > 0)
+    {
+        vlc_mutex_unlock(&slices_lock);
+        return;
+    }
+
+    struct vlc_filter_slices **pp = &slices_pools;
+    while (*pp != pool)
+    {
+        assert(*pp != NULL);
+        pp = &(*pp)->next;
+    }
+    *pp = pool->next;
+    vlc_mutex_unlock(&slices_lock);
+
+    vlc_mutex_lock(&pool->lock);
+    pool->quit = true;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->threads; i++)
+        vlc_join(pool->thread[i], NULL);
+    free(pool);
+}
+
+void vlc_filter_slices_Run(vlc_filter_slices_t *pool, unsigned count,
+                           void (*cb)(void *, unsigned, unsigned),
+                           void *opaque)
+{
+    if (count == 0)
+        return;
+    if (pool == NULL || count == 1)
+    {
+        cb(opaque, 0, count);
+        return;
+    }
+
+    struct vlc_filter_slices_job job = {
+        .cb = cb,
+        .opaque = opaque,
+        .count = count,
+        .slices = __MIN(count, (pool->threads + 1) * SLICES_PER_THREAD),
+        .busy = 0,
+    };
+    atomic_init(&job.next, 0);
+
+    vlc_mutex_lock(&pool->lock);
+    if (pool->job != NULL)
+    {
+        /* Another filter is using the threads, do not wait for it */
+        vlc_mutex_unlock(&pool->lock);
+        cb(opaque, 0, count);
+        return;
+    }
+    pool->job = &job;
+    vlc_cond_broadcast(&pool->wait);
+    vlc_mutex_unlock(&pool->lock);
+
+    JobProcess(&job);
+
+    vlc_mutex_lock(&pool->lock);
+    while (job.busy > 0)
+        vlc_cond_wait(&pool->done, &pool->lock);
+    pool->job = NULL;
+    vlc_mutex_unlock(&pool->lock);
+}
@@ -126,29 +126,53 @@ static int module_load(vlc_logger_t *log, module_t *m,
     return ret;
 }
 
-/**
- * Finds and instantiates the best module of a certain type.
- * All candidates modules having the specified capability and name will be
- * sorted in decreasing order of priority. Then the probe callback will be
- * invoked for each module, until it succeeds (returns 0), or all candidate
- * module failed to initialize.
- *
- * The probe callback first parameter is the address of the module entry point.
- * Further parameters are passed as an argument list; it corresponds to the
- * variable arguments passed to this function. This scheme is meant to
- * support arbitrary prototypes for the module entry point.
- *
- * \param log logger (or NULL to ignore)
- * \param capability capability, i.e. class of module
- * \param name name of the module asked, if any
- * \param strict if true, do not fallback to plugin with a different name
- *                 but the same capability
- * \param probe module probe callback
- * \return the module or NULL in case of a failure
- */
-module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
-                            const char *name, bool strict,
-                            vlc_activate_t probe, ...)
+/* Memoised successful modules, see vlc_module_load_hinted() */
+#define MODULE_HINTS 64
+#define MODULE_HINT_CAP_MAX 32
+#define MODULE_HINT_KEY_MAX 160
+/* Number of uses of a hint before the whole score order is probed again */
+#define MODULE_HINT_USES 16
+
+struct module_hint
+{
+    char capability[MODULE_HINT_CAP_MAX];
+    unsigned char key[MODULE_HINT_KEY_MAX];
+    size_t keylen;
+    const module_t *module;
+    unsigned uses;
+};
+
+static struct
+{
+    vlc_mutex_t lock;
+    struct module_hint slots[MODULE_HINTS];
+} hints = { .lock = VLC_STATIC_MUTEX };
+
+static uint32_t module_hint_hash(const char *capability,
+                                 const void *key, size_t keylen)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)capability; *p; p++)
+        hash = (hash ^ *p) * 16777619u;
+    for (const unsigned char *p = key; keylen > 0; p++, keylen--)
+        hash = (hash ^ *p) * 16777619u;
+    return hash;
+}
+
+static bool module_hint_match(const struct module_hint *slot,
+                              const char *capability,
+                              const void *key, size_t keylen)
+{
+    return slot->module != NULL && slot->keylen == keylen
+        && !strcmp(slot->capability, capability)
+        && !memcmp(slot->key, key, keylen);
+}
+
+static module_t *module_load_list(struct vlc_logger *log,
+                                  const char *capability, const char *name,
+                                  bool strict, const module_t *hint,
+                                  vlc_activate_t probe, va_list args)
 {
     if (name == NULL || name[0] == '\0')
         name = "any";
@@ -167,9 +191,32 @@ module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
     }
 
     module_t *module = NULL;
-    va_list args;
 
-    va_start(args, probe);
+    /* Try the hinted module first, if it is still a candidate */
+    if (hint != NULL)
+    {
+        for (ssize_t i = 0; i < total; i++)
+        {
+            module_t *cand = mods[i];
+            if (cand != hint)
+                continue;
+            mods[i] = NULL;
+
+            vlc_debug(log, "trying hinted %s module \"%s\"", capability,
+                      module_get_object(cand));
+            int ret = module_load(log, cand, probe, false, args);
+            switch (ret)
+            {
+                case VLC_SUCCESS:
+                    module = cand;
+                    /* fall through */
+                case VLC_ETIMEOUT:
+                    goto done;
+            }
+            break;
+        }
+    }
+
     while (*name)
     {
         const char *shortcut = name;
@@ -224,7 +271,6 @@ module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
         }
     }
 done:
-    va_end (args);
     module_list_free (mods);
 
     if (module != NULL)
@@ -235,6 +281,94 @@ done:
     return module;
 }
 
+/**
+ * Finds and instantiates the best module of a certain type.
+ * All candidates modules having the specified capability and name will be
+ * sorted in decreasing order of priority. Then the probe callback will be
+ * invoked for each module, until it succeeds (returns 0), or all candidate
+ * module failed to initialize.
+ *
+ * The probe callback first parameter is the address of the module entry point.
+ * Further parameters are passed as an argument list; it corresponds to the
+ * variable arguments passed to this function. This scheme is meant to
+ * support arbitrary prototypes for the module entry point.
+ *
+ * \param log logger (or NULL to ignore)
+ * \param capability capability, i.e. class of module
+ * \param name name of the module asked, if any
+ * \param strict if true, do not fallback to plugin with a different name
+ *                 but the same capability
+ * \param probe module probe callback
+ * \return the module or NULL in case of a failure
+ */
+module_t *(vlc_module_load)(struct vlc_logger *log, const char *capability,
+                            const char *name, bool strict,
+                            vlc_activate_t probe, ...)
+{
+    va_list args;
+
+    va_start(args, probe);
+    module_t *module = module_load_list(log, capability, name, strict, NULL,
+                                        probe, args);
+    va_end(args);
+    return module;
+}
+
+module_t *vlc_module_load_hinted(struct vlc_logger *log,
+                                 const char *capability,
+                                 const void *key, size_t keylen,
+                                 vlc_activate_t probe, ...)
+{
+    /* Requests that do not fit in a slot are never hinted */
+    bool hintable = strlen(capability) < MODULE_HINT_CAP_MAX
+                 && keylen <= MODULE_HINT_KEY_MAX;
+    struct module_hint *slot = NULL;
+    const module_t *hint = NULL;
+
+    if (hintable)
+    {
+        slot = &hints.slots[module_hint_hash(capability, key, keylen)
+                            % MODULE_HINTS];
+
+        vlc_mutex_lock(&hints.lock);
+        /* Periodically ignore the hint, so that a candidate with a higher
+         * score, which failed when the hint was recorded, gets its rank
+         * back */
+        if (module_hint_match(slot, capability, key, keylen)
+         && ++slot->uses < MODULE_HINT_USES)
+            hint = slot->module;
+        vlc_mutex_unlock(&hints.lock);
+    }
+
+    va_list args;
+
+    va_start(args, probe);
+    module_t *module = module_load_list(log, capability, NULL, false, hint,
+                                        probe, args);
+    va_end(args);
+
+    /* Only record the outcome of the regular score order: the module is
+     * then the best candidate for this request. */
+    if (hintable && module != NULL && module != hint)
+    {
+        vlc_mutex_lock(&hints.lock);
+        strcpy(slot->capability, capability);
+        memcpy(slot->key, key, keylen);
+        slot->keylen = keylen;
+        slot->module = module;
+        slot->uses = 0;
+        vlc_mutex_unlock(&hints.lock);
+    }
+    else if (hint != NULL && module == NULL)
+    {
+        vlc_mutex_lock(&hints.lock);
+        if (slot->module == hint)
+            slot->module = NULL;
+        vlc_mutex_unlock(&hints.lock);
+    }
+    return module;
+}
+
 static int generic_start(void *func, bool forced, va_list ap)
 {
     vlc_object_t *obj = va_arg(ap, vlc_object_t *);
@@ -264,6 +398,21 @@ module_t *module_need(vlc_object_t *obj, const char *cap, const char *name,
     return module;
 }
 
+module_t *module_need_hinted(vlc_object_t *obj, const char *cap,
+                             const void *key, size_t keylen)
+{
+    const bool b_force_backup = obj->force; /* FIXME: remove this */
+    module_t *module = vlc_module_load_hinted(obj->logger, cap, key, keylen,
+                                              generic_start, obj);
+    if (module != NULL) {
+        var_Create(obj, "module-name", VLC_VAR_STRING);
+        var_SetString(obj, "module-name", module_get_object(module));
+    }
+
+    obj->force = b_force_backup;
+    return module;
+}
+
 #undef module_unneed
 void module_unneed(vlc_object_t *obj, module_t *module)
 {
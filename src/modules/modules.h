@@ -24,6 +24,7 @@
 # define LIBVLC_MODULES_H 1
 
 # include <stdatomic.h>
+# include <vlc_modules.h>
 
 /** VLC plugin */
 typedef struct vlc_plugin_t
@@ -115,6 +116,27 @@ void *module_Symbol(struct vlc_logger *, vlc_plugin_t *, const char *name);
 
 ssize_t module_list_cap (module_t ***, const char *);
 
+/**
+ * Loads the best module of a capability, without name nor strict matching,
+ * trying first the module that last succeeded for the same key.
+ *
+ * The key identifies the request (e.g. the formats of a filter); it is
+ * compared as raw bytes, so it must not contain padding or pointers, and
+ * it must be complete: the candidates the hint skips are assumed to fail
+ * for all the requests with the same key. The hint is only recorded from
+ * the regular score order, and that order is probed again every few uses.
+ * Keys longer than 160 bytes are never hinted.
+ */
+module_t *vlc_module_load_hinted(struct vlc_logger *, const char *cap,
+                                 const void *key, size_t keylen,
+                                 vlc_activate_t probe, ...) VLC_USED;
+
+/**
+ * module_need() counterpart of vlc_module_load_hinted().
+ */
+module_t *module_need_hinted(vlc_object_t *, const char *cap,
+                             const void *key, size_t keylen) VLC_USED;
+
 int vlc_bindtextdomain (const char *);
 
 /* Low-level OS-dependent handler */
@@ -408,7 +408,8 @@ static void WorkerInit( input_fetcher_t* fetcher,
         .pf_probe = ProbeWorker,
         .pf_stop = CloseWorker,
         .pf_release = RequestRelease,
-        .pf_hold = RequestHold };
+        .pf_hold = RequestHold,
+        .pf_idle = NULL };
 
     *worker = background_worker_New( fetcher, &conf );
 }
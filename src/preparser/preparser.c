@@ -220,6 +220,16 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
         req->cbs->on_preparse_ended(req->item, status, req->userdata);
 }
 
+static void PreparserIdle( void* preparser_, unsigned count,
+                           vlc_tick_t duration )
+{
+    input_preparser_t* preparser = preparser_;
+
+    msg_Dbg( preparser->owner, "preparsed %u item(s) in %"PRId64" ms "
+             "(%.1f items/s)", count, MS_FROM_VLC_TICK( duration ),
+             duration > 0 ? count * (double)CLOCK_FREQ / duration : 0. );
+}
+
 static void ReqHoldVoid(void *item) { ReqHold(item); }
 static void ReqReleaseVoid(void *item) { ReqRelease(item); }
 
@@ -234,7 +244,8 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
         .pf_probe = PreparserProbeInput,
         .pf_stop = PreparserCloseInput,
         .pf_release = ReqReleaseVoid,
-        .pf_hold = ReqHoldVoid
+        .pf_hold = ReqHoldVoid,
+        .pf_idle = PreparserIdle,
     };
 
 
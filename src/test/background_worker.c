@@ -0,0 +1,264 @@
+/*****************************************************************************
+ * background_worker.c: Test for the background-worker
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+
+#include "../libvlc.h"
+#include "../misc/background_worker.h"
+
+const char vlc_module_name[] = "test_background_worker";
+
+/* vlc_clone_detach() is not exported by libvlccore: worker threads are
+ * created here, and only started on demand so that the test controls when
+ * the queue is consumed. */
+static struct
+{
+    void *(*entry)(void *);
+    void *data;
+    vlc_thread_t th;
+    bool started;
+} threads[8];
+static unsigned thread_count;
+
+int vlc_clone_detach(vlc_thread_t *th, void *(*entry)(void *), void *data,
+                     int priority)
+{
+    (void) th; (void) priority;
+    assert(thread_count < ARRAY_SIZE(threads));
+    threads[thread_count].entry = entry;
+    threads[thread_count].data = data;
+    threads[thread_count].started = false;
+    thread_count++;
+    return 0;
+}
+
+static void StartThreads(void)
+{
+    for (unsigned i = 0; i < thread_count; i++)
+        if (!threads[i].started)
+        {
+            int ret = vlc_clone(&threads[i].th, threads[i].entry,
+                                threads[i].data, VLC_THREAD_PRIORITY_LOW);
+            assert(ret == 0);
+            threads[i].started = true;
+        }
+}
+
+static void JoinThreads(void)
+{
+    for (unsigned i = 0; i < thread_count; i++)
+    {
+        assert(threads[i].started);
+        vlc_join(threads[i].th, NULL);
+    }
+    thread_count = 0;
+}
+
+/* entities: "run" tasks keep running until canceled, others fail to start */
+static char run, fail;
+
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+static vlc_cond_t cond = VLC_STATIC_COND;
+static int holds;
+static unsigned started;
+static unsigned idle_calls;
+static unsigned idle_count;
+
+static void Hold(void *entity)
+{
+    (void) entity;
+    vlc_mutex_lock(&lock);
+    holds++;
+    vlc_mutex_unlock(&lock);
+}
+
+static void Release(void *entity)
+{
+    (void) entity;
+    vlc_mutex_lock(&lock);
+    holds--;
+    assert(holds >= 0);
+    vlc_mutex_unlock(&lock);
+}
+
+static int Start(void *owner, void *entity, void **out)
+{
+    (void) owner;
+    vlc_mutex_lock(&lock);
+    started++;
+    vlc_cond_broadcast(&cond);
+    vlc_mutex_unlock(&lock);
+
+    *out = entity;
+    return entity == &run ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+static int Probe(void *owner, void *handle)
+{
+    (void) owner; (void) handle;
+    return 0;
+}
+
+static void Stop(void *owner, void *handle)
+{
+    (void) owner; (void) handle;
+}
+
+static void Idle(void *owner, unsigned count, vlc_tick_t duration)
+{
+    (void) owner;
+    assert(duration >= 0);
+    vlc_mutex_lock(&lock);
+    idle_calls++;
+    idle_count = count;
+    vlc_cond_broadcast(&cond);
+    vlc_mutex_unlock(&lock);
+}
+
+static void WaitStarted(unsigned count)
+{
+    vlc_mutex_lock(&lock);
+    while (started < count)
+        vlc_cond_wait(&cond, &lock);
+    vlc_mutex_unlock(&lock);
+}
+
+static void WaitIdle(unsigned calls, unsigned count)
+{
+    vlc_mutex_lock(&lock);
+    while (idle_calls < calls)
+        vlc_cond_wait(&cond, &lock);
+    assert(idle_calls == calls);
+    assert(idle_count == count);
+    vlc_mutex_unlock(&lock);
+}
+
+static struct background_worker *Create(void)
+{
+    struct background_worker_config conf = {
+        .default_timeout = 0,
+        .max_threads = 1,
+        .pf_release = Release,
+        .pf_hold = Hold,
+        .pf_start = Start,
+        .pf_probe = Probe,
+        .pf_stop = Stop,
+        .pf_idle = Idle,
+    };
+
+    holds = 0;
+    started = 0;
+    idle_calls = 0;
+    idle_count = 0;
+
+    struct background_worker *worker = background_worker_New(NULL, &conf);
+    assert(worker != NULL);
+    return worker;
+}
+
+static void Delete(struct background_worker *worker)
+{
+    background_worker_Delete(worker);
+    JoinThreads();
+    assert(holds == 0);
+}
+
+/* canceling queued tasks while nothing runs completes the batch */
+static void test_cancel_queued(void)
+{
+    struct background_worker *worker = Create();
+    int id;
+
+    assert(background_worker_Push(worker, &run, &id, -1) == VLC_SUCCESS);
+    assert(background_worker_Push(worker, &run, &id, -1) == VLC_SUCCESS);
+    assert(thread_count == 1);
+
+    background_worker_Cancel(worker, &id);
+    WaitIdle(1, 0);
+    assert(holds == 0);
+
+    /* nothing is uncompleted anymore, this is a new batch */
+    assert(background_worker_Push(worker, &fail, NULL, -1) == VLC_SUCCESS);
+    StartThreads();
+    WaitIdle(2, 1);
+
+    Delete(worker);
+    assert(idle_calls == 2);
+}
+
+/* canceling queued tasks while one runs completes the batch once it ends */
+static void test_cancel_running(void)
+{
+    struct background_worker *worker = Create();
+    int id_run, id_queued;
+
+    assert(background_worker_Push(worker, &run, &id_run, -1) == VLC_SUCCESS);
+    StartThreads();
+    WaitStarted(1);
+
+    assert(background_worker_Push(worker, &run, &id_queued, -1)
+           == VLC_SUCCESS);
+    background_worker_Cancel(worker, &id_queued);
+    vlc_mutex_lock(&lock);
+    assert(idle_calls == 0);
+    vlc_mutex_unlock(&lock);
+
+    background_worker_Cancel(worker, &id_run);
+    WaitIdle(1, 1);
+
+    Delete(worker);
+    assert(idle_calls == 1);
+    assert(started == 1);
+}
+
+/* deleting a worker with running and queued tasks reports the batch once */
+static void test_delete_queued(void)
+{
+    struct background_worker *worker = Create();
+
+    assert(background_worker_Push(worker, &fail, NULL, -1) == VLC_SUCCESS);
+    assert(background_worker_Push(worker, &fail, NULL, -1) == VLC_SUCCESS);
+    StartThreads();
+    WaitIdle(1, 2);
+
+    assert(background_worker_Push(worker, &run, NULL, -1) == VLC_SUCCESS);
+    assert(background_worker_Push(worker, &run, NULL, -1) == VLC_SUCCESS);
+    WaitStarted(3);
+
+    Delete(worker);
+    assert(idle_calls == 2);
+    assert(idle_count == 1);
+}
+
+int main(void)
+{
+    test_cancel_queued();
+    test_cancel_running();
+    test_delete_queued();
+    return 0;
+}
@@ -29,6 +29,7 @@
 
 #include <vlc_common.h>
 #include <vlc_block.h>
+#include <vlc_tick.h>
 
 static const char text[] =
     "This is a test!\n"
@@ -86,11 +87,92 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+static void test_block_pool(void)
+{
+    struct block_pool_stats before, after;
+
+    block_PoolEnable(true);
+    block_PoolGetStats(&before);
+
+    block_t *block = block_Alloc(188 * 7);
+    assert(block != NULL);
+    assert(block->i_buffer == 188 * 7);
+    assert(((uintptr_t)block->p_buffer & 31) == 0);
+    memset(block->p_buffer, 0xAA, block->i_buffer);
+    block_Release(block);
+
+    /* Same size class: must be recycled from the thread cache */
+    block_t *again = block_Alloc(188 * 7 - 100);
+    assert(again == block);
+    assert(again->i_buffer == 188 * 7 - 100);
+    assert(again->i_flags == 0 && again->i_pts == VLC_TICK_INVALID);
+
+    again = block_Realloc(again, 0, 4096);
+    assert(again != NULL);
+    block_Release(again);
+
+    block_PoolGetStats(&after);
+    assert(after.hits > before.hits);
+    assert(after.recycled >= before.recycled + 2);
+
+    /* Too large for any size class: bypasses the pool */
+    block = block_Alloc(1 << 20);
+    assert(block != NULL);
+    block_Release(block);
+
+    block_PoolEnable(false);
+}
+
+#define BENCH_COUNT 200000
+
+static double bench_block_Alloc(void)
+{
+    static const size_t sizes[] = { 188, 1316, 1500, 4096, 9400, 65536 };
+    block_t *inflight[16] = { NULL };
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < BENCH_COUNT; i++)
+    {
+        unsigned slot = i % ARRAY_SIZE(inflight);
+
+        if (inflight[slot] != NULL)
+            block_Release(inflight[slot]);
+        inflight[slot] = block_Alloc(sizes[i % ARRAY_SIZE(sizes)]);
+        assert(inflight[slot] != NULL);
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(inflight); i++)
+        block_Release(inflight[i]);
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    if (elapsed <= 0)
+        elapsed = 1;
+    return (double)BENCH_COUNT * CLOCK_FREQ / elapsed;
+}
+
+static void bench_block_pool(void)
+{
+    block_PoolEnable(false);
+    double heap = bench_block_Alloc();
+    block_PoolEnable(true);
+    double pool = bench_block_Alloc();
+    block_PoolEnable(false);
+
+    struct block_pool_stats stats;
+    block_PoolGetStats(&stats);
+    printf("block_Alloc: heap %.0f allocs/s, pool %.0f allocs/s\n",
+           heap, pool);
+    printf("block pool: %"PRIu64" hits, %"PRIu64" misses, "
+           "%"PRIu64" recycled, %"PRIu64" dropped\n",
+           stats.hits, stats.misses, stats.recycled, stats.dropped);
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_pool();
+    bench_block_pool();
     return 0;
 }
 
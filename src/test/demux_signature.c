@@ -0,0 +1,94 @@
+/*****************************************************************************
+ * demux_signature.c: Test for the demux content signatures
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "../input/demux.h"
+
+const char vlc_module_name[] = "test_demux_signature";
+
+static const char *Sniff(const void *header, size_t header_size, size_t size)
+{
+    uint8_t buf[DEMUX_SIGNATURE_PEEK];
+
+    assert(header_size <= size && size <= sizeof (buf));
+    memset(buf, 0, sizeof (buf));
+    memcpy(buf, header, header_size);
+    return demux_NameFromSignature(buf, size);
+}
+
+static void test_match(const void *header, size_t header_size,
+                       const char *name)
+{
+    const char *res = Sniff(header, header_size, DEMUX_SIGNATURE_PEEK);
+
+    if (name == NULL)
+        assert(res == NULL);
+    else
+        assert(res != NULL && !strcmp(res, name));
+
+    /* a truncated signature never matches */
+    if (header_size > 0)
+        assert(Sniff(header, header_size - 1, header_size - 1) == NULL);
+}
+
+#define test(header, name) test_match(header, sizeof (header) - 1, name)
+
+int main(void)
+{
+    test("\x1A\x45\xDF\xA3", "mkv");
+    test("OggS", "ogg");
+    test("fLaC", "flac");
+    test("\0\0\0\x20" "ftyp", "mp4");
+    test("\0\0\0\x20" "moov", "mp4");
+    test("\x30\x26\xB2\x75\x8E\x66\xCF\x11", "asf");
+    test("RIFF\0\0\0\0AVI ", "avi");
+    test("FORM\0\0\0\0AIFF", "aiff");
+    test(".snd", "au");
+    test("MThd", "smf");
+    test("Creative Voice F", "voc");
+    test("\x00\x00\x01\xBA", "ps");
+
+    /* WAV may hold A52 or DTS as raw audio, left to the priority order */
+    test("RIFF\0\0\0\0WAVE", NULL);
+    /* other RIFF forms and mismatching second parts */
+    test("RIFF\0\0\0\0RMID", NULL);
+    test("FORM\0\0\0\0AIFC", NULL);
+    test("Creative Noise File", NULL);
+    test("", NULL);
+
+    /* MPEG-TS needs two sync bytes one packet apart */
+    uint8_t ts[DEMUX_SIGNATURE_PEEK] = { 0 };
+    ts[0] = 0x47;
+    assert(demux_NameFromSignature(ts, sizeof (ts)) == NULL);
+    ts[188] = 0x47;
+    assert(!strcmp(demux_NameFromSignature(ts, sizeof (ts)), "ts"));
+    assert(demux_NameFromSignature(ts, sizeof (ts) - 1) == NULL);
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * startup.c - libvlc instance creation benchmark
+ *
+ */
+
+/**********************************************************************
+ *  Copyright (C) 2020 VLC authors and VideoLAN                       *
+ *  This program is free software; you can redistribute and/or modify *
+ *  it under the terms of the GNU General Public License as published *
+ *  by the Free Software Foundation; version 2 of the license, or (at *
+ *  your option) any later version.                                   *
+ *                                                                    *
+ *  This program is distributed in the hope that it will be useful,   *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of    *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *  See the GNU General Public License for more details.              *
+ *                                                                    *
+ *  You should have received a copy of the GNU General Public License *
+ *  along with this program; if not, you can get it from:             *
+ *  http://www.gnu.org/copyleft/gpl.html                              *
+ **********************************************************************/
+
+#include "test.h"
+
+#include <inttypes.h>
+
+/* Each instance is released before the next one is created, so that the
+ * module bank (and its plugins cache) is loaded again every time, as with
+ * embedded short-lived instances. */
+static void test_startup (const char ** argv, int argc, unsigned count)
+{
+    int64_t total = 0, best = INT64_MAX;
+
+    test_log ("Creating %u instances\n", count);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        int64_t start = libvlc_clock ();
+        libvlc_instance_t *vlc = libvlc_new (argc, argv);
+        int64_t duration = libvlc_clock () - start;
+        assert (vlc != NULL);
+        libvlc_release (vlc);
+
+        total += duration;
+        if (duration < best)
+            best = duration;
+    }
+
+    test_log ("libvlc_new: %"PRId64" us average, %"PRId64" us best\n",
+              total / count, best);
+}
+
+int main (void)
+{
+    test_init ();
+
+    unsigned count = 20;
+    const char *str = getenv ("VLC_TEST_STARTUP_COUNT");
+    if (str != NULL && atoi (str) > 0)
+        count = atoi (str);
+
+    /* Quiet: logging would dominate the measure */
+    const char *argv[] = { "--vout=vdummy", "--quiet" };
+
+    test_startup (argv, 2, count);
+
+    return 0;
+}
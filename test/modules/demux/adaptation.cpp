@@ -0,0 +1,286 @@
+/*****************************************************************************
+ * adaptation.cpp: adaptive streaming logic and telemetry tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc/vlc.h>
+#include "../lib/libvlc_internal.h"
+
+#include "../modules/demux/adaptive/playlist/BasePeriod.h"
+#include "../modules/demux/adaptive/playlist/BaseAdaptationSet.h"
+#include "../modules/demux/adaptive/playlist/BaseRepresentation.h"
+#include "../modules/demux/adaptive/logic/HybridAdaptationLogic.hpp"
+#include "../modules/demux/adaptive/logic/AdaptationTelemetry.hpp"
+#include "../modules/demux/adaptive/SegmentTracker.hpp"
+#include "../modules/demux/adaptive/xml/Node.h"
+#include "../modules/demux/dash/mpd/IsoffMainParser.h"
+#include "../modules/demux/dash/mpd/MPD.h"
+
+using namespace adaptive;
+using namespace adaptive::logic;
+using namespace adaptive::playlist;
+
+const char vlc_module_name[] = "test_adaptation";
+
+static xml::Node *AddNode(xml::Node *parent, const char *name)
+{
+    xml::Node *node = new xml::Node();
+    node->setName(name);
+    if(parent)
+        parent->addSubNode(node);
+    return node;
+}
+
+static void AddRepresentation(xml::Node *set, const char *id, const char *bandwidth)
+{
+    xml::Node *rep = AddNode(set, "Representation");
+    rep->addAttribute("id", id);
+    rep->addAttribute("bandwidth", bandwidth);
+    xml::Node *tpl = AddNode(rep, "SegmentTemplate");
+    tpl->addAttribute("media", "$Number$.m4s");
+    tpl->addAttribute("timescale", "1");
+    tpl->addAttribute("duration", "2");
+}
+
+/* JSON escaped id of the highest representation */
+#define REP_ID_ESCAPED "hi\\\"gh\\\\\\u0009"
+
+/* one adaptation set of 500 kb/s, 1 Mb/s and 4 Mb/s */
+static dash::mpd::MPD *ParseMPD(vlc_object_t *obj, xml::Node **rootp)
+{
+    xml::Node *root = *rootp = AddNode(NULL, "MPD");
+    root->addAttribute("type", "static");
+    root->addAttribute("profiles", "urn:mpeg:dash:profile:isoff-live:2011");
+    root->addAttribute("mediaPresentationDuration", "PT60S");
+    xml::Node *period = AddNode(root, "Period");
+    xml::Node *set = AddNode(period, "AdaptationSet");
+    set->addAttribute("id", "video");
+    set->addAttribute("mimeType", "video/mp4");
+    AddRepresentation(set, "low", "500000");
+    AddRepresentation(set, "mid", "1000000");
+    AddRepresentation(set, "hi\"gh\\\t", "4000000");
+
+    dash::mpd::IsoffMainParser parser(root, obj, NULL, "http://example.com/vod.mpd");
+    dash::mpd::MPD *mpd = parser.parse();
+    assert(mpd != NULL);
+    return mpd;
+}
+
+static BaseAdaptationSet *GetAdaptationSet(dash::mpd::MPD *mpd)
+{
+    return mpd->getPeriods().front()->getAdaptationSets().front();
+}
+
+static BaseRepresentation *GetRepresentation(BaseAdaptationSet *set,
+                                             uint64_t bandwidth)
+{
+    const std::vector<BaseRepresentation *> &reps = set->getRepresentations();
+    for(size_t i = 0; i < reps.size(); i++)
+        if(reps[i]->getBandwidth() == bandwidth)
+            return reps[i];
+    abort();
+}
+
+static void SetBuffering(SegmentTrackerListenerInterface *listener,
+                         const ID &id, unsigned level)
+{
+    listener->trackerEvent(SegmentTrackerEvent(id, VLC_TICK_FROM_SEC(6),
+                                               VLC_TICK_FROM_SEC(level),
+                                               VLC_TICK_FROM_SEC(30)));
+}
+
+/* one second download at the given rate */
+static void Download(IDownloadRateObserver *observer, const ID &id,
+                     unsigned bps, const BaseRepresentation *rep = NULL)
+{
+    SegmentIdentity segment;
+    if(rep)
+    {
+        segment.representation = rep->getID().str();
+        segment.bandwidth = rep->getBandwidth();
+        segment.number = 3;
+        segment.duration = VLC_TICK_FROM_SEC(2);
+    }
+    observer->updateDownloadRate(id, bps / 8, VLC_TICK_FROM_SEC(1), segment);
+}
+
+static BaseRepresentation *Next(AbstractAdaptationLogic *logic,
+                                BaseAdaptationSet *set,
+                                BaseRepresentation *prev, const char *reason)
+{
+    BaseRepresentation *rep = logic->getNextRepresentation(set, prev);
+    assert(rep != NULL);
+    assert(!strcmp(logic->getDecisionReason(set->getID()), reason));
+    return rep;
+}
+
+static void test_hybrid(vlc_object_t *obj)
+{
+    xml::Node *root;
+    dash::mpd::MPD *mpd = ParseMPD(obj, &root);
+    BaseAdaptationSet *set = GetAdaptationSet(mpd);
+    const ID &id = set->getID();
+    BaseRepresentation *low = GetRepresentation(set, 500000);
+    BaseRepresentation *mid = GetRepresentation(set, 1000000);
+    BaseRepresentation *high = GetRepresentation(set, 4000000);
+
+    HybridAdaptationLogic *logic = new HybridAdaptationLogic(obj);
+    logic->trackerEvent(SegmentTrackerEvent(id, true));
+    assert(logic->getDecisionReason(id) == NULL);
+
+    /* nothing measured yet */
+    BaseRepresentation *rep = Next(logic, set, NULL, "startup");
+    assert(rep == low);
+    logic->trackerEvent(SegmentTrackerEvent(NULL, low));
+
+    /* 2.5 Mb/s allows the middle one, but not below the minimum buffering */
+    Download(logic, id, 2500000);
+    SetBuffering(logic, id, 2);
+    assert(Next(logic, set, low, "low-buffer") == low);
+    SetBuffering(logic, id, 8);
+    assert(Next(logic, set, low, "throughput") == mid);
+    logic->trackerEvent(SegmentTrackerEvent(low, mid));
+
+    /* buffer based from 10 s, it would pick the highest one, over the
+     * throughput */
+    SetBuffering(logic, id, 12);
+    assert(Next(logic, set, mid, "buffer-capped") == mid);
+
+    /* hysteresis: back to throughput only below 5 s, and to buffer based
+     * only from 10 s again */
+    SetBuffering(logic, id, 7);
+    assert(Next(logic, set, mid, "buffer-capped") == mid);
+    SetBuffering(logic, id, 4);
+    assert(Next(logic, set, mid, "throughput") == mid);
+    SetBuffering(logic, id, 8);
+    assert(Next(logic, set, mid, "throughput") == mid);
+
+    /* the buffer based choice is kept within the throughput */
+    delete logic;
+    logic = new HybridAdaptationLogic(obj);
+    logic->trackerEvent(SegmentTrackerEvent(id, true));
+    logic->trackerEvent(SegmentTrackerEvent(NULL, mid));
+    Download(logic, id, 10000000);
+    SetBuffering(logic, id, 12);
+    assert(Next(logic, set, mid, "buffer") == high);
+
+    /* the stream is gone */
+    logic->trackerEvent(SegmentTrackerEvent(id, false));
+    assert(logic->getDecisionReason(id) == NULL);
+
+    delete logic;
+    delete mpd;
+    delete root;
+}
+
+static void test_telemetry(vlc_object_t *obj)
+{
+    xml::Node *root;
+    dash::mpd::MPD *mpd = ParseMPD(obj, &root);
+    BaseAdaptationSet *set = GetAdaptationSet(mpd);
+    const ID &id = set->getID();
+    BaseRepresentation *mid = GetRepresentation(set, 1000000);
+    BaseRepresentation *high = GetRepresentation(set, 4000000);
+
+    char path[] = "/tmp/vlc-telemetry-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    HybridAdaptationLogic *logic = new HybridAdaptationLogic(obj);
+    AdaptationTelemetry *telemetry = new AdaptationTelemetry(obj, logic);
+    assert(telemetry->open(path));
+
+    /* the trackers notify both */
+    const SegmentTrackerEvent events[] = {
+        SegmentTrackerEvent(id, true),
+        SegmentTrackerEvent(NULL, mid),
+    };
+    for(size_t i = 0; i < ARRAY_SIZE(events); i++)
+    {
+        logic->trackerEvent(events[i]);
+        telemetry->trackerEvent(events[i]);
+    }
+
+    /* downloads are forwarded to the logic */
+    Download(telemetry, id, 10000000, mid);
+    SetBuffering(logic, id, 12);
+    SetBuffering(telemetry, id, 12);
+    BaseRepresentation *rep = Next(logic, set, mid, "buffer");
+    assert(rep == high);
+
+    const SegmentTrackerEvent switching(mid, high);
+    logic->trackerEvent(switching);
+    telemetry->trackerEvent(switching);
+    telemetry->trackerEvent(SegmentTrackerEvent(id, VLC_TICK_FROM_SEC(2)));
+    Download(telemetry, id, 8000000, high);
+    delete telemetry;
+    delete logic;
+
+    FILE *stream = fopen(path, "rt");
+    assert(stream != NULL);
+    char line[1024];
+    /* no decision was made for the first segment */
+    assert(fgets(line, sizeof(line), stream) != NULL);
+    assert(strstr(line, "\"stream\":\"video\",\"representation\":\"mid\","
+                        "\"segment\":3,\"bandwidth\":1000000,\"bytes\":1250000,"
+                        "\"download\":1000,\"duration\":2000,"
+                        "\"buffering\":0,\"target\":0,\"reason\":\"\"}\n"));
+    assert(fgets(line, sizeof(line), stream) != NULL);
+    assert(strstr(line, "\"representation\":\"" REP_ID_ESCAPED "\","
+                        "\"segment\":3,\"bandwidth\":4000000,\"bytes\":1000000,"
+                        "\"download\":1000,\"duration\":2000,"
+                        "\"buffering\":12000,\"target\":30000,"
+                        "\"reason\":\"buffer\"}\n"));
+    assert(fgets(line, sizeof(line), stream) == NULL);
+    fclose(stream);
+    unlink(path);
+
+    delete mpd;
+    delete root;
+}
+
+int main(int, char **)
+{
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    /* the playlists look up the options of the adaptive module */
+    vlc_object_t *obj = static_cast<vlc_object_t *>(
+            vlc_object_create(vlc->p_libvlc_int, sizeof(*obj)));
+    assert(obj != NULL);
+    var_Create(obj, "adaptive-lowlatency", VLC_VAR_BOOL);
+
+    test_hybrid(obj);
+    test_telemetry(obj);
+
+    vlc_object_delete(obj);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,395 @@
+/*****************************************************************************
+ * lowlatency.cpp: low latency HLS and DASH playlists parsing tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc/vlc.h>
+#include "../lib/libvlc_internal.h"
+
+#include "../modules/demux/adaptive/playlist/BasePeriod.h"
+#include "../modules/demux/adaptive/playlist/BaseAdaptationSet.h"
+#include "../modules/demux/adaptive/playlist/BaseRepresentation.h"
+#include "../modules/demux/adaptive/playlist/Segment.h"
+#include "../modules/demux/adaptive/xml/Node.h"
+#include "../modules/demux/hls/playlist/M3U8.hpp"
+#include "../modules/demux/hls/playlist/Parser.hpp"
+#include "../modules/demux/hls/playlist/Representation.hpp"
+#include "../modules/demux/dash/mpd/IsoffMainParser.h"
+#include "../modules/demux/dash/mpd/MPD.h"
+
+using namespace adaptive;
+using namespace adaptive::playlist;
+
+const char vlc_module_name[] = "test_lowlatency";
+
+static vlc_object_t *CreateObject(vlc_object_t *parent, bool lowlatency)
+{
+    vlc_object_t *obj =
+        static_cast<vlc_object_t *>(vlc_object_create(parent, sizeof(*obj)));
+    assert(obj != NULL);
+    var_Create(obj, "adaptive-lowlatency", VLC_VAR_BOOL);
+    var_SetBool(obj, "adaptive-lowlatency", lowlatency);
+    return obj;
+}
+
+/*
+ * HLS
+ */
+#define PLAYLIST_URL "http://example.com/live/index.m3u8"
+
+static const char playlist_head[] =
+    "#EXTM3U\n"
+    "#EXT-X-VERSION:6\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.0\n"
+    "#EXT-X-PART-INF:PART-TARGET=1.0\n";
+
+/* 11 is still being published, part 3 is hinted */
+static const char playlist_first[] =
+    "#EXT-X-MEDIA-SEQUENCE:10\n"
+    "#EXTINF:4.0,\n"
+    "seg10.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"1000@0\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"1200\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"800\",INDEPENDENT=YES\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg11.mp4\",BYTERANGE-START=3000,BYTERANGE-LENGTH=900\n";
+
+/* 11 is complete, and listed both as parts and as a full segment */
+static const char playlist_second[] =
+    "#EXT-X-MEDIA-SEQUENCE:10\n"
+    "#EXTINF:4.0,\n"
+    "seg10.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"1000@0\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"1200\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"800\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg11.mp4\",BYTERANGE=\"900\"\n"
+    "#EXTINF:4.0,\n"
+    "seg11.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg12.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg12.1.mp4\"\n";
+
+/* the parts of 11 are gone, only the full segment is left */
+static const char playlist_third[] =
+    "#EXT-X-MEDIA-SEQUENCE:11\n"
+    "#EXTINF:4.0,\n"
+    "seg11.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg12.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg12.1.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg12.2.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg12.3.mp4\"\n"
+    "#EXTINF:4.0,\n"
+    "seg12.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg13.0.mp4\",INDEPENDENT=YES\n";
+
+static stream_t *OpenPlaylist(vlc_object_t *obj, const char *body)
+{
+    const std::string text = std::string(playlist_head) + body;
+    /* the memory stream owns and frees the buffer */
+    char *buf = strdup(text.c_str());
+    assert(buf != NULL);
+    stream_t *s = vlc_stream_MemoryNew(obj, reinterpret_cast<uint8_t *>(buf),
+                                       text.length(), false);
+    assert(s != NULL);
+    return s;
+}
+
+static hls::playlist::M3U8 *ParsePlaylist(vlc_object_t *obj, const char *body,
+                                          const std::string &url)
+{
+    stream_t *s = OpenPlaylist(obj, body);
+    hls::playlist::M3U8Parser parser(NULL);
+    hls::playlist::M3U8 *playlist = parser.parse(obj, s, url);
+    vlc_stream_Delete(s);
+    assert(playlist != NULL);
+    return playlist;
+}
+
+static void ReloadPlaylist(vlc_object_t *obj, hls::playlist::Representation *rep,
+                           const char *body)
+{
+    stream_t *s = OpenPlaylist(obj, body);
+    hls::playlist::M3U8Parser parser(NULL);
+    parser.appendSegmentsFromPlaylist(obj, rep, s);
+    vlc_stream_Delete(s);
+}
+
+static hls::playlist::Representation *GetRepresentation(AbstractPlaylist *playlist)
+{
+    BasePeriod *period = playlist->getPeriods().front();
+    BaseAdaptationSet *set = period->getAdaptationSets().front();
+    BaseRepresentation *rep = set->getRepresentations().front();
+    return dynamic_cast<hls::playlist::Representation *>(rep);
+}
+
+static std::vector<uint64_t> GetNumbers(const BaseRepresentation *rep)
+{
+    std::vector<uint64_t> numbers;
+    uint64_t pos = 0, next;
+    bool gap;
+    while(rep->getNextSegment(SegmentInformation::INFOTYPE_MEDIA, pos, &next, &gap))
+    {
+        numbers.push_back(next);
+        pos = next + 1;
+    }
+    return numbers;
+}
+
+static bool CheckNumbers(const BaseRepresentation *rep,
+                         const uint64_t *expected, size_t count)
+{
+    const std::vector<uint64_t> numbers = GetNumbers(rep);
+    return numbers == std::vector<uint64_t>(expected, expected + count);
+}
+
+static void CheckRange(const BaseRepresentation *rep, uint64_t number,
+                       size_t start, size_t end)
+{
+    const ISegment *seg = rep->getSegment(SegmentInformation::INFOTYPE_MEDIA, number);
+    assert(seg != NULL);
+    assert(seg->getOffset() == start);
+    assert(seg->contains(end));
+    assert(!seg->contains(end + 1));
+}
+
+static void test_hls_parts(vlc_object_t *parent)
+{
+    vlc_object_t *obj = CreateObject(parent, true);
+    hls::playlist::M3U8 *playlist = ParsePlaylist(obj, playlist_first, PLAYLIST_URL);
+    hls::playlist::Representation *rep = GetRepresentation(playlist);
+    assert(rep != NULL);
+
+    /* parts are numbered media sequence * 1000 + part index, plus the
+     * first segment number */
+    static const uint64_t first[] = { 10001, 11001, 11002, 11003, 11004 };
+    assert(CheckNumbers(rep, first, ARRAY_SIZE(first)));
+    assert(playlist->targetLatency.Get() == VLC_TICK_FROM_SEC(3));
+    assert(playlist->isLowLatency());
+
+    /* byte ranges without offset follow the previous part */
+    CheckRange(rep, 11001, 0, 999);
+    CheckRange(rep, 11002, 1000, 2199);
+    CheckRange(rep, 11003, 2200, 2999);
+    CheckRange(rep, 11004, 3000, 3899);
+
+    /* start on the last independent part before the latency target */
+    uint64_t start = rep->getLiveStartSegmentNumber(0);
+    assert(start == 11001);
+
+    /* blocking reload of the hinted part, only once out of buffer */
+    rep->scheduleNextUpdate(start);
+    assert(rep->getUpdateUrl() == PLAYLIST_URL);
+    rep->scheduleNextUpdate(11004);
+    assert(rep->getUpdateUrl() == PLAYLIST_URL "?_HLS_msn=11&_HLS_part=3");
+
+    /* parts are not listed twice with their full segment */
+    ReloadPlaylist(obj, rep, playlist_second);
+    static const uint64_t second[] = { 10001, 11001, 11002, 11003, 11004,
+                                       12001, 12002 };
+    assert(CheckNumbers(rep, second, ARRAY_SIZE(second)));
+    assert(rep->getMinAheadTime(10001) == VLC_TICK_FROM_SEC(6));
+    CheckRange(rep, 11004, 3000, 3899);
+    rep->scheduleNextUpdate(12002);
+    assert(rep->getUpdateUrl() == PLAYLIST_URL "?_HLS_msn=12&_HLS_part=1");
+
+    /* the next media sequence is not a gap */
+    uint64_t next;
+    bool gap;
+    assert(rep->getNextSegment(SegmentInformation::INFOTYPE_MEDIA, 11005,
+                               &next, &gap) != NULL);
+    assert(next == 12001 && !gap);
+
+    /* full segments do not replace the parts already listed */
+    ReloadPlaylist(obj, rep, playlist_third);
+    static const uint64_t third[] = { 11001, 11002, 11003, 11004,
+                                      12001, 12002, 12003, 12004, 13001 };
+    assert(CheckNumbers(rep, third, ARRAY_SIZE(third)));
+    assert(rep->getMinAheadTime(11001) == VLC_TICK_FROM_SEC(8));
+    CheckRange(rep, 11001, 0, 999);
+    /* no hint: wait for the part following the listed ones */
+    rep->scheduleNextUpdate(13001);
+    assert(rep->getUpdateUrl() == PLAYLIST_URL "?_HLS_msn=13&_HLS_part=1");
+
+    delete playlist;
+    vlc_object_delete(obj);
+}
+
+static void test_hls_query(vlc_object_t *parent)
+{
+    vlc_object_t *obj = CreateObject(parent, true);
+    hls::playlist::M3U8 *playlist = ParsePlaylist(obj, playlist_first,
+                                                  PLAYLIST_URL "?token=abc");
+    hls::playlist::Representation *rep = GetRepresentation(playlist);
+    assert(rep != NULL);
+
+    rep->scheduleNextUpdate(11004);
+    assert(rep->getUpdateUrl() ==
+           PLAYLIST_URL "?token=abc&_HLS_msn=11&_HLS_part=3");
+
+    delete playlist;
+    vlc_object_delete(obj);
+}
+
+static void test_hls_disabled(vlc_object_t *parent)
+{
+    vlc_object_t *obj = CreateObject(parent, false);
+    hls::playlist::M3U8 *playlist = ParsePlaylist(obj, playlist_second, PLAYLIST_URL);
+    hls::playlist::Representation *rep = GetRepresentation(playlist);
+    assert(rep != NULL);
+
+    /* parts are ignored, and segments are numbered from their media sequence */
+    static const uint64_t numbers[] = { 11, 12 };
+    assert(CheckNumbers(rep, numbers, ARRAY_SIZE(numbers)));
+    assert(!playlist->isLowLatency());
+
+    rep->scheduleNextUpdate(11);
+    assert(rep->getUpdateUrl() == PLAYLIST_URL);
+
+    delete playlist;
+    vlc_object_delete(obj);
+}
+
+/*
+ * DASH
+ */
+static xml::Node *AddNode(xml::Node *parent, const char *name)
+{
+    xml::Node *node = new xml::Node();
+    node->setName(name);
+    if(parent)
+        parent->addSubNode(node);
+    return node;
+}
+
+/* live template of 1 second segments */
+static xml::Node *BuildMPD(const char *latency, const char *ato)
+{
+    xml::Node *root = AddNode(NULL, "MPD");
+    root->addAttribute("type", "dynamic");
+    root->addAttribute("profiles", "urn:mpeg:dash:profile:isoff-live:2011");
+    root->addAttribute("availabilityStartTime", "2020-01-01T00:00:00Z");
+
+    if(latency)
+    {
+        xml::Node *desc = AddNode(root, "ServiceDescription");
+        AddNode(desc, "Latency")->addAttribute("target", latency);
+    }
+
+    xml::Node *period = AddNode(root, "Period");
+    period->addAttribute("start", "PT0S");
+    xml::Node *set = AddNode(period, "AdaptationSet");
+    set->addAttribute("mimeType", "video/mp4");
+    xml::Node *rep = AddNode(set, "Representation");
+    rep->addAttribute("id", "video");
+    rep->addAttribute("bandwidth", "1000000");
+    xml::Node *tpl = AddNode(rep, "SegmentTemplate");
+    tpl->addAttribute("media", "$Number$.m4s");
+    tpl->addAttribute("timescale", "1");
+    tpl->addAttribute("duration", "1");
+    if(ato)
+        tpl->addAttribute("availabilityTimeOffset", ato);
+    return root;
+}
+
+static dash::mpd::MPD *ParseMPD(vlc_object_t *obj, xml::Node *root)
+{
+    dash::mpd::IsoffMainParser parser(root, obj, NULL, "http://example.com/live.mpd");
+    dash::mpd::MPD *mpd = parser.parse();
+    assert(mpd != NULL);
+    return mpd;
+}
+
+static vlc_tick_t MinAhead(dash::mpd::MPD *mpd)
+{
+    BasePeriod *period = mpd->getPeriods().front();
+    BaseRepresentation *rep = period->getAdaptationSets().front()
+                                    ->getRepresentations().front();
+    return rep->getMinAheadTime(1);
+}
+
+static void test_dash(vlc_object_t *parent)
+{
+    vlc_object_t *obj = CreateObject(parent, true);
+    vlc_object_t *objoff = CreateObject(parent, false);
+
+    /* the service description sets the latency target */
+    xml::Node *root = BuildMPD("1500", NULL);
+    dash::mpd::MPD *mpd = ParseMPD(obj, root);
+    assert(mpd->targetLatency.Get() == VLC_TICK_FROM_MS(1500));
+    assert(mpd->isLowLatency());
+    assert(mpd->getMinBuffering() == VLC_TICK_FROM_MS(750));
+    vlc_tick_t ahead = MinAhead(mpd);
+    delete mpd;
+    delete root;
+
+    /* the availability offset alone sets a default target */
+    root = BuildMPD(NULL, "10");
+    mpd = ParseMPD(obj, root);
+    assert(mpd->targetLatency.Get() == VLC_TICK_FROM_SEC(3));
+    assert(mpd->isLowLatency());
+
+    /* segments are available that much before their end */
+    vlc_tick_t diff = MinAhead(mpd) - ahead;
+    assert(diff >= VLC_TICK_FROM_SEC(9) && diff <= VLC_TICK_FROM_SEC(11));
+    delete mpd;
+
+    /* unless low latency is disabled */
+    mpd = ParseMPD(objoff, root);
+    assert(!mpd->isLowLatency());
+    diff = MinAhead(mpd) - ahead;
+    assert(diff >= VLC_TICK_FROM_SEC(-1) && diff <= VLC_TICK_FROM_SEC(1));
+    delete mpd;
+    delete root;
+
+    /* INF means no chunked availability */
+    root = BuildMPD(NULL, "INF");
+    mpd = ParseMPD(obj, root);
+    assert(mpd->targetLatency.Get() == 0);
+    assert(!mpd->isLowLatency());
+    delete mpd;
+    delete root;
+
+    vlc_object_delete(objoff);
+    vlc_object_delete(obj);
+}
+
+int main(int, char **)
+{
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    test_hls_parts(obj);
+    test_hls_query(obj);
+    test_hls_disabled(obj);
+    test_dash(obj);
+
+    libvlc_release(vlc);
+    return 0;
+}
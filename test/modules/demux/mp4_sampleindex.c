@@ -0,0 +1,455 @@
+/*****************************************************************************
+ * mp4_sampleindex.c: MP4 lazy chunk times and sample index tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc/vlc.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../../modules/demux/mp4/sampleindex.h"
+
+const char vlc_module_name[] = "test_mp4_sampleindex";
+
+#define CHUNKS  200
+#define STTS    197
+#define CTTS    61
+
+/* Tables of the test track, and their expansion per sample */
+static uint32_t stts_count[STTS];
+static int32_t  stts_delta[STTS];
+static uint32_t ctts_count[CTTS];
+static int32_t  ctts_offset[CTTS];
+static uint32_t *sizes;
+static uint32_t *sample_delta;
+static int32_t  *sample_offset;
+static uint32_t samples;
+
+static void BuildTables(void)
+{
+    uint32_t count = 0;
+    for (unsigned i = 0; i < STTS; i++)
+    {
+        stts_count[i] = (i % 4) + 1;
+        stts_delta[i] = 10 * (i + 1);
+        count += stts_count[i];
+    }
+    samples = count;
+
+    /* the last ctts entry covers the remaining samples */
+    count = 0;
+    for (unsigned i = 0; i < CTTS; i++)
+    {
+        ctts_count[i] = i + 1 < CTTS ? (i % 3) + 1 : samples - count;
+        ctts_offset[i] = 3 * i - 20;
+        count += ctts_count[i];
+    }
+    assert(count == samples);
+
+    sizes = malloc(samples * sizeof (*sizes));
+    sample_delta = malloc(samples * sizeof (*sample_delta));
+    sample_offset = malloc(samples * sizeof (*sample_offset));
+    assert(sizes && sample_delta && sample_offset);
+
+    uint32_t s = 0;
+    for (unsigned i = 0; i < STTS; i++)
+        for (uint32_t j = 0; j < stts_count[i]; j++)
+            sample_delta[s++] = stts_delta[i];
+    s = 0;
+    for (unsigned i = 0; i < CTTS; i++)
+        for (uint32_t j = 0; j < ctts_count[i]; j++)
+            sample_offset[s++] = ctts_offset[i];
+    for (s = 0; s < samples; s++)
+        sizes[s] = 100 + s;
+}
+
+/* Position of a sample in a time to sample table, as recorded in chunks */
+static void Locate(const uint32_t *table_count, uint32_t sample,
+                   uint32_t *index, uint32_t *left)
+{
+    uint32_t i = 0;
+    while (sample >= table_count[i])
+        sample -= table_count[i++];
+    *index = i;
+    *left = sample ? table_count[i] - sample : 0;
+}
+
+static uint32_t Entries(const uint32_t *table_count, uint32_t first,
+                        uint32_t count)
+{
+    uint32_t first_index, last_index, left;
+    Locate(table_count, first, &first_index, &left);
+    Locate(table_count, first + count - 1, &last_index, &left);
+    return last_index - first_index + 1;
+}
+
+static void SetupTrack(mp4_track_t *track, unsigned id)
+{
+    memset(track, 0, sizeof (*track));
+    track->i_track_ID = id;
+    track->i_sample_count = samples;
+    track->p_sample_size = sizes;
+    track->tables.i_sizes_count = samples;
+    track->tables.i_stts_count = STTS;
+    track->tables.p_stts_count = stts_count;
+    track->tables.p_stts_delta = stts_delta;
+    track->tables.i_ctts_count = CTTS;
+    track->tables.p_ctts_count = ctts_count;
+    track->tables.p_ctts_offset = ctts_offset;
+    track->tables.i_cts_shift = 20;
+
+    track->i_chunk_count = CHUNKS;
+    track->chunk = calloc(CHUNKS, sizeof (*track->chunk));
+    assert(track->chunk != NULL);
+
+    /* chunks of 1 to 3 samples, the last one takes the remaining ones */
+    uint32_t first = 0;
+    uint64_t dts = 0;
+    for (unsigned i = 0; i < CHUNKS; i++)
+    {
+        mp4_chunk_t *ck = &track->chunk[i];
+
+        ck->i_offset = 1000 * i;
+        ck->i_sample_description_index = 1;
+        ck->i_sample_first = first;
+        ck->i_sample_count = i + 1 < CHUNKS ? (i % 3) + 1 : samples - first;
+        ck->i_first_dts = dts;
+        for (uint32_t s = 0; s < ck->i_sample_count; s++)
+            ck->i_duration += sample_delta[first + s];
+        dts += ck->i_duration;
+
+        Locate(stts_count, first, &ck->i_stts_index, &ck->i_stts_left);
+        Locate(ctts_count, first, &ck->i_ctts_index, &ck->i_ctts_left);
+        ck->i_entries_dts = Entries(stts_count, first, ck->i_sample_count);
+        ck->i_entries_pts = Entries(ctts_count, first, ck->i_sample_count);
+        first += ck->i_sample_count;
+    }
+    assert(first == samples);
+}
+
+static void CleanTrack(mp4_track_t *track)
+{
+    for (unsigned i = 0; i < track->i_chunk_count; i++)
+        MP4_ChunkTimes_Release(&track->chunk[i]);
+    free(track->chunk);
+}
+
+/* The loaded tables of a chunk expand to the tables of its samples */
+static void CheckChunkTimes(const mp4_track_t *track, unsigned i)
+{
+    const mp4_chunk_t *ck = &track->chunk[i];
+    uint32_t s = ck->i_sample_first;
+
+    assert(ck->p_sample_count_dts != NULL && ck->p_sample_count_pts != NULL);
+    for (uint32_t e = 0; e < ck->i_entries_dts; e++)
+    {
+        assert(ck->p_sample_count_dts[e] > 0);
+        for (uint32_t j = 0; j < ck->p_sample_count_dts[e]; j++)
+            assert(ck->p_sample_delta_dts[e] == sample_delta[s++]);
+    }
+    assert(s == ck->i_sample_first + ck->i_sample_count);
+
+    s = ck->i_sample_first;
+    for (uint32_t e = 0; e < ck->i_entries_pts; e++)
+    {
+        assert(ck->p_sample_count_pts[e] > 0);
+        for (uint32_t j = 0; j < ck->p_sample_count_pts[e]; j++)
+            assert(ck->p_sample_offset_pts[e] == sample_offset[s++] + 20);
+    }
+    assert(s == ck->i_sample_first + ck->i_sample_count);
+}
+
+static void test_next_run(void)
+{
+    const uint32_t counts[] = { 3, 2, 4 };
+    uint32_t index = 0, left = 0, entry;
+
+    /* chunk of 4 samples: the whole first entry and a part of the second */
+    uint32_t count = 4;
+    assert(MP4_ChunkTimes_NextRun(counts, &index, &left, &count, &entry) == 3);
+    assert(entry == 0 && index == 1 && left == 0 && count == 1);
+    assert(MP4_ChunkTimes_NextRun(counts, &index, &left, &count, &entry) == 1);
+    assert(entry == 1 && index == 1 && left == 1 && count == 0);
+
+    /* next chunk of 5 samples: the rest of the second entry, then the third */
+    count = 5;
+    assert(MP4_ChunkTimes_NextRun(counts, &index, &left, &count, &entry) == 1);
+    assert(entry == 1 && index == 2 && left == 0 && count == 4);
+    assert(MP4_ChunkTimes_NextRun(counts, &index, &left, &count, &entry) == 4);
+    assert(entry == 2 && index == 3 && left == 0 && count == 0);
+}
+
+static void test_lazy_chunk_times(vlc_object_t *obj)
+{
+    mp4_track_t track;
+    SetupTrack(&track, 1);
+
+    for (unsigned i = 0; i < CHUNKS; i++)
+    {
+        track.i_chunk = i;
+        assert(MP4_ChunkTimes_Load(obj, &track, i) == VLC_SUCCESS);
+        CheckChunkTimes(&track, i);
+        /* loading twice is a no-op */
+        assert(MP4_ChunkTimes_Load(obj, &track, i) == VLC_SUCCESS);
+        CheckChunkTimes(&track, i);
+    }
+    /* out of range chunks are ignored */
+    assert(MP4_ChunkTimes_Load(obj, &track, CHUNKS) == VLC_SUCCESS);
+
+    /* only the chunks around the last loaded one are kept */
+    unsigned loaded = 0;
+    for (unsigned i = 0; i < CHUNKS; i++)
+        if (track.chunk[i].p_sample_count_dts != NULL)
+            loaded++;
+    assert(loaded <= 2 * 32 + 1);
+    assert(track.chunk[0].p_sample_count_dts == NULL);
+
+    /* the current chunk is kept when seeking far from it */
+    track.i_chunk = 10;
+    assert(MP4_ChunkTimes_Load(obj, &track, 10) == VLC_SUCCESS);
+    assert(MP4_ChunkTimes_Load(obj, &track, 11) == VLC_SUCCESS);
+    assert(MP4_ChunkTimes_Load(obj, &track, 150) == VLC_SUCCESS);
+    CheckChunkTimes(&track, 10);
+    CheckChunkTimes(&track, 150);
+    assert(track.chunk[11].p_sample_count_dts == NULL);
+    assert(track.chunk[CHUNKS - 1].p_sample_count_dts == NULL);
+
+    CleanTrack(&track);
+}
+
+static void test_index_roundtrip(vlc_object_t *obj, const char *dir)
+{
+    char path[256];
+    snprintf(path, sizeof (path), "%s/media.mp4", dir);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    assert(fd != -1);
+    assert(write(fd, "mp4", 3) == 3);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    const struct timespec indexed[2] = { { 1000, 1 }, { 1000, 1 } };
+    assert(futimens(fd, indexed) == 0);
+#endif
+    close(fd);
+
+    /* a valid track, and one with more chunks samples than samples */
+    mp4_track_t tracks[2];
+    SetupTrack(&tracks[0], 1);
+    SetupTrack(&tracks[1], 2);
+    tracks[1].i_sample_count = samples - 1;
+    tracks[1].tables.i_sizes_count = samples - 1;
+    assert(MP4_SampleIndex_Write(obj, path, tracks, 2) == VLC_SUCCESS);
+
+    mp4_sample_index_t *index = MP4_SampleIndex_Open(obj, path);
+    assert(index != NULL);
+
+    mp4_track_t track = { .i_track_ID = 1 };
+    assert(MP4_SampleIndex_SetupTrack(index, &track) == VLC_SUCCESS);
+    assert(track.i_chunk_count == CHUNKS);
+    assert(track.i_sample_count == samples);
+    assert(track.i_sample_size == 0);
+    assert(track.tables.i_sizes_count == samples);
+    assert(!memcmp(track.p_sample_size, sizes, samples * sizeof (*sizes)));
+    assert(track.tables.i_stts_count == STTS);
+    assert(!memcmp(track.tables.p_stts_count, stts_count, sizeof (stts_count)));
+    assert(!memcmp(track.tables.p_stts_delta, stts_delta, sizeof (stts_delta)));
+    assert(track.tables.i_ctts_count == CTTS);
+    assert(!memcmp(track.tables.p_ctts_count, ctts_count, sizeof (ctts_count)));
+    assert(!memcmp(track.tables.p_ctts_offset, ctts_offset, sizeof (ctts_offset)));
+    assert(track.tables.i_cts_shift == 20);
+
+    for (unsigned i = 0; i < CHUNKS; i++)
+    {
+        const mp4_chunk_t *a = &tracks[0].chunk[i], *b = &track.chunk[i];
+        assert(a->i_offset == b->i_offset);
+        assert(a->i_first_dts == b->i_first_dts);
+        assert(a->i_duration == b->i_duration);
+        assert(a->i_sample_description_index == b->i_sample_description_index);
+        assert(a->i_sample_count == b->i_sample_count);
+        assert(a->i_sample_first == b->i_sample_first);
+        assert(a->i_entries_dts == b->i_entries_dts);
+        assert(a->i_entries_pts == b->i_entries_pts);
+        assert(a->i_stts_index == b->i_stts_index);
+        assert(a->i_stts_left == b->i_stts_left);
+        assert(a->i_ctts_index == b->i_ctts_index);
+        assert(a->i_ctts_left == b->i_ctts_left);
+    }
+
+    /* the times tables are loaded from the index just the same */
+    for (unsigned i = 0; i < CHUNKS; i++)
+    {
+        track.i_chunk = i;
+        assert(MP4_ChunkTimes_Load(obj, &track, i) == VLC_SUCCESS);
+        CheckChunkTimes(&track, i);
+    }
+    CleanTrack(&track);
+
+    /* the chunks of the second track go past its samples */
+    track = (mp4_track_t) { .i_track_ID = 2 };
+    assert(MP4_SampleIndex_SetupTrack(index, &track) != VLC_SUCCESS);
+    free(track.chunk);
+
+    /* not indexed */
+    track = (mp4_track_t) { .i_track_ID = 3 };
+    assert(MP4_SampleIndex_SetupTrack(index, &track) != VLC_SUCCESS);
+
+    MP4_SampleIndex_Close(index);
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    /* a file rewritten within the same second is not the indexed one */
+    const struct timespec modified[2] = { { 1000, 2 }, { 1000, 2 } };
+    assert(utimensat(AT_FDCWD, path, modified, 0) == 0);
+    assert(MP4_SampleIndex_Open(obj, path) == NULL);
+#endif
+
+    CleanTrack(&tracks[0]);
+    CleanTrack(&tracks[1]);
+    unlink(path);
+}
+
+/* Boxes writer for the deferred tables test */
+static uint8_t file[512];
+static size_t file_size;
+
+static void Put32(uint32_t v)
+{
+    assert(file_size + 4 <= sizeof (file));
+    SetDWBE(&file[file_size], v);
+    file_size += 4;
+}
+
+static size_t BoxOpen(const char *type)
+{
+    size_t pos = file_size;
+    Put32(0);
+    memcpy(&file[file_size], type, 4);
+    file_size += 4;
+    return pos;
+}
+
+static void BoxClose(size_t pos)
+{
+    SetDWBE(&file[pos], file_size - pos);
+}
+
+static void PutTrack(uint32_t stco_count)
+{
+    size_t trak = BoxOpen("trak");
+    size_t mdia = BoxOpen("mdia");
+    size_t minf = BoxOpen("minf");
+    size_t stbl = BoxOpen("stbl");
+
+    size_t box = BoxOpen("stsc");
+    Put32(0); /* version and flags */
+    Put32(1);
+    Put32(1); Put32(1); Put32(1);
+    BoxClose(box);
+
+    /* only one offset, whatever the entries count */
+    box = BoxOpen("stco");
+    Put32(0);
+    Put32(stco_count);
+    Put32(1000);
+    BoxClose(box);
+
+    BoxClose(stbl);
+    BoxClose(minf);
+    BoxClose(mdia);
+    BoxClose(trak);
+}
+
+static const MP4_Box_t *GetTrackTables(const MP4_Box_t *root, unsigned i)
+{
+    return MP4_BoxGet(root, "moov/trak[%u]/mdia/minf/stbl", i);
+}
+
+/* a track whose tables fail to load can't be left with empty tables,
+ * while the tables of the other tracks are still deferred */
+static void test_deferred_tables(vlc_object_t *obj)
+{
+    file_size = 0;
+    size_t moov = BoxOpen("moov");
+    PutTrack(1);
+    PutTrack(10); /* corrupted */
+    BoxClose(moov);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, file, file_size, true);
+    assert(s != NULL);
+    MP4_Box_t *root = MP4_BoxGetRootDeferred(s);
+    assert(root != NULL);
+
+    MP4_Box_t *stbl = (MP4_Box_t *) GetTrackTables(root, 1);
+    assert(stbl != NULL);
+    const MP4_Box_t *p_co64 = MP4_BoxGet(stbl, "stco");
+    assert(p_co64 != NULL && (p_co64->e_flags & BOX_FLAG_DEFERRED));
+    assert(BOXDATA(p_co64) == NULL);
+
+    /* the corrupted table is dropped, the valid one is loaded */
+    assert(MP4_BoxLoadDeferred(s, stbl) != VLC_SUCCESS);
+    assert(MP4_BoxGet(stbl, "stco") == NULL);
+    const MP4_Box_t *p_stsc = MP4_BoxGet(stbl, "stsc");
+    assert(p_stsc != NULL && !(p_stsc->e_flags & BOX_FLAG_DEFERRED));
+    assert(BOXDATA(p_stsc) != NULL && BOXDATA(p_stsc)->i_entry_count == 1);
+    assert(stbl->p_last == p_stsc);
+
+    /* the other track loads after it */
+    stbl = (MP4_Box_t *) GetTrackTables(root, 0);
+    assert(MP4_BoxLoadDeferred(s, stbl) == VLC_SUCCESS);
+    p_co64 = MP4_BoxGet(stbl, "stco");
+    assert(p_co64 != NULL && BOXDATA(p_co64) != NULL);
+    assert(BOXDATA(p_co64)->i_entry_count == 1);
+    assert(BOXDATA(p_co64)->i_chunk_offset[0] == 1000);
+
+    MP4_BoxFree(root);
+    vlc_stream_Delete(s);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-mp4index-XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+    /* the index is written in the user cache directory */
+    setenv("XDG_CACHE_HOME", dir, 1);
+
+    libvlc_instance_t *vlc = libvlc_new(0, NULL);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    BuildTables();
+    test_next_run();
+    test_lazy_chunk_times(obj);
+    test_index_roundtrip(obj, dir);
+    test_deferred_tables(obj);
+
+    libvlc_release(vlc);
+    free(sizes);
+    free(sample_delta);
+    free(sample_offset);
+    return 0;
+}
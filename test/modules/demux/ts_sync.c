@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * ts_sync.c: TS packet headers scanning tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/demux/mpeg/ts_sync.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKETS 4096
+
+typedef size_t (*scan_fn)(const uint8_t *, size_t, size_t, uint16_t *, uint8_t *);
+
+static void Generate(uint8_t *p, size_t stride, size_t header, size_t count)
+{
+    unsigned seed = 42;
+    memset(p, 0, stride * count);
+    for(size_t i=0; i<count; i++)
+    {
+        uint8_t *pkt = &p[i * stride + header];
+        seed = seed * 1103515245 + 12345;
+        pkt[0] = 0x47;
+        pkt[1] = (seed >> 8) & 0xFF;
+        pkt[2] = (seed >> 16) & 0xFF;
+        pkt[3] = (seed >> 24) & 0xFF;
+        pkt[4] = seed & 0xFF;
+    }
+}
+
+static int Compare(const char *name, scan_fn scan,
+                   const uint8_t *p, size_t stride, size_t count)
+{
+    uint16_t refpid[PACKETS], pid[PACKETS];
+    uint8_t refflags[PACKETS], flags[PACKETS];
+
+    size_t ref = ts_sync_ScanHeaders_C(p, stride, count, refpid, refflags);
+    size_t ret = scan(p, stride, count, pid, flags);
+    if(ret != ref ||
+       memcmp(refpid, pid, ref * sizeof(*pid)) ||
+       memcmp(refflags, flags, ref))
+    {
+        fprintf(stderr, "%s: mismatch (stride %zu, %zu/%zu)\n",
+                name, stride, ret, ref);
+        return 1;
+    }
+    return 0;
+}
+
+static int Check(const char *name, scan_fn scan)
+{
+    static const size_t strides[] = { 188, 192, 204 };
+    uint8_t *p = malloc(204 * PACKETS);
+    if(!p)
+        return 1;
+
+    for(size_t s=0; s<ARRAY_SIZE(strides); s++)
+    {
+        const size_t header = strides[s] == 192 ? 4 : 0;
+        Generate(p, strides[s], header, PACKETS);
+
+        /* all partial lengths */
+        for(size_t count=0; count<=17; count++)
+            if(Compare(name, scan, &p[header], strides[s], count))
+                goto error;
+
+        /* lost sync at every position of a vector */
+        for(size_t lost=0; lost<17; lost++)
+        {
+            p[lost * strides[s] + header] = 0x46;
+            if(Compare(name, scan, &p[header], strides[s], 17))
+                goto error;
+            p[lost * strides[s] + header] = 0x47;
+        }
+
+        if(Compare(name, scan, &p[header], strides[s], PACKETS))
+            goto error;
+    }
+
+    /* bench */
+    Generate(p, 188, 0, PACKETS);
+    uint16_t pid[PACKETS];
+    uint8_t flags[PACKETS];
+    const unsigned loops = 2000;
+    vlc_tick_t start = vlc_tick_now();
+    for(unsigned i=0; i<loops; i++)
+        if(scan(p, 188, PACKETS, pid, flags) != PACKETS)
+            goto error;
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    if(elapsed > 0)
+        printf("%s: %.1f Mpackets/s\n", name,
+               (double) loops * PACKETS / US_FROM_VLC_TICK(elapsed));
+
+    free(p);
+    return 0;
+
+error:
+    free(p);
+    return 1;
+}
+
+int main(void)
+{
+    if(Check("C", ts_sync_ScanHeaders_C))
+        return 1;
+#if defined(HAVE_SSE2_INTRINSICS)
+    if(vlc_CPU_SSE2() && Check("SSE2", ts_sync_ScanHeaders_SSE2))
+        return 1;
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if(vlc_CPU_AVX2() && Check("AVX2", ts_sync_ScanHeaders_AVX2))
+        return 1;
+#endif
+#if defined(__ARM_NEON)
+    if(vlc_CPU_ARM_NEON() && Check("NEON", ts_sync_ScanHeaders_NEON))
+        return 1;
+#endif
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*****************************************************************************
+ * lru_cache.c: freetype LRU cache tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+
+#include "../../../modules/text_renderer/freetype/lru_cache.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* values are malloc'ed ints, their releases are recorded in order */
+static int freed[4096];
+static size_t freed_count;
+
+static void FreeValue(void *value)
+{
+    int *v = value;
+    assert(freed_count < ARRAY_SIZE(freed));
+    freed[freed_count++] = *v;
+    free(v);
+}
+
+static int Put(lru_cache_t *cache, int key)
+{
+    int *value = malloc(sizeof (*value));
+    assert(value != NULL);
+    *value = key;
+    return LRUCachePut(cache, &key, sizeof (key), value);
+}
+
+static int Get(lru_cache_t *cache, int key)
+{
+    const int *value = LRUCacheGet(cache, &key, sizeof (key));
+    return value != NULL ? *value : -1;
+}
+
+static void test_eviction_order(void)
+{
+    lru_cache_stats_t stats;
+    lru_cache_t *cache = LRUCacheNew(3, FreeValue);
+    assert(cache != NULL);
+    freed_count = 0;
+
+    for (int i = 0; i < 3; i++)
+        assert(Put(cache, i) == VLC_SUCCESS);
+    assert(freed_count == 0);
+
+    /* 0 becomes the most recently used, 1 the least */
+    assert(Get(cache, 0) == 0);
+    assert(Put(cache, 3) == VLC_SUCCESS);
+    assert(freed_count == 1 && freed[0] == 1);
+    assert(Get(cache, 1) == -1);
+
+    /* 2 is now the least recently used */
+    assert(Put(cache, 4) == VLC_SUCCESS);
+    assert(freed_count == 2 && freed[1] == 2);
+
+    assert(Get(cache, 0) == 0);
+    assert(Get(cache, 3) == 3);
+    assert(Get(cache, 4) == 4);
+
+    /* 0 was used before 3 and 4 */
+    assert(Put(cache, 5) == VLC_SUCCESS);
+    assert(freed_count == 3 && freed[2] == 0);
+
+    LRUCacheGetStats(cache, &stats);
+    assert(stats.i_hits == 4);
+    assert(stats.i_misses == 1);
+    assert(stats.i_evictions == 3);
+    assert(stats.i_entries == 3);
+
+    LRUCacheFlush(cache);
+    assert(freed_count == 6);
+    LRUCacheGetStats(cache, &stats);
+    assert(stats.i_entries == 0);
+    assert(Get(cache, 5) == -1);
+
+    LRUCacheDelete(cache);
+}
+
+static void test_size_bound(void)
+{
+    lru_cache_stats_t stats;
+    lru_cache_t *cache = LRUCacheNew(100, FreeValue);
+    assert(cache != NULL);
+    freed_count = 0;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        assert(Put(cache, i) == VLC_SUCCESS);
+        LRUCacheGetStats(cache, &stats);
+        assert(stats.i_entries == (size_t) __MIN(i + 1, 100));
+    }
+
+    /* only the last ones remain, the others were evicted in order */
+    assert(freed_count == 900);
+    for (int i = 0; i < 900; i++)
+    {
+        assert(freed[i] == i);
+        assert(Get(cache, i) == -1);
+    }
+    for (int i = 900; i < 1000; i++)
+        assert(Get(cache, i) == i);
+
+    LRUCacheGetStats(cache, &stats);
+    assert(stats.i_evictions == 900);
+    assert(stats.i_entries == 100);
+
+    /* keys of different sizes never match */
+    short shortkey = 950;
+    assert(LRUCacheGet(cache, &shortkey, sizeof (shortkey)) == NULL);
+
+    LRUCacheDelete(cache);
+    assert(freed_count == 1000);
+}
+
+int main(void)
+{
+    test_eviction_order();
+    test_size_bound();
+    return 0;
+}
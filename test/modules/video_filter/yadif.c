@@ -0,0 +1,148 @@
+/*****************************************************************************
+ * yadif.c: yadif deinterlacer line filters tests
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_tick.h>
+
+#include "../../../modules/video_filter/deinterlace/common.h"
+#include "../../../modules/video_filter/deinterlace/yadif.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 1080 lines of 1920 pixels, with margins for the -3/+3 neighbours */
+#define WIDTH  1920
+#define LINES  5
+#define MARGIN 32
+#define PITCH  (2 * (WIDTH + 2 * MARGIN))
+
+typedef void (*filter_fn)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                          int, int, int, int, int);
+
+struct planes
+{
+    uint8_t *prev, *cur, *next;
+    uint8_t *ref, *dst;
+};
+
+static void Generate(uint8_t *p, size_t size, unsigned *seed, unsigned max)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        *seed = *seed * 1103515245 + 12345;
+        /* mostly smooth data, with some noise, to go through all the
+         * branches of the spatial checks */
+        p[i] = (i & 0x3F) < 48 ? ((*seed >> 16) & max) : ((i >> 2) & max);
+    }
+}
+
+static int Compare(const char *name, filter_fn ref, filter_fn filter,
+                   const struct planes *p, int pixel_size)
+{
+    /* middle line of the planes */
+    const size_t offset = 2 * PITCH + MARGIN * pixel_size;
+
+    for (int w = 1; w <= WIDTH; w += w < 64 ? 1 : 61)
+    for (int parity = 0; parity < 2; parity++)
+    for (int mode = 0; mode <= 2; mode += 2)
+    for (int edge = 0; edge < 3; edge++)
+    {
+        /* same references as RenderYadif() for the first, last and
+         * other lines */
+        int prefs = edge == 2 ? -PITCH : PITCH;
+        int mrefs = edge == 1 ? PITCH : -PITCH;
+
+        memset(p->ref, 0xA5, LINES * PITCH);
+        memset(p->dst, 0xA5, LINES * PITCH);
+        ref(p->ref + offset, p->prev + offset, p->cur + offset,
+            p->next + offset, w, prefs, mrefs, parity, mode);
+        filter(p->dst + offset, p->prev + offset, p->cur + offset,
+               p->next + offset, w, prefs, mrefs, parity, mode);
+        if (memcmp(p->ref, p->dst, LINES * PITCH))
+        {
+            fprintf(stderr, "%s: mismatch (width %d, parity %d, mode %d)\n",
+                    name, w, parity, mode);
+            return 1;
+        }
+    }
+
+    /* bench: one 1080 lines field */
+    const unsigned loops = 540 * 20;
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < loops; i++)
+        filter(p->dst + offset, p->prev + offset, p->cur + offset,
+               p->next + offset, WIDTH, PITCH, -PITCH, i & 1, 0);
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    if (elapsed > 0)
+        printf("%s: %.1f 1080i fields/s\n", name,
+               (double) loops / 540 * CLOCK_FREQ / elapsed);
+    return 0;
+}
+
+static int Check(const char *name, filter_fn ref, filter_fn filter,
+                 int pixel_size)
+{
+    struct planes p;
+    unsigned seed = 42;
+    int ret = 1;
+
+    p.prev = malloc(LINES * PITCH);
+    p.cur = malloc(LINES * PITCH);
+    p.next = malloc(LINES * PITCH);
+    p.ref = malloc(LINES * PITCH);
+    p.dst = malloc(LINES * PITCH);
+    if (!p.prev || !p.cur || !p.next || !p.ref || !p.dst)
+        goto end;
+
+    Generate(p.prev, LINES * PITCH, &seed, 0xFF);
+    Generate(p.cur, LINES * PITCH, &seed, 0xFF);
+    Generate(p.next, LINES * PITCH, &seed, 0xFF);
+
+    ret = Compare(name, ref, filter, &p, pixel_size);
+end:
+    free(p.prev);
+    free(p.cur);
+    free(p.next);
+    free(p.ref);
+    free(p.dst);
+    return ret;
+}
+
+int main(void)
+{
+    if (Check("C", yadif_filter_line_c, yadif_filter_line_c, 1))
+        return 1;
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2())
+    {
+        if (Check("AVX2", yadif_filter_line_c, yadif_filter_line_avx2, 1))
+            return 1;
+        if (Check("AVX2 16-bit", yadif_filter_line_c_16bit,
+                  yadif_filter_line_avx2_16bit, 2))
+            return 1;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * filter_chain.c: test for the converter hints of the filter chains
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#define MODULE_NAME test_src_misc_filter_chain
+#define MODULE_STRING "test_src_misc_filter_chain"
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+/* Two converters between private chromas, ranked above all the others */
+#define CHROMA_IN  VLC_FOURCC('T','S','T','i')
+#define CHROMA_OUT VLC_FOURCC('T','S','T','o')
+
+struct converter
+{
+    unsigned probes;
+    unsigned uses;
+    unsigned reject_width; /* fails for this input width (0: never) */
+    bool reject_full_range; /* fails for full range input */
+};
+
+static struct converter high, low;
+
+static picture_t *Filter(filter_t *filter, picture_t *pic)
+{
+    (void) filter;
+    return pic;
+}
+
+static int Open(filter_t *filter, struct converter *conv)
+{
+    if (filter->fmt_in.video.i_chroma != CHROMA_IN
+     || filter->fmt_out.video.i_chroma != CHROMA_OUT)
+        return VLC_EGENERIC;
+
+    conv->probes++;
+    if (filter->fmt_in.video.i_width == conv->reject_width)
+        return VLC_EGENERIC;
+    if (filter->fmt_in.video.color_range == COLOR_RANGE_FULL
+     && conv->reject_full_range)
+        return VLC_EGENERIC;
+
+    conv->uses++;
+    filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+static int OpenHigh(vlc_object_t *obj)
+{
+    return Open((filter_t *)obj, &high);
+}
+
+static int OpenLow(vlc_object_t *obj)
+{
+    return Open((filter_t *)obj, &low);
+}
+
+vlc_module_begin()
+    set_capability("video converter", 1000001)
+    set_callback(OpenHigh)
+    add_submodule()
+    set_capability("video converter", 1000000)
+    set_callback(OpenLow)
+vlc_module_end()
+
+typedef int (*vlc_plugin_cb)(int (*)(void *, void *, int, ...), void *);
+
+VLC_EXPORT vlc_plugin_cb vlc_static_modules[] = {
+    VLC_SYMBOL(vlc_entry), NULL
+};
+
+static void Reset(void)
+{
+    high.probes = high.uses = 0;
+    low.probes = low.uses = 0;
+}
+
+static int ConvertRange(vlc_object_t *obj, unsigned width,
+                        video_color_range_t range)
+{
+    es_format_t in, out;
+
+    es_format_Init(&in, VIDEO_ES, CHROMA_IN);
+    video_format_Setup(&in.video, CHROMA_IN, width, 480, width, 480, 1, 1);
+    in.video.color_range = range;
+    es_format_Init(&out, VIDEO_ES, CHROMA_OUT);
+    video_format_Setup(&out.video, CHROMA_OUT, width, 480, width, 480, 1, 1);
+
+    filter_chain_t *chain = filter_chain_NewVideo(obj, false, NULL);
+    assert(chain != NULL);
+    filter_chain_Reset(chain, &in, NULL, &out);
+    int ret = filter_chain_AppendConverter(chain, &out);
+    filter_chain_Delete(chain);
+
+    es_format_Clean(&in);
+    es_format_Clean(&out);
+    return ret;
+}
+
+static int Convert(vlc_object_t *obj, unsigned width)
+{
+    return ConvertRange(obj, width, COLOR_RANGE_UNDEF);
+}
+
+static void test_hints(vlc_object_t *obj)
+{
+    /* the higher converter rejects 640 pixels wide pictures */
+    high.reject_width = 640;
+    low.reject_width = 0;
+
+    Reset();
+    assert(Convert(obj, 640) == 0);
+    assert(high.probes == 1 && high.uses == 0);
+    assert(low.probes == 1 && low.uses == 1);
+
+    /* the same conversion skips the higher converter */
+    Reset();
+    assert(Convert(obj, 640) == 0);
+    assert(high.probes == 0);
+    assert(low.probes == 1 && low.uses == 1);
+
+    /* another size is another request, the hint does not apply */
+    Reset();
+    assert(Convert(obj, 1280) == 0);
+    assert(high.probes == 1 && high.uses == 1);
+    assert(low.probes == 0);
+
+    Reset();
+    assert(Convert(obj, 1280) == 0);
+    assert(high.probes == 1 && high.uses == 1);
+    assert(low.probes == 0);
+
+    /* the higher converter recovers: the hint does not keep outranking it */
+    high.reject_width = 0;
+    Reset();
+    for (unsigned i = 0; i < 64 && high.uses == 0; i++)
+        assert(Convert(obj, 640) == 0);
+    assert(high.uses == 1);
+
+    Reset();
+    assert(Convert(obj, 640) == 0);
+    assert(high.uses == 1);
+    assert(low.probes == 0);
+
+    /* a failing hint falls back to the score order */
+    low.reject_width = 1280;
+    high.reject_width = 1280;
+    Reset();
+    assert(Convert(obj, 1280) != 0);
+    assert(high.probes == 1 && low.probes == 1);
+}
+
+static void test_hints_colorimetry(vlc_object_t *obj)
+{
+    /* the higher converter rejects full range pictures */
+    high.reject_width = low.reject_width = 0;
+    high.reject_full_range = true;
+
+    Reset();
+    assert(ConvertRange(obj, 320, COLOR_RANGE_FULL) == 0);
+    assert(high.probes == 1 && high.uses == 0);
+    assert(low.uses == 1);
+
+    Reset();
+    assert(ConvertRange(obj, 320, COLOR_RANGE_FULL) == 0);
+    assert(high.probes == 0 && low.uses == 1);
+
+    /* the same size with another range is another request */
+    Reset();
+    assert(ConvertRange(obj, 320, COLOR_RANGE_LIMITED) == 0);
+    assert(high.probes == 1 && high.uses == 1);
+    assert(low.probes == 0);
+
+    high.reject_full_range = false;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    /* the static modules are only looked up on ELF platforms */
+    if (!module_exists(MODULE_STRING))
+    {
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    test_hints(obj);
+    test_hints_colorimetry(obj);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*****************************************************************************
+ * filter_slices.c: test for the video filters slice threads
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_tick.h>
+
+#define UNITS 1087
+
+struct count_ctx
+{
+    atomic_uint hits[UNITS];
+};
+
+static void Count(void *opaque, unsigned start, unsigned end)
+{
+    struct count_ctx *ctx = opaque;
+
+    assert(start < end && end <= UNITS);
+    for (unsigned i = start; i < end; i++)
+        atomic_fetch_add(&ctx->hits[i], 1);
+}
+
+static void CheckRun(vlc_filter_slices_t *pool, unsigned count)
+{
+    struct count_ctx ctx;
+
+    for (unsigned i = 0; i < UNITS; i++)
+        atomic_init(&ctx.hits[i], 0);
+
+    vlc_filter_slices_Run(pool, count, Count, &ctx);
+
+    /* every unit is processed exactly once */
+    for (unsigned i = 0; i < UNITS; i++)
+        assert(atomic_load(&ctx.hits[i]) == (i < count ? 1 : 0));
+}
+
+static void *Concurrent(void *data)
+{
+    vlc_filter_slices_t *pool = data;
+
+    for (unsigned i = 0; i < 200; i++)
+        CheckRun(pool, UNITS - i);
+    return NULL;
+}
+
+/* 4K I420 picture, processed like a lookup table based filter */
+#define WIDTH  3840
+#define HEIGHT 2160
+
+struct bench_ctx
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    uint8_t lut[256];
+};
+
+static void Lut(void *opaque, unsigned start, unsigned end)
+{
+    const struct bench_ctx *ctx = opaque;
+
+    for (unsigned y = start; y < end; y++)
+    {
+        const uint8_t *src = &ctx->src[y * WIDTH];
+        uint8_t *dst = &ctx->dst[y * WIDTH];
+
+        for (unsigned x = 0; x < WIDTH; x++)
+            dst[x] = ctx->lut[src[x]];
+    }
+}
+
+static double Bench(vlc_filter_slices_t *pool, struct bench_ctx *ctx)
+{
+    const unsigned frames = 20;
+    const unsigned lines = HEIGHT * 3 / 2;
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned i = 0; i < frames; i++)
+        vlc_filter_slices_Run(pool, lines, Lut, ctx);
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    return elapsed > 0 ? (double) frames * CLOCK_FREQ / elapsed : 0.;
+}
+
+static void test_slices(libvlc_int_t *obj)
+{
+    var_Create(obj, "video-filter-threads", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "video-filter-threads", 4);
+
+    vlc_filter_slices_t *pool = vlc_filter_slices_Hold(obj);
+    assert(pool != NULL);
+    /* the pool is shared */
+    vlc_filter_slices_t *other = vlc_filter_slices_Hold(obj);
+    assert(other == pool);
+    vlc_filter_slices_Release(other);
+
+    /* one pool per parent, like video outputs with their filters */
+    vlc_object_t *vout1 = vlc_object_create(obj, sizeof (*vout1));
+    vlc_object_t *vout2 = vlc_object_create(obj, sizeof (*vout2));
+    vlc_object_t *filter1a = vlc_object_create(vout1, sizeof (*filter1a));
+    vlc_object_t *filter1b = vlc_object_create(vout1, sizeof (*filter1b));
+    vlc_object_t *filter2 = vlc_object_create(vout2, sizeof (*filter2));
+    assert(vout1 && vout2 && filter1a && filter1b && filter2);
+
+    vlc_filter_slices_t *pool1a = vlc_filter_slices_Hold(filter1a);
+    vlc_filter_slices_t *pool1b = vlc_filter_slices_Hold(filter1b);
+    vlc_filter_slices_t *pool2 = vlc_filter_slices_Hold(filter2);
+    assert(pool1a != NULL && pool2 != NULL);
+    assert(pool1a == pool1b);
+    assert(pool1a != pool2 && pool1a != pool && pool2 != pool);
+    vlc_filter_slices_Release(pool1b);
+    vlc_filter_slices_Release(pool2);
+
+    /* the video outputs do not compete for the same threads */
+    vlc_thread_t th1;
+    int ret = vlc_clone(&th1, Concurrent, pool1a, VLC_THREAD_PRIORITY_LOW);
+    assert(ret == 0);
+    Concurrent(pool);
+    vlc_join(th1, NULL);
+    vlc_filter_slices_Release(pool1a);
+
+    vlc_object_delete(filter2);
+    vlc_object_delete(filter1b);
+    vlc_object_delete(filter1a);
+    vlc_object_delete(vout2);
+    vlc_object_delete(vout1);
+
+    CheckRun(NULL, UNITS);
+    for (unsigned count = 0; count <= 70; count++)
+        CheckRun(pool, count);
+    CheckRun(pool, UNITS);
+
+    /* two filters running at the same time */
+    vlc_thread_t th;
+    ret = vlc_clone(&th, Concurrent, pool, VLC_THREAD_PRIORITY_LOW);
+    assert(ret == 0);
+    Concurrent(pool);
+    vlc_join(th, NULL);
+
+    struct bench_ctx ctx;
+    uint8_t *src = malloc(WIDTH * HEIGHT * 3 / 2);
+    uint8_t *dst = malloc(WIDTH * HEIGHT * 3 / 2);
+    assert(src != NULL && dst != NULL);
+    memset(src, 0x80, WIDTH * HEIGHT * 3 / 2);
+    for (unsigned i = 0; i < 256; i++)
+        ctx.lut[i] = 255 - i;
+    ctx.src = src;
+    ctx.dst = dst;
+
+    double single = Bench(NULL, &ctx);
+    double sliced = Bench(pool, &ctx);
+    test_log("4K planar filter: %.1f fps single threaded, %.1f fps sliced\n",
+             single, sliced);
+    assert(dst[WIDTH * HEIGHT * 3 / 2 - 1] == 0x7F);
+
+    free(src);
+    free(dst);
+    vlc_filter_slices_Release(pool);
+
+    /* slice threading disabled */
+    var_SetInteger(obj, "video-filter-threads", 1);
+    pool = vlc_filter_slices_Hold(obj);
+    assert(pool == NULL);
+    CheckRun(pool, UNITS);
+
+    var_Destroy(obj, "video-filter-threads");
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_slices(vlc->p_libvlc_int);
+
+    libvlc_release(vlc);
+    return 0;
+}